@@ -3030,6 +3030,52 @@ void amd64g_dirtyhelper_SxDT ( void *address, ULong op ) {
 #  endif
 }
 
+
+/* CALLED FROM GENERATED CODE */
+/* DIRTY HELPER (reads guest state, writes guest state, reads and
+   writes guest memory) */
+/* Do a run of iterations of REP MOVS, STOS, CMPS or SCAS (op is one
+   of the X86AMD64_REP_ values), on szB byte elements, with 32-bit
+   addressing if addr32.  RCX must be nonzero.  CMPS and SCAS stop
+   early as REPE does if whileEq, as REPNE does otherwise.  Leaves
+   RCX, RSI, RDI and, for CMPS and SCAS, the flags thunk as the
+   iterations done so far would have; returns 1 if the insn is not
+   yet finished and must be run again. */
+ULong amd64g_dirtyhelper_REP ( VexGuestAMD64State* gst, ULong op,
+                               ULong szB, ULong whileEq, ULong addr32 )
+{
+   /* Give the dispatcher a look-in every so many pages. */
+   const Int maxChunks = 64;
+   X86AMD64RepState st;
+   ULong mask = addr32 ? 0xFFFFFFFFULL : ~0ULL;
+   Bool  down = gst->guest_DFLAG != 1;
+   Bool  more;
+   Int   i;
+
+   st.cx = gst->guest_RCX & mask;
+   st.si = gst->guest_RSI & mask;
+   st.di = gst->guest_RDI & mask;
+   st.ax = gst->guest_RAX;
+   for (i = 0; ; i++) {
+      more = x86amd64g_rep_chunk( &st, (UInt)op, (UInt)szB, down,
+                                  whileEq != 0, mask );
+      gst->guest_RCX = st.cx;
+      gst->guest_RDI = st.di;
+      if (op == X86AMD64_REP_MOVS || op == X86AMD64_REP_CMPS)
+         gst->guest_RSI = st.si;
+      if (op == X86AMD64_REP_CMPS || op == X86AMD64_REP_SCAS) {
+         gst->guest_CC_OP   = AMD64G_CC_OP_SUBB
+                              + (szB == 1 ? 0 : szB == 2 ? 1 : szB == 4 ? 2 : 3);
+         gst->guest_CC_DEP1 = st.dep1;
+         gst->guest_CC_DEP2 = st.dep2;
+      }
+      if (!more || st.cx == 0)
+         return 0;
+      if (i == maxChunks-1)
+         return 1;
+   }
+}
+
 /*---------------------------------------------------------------*/
 /*--- Helpers for MMX/SSE/SSE2.                               ---*/
 /*---------------------------------------------------------------*/
@@ -3139,41 +3185,27 @@ ULong amd64g_calculate_sse_phminposuw ( ULong sLo, ULong sHi )
 /* CALLED FROM GENERATED CODE: CLEAN HELPER */
 ULong amd64g_calc_crc32b ( ULong crcIn, ULong b )
 {
-   UInt  i;
-   ULong crc = (b & 0xFFULL) ^ crcIn;
-   for (i = 0; i < 8; i++)
-      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78ULL : 0);
-   return crc;
+   return x86amd64g_calc_crc32c((UInt)crcIn, b, 1);
 }
 
 /* CALLED FROM GENERATED CODE: CLEAN HELPER */
 ULong amd64g_calc_crc32w ( ULong crcIn, ULong w )
 {
-   UInt  i;
-   ULong crc = (w & 0xFFFFULL) ^ crcIn;
-   for (i = 0; i < 16; i++)
-      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78ULL : 0);
-   return crc;
+   return x86amd64g_calc_crc32c((UInt)crcIn, w, 2);
 }
 
 /* CALLED FROM GENERATED CODE: CLEAN HELPER */
 ULong amd64g_calc_crc32l ( ULong crcIn, ULong l )
 {
-   UInt i;
-   ULong crc = (l & 0xFFFFFFFFULL) ^ crcIn;
-   for (i = 0; i < 32; i++)
-      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78ULL : 0);
-   return crc;
+   return x86amd64g_calc_crc32c((UInt)crcIn, l, 4);
 }
 
 /* CALLED FROM GENERATED CODE: CLEAN HELPER */
 ULong amd64g_calc_crc32q ( ULong crcIn, ULong q )
 {
-   ULong crc = amd64g_calc_crc32l(crcIn, q);
-   return amd64g_calc_crc32l(crc, q >> 32);
+   return x86amd64g_calc_crc32c((UInt)crcIn, q, 8);
 }
 
-
 /* .. helper for next fn .. */
 static inline ULong sad_8x4 ( ULong xx, ULong yy )
 {
@@ -3455,15 +3487,6 @@ static const UChar sbox[256] = {                   // row nr
    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, //16
    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
 };
-static void SubBytes (V128* v)
-{
-   V128 r;
-   UInt i;
-   for (i = 0; i < 16; i++)
-      r.w8[i] = sbox[v->w8[i]];
-   *v = r;
-}
-
 /* a 16 x 16 matrix */
 static const UChar invsbox[256] = {                // row nr
    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, // 1
@@ -3499,163 +3522,221 @@ static const UChar invsbox[256] = {                // row nr
    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, //16
    0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
 };
-static void InvSubBytes (V128* v)
+/* The full-round tables.  They fold SubBytes and MixColumns (resp.
+   InvSubBytes and InvMixColumns) into one lookup per state byte.
+   aes_Te[x] is the column that a byte x in row 0 turns into, ie
+   { 2.S(x), S(x), S(x), 3.S(x) } with row 0 in the low byte, and
+   aes_Td[x] likewise holds { 14.S'(x), 9.S'(x), 13.S'(x), 11.S'(x) },
+   with S' the inverse sbox.  A byte in row r gives the same column
+   rotated up by r bytes. */
+static const UInt aes_Te[256] = {
+   0xa56363c6, 0x847c7cf8, 0x997777ee, 0x8d7b7bf6,
+   0x0df2f2ff, 0xbd6b6bd6, 0xb16f6fde, 0x54c5c591,
+   0x50303060, 0x03010102, 0xa96767ce, 0x7d2b2b56,
+   0x19fefee7, 0x62d7d7b5, 0xe6abab4d, 0x9a7676ec,
+   0x45caca8f, 0x9d82821f, 0x40c9c989, 0x877d7dfa,
+   0x15fafaef, 0xeb5959b2, 0xc947478e, 0x0bf0f0fb,
+   0xecadad41, 0x67d4d4b3, 0xfda2a25f, 0xeaafaf45,
+   0xbf9c9c23, 0xf7a4a453, 0x967272e4, 0x5bc0c09b,
+   0xc2b7b775, 0x1cfdfde1, 0xae93933d, 0x6a26264c,
+   0x5a36366c, 0x413f3f7e, 0x02f7f7f5, 0x4fcccc83,
+   0x5c343468, 0xf4a5a551, 0x34e5e5d1, 0x08f1f1f9,
+   0x937171e2, 0x73d8d8ab, 0x53313162, 0x3f15152a,
+   0x0c040408, 0x52c7c795, 0x65232346, 0x5ec3c39d,
+   0x28181830, 0xa1969637, 0x0f05050a, 0xb59a9a2f,
+   0x0907070e, 0x36121224, 0x9b80801b, 0x3de2e2df,
+   0x26ebebcd, 0x6927274e, 0xcdb2b27f, 0x9f7575ea,
+   0x1b090912, 0x9e83831d, 0x742c2c58, 0x2e1a1a34,
+   0x2d1b1b36, 0xb26e6edc, 0xee5a5ab4, 0xfba0a05b,
+   0xf65252a4, 0x4d3b3b76, 0x61d6d6b7, 0xceb3b37d,
+   0x7b292952, 0x3ee3e3dd, 0x712f2f5e, 0x97848413,
+   0xf55353a6, 0x68d1d1b9, 0x00000000, 0x2cededc1,
+   0x60202040, 0x1ffcfce3, 0xc8b1b179, 0xed5b5bb6,
+   0xbe6a6ad4, 0x46cbcb8d, 0xd9bebe67, 0x4b393972,
+   0xde4a4a94, 0xd44c4c98, 0xe85858b0, 0x4acfcf85,
+   0x6bd0d0bb, 0x2aefefc5, 0xe5aaaa4f, 0x16fbfbed,
+   0xc5434386, 0xd74d4d9a, 0x55333366, 0x94858511,
+   0xcf45458a, 0x10f9f9e9, 0x06020204, 0x817f7ffe,
+   0xf05050a0, 0x443c3c78, 0xba9f9f25, 0xe3a8a84b,
+   0xf35151a2, 0xfea3a35d, 0xc0404080, 0x8a8f8f05,
+   0xad92923f, 0xbc9d9d21, 0x48383870, 0x04f5f5f1,
+   0xdfbcbc63, 0xc1b6b677, 0x75dadaaf, 0x63212142,
+   0x30101020, 0x1affffe5, 0x0ef3f3fd, 0x6dd2d2bf,
+   0x4ccdcd81, 0x140c0c18, 0x35131326, 0x2fececc3,
+   0xe15f5fbe, 0xa2979735, 0xcc444488, 0x3917172e,
+   0x57c4c493, 0xf2a7a755, 0x827e7efc, 0x473d3d7a,
+   0xac6464c8, 0xe75d5dba, 0x2b191932, 0x957373e6,
+   0xa06060c0, 0x98818119, 0xd14f4f9e, 0x7fdcdca3,
+   0x66222244, 0x7e2a2a54, 0xab90903b, 0x8388880b,
+   0xca46468c, 0x29eeeec7, 0xd3b8b86b, 0x3c141428,
+   0x79dedea7, 0xe25e5ebc, 0x1d0b0b16, 0x76dbdbad,
+   0x3be0e0db, 0x56323264, 0x4e3a3a74, 0x1e0a0a14,
+   0xdb494992, 0x0a06060c, 0x6c242448, 0xe45c5cb8,
+   0x5dc2c29f, 0x6ed3d3bd, 0xefacac43, 0xa66262c4,
+   0xa8919139, 0xa4959531, 0x37e4e4d3, 0x8b7979f2,
+   0x32e7e7d5, 0x43c8c88b, 0x5937376e, 0xb76d6dda,
+   0x8c8d8d01, 0x64d5d5b1, 0xd24e4e9c, 0xe0a9a949,
+   0xb46c6cd8, 0xfa5656ac, 0x07f4f4f3, 0x25eaeacf,
+   0xaf6565ca, 0x8e7a7af4, 0xe9aeae47, 0x18080810,
+   0xd5baba6f, 0x887878f0, 0x6f25254a, 0x722e2e5c,
+   0x241c1c38, 0xf1a6a657, 0xc7b4b473, 0x51c6c697,
+   0x23e8e8cb, 0x7cdddda1, 0x9c7474e8, 0x211f1f3e,
+   0xdd4b4b96, 0xdcbdbd61, 0x868b8b0d, 0x858a8a0f,
+   0x907070e0, 0x423e3e7c, 0xc4b5b571, 0xaa6666cc,
+   0xd8484890, 0x05030306, 0x01f6f6f7, 0x120e0e1c,
+   0xa36161c2, 0x5f35356a, 0xf95757ae, 0xd0b9b969,
+   0x91868617, 0x58c1c199, 0x271d1d3a, 0xb99e9e27,
+   0x38e1e1d9, 0x13f8f8eb, 0xb398982b, 0x33111122,
+   0xbb6969d2, 0x70d9d9a9, 0x898e8e07, 0xa7949433,
+   0xb69b9b2d, 0x221e1e3c, 0x92878715, 0x20e9e9c9,
+   0x49cece87, 0xff5555aa, 0x78282850, 0x7adfdfa5,
+   0x8f8c8c03, 0xf8a1a159, 0x80898909, 0x170d0d1a,
+   0xdabfbf65, 0x31e6e6d7, 0xc6424284, 0xb86868d0,
+   0xc3414182, 0xb0999929, 0x772d2d5a, 0x110f0f1e,
+   0xcbb0b07b, 0xfc5454a8, 0xd6bbbb6d, 0x3a16162c
+};
+
+static const UInt aes_Td[256] = {
+   0x50a7f451, 0x5365417e, 0xc3a4171a, 0x965e273a,
+   0xcb6bab3b, 0xf1459d1f, 0xab58faac, 0x9303e34b,
+   0x55fa3020, 0xf66d76ad, 0x9176cc88, 0x254c02f5,
+   0xfcd7e54f, 0xd7cb2ac5, 0x80443526, 0x8fa362b5,
+   0x495ab1de, 0x671bba25, 0x980eea45, 0xe1c0fe5d,
+   0x02752fc3, 0x12f04c81, 0xa397468d, 0xc6f9d36b,
+   0xe75f8f03, 0x959c9215, 0xeb7a6dbf, 0xda595295,
+   0x2d83bed4, 0xd3217458, 0x2969e049, 0x44c8c98e,
+   0x6a89c275, 0x78798ef4, 0x6b3e5899, 0xdd71b927,
+   0xb64fe1be, 0x17ad88f0, 0x66ac20c9, 0xb43ace7d,
+   0x184adf63, 0x82311ae5, 0x60335197, 0x457f5362,
+   0xe07764b1, 0x84ae6bbb, 0x1ca081fe, 0x942b08f9,
+   0x58684870, 0x19fd458f, 0x876cde94, 0xb7f87b52,
+   0x23d373ab, 0xe2024b72, 0x578f1fe3, 0x2aab5566,
+   0x0728ebb2, 0x03c2b52f, 0x9a7bc586, 0xa50837d3,
+   0xf2872830, 0xb2a5bf23, 0xba6a0302, 0x5c8216ed,
+   0x2b1ccf8a, 0x92b479a7, 0xf0f207f3, 0xa1e2694e,
+   0xcdf4da65, 0xd5be0506, 0x1f6234d1, 0x8afea6c4,
+   0x9d532e34, 0xa055f3a2, 0x32e18a05, 0x75ebf6a4,
+   0x39ec830b, 0xaaef6040, 0x069f715e, 0x51106ebd,
+   0xf98a213e, 0x3d06dd96, 0xae053edd, 0x46bde64d,
+   0xb58d5491, 0x055dc471, 0x6fd40604, 0xff155060,
+   0x24fb9819, 0x97e9bdd6, 0xcc434089, 0x779ed967,
+   0xbd42e8b0, 0x888b8907, 0x385b19e7, 0xdbeec879,
+   0x470a7ca1, 0xe90f427c, 0xc91e84f8, 0x00000000,
+   0x83868009, 0x48ed2b32, 0xac70111e, 0x4e725a6c,
+   0xfbff0efd, 0x5638850f, 0x1ed5ae3d, 0x27392d36,
+   0x64d90f0a, 0x21a65c68, 0xd1545b9b, 0x3a2e3624,
+   0xb1670a0c, 0x0fe75793, 0xd296eeb4, 0x9e919b1b,
+   0x4fc5c080, 0xa220dc61, 0x694b775a, 0x161a121c,
+   0x0aba93e2, 0xe52aa0c0, 0x43e0223c, 0x1d171b12,
+   0x0b0d090e, 0xadc78bf2, 0xb9a8b62d, 0xc8a91e14,
+   0x8519f157, 0x4c0775af, 0xbbdd99ee, 0xfd607fa3,
+   0x9f2601f7, 0xbcf5725c, 0xc53b6644, 0x347efb5b,
+   0x7629438b, 0xdcc623cb, 0x68fcedb6, 0x63f1e4b8,
+   0xcadc31d7, 0x10856342, 0x40229713, 0x2011c684,
+   0x7d244a85, 0xf83dbbd2, 0x1132f9ae, 0x6da129c7,
+   0x4b2f9e1d, 0xf330b2dc, 0xec52860d, 0xd0e3c177,
+   0x6c16b32b, 0x99b970a9, 0xfa489411, 0x2264e947,
+   0xc48cfca8, 0x1a3ff0a0, 0xd82c7d56, 0xef903322,
+   0xc74e4987, 0xc1d138d9, 0xfea2ca8c, 0x360bd498,
+   0xcf81f5a6, 0x28de7aa5, 0x268eb7da, 0xa4bfad3f,
+   0xe49d3a2c, 0x0d927850, 0x9bcc5f6a, 0x62467e54,
+   0xc2138df6, 0xe8b8d890, 0x5ef7392e, 0xf5afc382,
+   0xbe805d9f, 0x7c93d069, 0xa92dd56f, 0xb31225cf,
+   0x3b99acc8, 0xa77d1810, 0x6e639ce8, 0x7bbb3bdb,
+   0x097826cd, 0xf418596e, 0x01b79aec, 0xa89a4f83,
+   0x656e95e6, 0x7ee6ffaa, 0x08cfbc21, 0xe6e815ef,
+   0xd99be7ba, 0xce366f4a, 0xd4099fea, 0xd67cb029,
+   0xafb2a431, 0x31233f2a, 0x3094a5c6, 0xc066a235,
+   0x37bc4e74, 0xa6ca82fc, 0xb0d090e0, 0x15d8a733,
+   0x4a9804f1, 0xf7daec41, 0x0e50cd7f, 0x2ff69117,
+   0x8dd64d76, 0x4db0ef43, 0x544daacc, 0xdf0496e4,
+   0xe3b5d19e, 0x1b886a4c, 0xb81f2cc1, 0x7f516546,
+   0x04ea5e9d, 0x5d358c01, 0x737487fa, 0x2e410bfb,
+   0x5a1d67b3, 0x52d2db92, 0x335610e9, 0x1347d66d,
+   0x8c61d79a, 0x7a0ca137, 0x8e14f859, 0x893c13eb,
+   0xee27a9ce, 0x35c961b7, 0xede51ce1, 0x3cb1477a,
+   0x59dfd29c, 0x3f73f255, 0x79ce1418, 0xbf37c773,
+   0xeacdf753, 0x5baafd5f, 0x146f3ddf, 0x86db4478,
+   0x81f3afca, 0x3ec468b9, 0x2c342438, 0x5f40a3c2,
+   0x72c31d16, 0x0c25e2bc, 0x8b493c28, 0x41950dff,
+   0x7101a839, 0xdeb30c08, 0x9ce4b4d8, 0x90c15664,
+   0x6184cb7b, 0x70b632d5, 0x745c6c48, 0x4257b8d0
+};
+
+/* Byte r of column c of an AES state, laid out as in an XMM register
+   (column c is bytes 4c .. 4c+3).  c is taken mod 4, which does
+   ShiftRows (for c+r) or InvShiftRows (for c-r) on the way in. */
+#define AES_B(_v,_r,_c) ((_v)->w8[4 * ((_c) & 3) + (_r)])
+
+static inline UInt aes_rol32 ( UInt w, UInt n )
 {
-   V128 r;
-   UInt i;
-   for (i = 0; i < 16; i++)
-      r.w8[i] = invsbox[v->w8[i]];
-   *v = r;
+   return (w << n) | (w >> (32 - n));
 }
 
-static const UChar ShiftRows_op[16] =
-   {11, 6, 1, 12, 7, 2, 13, 8, 3, 14, 9, 4, 15, 10, 5, 0};
-static void ShiftRows (V128* v)
+/* ShiftRows, SubBytes and, unless last, MixColumns. */
+static void aes_enc_round ( /*OUT*/V128* res, const V128* st, Bool last )
 {
-   V128 r;
-   UInt i;
-   for (i = 0; i < 16; i++)
-      r.w8[i] = v->w8[ShiftRows_op[15-i]];
-   *v = r;
+   UInt c;
+   for (c = 0; c < 4; c++) {
+      if (last)
+         res->w32[c] = (UInt)sbox[AES_B(st, 0, c)]
+                       | ((UInt)sbox[AES_B(st, 1, c+1)] << 8)
+                       | ((UInt)sbox[AES_B(st, 2, c+2)] << 16)
+                       | ((UInt)sbox[AES_B(st, 3, c+3)] << 24);
+      else
+         res->w32[c] = aes_Te[AES_B(st, 0, c)]
+                       ^ aes_rol32(aes_Te[AES_B(st, 1, c+1)], 8)
+                       ^ aes_rol32(aes_Te[AES_B(st, 2, c+2)], 16)
+                       ^ aes_rol32(aes_Te[AES_B(st, 3, c+3)], 24);
+   }
 }
 
-static const UChar InvShiftRows_op[16] = 
-   {3, 6, 9, 12, 15, 2, 5, 8, 11, 14, 1, 4, 7, 10, 13, 0};
-static void InvShiftRows (V128* v)
-{
-   V128 r;
-   UInt i;
-   for (i = 0; i < 16; i++)
-      r.w8[i] = v->w8[InvShiftRows_op[15-i]];
-   *v = r;
+/* InvShiftRows, InvSubBytes and, unless last, InvMixColumns. */
+static void aes_dec_round ( /*OUT*/V128* res, const V128* st, Bool last )
+{
+   UInt c;
+   for (c = 0; c < 4; c++) {
+      if (last)
+         res->w32[c] = (UInt)invsbox[AES_B(st, 0, c)]
+                       | ((UInt)invsbox[AES_B(st, 1, c-1)] << 8)
+                       | ((UInt)invsbox[AES_B(st, 2, c-2)] << 16)
+                       | ((UInt)invsbox[AES_B(st, 3, c-3)] << 24);
+      else
+         res->w32[c] = aes_Td[AES_B(st, 0, c)]
+                       ^ aes_rol32(aes_Td[AES_B(st, 1, c-1)], 8)
+                       ^ aes_rol32(aes_Td[AES_B(st, 2, c-2)], 16)
+                       ^ aes_rol32(aes_Td[AES_B(st, 3, c-3)], 24);
+   }
 }
 
-/* Multiplication of the finite fields elements of AES.
-   See "A Specification for The AES Algorithm Rijndael 
-        (by Joan Daemen & Vincent Rijmen)"
-        Dr. Brian Gladman, v3.1, 3rd March 2001. */
-/* N values so that (hex) xy = 0x03^N.
-   0x00 cannot be used. We put 0xff for this value.*/
-/* a 16 x 16 matrix */
-static const UChar Nxy[256] = {                    // row nr
-   0xff, 0x00, 0x19, 0x01, 0x32, 0x02, 0x1a, 0xc6, // 1
-   0x4b, 0xc7, 0x1b, 0x68, 0x33, 0xee, 0xdf, 0x03,     
-   0x64, 0x04, 0xe0, 0x0e, 0x34, 0x8d, 0x81, 0xef, // 2
-   0x4c, 0x71, 0x08, 0xc8, 0xf8, 0x69, 0x1c, 0xc1,     
-   0x7d, 0xc2, 0x1d, 0xb5, 0xf9, 0xb9, 0x27, 0x6a, // 3
-   0x4d, 0xe4, 0xa6, 0x72, 0x9a, 0xc9, 0x09, 0x78,     
-   0x65, 0x2f, 0x8a, 0x05, 0x21, 0x0f, 0xe1, 0x24, // 4
-   0x12, 0xf0, 0x82, 0x45, 0x35, 0x93, 0xda, 0x8e,     
-   0x96, 0x8f, 0xdb, 0xbd, 0x36, 0xd0, 0xce, 0x94, // 5
-   0x13, 0x5c, 0xd2, 0xf1, 0x40, 0x46, 0x83, 0x38,     
-   0x66, 0xdd, 0xfd, 0x30, 0xbf, 0x06, 0x8b, 0x62, // 6
-   0xb3, 0x25, 0xe2, 0x98, 0x22, 0x88, 0x91, 0x10,     
-   0x7e, 0x6e, 0x48, 0xc3, 0xa3, 0xb6, 0x1e, 0x42, // 7
-   0x3a, 0x6b, 0x28, 0x54, 0xfa, 0x85, 0x3d, 0xba,     
-   0x2b, 0x79, 0x0a, 0x15, 0x9b, 0x9f, 0x5e, 0xca, // 8
-   0x4e, 0xd4, 0xac, 0xe5, 0xf3, 0x73, 0xa7, 0x57,     
-   0xaf, 0x58, 0xa8, 0x50, 0xf4, 0xea, 0xd6, 0x74, // 9
-   0x4f, 0xae, 0xe9, 0xd5, 0xe7, 0xe6, 0xad, 0xe8,     
-   0x2c, 0xd7, 0x75, 0x7a, 0xeb, 0x16, 0x0b, 0xf5, //10
-   0x59, 0xcb, 0x5f, 0xb0, 0x9c, 0xa9, 0x51, 0xa0,     
-   0x7f, 0x0c, 0xf6, 0x6f, 0x17, 0xc4, 0x49, 0xec, //11
-   0xd8, 0x43, 0x1f, 0x2d, 0xa4, 0x76, 0x7b, 0xb7,     
-   0xcc, 0xbb, 0x3e, 0x5a, 0xfb, 0x60, 0xb1, 0x86, //12
-   0x3b, 0x52, 0xa1, 0x6c, 0xaa, 0x55, 0x29, 0x9d,     
-   0x97, 0xb2, 0x87, 0x90, 0x61, 0xbe, 0xdc, 0xfc, //13
-   0xbc, 0x95, 0xcf, 0xcd, 0x37, 0x3f, 0x5b, 0xd1,     
-   0x53, 0x39, 0x84, 0x3c, 0x41, 0xa2, 0x6d, 0x47, //14
-   0x14, 0x2a, 0x9e, 0x5d, 0x56, 0xf2, 0xd3, 0xab,     
-   0x44, 0x11, 0x92, 0xd9, 0x23, 0x20, 0x2e, 0x89, //15
-   0xb4, 0x7c, 0xb8, 0x26, 0x77, 0x99, 0xe3, 0xa5,     
-   0x67, 0x4a, 0xed, 0xde, 0xc5, 0x31, 0xfe, 0x18, //16
-   0x0d, 0x63, 0x8c, 0x80, 0xc0, 0xf7, 0x70, 0x07
-};
+#undef AES_B
 
-/* E values so that E = 0x03^xy. */
-static const UChar Exy[256] = {                    // row nr
-   0x01, 0x03, 0x05, 0x0f, 0x11, 0x33, 0x55, 0xff, // 1
-   0x1a, 0x2e, 0x72, 0x96, 0xa1, 0xf8, 0x13, 0x35,     
-   0x5f, 0xe1, 0x38, 0x48, 0xd8, 0x73, 0x95, 0xa4, // 2
-   0xf7, 0x02, 0x06, 0x0a, 0x1e, 0x22, 0x66, 0xaa,     
-   0xe5, 0x34, 0x5c, 0xe4, 0x37, 0x59, 0xeb, 0x26, // 3
-   0x6a, 0xbe, 0xd9, 0x70, 0x90, 0xab, 0xe6, 0x31,     
-   0x53, 0xf5, 0x04, 0x0c, 0x14, 0x3c, 0x44, 0xcc, // 4
-   0x4f, 0xd1, 0x68, 0xb8, 0xd3, 0x6e, 0xb2, 0xcd,     
-   0x4c, 0xd4, 0x67, 0xa9, 0xe0, 0x3b, 0x4d, 0xd7, // 5
-   0x62, 0xa6, 0xf1, 0x08, 0x18, 0x28, 0x78, 0x88,     
-   0x83, 0x9e, 0xb9, 0xd0, 0x6b, 0xbd, 0xdc, 0x7f, // 6
-   0x81, 0x98, 0xb3, 0xce, 0x49, 0xdb, 0x76, 0x9a,     
-   0xb5, 0xc4, 0x57, 0xf9, 0x10, 0x30, 0x50, 0xf0, // 7
-   0x0b, 0x1d, 0x27, 0x69, 0xbb, 0xd6, 0x61, 0xa3,     
-   0xfe, 0x19, 0x2b, 0x7d, 0x87, 0x92, 0xad, 0xec, // 8
-   0x2f, 0x71, 0x93, 0xae, 0xe9, 0x20, 0x60, 0xa0,     
-   0xfb, 0x16, 0x3a, 0x4e, 0xd2, 0x6d, 0xb7, 0xc2, // 9
-   0x5d, 0xe7, 0x32, 0x56, 0xfa, 0x15, 0x3f, 0x41,     
-   0xc3, 0x5e, 0xe2, 0x3d, 0x47, 0xc9, 0x40, 0xc0, //10
-   0x5b, 0xed, 0x2c, 0x74, 0x9c, 0xbf, 0xda, 0x75,     
-   0x9f, 0xba, 0xd5, 0x64, 0xac, 0xef, 0x2a, 0x7e, //11
-   0x82, 0x9d, 0xbc, 0xdf, 0x7a, 0x8e, 0x89, 0x80,     
-   0x9b, 0xb6, 0xc1, 0x58, 0xe8, 0x23, 0x65, 0xaf, //12
-   0xea, 0x25, 0x6f, 0xb1, 0xc8, 0x43, 0xc5, 0x54,     
-   0xfc, 0x1f, 0x21, 0x63, 0xa5, 0xf4, 0x07, 0x09, //13
-   0x1b, 0x2d, 0x77, 0x99, 0xb0, 0xcb, 0x46, 0xca,     
-   0x45, 0xcf, 0x4a, 0xde, 0x79, 0x8b, 0x86, 0x91, //14
-   0xa8, 0xe3, 0x3e, 0x42, 0xc6, 0x51, 0xf3, 0x0e,     
-   0x12, 0x36, 0x5a, 0xee, 0x29, 0x7b, 0x8d, 0x8c, //15
-   0x8f, 0x8a, 0x85, 0x94, 0xa7, 0xf2, 0x0d, 0x17,     
-   0x39, 0x4b, 0xdd, 0x7c, 0x84, 0x97, 0xa2, 0xfd, //16
-   0x1c, 0x24, 0x6c, 0xb4, 0xc7, 0x52, 0xf6, 0x01};
-
-static inline UChar ff_mul(UChar u1, UChar u2)
-{
-   if ((u1 > 0) && (u2 > 0)) {
-      UInt ui = Nxy[u1] + Nxy[u2];
-      if (ui >= 255)
-         ui = ui - 255;
-      return Exy[ui];
-   } else {
-      return 0;
-   };
-}
-
-static void MixColumns (V128* v)
-{
-   V128 r;
-   Int j;
-#define P(x,row,col) (x)->w8[((row)*4+(col))]
-   for (j = 0; j < 4; j++) {
-      P(&r,j,0) = ff_mul(0x02, P(v,j,0)) ^ ff_mul(0x03, P(v,j,1)) 
-         ^ P(v,j,2) ^ P(v,j,3);
-      P(&r,j,1) = P(v,j,0) ^ ff_mul( 0x02, P(v,j,1) ) 
-         ^ ff_mul(0x03, P(v,j,2) ) ^ P(v,j,3);
-      P(&r,j,2) = P(v,j,0) ^ P(v,j,1) ^ ff_mul( 0x02, P(v,j,2) )
-         ^ ff_mul(0x03, P(v,j,3) );
-      P(&r,j,3) = ff_mul(0x03, P(v,j,0) ) ^ P(v,j,1) ^ P(v,j,2)
-         ^ ff_mul( 0x02, P(v,j,3) );
-   }
-   *v = r;
-#undef P
-}
-
-static void InvMixColumns (V128* v)
-{
-   V128 r;
-   Int j;
-#define P(x,row,col) (x)->w8[((row)*4+(col))]
-   for (j = 0; j < 4; j++) {
-      P(&r,j,0) = ff_mul(0x0e, P(v,j,0) ) ^ ff_mul(0x0b, P(v,j,1) )
-         ^ ff_mul(0x0d,P(v,j,2) ) ^ ff_mul(0x09, P(v,j,3) );
-      P(&r,j,1) = ff_mul(0x09, P(v,j,0) ) ^ ff_mul(0x0e, P(v,j,1) )
-         ^ ff_mul(0x0b,P(v,j,2) ) ^ ff_mul(0x0d, P(v,j,3) );
-      P(&r,j,2) = ff_mul(0x0d, P(v,j,0) ) ^ ff_mul(0x09, P(v,j,1) )
-         ^ ff_mul(0x0e,P(v,j,2) ) ^ ff_mul(0x0b, P(v,j,3) );
-      P(&r,j,3) = ff_mul(0x0b, P(v,j,0) ) ^ ff_mul(0x0d, P(v,j,1) )
-         ^ ff_mul(0x09,P(v,j,2) ) ^ ff_mul(0x0e, P(v,j,3) );
-   }
-   *v = r;
-#undef P
+/* Multiply each of the 8 bytes of w by 2 in GF(2^8). */
+static inline ULong aes_xtime64 ( ULong w )
+{
+   return ((w & 0x7F7F7F7F7F7F7F7FULL) << 1)
+          ^ (((w >> 7) & 0x0101010101010101ULL) * 0x1B);
+}
 
+/* Rotate each of the two 32-bit columns in w down by n bytes. */
+static inline ULong aes_ror_cols64 ( ULong w, UInt n )
+{
+   /* the bytes that stay in their own column when shifted down */
+   ULong keep = (0xFFFFFFFFULL >> (8 * n)) * 0x100000001ULL;
+   return ((w >> (8 * n)) & keep) | ((w << (32 - 8 * n)) & ~keep);
+}
+
+/* InvMixColumns on two columns at once, without tables.  It is
+   MixColumns applied after a_i ^= 4.(a_i ^ a_{i+2}), since the
+   inverse matrix factors as the forward one times { 5 0 4 0 }
+   circulant. */
+static ULong aes_invmixcolumns64 ( ULong w )
+{
+   ULong r1, r2;
+   w ^= aes_xtime64(aes_xtime64(w ^ aes_ror_cols64(w, 2)));
+   r1 = aes_ror_cols64(w, 1);
+   r2 = aes_ror_cols64(w, 2);
+   return aes_xtime64(w ^ r1) ^ r1 ^ r2 ^ aes_ror_cols64(w, 3);
 }
 
 /* For description, see definition in guest_amd64_defs.h */
@@ -3674,29 +3755,22 @@ void amd64g_dirtyhelper_AES (
    switch (opc4) {
       case 0xDC: /* AESENC */
       case 0xDD: /* AESENCLAST */
-         r = *argR;
-         ShiftRows (&r);
-         SubBytes  (&r);
-         if (opc4 == 0xDC)
-            MixColumns (&r);
+         aes_enc_round(&r, argR, opc4 == 0xDD);
          argD->w64[0] = r.w64[0] ^ argL->w64[0];
          argD->w64[1] = r.w64[1] ^ argL->w64[1];
          break;
 
       case 0xDE: /* AESDEC */
       case 0xDF: /* AESDECLAST */
-         r = *argR;
-         InvShiftRows (&r);
-         InvSubBytes (&r);
-         if (opc4 == 0xDE)
-            InvMixColumns (&r);
+         aes_dec_round(&r, argR, opc4 == 0xDF);
          argD->w64[0] = r.w64[0] ^ argL->w64[0];
          argD->w64[1] = r.w64[1] ^ argL->w64[1];
          break;
 
       case 0xDB: /* AESIMC */
-         *argD = *argL;
-         InvMixColumns (argD);
+         r.w64[0] = aes_invmixcolumns64(argL->w64[0]);
+         r.w64[1] = aes_invmixcolumns64(argL->w64[1]);
+         *argD = r;
          break;
       default: vassert(0);
    }
@@ -3826,10 +3900,28 @@ void LibVEX_GuestAMD64_initialise ( /*OUT*/VexGuestAMD64State* vex_state )
    vex_state->guest_GS_0x60  = 0;
 
    vex_state->guest_IP_AT_SYSCALL = 0;
+
+   vex_state->host_RS_HITS   = 0;
+   vex_state->host_RS_MISSES = 0;
+   vex_state->host_RS_pad    = 0;
+   LibVEX_GuestAMD64_clear_ret_stack(vex_state);
+
    vex_state->pad1 = 0;
 }
 
 
+/* VISIBLE TO LIBVEX CLIENT */
+void LibVEX_GuestAMD64_clear_ret_stack ( /*MOD*/VexGuestAMD64State* vex_state )
+{
+   Int i;
+   vex_state->host_RS_TOP = 0;
+   for (i = 0; i < 16; i++) {
+      vex_state->host_RS_GA[i] = ~0ULL;
+      vex_state->host_RS_HA[i] = 0;
+   }
+}
+
+
 /* Figure out if any part of the guest state contained in minoff
    .. maxoff requires precise memory exceptions.  If in doubt return
    True (but this generates significantly slower code).  
@@ -189,21 +189,21 @@
    that we don't have to pass them around endlessly. */
 
 /* We need to know this to do sub-register accesses correctly. */
-static Bool host_is_bigendian;
+static VEX_TLS Bool host_is_bigendian;
 
 /* Pointer to the guest code area (points to start of BB, not to the
    insn being processed). */
-static UChar* guest_code;
+static VEX_TLS UChar* guest_code;
 
 /* The guest address corresponding to guest_code[0]. */
-static Addr64 guest_RIP_bbstart;
+static VEX_TLS Addr64 guest_RIP_bbstart;
 
 /* The guest address for the instruction currently being
    translated. */
-static Addr64 guest_RIP_curr_instr;
+static VEX_TLS Addr64 guest_RIP_curr_instr;
 
 /* The IRSB* into which we're generating code. */
-static IRSB* irsb;
+static VEX_TLS IRSB* irsb;
 
 /* For ensuring that %rip-relative addressing is done right.  A read
    of %rip generates the address of the next instruction.  It may be
@@ -217,8 +217,8 @@ static IRSB* irsb;
    After the decode, if _mustcheck is now True, _assumed is
    checked. */
 
-static Addr64 guest_RIP_next_assumed;
-static Bool   guest_RIP_next_mustcheck;
+static VEX_TLS Addr64 guest_RIP_next_assumed;
+static VEX_TLS Bool   guest_RIP_next_mustcheck;
 
 
 /*------------------------------------------------------------*/
@@ -2272,6 +2272,55 @@ void jcc_01 ( /*MOD*/DisResult* dres,
    }
 }
 
+/* Speculatively chase the conditional branch "if (cond) goto d64_true
+   else goto d64_false", continuing disassembly in one direction and
+   making the other a side exit.  A backward branch is assumed taken
+   and a forward one not taken; if resteerOkFn refuses that direction,
+   the other one is tried, which is what lets a trace translation
+   follow its path whichever way the branch went.  Returns the
+   comment for DIP, or NULL (with nothing generated) if resteerOkFn
+   refuses both. */
+static
+const HChar* jcc_chase ( /*MOD*/DisResult* dres,
+                         Bool (*resteerOkFn) ( /*opaque*/void*, Addr64 ),
+                         void* callback_opaque,
+                         AMD64Condcode cond,
+                         Addr64 d64_false, Addr64 d64_true )
+{
+   Bool backward = toBool(d64_true < d64_false);
+   Bool taken;
+   if (resteerOkFn( callback_opaque, backward ? d64_true : d64_false ))
+      taken = backward;
+   else
+   if (resteerOkFn( callback_opaque, backward ? d64_false : d64_true ))
+      taken = !backward;
+   else
+      return NULL;
+
+   dres->whatNext = Dis_ResteerC;
+   if (taken) {
+      /* Side-exit to the insn following this one, on the negation of
+         the condition, and continue at the branch target. */
+      stmt( IRStmt_Exit( 
+               mk_amd64g_calculate_condition((AMD64Condcode)(1 ^ cond)),
+               Ijk_Boring,
+               IRConst_U64(d64_false),
+               OFFB_RIP ) );
+      dres->continueAt = d64_true;
+      return "(assumed taken)";
+   } else {
+      /* Side-exit to the branch target, and continue at the insn
+         immediately following this one. */
+      stmt( IRStmt_Exit( 
+               mk_amd64g_calculate_condition(cond),
+               Ijk_Boring,
+               IRConst_U64(d64_true),
+               OFFB_RIP ) );
+      dres->continueAt = d64_false;
+      return "(assumed not taken)";
+   }
+}
+
 /* Let new_rsp be the %rsp value after a call/return.  Let nia be the
    guest address of the next instruction to be executed.
 
@@ -4597,6 +4646,89 @@ void dis_SCAS ( Int sz, IRTemp t_inc, Prefix pfx )
 }
 
 
+/* REP MOVS/STOS and REPE/REPNE CMPS/SCAS as a call to
+   amd64g_dirtyhelper_REP, which does up to a few hundred KB worth of
+   iterations and says whether there are any left.  Like the
+   single-iteration version, skips the insn entirely if the count
+   is zero, so that the helper always does at least one iteration
+   and so always sets the flags thunk for CMPS/SCAS. */
+static
+void dis_REP_bulk ( /*MOD*/DisResult* dres,
+                    AMD64Condcode cond,
+                    void (*dis_OP)(Int, IRTemp, Prefix),
+                    Int sz, Addr64 rip, Addr64 rip_next, Prefix pfx )
+{
+   Bool     cmp  = dis_OP == dis_CMPS || dis_OP == dis_SCAS;
+   UInt     op   = dis_OP == dis_MOVS ? X86AMD64_REP_MOVS
+                   : dis_OP == dis_STOS ? X86AMD64_REP_STOS
+                   : dis_OP == dis_CMPS ? X86AMD64_REP_CMPS
+                   : X86AMD64_REP_SCAS;
+   IRTemp   more = newTemp(Ity_I64);
+   IRExpr*  cx0;
+   IRDirty* d;
+
+   if (haveASO(pfx))
+      cx0 = binop(Iop_CmpEQ32, getIReg32(R_RCX), mkU32(0));
+   else
+      cx0 = binop(Iop_CmpEQ64, getIReg64(R_RCX), mkU64(0));
+   stmt( IRStmt_Exit( cx0, Ijk_Boring,
+                      IRConst_U64(rip_next), OFFB_RIP ) );
+
+   /* So that RIP is right should the helper fault. */
+   stmt( IRStmt_Put( OFFB_RIP, mkU64(rip) ) );
+
+   d = unsafeIRDirty_1_N(
+          more, 0/*regparms*/,
+          "amd64g_dirtyhelper_REP", &amd64g_dirtyhelper_REP,
+          mkIRExprVec_5( IRExpr_BBPTR(), mkU64(op), mkU64(sz),
+                         mkU64(cond == AMD64CondZ ? 1 : 0),
+                         mkU64(haveASO(pfx) ? 1 : 0) )
+       );
+   /* The memory accesses are not declared: there is no way to say
+      how many there are.  Hence VexControl.guest_rep_bulk, which is
+      off unless the client asks for it. */
+   d->nFxState = 0;
+   vex_bzero(&d->fxState, sizeof(d->fxState));
+   d->fxState[d->nFxState].fx     = Ifx_Read;
+   d->fxState[d->nFxState].offset = OFFB_RIP;
+   d->fxState[d->nFxState].size   = 8;
+   d->nFxState++;
+   d->fxState[d->nFxState].fx     = Ifx_Read;
+   d->fxState[d->nFxState].offset = OFFB_DFLAG;
+   d->fxState[d->nFxState].size   = 8;
+   d->nFxState++;
+   d->fxState[d->nFxState].fx     = Ifx_Modify;
+   d->fxState[d->nFxState].offset = OFFB_RCX;
+   d->fxState[d->nFxState].size   = 8;
+   d->nFxState++;
+   /* RSI and RDI are adjacent. */
+   d->fxState[d->nFxState].fx     = Ifx_Modify;
+   d->fxState[d->nFxState].offset = OFFB_RSI;
+   d->fxState[d->nFxState].size   = 16;
+   d->nFxState++;
+   if (dis_OP != dis_MOVS && dis_OP != dis_CMPS) {
+      d->fxState[d->nFxState].fx     = Ifx_Read;
+      d->fxState[d->nFxState].offset = OFFB_RAX;
+      d->fxState[d->nFxState].size   = 8;
+      d->nFxState++;
+   }
+   if (cmp) {
+      /* CC_OP, CC_DEP1 and CC_DEP2 are adjacent. */
+      d->fxState[d->nFxState].fx     = Ifx_Write;
+      d->fxState[d->nFxState].offset = OFFB_CC_OP;
+      d->fxState[d->nFxState].size   = 24;
+      d->nFxState++;
+   }
+   stmt( IRStmt_Dirty(d) );
+
+   stmt( IRStmt_Exit( binop(Iop_CmpNE64, mkexpr(more), mkU64(0)),
+                      Ijk_Boring,
+                      IRConst_U64(rip),
+                      OFFB_RIP ) );
+   jmp_lit(dres, Ijk_Boring, rip_next);
+   vassert(dres->whatNext == Dis_StopHere);
+}
+
 /* Wrap the appropriate string op inside a REP/REPE/REPNE.  We assume
    the insn is the last one in the basic block, and so emit a jump to
    the next insn, rather than just falling through. */
@@ -4615,6 +4747,16 @@ void dis_REP_op ( /*MOD*/DisResult* dres,
       The following assertion catches any resulting sillyness. */
    vassert(pfx == clearSegBits(pfx));
 
+   if (vex_control.guest_rep_bulk
+       && ((cond == AMD64CondAlways
+            && (dis_OP == dis_MOVS || dis_OP == dis_STOS))
+           || ((cond == AMD64CondZ || cond == AMD64CondNZ)
+               && (dis_OP == dis_CMPS || dis_OP == dis_SCAS)))) {
+      dis_REP_bulk(dres, cond, dis_OP, sz, rip, rip_next, pfx);
+      DIP("%s%c\n", name, nameISize(sz));
+      return;
+   }
+
    if (haveASO(pfx)) {
       tc = newTemp(Ity_I32);  /*  ECX  */
       assign( tc, getIReg32(R_RCX) );
@@ -17048,7 +17190,7 @@ static Long dis_PHMINPOSUW_128 ( VexAbiInfo* vbi, Prefix pfx,
 }
 
 
-static Long dis_AESx ( VexAbiInfo* vbi, Prefix pfx,
+static Long dis_AESx ( VexAbiInfo* vbi, VexArchInfo* archinfo, Prefix pfx,
                        Long delta, Bool isAvx, UChar opc )
 {
    IRTemp addr   = IRTemp_INVALID;
@@ -17058,8 +17200,10 @@ static Long dis_AESx ( VexAbiInfo* vbi, Prefix pfx,
    UInt   rG     = gregOfRexRM(pfx, modrm);
    UInt   regNoL = 0;
    UInt   regNoR = (isAvx && opc != 0xDB) ? getVexNvvvv(pfx) : rG;
+   Bool   native = toBool(archinfo->hwcaps & VEX_HWCAPS_AMD64_AES);
 
-   /* This is a nasty kludge.  We need to pass 2 x V128 to the
+   /* With AES-NI this is just an IROp, which the host can do in one
+      insn.  Without, it is a nasty kludge.  We need to pass 2 x V128 to the
       helper.  Since we can't do that, use a dirty
       helper to compute the results directly from the XMM regs in
       the guest state.  That means for the memory case, we need to
@@ -17072,53 +17216,75 @@ static Long dis_AESx ( VexAbiInfo* vbi, Prefix pfx,
       regNoL = 16; /* use XMM16 as an intermediary */
       addr = disAMode( &alen, vbi, pfx, delta, dis_buf, 0 );
       /* alignment check needed ???? */
-      stmt( IRStmt_Put( OFFB_YMM16, loadLE(Ity_V128, mkexpr(addr)) ));
+      if (!native)
+         stmt( IRStmt_Put( OFFB_YMM16, loadLE(Ity_V128, mkexpr(addr)) ));
       delta += alen;
    }
 
-   void*  fn = &amd64g_dirtyhelper_AES;
-   const HChar* nm = "amd64g_dirtyhelper_AES";
-
-   /* Round up the arguments.  Note that this is a kludge -- the
-      use of mkU64 rather than mkIRExpr_HWord implies the
-      assumption that the host's word size is 64-bit. */
-   UInt gstOffD = ymmGuestRegOffset(rG);
-   UInt gstOffL = regNoL == 16 ? OFFB_YMM16 : ymmGuestRegOffset(regNoL);
-   UInt gstOffR = ymmGuestRegOffset(regNoR);
-   IRExpr*  opc4         = mkU64(opc);
-   IRExpr*  gstOffDe     = mkU64(gstOffD);
-   IRExpr*  gstOffLe     = mkU64(gstOffL);
-   IRExpr*  gstOffRe     = mkU64(gstOffR);
-   IRExpr** args
-      = mkIRExprVec_5( IRExpr_BBPTR(), opc4, gstOffDe, gstOffLe, gstOffRe );
+   if (native) {
+      IRExpr* argL = regNoL == 16 ? loadLE(Ity_V128, mkexpr(addr))
+                                  : getXMMReg(regNoL);
+      IRExpr* res;
+      switch (opc) {
+         case 0xDC: res = binop(Iop_AESEnc128,     getXMMReg(regNoR), argL);
+                    break;
+         case 0xDD: res = binop(Iop_AESEncLast128, getXMMReg(regNoR), argL);
+                    break;
+         case 0xDE: res = binop(Iop_AESDec128,     getXMMReg(regNoR), argL);
+                    break;
+         case 0xDF: res = binop(Iop_AESDecLast128, getXMMReg(regNoR), argL);
+                    break;
+         case 0xDB: res = unop(Iop_AESIMC128, argL);
+                    break;
+         default: vassert(0);
+      }
+      (isAvx ? putYMMRegLoAndZU : putXMMReg)(rG, res);
+   } else {
+      void*  fn = &amd64g_dirtyhelper_AES;
+      const HChar* nm = "amd64g_dirtyhelper_AES";
+
+      /* Round up the arguments.  Note that this is a kludge -- the
+         use of mkU64 rather than mkIRExpr_HWord implies the
+         assumption that the host's word size is 64-bit. */
+      UInt gstOffD = ymmGuestRegOffset(rG);
+      UInt gstOffL = regNoL == 16 ? OFFB_YMM16 : ymmGuestRegOffset(regNoL);
+      UInt gstOffR = ymmGuestRegOffset(regNoR);
+      IRExpr*  opc4         = mkU64(opc);
+      IRExpr*  gstOffDe     = mkU64(gstOffD);
+      IRExpr*  gstOffLe     = mkU64(gstOffL);
+      IRExpr*  gstOffRe     = mkU64(gstOffR);
+      IRExpr** args
+         = mkIRExprVec_5( IRExpr_BBPTR(), opc4,
+                          gstOffDe, gstOffLe, gstOffRe );
+
+      IRDirty* d    = unsafeIRDirty_0_N( 0/*regparms*/, nm, fn, args );
+      /* It's not really a dirty call, but we can't use the clean helper
+         mechanism here for the very lame reason that we can't pass 2 x
+         V128s by value to a helper.  Hence this roundabout scheme. */
+      d->nFxState = 2;
+      vex_bzero(&d->fxState, sizeof(d->fxState));
+      /* AES{ENC,ENCLAST,DEC,DECLAST} read both registers, and writes
+         the second for !isAvx or the third for isAvx.
+         AESIMC (0xDB) reads the first register, and writes the second. */
+      d->fxState[0].fx     = Ifx_Read;
+      d->fxState[0].offset = gstOffL;
+      d->fxState[0].size   = sizeof(U128);
+      d->fxState[1].offset = gstOffR;
+      d->fxState[1].size   = sizeof(U128);
+      if (opc == 0xDB)
+         d->fxState[1].fx   = Ifx_Write;
+      else if (!isAvx || rG == regNoR)
+         d->fxState[1].fx   = Ifx_Modify;
+      else {
+         d->fxState[1].fx     = Ifx_Read;
+         d->nFxState++;
+         d->fxState[2].fx     = Ifx_Write;
+         d->fxState[2].offset = gstOffD; 
+         d->fxState[2].size   = sizeof(U128);
+      }
 
-   IRDirty* d    = unsafeIRDirty_0_N( 0/*regparms*/, nm, fn, args );
-   /* It's not really a dirty call, but we can't use the clean helper
-      mechanism here for the very lame reason that we can't pass 2 x
-      V128s by value to a helper.  Hence this roundabout scheme. */
-   d->nFxState = 2;
-   vex_bzero(&d->fxState, sizeof(d->fxState));
-   /* AES{ENC,ENCLAST,DEC,DECLAST} read both registers, and writes
-      the second for !isAvx or the third for isAvx.
-      AESIMC (0xDB) reads the first register, and writes the second. */
-   d->fxState[0].fx     = Ifx_Read;
-   d->fxState[0].offset = gstOffL;
-   d->fxState[0].size   = sizeof(U128);
-   d->fxState[1].offset = gstOffR;
-   d->fxState[1].size   = sizeof(U128);
-   if (opc == 0xDB)
-      d->fxState[1].fx   = Ifx_Write;
-   else if (!isAvx || rG == regNoR)
-      d->fxState[1].fx   = Ifx_Modify;
-   else {
-      d->fxState[1].fx     = Ifx_Read;
-      d->nFxState++;
-      d->fxState[2].fx     = Ifx_Write;
-      d->fxState[2].offset = gstOffD; 
-      d->fxState[2].size   = sizeof(U128);
+      stmt( IRStmt_Dirty(d) );
    }
-
-   stmt( IRStmt_Dirty(d) );
    {
       const HChar* opsuf;
       switch (opc) {
@@ -17135,7 +17301,7 @@ static Long dis_AESx ( VexAbiInfo* vbi, Prefix pfx,
           (isAvx && opc != 0xDB) ? "," : "",
           (isAvx && opc != 0xDB) ? nameXMMReg(rG) : "");
    }
-   if (isAvx)
+   if (isAvx && !native)
       putYMMRegLane128( rG, 1, mkV128(0) );
    return delta;
 }
@@ -17208,6 +17374,7 @@ static Long dis_AESKEYGENASSIST ( VexAbiInfo* vbi, Prefix pfx,
 __attribute__((noinline))
 static
 Long dis_ESC_0F38__SSE4 ( Bool* decode_OK,
+                          VexArchInfo* archinfo,
                           VexAbiInfo* vbi,
                           Prefix pfx, Int sz, Long deltaIN )
 {
@@ -17645,7 +17812,7 @@ Long dis_ESC_0F38__SSE4 ( Bool* decode_OK,
 
                   DB /r = AESIMC xmm1, xmm2/m128 */
       if (have66noF2noF3(pfx) && sz == 2) {
-         delta = dis_AESx( vbi, pfx, delta, False/*!isAvx*/, opc );
+         delta = dis_AESx( vbi, archinfo, pfx, delta, False/*!isAvx*/, opc );
          goto decode_success;
       }
       break;
@@ -17689,6 +17856,26 @@ Long dis_ESC_0F38__SSE4 ( Bool* decode_OK,
          assign(valG0, binop(Iop_And64, getIRegG(8, pfx, modrm),
                              mkU64(0xFFFFFFFF)));
 
+         /* If the guest has SSE4.2 this is a single IROp, which the
+            host does in one insn.  Otherwise call the table-driven
+            helper. */
+         IRTemp valG1 = newTemp(Ity_I64);
+         if (archinfo->hwcaps & VEX_HWCAPS_AMD64_SSE42) {
+            IROp op = Iop_INVALID;
+            switch (sz) {
+               case 1: op = Iop_CRC32C8;  break;
+               case 2: op = Iop_CRC32C16; break;
+               case 4: op = Iop_CRC32C32; break;
+               case 8: op = Iop_CRC32C64; break;
+            }
+            assign(valG1,
+                   unop(Iop_32Uto64,
+                        binop(op, unop(Iop_64to32, mkexpr(valG0)),
+                                  mkexpr(valE))));
+            putIRegG(4, pfx, modrm, unop(Iop_64to32, mkexpr(valG1)));
+            goto decode_success;
+         }
+
          const HChar* nm = NULL;
          void*  fn = NULL;
          switch (sz) {
@@ -17702,7 +17889,6 @@ Long dis_ESC_0F38__SSE4 ( Bool* decode_OK,
                     fn = &amd64g_calc_crc32q; break;
          }
          vassert(nm && fn);
-         IRTemp valG1 = newTemp(Ity_I64);
          assign(valG1,
                 mkIRExprCCall(Ity_I64, 0/*regparm*/, nm, fn, 
                               mkIRExprVec_2(mkexpr(valG0),
@@ -18489,8 +18675,24 @@ static Long dis_EXTRACTPS ( VexAbiInfo* vbi, Prefix pfx,
 }
 
 
-static IRTemp math_PCLMULQDQ( IRTemp dV, IRTemp sV, UInt imm8 )
+static IRTemp math_PCLMULQDQ( IRTemp dV, IRTemp sV, UInt imm8,
+                               VexArchInfo* archinfo )
 {
+   if (archinfo->hwcaps & VEX_HWCAPS_AMD64_PCLMUL) {
+      /* Bring the selected halves down to the lower lanes, and
+         multiply those.  The host can usually fold the moves into
+         its own PCLMULQDQ imm8. */
+      IRTemp res = newTemp(Ity_V128);
+      assign(res, binop(Iop_PolynomialMull64,
+                        (imm8 & 1)
+                           ? binop(Iop_InterleaveHI64x2, mkexpr(dV), mkexpr(dV))
+                           : mkexpr(dV),
+                        (imm8 & 16)
+                           ? binop(Iop_InterleaveHI64x2, mkexpr(sV), mkexpr(sV))
+                           : mkexpr(sV)));
+      return res;
+   }
+
    IRTemp t0 = newTemp(Ity_I64);
    IRTemp t1 = newTemp(Ity_I64);
    assign(t0, unop((imm8&1)? Iop_V128HIto64 : Iop_V128to64, 
@@ -18519,6 +18721,7 @@ static IRTemp math_PCLMULQDQ( IRTemp dV, IRTemp sV, UInt imm8 )
 __attribute__((noinline))
 static
 Long dis_ESC_0F3A__SSE4 ( Bool* decode_OK,
+                          VexArchInfo* archinfo,
                           VexAbiInfo* vbi,
                           Prefix pfx, Int sz, Long deltaIN )
 {
@@ -19144,7 +19347,7 @@ Long dis_ESC_0F3A__SSE4 ( Bool* decode_OK,
                  imm8, dis_buf, nameXMMReg(rG) );
          }
 
-         putXMMReg( rG, mkexpr( math_PCLMULQDQ(dvec, svec, imm8) ) );
+         putXMMReg( rG, mkexpr( math_PCLMULQDQ(dvec, svec, imm8, archinfo) ) );
          goto decode_success;
       }
       break;
@@ -19607,58 +19810,28 @@ Long dis_ESC_NONE (
    case 0x7E:   /* JLEb/JNGb (jump less or equal) */
    case 0x7F: { /* JGb/JNLEb (jump greater) */
       Long   jmpDelta;
-      const HChar* comment  = "";
+      const HChar* comment  = NULL;
       if (haveF2orF3(pfx)) goto decode_failure;
       jmpDelta = getSDisp8(delta);
       vassert(-128 <= jmpDelta && jmpDelta < 128);
       d64 = (guest_RIP_bbstart+delta+1) + jmpDelta;
       delta++;
       if (resteerCisOk
-          && vex_control.guest_chase_cond
-          && (Addr64)d64 != (Addr64)guest_RIP_bbstart
-          && jmpDelta < 0
-          && resteerOkFn( callback_opaque, d64) ) {
-         /* Speculation: assume this backward branch is taken.  So we
-            need to emit a side-exit to the insn following this one,
-            on the negation of the condition, and continue at the
-            branch target address (d64).  If we wind up back at the
-            first instruction of the trace, just stop; it's better to
-            let the IR loop unroller handle that case. */
-         stmt( IRStmt_Exit( 
-                  mk_amd64g_calculate_condition(
-                     (AMD64Condcode)(1 ^ (opc - 0x70))),
-                  Ijk_Boring,
-                  IRConst_U64(guest_RIP_bbstart+delta),
-                  OFFB_RIP ) );
-         dres->whatNext   = Dis_ResteerC;
-         dres->continueAt = d64;
-         comment = "(assumed taken)";
-      }
-      else
-      if (resteerCisOk
-          && vex_control.guest_chase_cond
-          && (Addr64)d64 != (Addr64)guest_RIP_bbstart
-          && jmpDelta >= 0
-          && resteerOkFn( callback_opaque, guest_RIP_bbstart+delta ) ) {
-         /* Speculation: assume this forward branch is not taken.  So
-            we need to emit a side-exit to d64 (the dest) and continue
-            disassembling at the insn immediately following this
-            one. */
-         stmt( IRStmt_Exit( 
-                  mk_amd64g_calculate_condition((AMD64Condcode)(opc - 0x70)),
-                  Ijk_Boring,
-                  IRConst_U64(d64),
-                  OFFB_RIP ) );
-         dres->whatNext   = Dis_ResteerC;
-         dres->continueAt = guest_RIP_bbstart+delta;
-         comment = "(assumed not taken)";
-      }
-      else {
-         /* Conservative default translation - end the block at this
-            point. */
+          && (Addr64)d64 != (Addr64)guest_RIP_bbstart) {
+         /* If we wind up back at the first instruction of the
+            trace, just stop; it's better to let the IR loop
+            unroller handle that case. */
+         comment = jcc_chase( dres, resteerOkFn, callback_opaque,
+                              (AMD64Condcode)(opc - 0x70),
+                              guest_RIP_bbstart+delta, d64 );
+      }
+      if (comment == NULL) {
+         /* Conservative default translation - end the block at
+            this point. */
          jcc_01( dres, (AMD64Condcode)(opc - 0x70),
                  guest_RIP_bbstart+delta, d64 );
          vassert(dres->whatNext == Dis_StopHere);
+         comment = "";
       }
       DIP("j%s-8 0x%llx %s\n", name_AMD64Condcode(opc - 0x70), d64, comment);
       return delta;
@@ -20685,7 +20858,10 @@ Long dis_ESC_NONE (
       t2 = newTemp(Ity_I64);
       assign(t2, mkU64((Addr64)d64));
       make_redzone_AbiHint(vbi, t1, t2/*nia*/, "call-d32");
-      if (resteerOkFn( callback_opaque, (Addr64)d64) ) {
+      /* Don't follow the call if the shadow return stack is in use,
+         since the push happens at the block's Ijk_Call exit. */
+      if (!vex_control.shadow_ret_stack
+          && resteerOkFn( callback_opaque, (Addr64)d64) ) {
          /* follow into the call target. */
          dres->whatNext   = Dis_ResteerU;
          dres->continueAt = d64;
@@ -21132,60 +21308,27 @@ Long dis_ESC_0F (
    case 0x8E:   /* JLEb/JNGb (jump less or equal) */
    case 0x8F: { /* JGb/JNLEb (jump greater) */
       Long   jmpDelta;
-      const HChar* comment  = "";
+      const HChar* comment  = NULL;
       if (haveF2orF3(pfx)) goto decode_failure;
       jmpDelta = getSDisp32(delta);
       d64 = (guest_RIP_bbstart+delta+4) + jmpDelta;
       delta += 4;
       if (resteerCisOk
-          && vex_control.guest_chase_cond
-          && (Addr64)d64 != (Addr64)guest_RIP_bbstart
-          && jmpDelta < 0
-          && resteerOkFn( callback_opaque, d64) ) {
-         /* Speculation: assume this backward branch is taken.  So
-            we need to emit a side-exit to the insn following this
-            one, on the negation of the condition, and continue at
-            the branch target address (d64).  If we wind up back at
-            the first instruction of the trace, just stop; it's
-            better to let the IR loop unroller handle that case. */
-         stmt( IRStmt_Exit( 
-                  mk_amd64g_calculate_condition(
-                     (AMD64Condcode)(1 ^ (opc - 0x80))),
-                  Ijk_Boring,
-                  IRConst_U64(guest_RIP_bbstart+delta),
-                  OFFB_RIP
-             ));
-         dres->whatNext   = Dis_ResteerC;
-         dres->continueAt = d64;
-         comment = "(assumed taken)";
-      }
-      else
-      if (resteerCisOk
-          && vex_control.guest_chase_cond
-          && (Addr64)d64 != (Addr64)guest_RIP_bbstart
-          && jmpDelta >= 0
-          && resteerOkFn( callback_opaque, guest_RIP_bbstart+delta ) ) {
-         /* Speculation: assume this forward branch is not taken.
-            So we need to emit a side-exit to d64 (the dest) and
-            continue disassembling at the insn immediately
-            following this one. */
-         stmt( IRStmt_Exit( 
-                  mk_amd64g_calculate_condition((AMD64Condcode)
-                                                (opc - 0x80)),
-                  Ijk_Boring,
-                  IRConst_U64(d64),
-                  OFFB_RIP
-             ));
-         dres->whatNext   = Dis_ResteerC;
-         dres->continueAt = guest_RIP_bbstart+delta;
-         comment = "(assumed not taken)";
-      }
-      else {
+          && (Addr64)d64 != (Addr64)guest_RIP_bbstart) {
+         /* If we wind up back at the first instruction of the
+            trace, just stop; it's better to let the IR loop
+            unroller handle that case. */
+         comment = jcc_chase( dres, resteerOkFn, callback_opaque,
+                              (AMD64Condcode)(opc - 0x80),
+                              guest_RIP_bbstart+delta, d64 );
+      }
+      if (comment == NULL) {
          /* Conservative default translation - end the block at
             this point. */
          jcc_01( dres, (AMD64Condcode)(opc - 0x80),
                  guest_RIP_bbstart+delta, d64 );
          vassert(dres->whatNext == Dis_StopHere);
+         comment = "";
       }
       DIP("j%s-32 0x%llx %s\n", name_AMD64Condcode(opc - 0x80), d64, comment);
       return delta;
@@ -21845,7 +21988,7 @@ Long dis_ESC_0F38 (
       rather than proceeding indiscriminately. */
    {
       Bool decode_OK = False;
-      delta = dis_ESC_0F38__SSE4 ( &decode_OK, vbi, pfx, sz, deltaIN );
+      delta = dis_ESC_0F38__SSE4 ( &decode_OK, archinfo, vbi, pfx, sz, deltaIN );
       if (decode_OK)
          return delta;
    }
@@ -21898,7 +22041,7 @@ Long dis_ESC_0F3A (
       rather than proceeding indiscriminately. */
    {
       Bool decode_OK = False;
-      delta = dis_ESC_0F3A__SSE4 ( &decode_OK, vbi, pfx, sz, deltaIN );
+      delta = dis_ESC_0F3A__SSE4 ( &decode_OK, archinfo, vbi, pfx, sz, deltaIN );
       if (decode_OK)
          return delta;
    }
@@ -28858,7 +29001,7 @@ Long dis_ESC_0F38__VEX (
       /* VAESDEC xmm3/m128, xmm2, xmm1 = VEX.128.66.0F38.WIG DE /r */
       /* VAESDECLAST xmm3/m128, xmm2, xmm1 = VEX.128.66.0F38.WIG DF /r */
       if (have66noF2noF3(pfx) && 0==getVexL(pfx)/*128*/) {
-         delta = dis_AESx( vbi, pfx, delta, True/*!isAvx*/, opc );
+         delta = dis_AESx( vbi, archinfo, pfx, delta, True/*!isAvx*/, opc );
          if (opc != 0xDB) *uses_vvvv = True;
          goto decode_success;
       }
@@ -30708,7 +30851,7 @@ Long dis_ESC_0F3A__VEX (
                  imm8, dis_buf, nameXMMReg(rV), nameXMMReg(rG) );
          }
 
-         putYMMRegLoAndZU( rG, mkexpr( math_PCLMULQDQ(dV, sV, imm8) ) );
+         putYMMRegLoAndZU( rG, mkexpr( math_PCLMULQDQ(dV, sV, imm8, archinfo) ) );
          *uses_vvvv = True;
          goto decode_success;
       }
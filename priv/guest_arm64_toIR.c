@@ -121,14 +121,14 @@
 
 /* CONST: is the host bigendian?  We need to know this in order to do
    sub-register accesses to the SIMD/FP registers correctly. */
-static Bool host_is_bigendian;
+static VEX_TLS Bool host_is_bigendian;
 
 /* CONST: The guest address for the instruction currently being
    translated.  */
-static Addr64 guest_PC_curr_instr;
+static VEX_TLS Addr64 guest_PC_curr_instr;
 
 /* MOD: The IRSB* into which we're generating code. */
-static IRSB* irsb;
+static VEX_TLS IRSB* irsb;
 
 
 /*------------------------------------------------------------*/
@@ -126,19 +126,19 @@
 /* CONST: is the host bigendian?  This has to do with float vs double
    register accesses on VFP, but it's complex and not properly thought
    out. */
-static Bool host_is_bigendian;
+static VEX_TLS Bool host_is_bigendian;
 
 /* CONST: The guest address for the instruction currently being
    translated.  This is the real, "decoded" address (not subject
    to the CPSR.T kludge). */
-static Addr32 guest_R15_curr_instr_notENC;
+static VEX_TLS Addr32 guest_R15_curr_instr_notENC;
 
 /* CONST, FOR ASSERTIONS ONLY.  Indicates whether currently processed
    insn is Thumb (True) or ARM (False). */
-static Bool __curr_is_Thumb;
+static VEX_TLS Bool __curr_is_Thumb;
 
 /* MOD: The IRSB* into which we're generating code. */
-static IRSB* irsb;
+static VEX_TLS IRSB* irsb;
 
 /* These are to do with handling writes to r15.  They are initially
    set at the start of disInstr_ARM_WRK to indicate no update,
@@ -151,17 +151,17 @@ static IRSB* irsb;
 
 /* MOD.  Initially False; set to True iff abovementioned handling is
    required. */
-static Bool r15written;
+static VEX_TLS Bool r15written;
 
 /* MOD.  Initially IRTemp_INVALID.  If the r15 branch to be generated
    is conditional, this holds the gating IRTemp :: Ity_I32.  If the
    branch to be generated is unconditional, this remains
    IRTemp_INVALID. */
-static IRTemp r15guard; /* :: Ity_I32, 0 or 1 */
+static VEX_TLS IRTemp r15guard; /* :: Ity_I32, 0 or 1 */
 
 /* MOD.  Initially Ijk_Boring.  If an r15 branch is to be generated,
    this holds the jump kind. */
-static IRTemp r15kind;
+static VEX_TLS IRTemp r15kind;
 
 
 /*------------------------------------------------------------*/
@@ -15482,7 +15482,6 @@ DisResult disInstr_ARM_WRK (
             known destination. */
          if (!link
              && resteerCisOk
-             && vex_control.guest_chase_cond
              && dst < guest_R15_curr_instr_notENC
              && resteerOkFn( callback_opaque, (Addr64)(Addr32)dst) ) {
             /* Speculation: assume this backward branch is taken.  So
@@ -15501,7 +15500,6 @@ DisResult disInstr_ARM_WRK (
          else
          if (!link
              && resteerCisOk
-             && vex_control.guest_chase_cond
              && dst >= guest_R15_curr_instr_notENC
              && resteerOkFn( callback_opaque, 
                              (Addr64)(Addr32)
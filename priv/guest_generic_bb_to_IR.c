@@ -101,6 +101,54 @@ static Bool const_False ( void* callback_opaque, Addr64 a ) {
    return False; 
 }
 
+/* State for a trace translation.  dis_instr_fn is handed one of
+   these as its callback_opaque, so that the resteer function it calls
+   is trace_resteer_ok, which only accepts the next address on the
+   path (and then only if the caller's chase_into_ok agrees). */
+typedef
+   struct {
+      const Addr64* trace;
+      UInt          trace_len;
+      UInt          next;  /* index of the next path address to reach */
+      Bool          (*chase_into_ok)(void*,Addr64);
+      void*         callback_opaque;
+   }
+   TraceState;
+
+static Bool trace_resteer_ok ( void* opaque, Addr64 a )
+{
+   TraceState* ts = (TraceState*)opaque;
+   return toBool(ts->next < ts->trace_len
+                 && a == ts->trace[ts->next]
+                 && ts->chase_into_ok(ts->callback_opaque, a));
+}
+
+/* Ask needs_self_check which of the extents in *vge need a check.
+   It takes a VexGuestExtents, which holds at most 3, so a trace's
+   extents are passed 3 at a time and the answers put together. */
+UInt bb_sc_extents ( UInt (*needs_self_check)(void*,VexGuestExtents*),
+                     void* callback_opaque,
+                     const VexGuestTraceExtents* vge )
+{
+   VexGuestExtents run;
+   UInt            mask = 0, run_mask;
+   Int             i, j;
+
+   for (i = 0; i < vge->n_used; i += 3) {
+      run.n_used = toUShort(vge->n_used - i < 3 ? vge->n_used - i : 3);
+      for (j = 0; j < 3; j++) {
+         run.base[j] = j < run.n_used ? vge->base[i+j] : 0;
+         run.len[j]  = j < run.n_used ? vge->len[i+j]  : 0;
+      }
+      run_mask = needs_self_check(callback_opaque, &run);
+      /* Caller shouldn't claim that nonexistent extents need a
+         check. */
+      vassert((run_mask >> run.n_used) == 0);
+      mask |= run_mask << i;
+   }
+   return mask;
+}
+
 /* Disassemble a complete basic block, starting at guest_IP_start, 
    returning a new IRSB.  The disassembler may chase across basic
    block boundaries if it wishes and if chase_into_ok allows it.
@@ -115,10 +163,9 @@ static Bool const_False ( void* callback_opaque, Addr64 a ) {
    needs_self_check is a callback used to ask the caller which of the
    extents, if any, a self check is required for.  The returned value
    is a bitmask with a 1 in position i indicating that the i'th extent
-   needs a check.  Since there can be at most 3 extents, the returned
-   values must be between 0 and 7.
+   needs a check.  Bits for extents that don't exist must be zero.
 
-   The number of extents which did get a self check (0 to 3) is put in
+   The number of extents which did get a self check is put in
    n_sc_extents.  The caller already knows this because it told us
    which extents to add checks for, via the needs_self_check callback,
    but we ship the number back out here for the caller's convenience.
@@ -138,6 +185,14 @@ static Bool const_False ( void* callback_opaque, Addr64 a ) {
    callback_opaque is a caller-supplied pointer to data which the
    callbacks may want to see.  Vex has no idea what it is.
    (In fact it's a VgInstrumentClosure.)
+
+   If trace_len is nonzero, trace[0 .. trace_len-1] is a path of
+   guest addresses, starting at guest_IP_bbstart, to be followed as a
+   single trace (see VexTranslateArgs.trace).  Resteers are then only
+   allowed to the next address on the path, conditional ones in
+   either direction, and there may be up to trace_len extents.  The
+   guest_max_insns limit applies to each block of the path separately
+   rather than to the trace as a whole.
 */
 
 /* Regarding IP updating.  dis_instr_fn (that does the guest specific
@@ -178,7 +233,7 @@ static Bool const_False ( void* callback_opaque, Addr64 a ) {
 */
 
 IRSB* bb_to_IR ( 
-         /*OUT*/VexGuestExtents* vge,
+         /*OUT*/VexGuestTraceExtents* vge,
          /*OUT*/UInt*            n_sc_extents,
          /*OUT*/UInt*            n_guest_instrs, /* stats only */
          /*IN*/ void*            callback_opaque,
@@ -186,6 +241,8 @@ IRSB* bb_to_IR (
          /*IN*/ UChar*           guest_code,
          /*IN*/ Addr64           guest_IP_bbstart,
          /*IN*/ Bool             (*chase_into_ok)(void*,Addr64),
+         /*IN*/ const Addr64*    trace,
+         /*IN*/ UInt             trace_len,
          /*IN*/ Bool             host_bigendian,
          /*IN*/ Bool             sigill_diag,
          /*IN*/ VexArch          arch_guest,
@@ -201,18 +258,22 @@ IRSB* bb_to_IR (
       )
 {
    Long       delta;
-   Int        i, n_instrs, first_stmt_idx;
-   Bool       resteerOK, debug_print;
+   Int        i, n_instrs, n_seg_instrs, first_stmt_idx;
+   Bool       resteerOK, resteerCOK, debug_print;
    DisResult  dres;
    IRStmt*    imark;
    IRStmt*    nop;
-   static Int n_resteers = 0;
+   static VEX_TLS Int n_resteers = 0;
    Int        d_resteers = 0;
    Int        selfcheck_idx = 0;
    IRSB*      irsb;
    Addr64     guest_IP_curr_instr;
    IRConst*   guest_IP_bbstart_IRConst = NULL;
    Int        n_cond_resteers_allowed = 2;
+   Bool       in_trace = toBool(trace_len > 0);
+   Int        max_extents = in_trace ? (Int)trace_len : 3;
+   TraceState ts;
+   void*      dis_opaque;
 
    Bool (*resteerOKfn)(void*,Addr64) = NULL;
 
@@ -225,6 +286,17 @@ IRSB* bb_to_IR (
    vassert(vex_control.guest_chase_thresh >= 0);
    vassert(vex_control.guest_chase_thresh < vex_control.guest_max_insns);
    vassert(guest_word_type == Ity_I32 || guest_word_type == Ity_I64);
+   vassert(trace_len <= VEX_MAX_TRACE_EXTENTS);
+   vassert(!in_trace || trace[0] == guest_IP_bbstart);
+
+   /* In a trace, dis_instr_fn's resteer callback gets the trace state
+      rather than the caller's opaque value; see trace_resteer_ok. */
+   ts.trace           = trace;
+   ts.trace_len       = trace_len;
+   ts.next            = 1;
+   ts.chase_into_ok   = chase_into_ok;
+   ts.callback_opaque = callback_opaque;
+   dis_opaque = in_trace ? (void*)&ts : callback_opaque;
 
    if (guest_word_type == Ity_I32) {
       vassert(szB_GUEST_IP == 4);
@@ -245,8 +317,9 @@ IRSB* bb_to_IR (
 
    /* Delta keeps track of how far along the guest_code array we have
       so far gone. */
-   delta    = 0;
-   n_instrs = 0;
+   delta        = 0;
+   n_instrs     = 0;
+   n_seg_instrs = 0;
    *n_guest_instrs = 0;
 
    /* Guest addresses as IRConsts.  Used in self-checks to specify the
@@ -256,13 +329,14 @@ IRSB* bb_to_IR (
            ? IRConst_U32(toUInt(guest_IP_bbstart))
            : IRConst_U64(guest_IP_bbstart);
 
-   /* Leave 15 spaces in which to put the check statements for a self
-      checking translation (up to 3 extents, and 5 stmts required for
-      each).  We won't know until later the extents and checksums of
-      the areas, if any, that need to be checked. */
+   /* Leave spaces in which to put the check statements for a self
+      checking translation (5 stmts required for each possible extent,
+      so 15 for an ordinary block).  We won't know until later the
+      extents and checksums of the areas, if any, that need to be
+      checked. */
    nop = IRStmt_NoOp();
    selfcheck_idx = irsb->stmts_used;
-   for (i = 0; i < 3 * 5; i++)
+   for (i = 0; i < max_extents * 5; i++)
       addStmtToIRSB( irsb, nop );
 
    /* If the caller supplied a function to add its own preamble, use
@@ -273,7 +347,7 @@ IRSB* bb_to_IR (
          /* The callback has completed the IR block without any guest
             insns being disassembled into it, so just return it at
             this point, even if a self-check was requested - as there
-            is nothing to self-check.  The 15 self-check no-ops will
+            is nothing to self-check.  The self-check no-ops will
             still be in place, but they are harmless. */
          return irsb;
       }
@@ -281,20 +355,26 @@ IRSB* bb_to_IR (
 
    /* Process instructions. */
    while (True) {
-      vassert(n_instrs < vex_control.guest_max_insns);
+      vassert(n_seg_instrs < vex_control.guest_max_insns);
 
       /* Regardless of what chase_into_ok says, is chasing permissible
-         at all right now?  Set resteerOKfn accordingly. */
-      resteerOK 
-         = toBool(
-              n_instrs < vex_control.guest_chase_thresh
-              /* we can't afford to have a resteer once we're on the
-                 last extent slot. */
-              && vge->n_used < 3
-           );
-
-      resteerOKfn
-         = resteerOK ? chase_into_ok : const_False;
+         at all right now?  Set resteerOKfn accordingly.  In a trace
+         it is as long as some of the path is left; each resteer
+         consumes one path address, so the extents can't run out. */
+      if (in_trace) {
+         resteerOK   = toBool(ts.next < trace_len);
+         resteerOKfn = resteerOK ? trace_resteer_ok : const_False;
+      } else {
+         resteerOK 
+            = toBool(
+                 n_instrs < vex_control.guest_chase_thresh
+                 /* we can't afford to have a resteer once we're on the
+                    last extent slot. */
+                 && vge->n_used < 3
+              );
+         resteerOKfn
+            = resteerOK ? chase_into_ok : const_False;
+      }
 
       /* n_cond_resteers_allowed keeps track of whether we're still
          allowing dis_instr_fn to chase conditional branches.  It
@@ -305,6 +385,13 @@ IRSB* bb_to_IR (
          branches. */
       vassert(n_cond_resteers_allowed >= 0 && n_cond_resteers_allowed <= 2);
 
+      /* Conditional chasing is off unless VexControl asks for it, but
+         a trace must follow its path whichever way a branch goes. */
+      resteerCOK
+         = in_trace ? True
+                    : toBool(vex_control.guest_chase_cond
+                             && n_cond_resteers_allowed > 0);
+
       /* This is the IP of the instruction we're just about to deal
          with. */
       guest_IP_curr_instr = guest_IP_bbstart + delta;
@@ -354,8 +441,8 @@ IRSB* bb_to_IR (
       vassert(irsb->next == NULL);
       dres = dis_instr_fn ( irsb,
                             resteerOKfn,
-                            toBool(n_cond_resteers_allowed > 0),
-                            callback_opaque,
+                            resteerCOK,
+                            dis_opaque,
                             guest_code,
                             delta,
                             guest_IP_curr_instr,
@@ -377,7 +464,7 @@ IRSB* bb_to_IR (
          vassert(dres.continueAt == 0);
       /* ... if we disallowed conditional resteers, check that one
              didn't actually happen anyway ... */
-      if (n_cond_resteers_allowed == 0)
+      if (!resteerCOK)
          vassert(dres.whatNext != Dis_ResteerC);
 
       /* Fill in the insn-mark length field. */
@@ -424,6 +511,7 @@ IRSB* bb_to_IR (
       vge->len[vge->n_used-1] 
          = toUShort(toUInt( vge->len[vge->n_used-1] + dres.len ));
       n_instrs++;
+      n_seg_instrs++;
 
       /* Advance delta (inconspicuous but very important :-) */
       delta += (Long)dres.len;
@@ -432,7 +520,15 @@ IRSB* bb_to_IR (
          case Dis_Continue:
             vassert(dres.continueAt == 0);
             vassert(dres.jk_StopHere == Ijk_INVALID);
-            if (n_instrs < vex_control.guest_max_insns) {
+            /* A trace may fall through into the next block on its
+               path; that needs no new extent, but it does start a
+               new block as far as the insn limit is concerned. */
+            if (in_trace && ts.next < trace_len
+                && guest_IP_bbstart + delta == ts.trace[ts.next]) {
+               ts.next++;
+               n_seg_instrs = 0;
+            }
+            if (n_seg_instrs < vex_control.guest_max_insns) {
                /* keep going */
             } else {
                /* We have to stop.  See comment above re irsb field
@@ -456,16 +552,20 @@ IRSB* bb_to_IR (
          case Dis_ResteerC:
             /* Check that we actually allowed a resteer .. */
             vassert(resteerOK);
-            if (dres.whatNext == Dis_ResteerC) {
+            if (dres.whatNext == Dis_ResteerC && !in_trace) {
                vassert(n_cond_resteers_allowed > 0);
                n_cond_resteers_allowed--;
             }
             /* figure out a new delta to continue at. */
-            vassert(resteerOKfn(callback_opaque,dres.continueAt));
+            vassert(resteerOKfn(dis_opaque,dres.continueAt));
             delta = dres.continueAt - guest_IP_bbstart;
+            if (in_trace) {
+               ts.next++;
+               n_seg_instrs = 0;
+            }
             /* we now have to start a new extent slot. */
             vge->n_used++;
-            vassert(vge->n_used <= 3);
+            vassert(vge->n_used <= max_extents);
             vge->base[vge->n_used-1] = dres.continueAt;
             vge->len[vge->n_used-1] = 0;
             n_resteers++;
@@ -485,7 +585,7 @@ IRSB* bb_to_IR (
   done:
    /* We're done.  The only thing that might need attending to is that
       a self-checking preamble may need to be created.  If so it gets
-      placed in the 15 slots reserved above.
+      placed in the slots reserved above.
 
       The scheme is to compute a rather crude checksum of the code
       we're making a translation of, and add to the IR a call to a
@@ -509,7 +609,7 @@ IRSB* bb_to_IR (
         They seem to cover about 90% of the cases that occur in
         practice.
 
-      We ask the caller, via needs_self_check, which of the 3 vge
+      We ask the caller, via needs_self_check, which of the vge
       extents needs a check, and only generate check code for those
       that do.
    */
@@ -527,19 +627,14 @@ IRSB* bb_to_IR (
       UInt     host_word_szB = sizeof(HWord);
       IRType   host_word_type = Ity_INVALID;
 
-      VexGuestExtents vge_tmp = *vge;
       UInt extents_needing_check
-         = needs_self_check(callback_opaque, &vge_tmp);
+         = bb_sc_extents(needs_self_check, callback_opaque, vge);
 
       if (host_word_szB == 4) host_word_type = Ity_I32;
       if (host_word_szB == 8) host_word_type = Ity_I64;
       vassert(host_word_type != Ity_INVALID);
 
-      vassert(vge->n_used >= 1 && vge->n_used <= 3);
-
-      /* Caller shouldn't claim that nonexistent extents need a
-         check. */
-      vassert((extents_needing_check >> vge->n_used) == 0);
+      vassert(vge->n_used >= 1 && vge->n_used <= max_extents);
 
       for (i = 0; i < vge->n_used; i++) {
 
@@ -127,9 +127,11 @@ typedef
       /*IN*/  Bool         (*resteerOkFn) ( /*opaque*/void*, Addr64 ),
 
       /* Should we speculatively resteer across conditional branches?
-         (Experimental and not enabled by default).  The strategy is
-         to assume that backward branches are taken and forward
-         branches are not taken. */
+         (Experimental and not enabled by default, except in trace
+         translations).  The strategy is to assume that backward
+         branches are taken and forward branches are not taken, and
+         failing that, if resteerOkFn refuses the assumed direction,
+         to try the other one. */
       /*IN*/  Bool         resteerCisOk,
 
       /* Vex-opaque data passed to all caller (valgrind) supplied
@@ -165,10 +167,17 @@ typedef
    Top-level BB to IR conversion fn.
    --------------------------------------------------------------- */
 
+/* Which of the extents in *vge need a self check, according to
+   needs_self_check.  See comment in bb_to_IR.c. */
+extern
+UInt bb_sc_extents ( UInt (*needs_self_check)(void*,VexGuestExtents*),
+                     void* callback_opaque,
+                     const VexGuestTraceExtents* vge );
+
 /* See detailed comment in bb_to_IR.c. */
 extern
 IRSB* bb_to_IR ( 
-         /*OUT*/VexGuestExtents* vge,
+         /*OUT*/VexGuestTraceExtents* vge,
          /*OUT*/UInt*            n_sc_extents,
          /*OUT*/UInt*            n_guest_instrs, /* stats only */
          /*IN*/ void*            callback_opaque,
@@ -176,6 +185,8 @@ IRSB* bb_to_IR (
          /*IN*/ UChar*           guest_code,
          /*IN*/ Addr64           guest_IP_bbstart,
          /*IN*/ Bool             (*chase_into_ok)(void*,Addr64),
+         /*IN*/ const Addr64*    trace,
+         /*IN*/ UInt             trace_len,
          /*IN*/ Bool             host_bigendian,
          /*IN*/ Bool             sigill_diag,
          /*IN*/ VexArch          arch_guest,
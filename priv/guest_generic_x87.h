@@ -135,6 +135,39 @@ extern Bool compute_PCMPxSTRx_wide ( /*OUT*/V128* resV,
                                      UInt zmaskL, UInt zmaskR,
                                      UInt imm8,   Bool isxSTRM );
 
+/* Fold the low szB (1, 2, 4 or 8) bytes of data into crc, giving
+   what the SSE4.2 CRC32 insn does.  CLEAN HELPER. */
+extern UInt x86amd64g_calc_crc32c ( UInt crc, ULong data, UInt szB );
+
+/* REP MOVS, STOS, CMPS and SCAS, done in bulk by dirty helpers for
+   the x86 and amd64 front ends.  cx, si and di are the count and
+   addresses, already reduced by the address size; ax holds the STOS
+   or SCAS operand.  dep1 and dep2 receive the operands of the last
+   CMPS or SCAS comparison, for the flags thunk. */
+typedef
+   struct {
+      ULong cx, si, di;
+      ULong ax;
+      ULong dep1, dep2;
+   }
+   X86AMD64RepState;
+
+#define X86AMD64_REP_MOVS  0
+#define X86AMD64_REP_STOS  1
+#define X86AMD64_REP_CMPS  2
+#define X86AMD64_REP_SCAS  3
+
+/* Do up to st->cx (which must be nonzero) iterations of op, on szB
+   byte elements, going downwards if down.  No element after the
+   first leaves the page of the first, so the caller can write the
+   registers back between calls and leave them exact should a later
+   access fault.  Returns False if a CMPS or SCAS stopped because the
+   elements compared equal (whileEq == False) or unequal
+   (whileEq == True). */
+extern Bool x86amd64g_rep_chunk ( /*MOD*/X86AMD64RepState* st, UInt op,
+                                  UInt szB, Bool down, Bool whileEq,
+                                  ULong addrMask );
+
 #endif /* ndef __VEX_GUEST_GENERIC_X87_H */
 
 /*---------------------------------------------------------------*/
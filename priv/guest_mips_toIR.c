@@ -52,28 +52,28 @@
 /* CONST: is the host bigendian?  This has to do with float vs double
    register accesses on VFP, but it's complex and not properly thought
    out. */
-static Bool host_is_bigendian;
+static VEX_TLS Bool host_is_bigendian;
 
 /* Pointer to the guest code area. */
-static UChar *guest_code;
+static VEX_TLS UChar *guest_code;
 
 /* CONST: The guest address for the instruction currently being
    translated. */
 #if defined(VGP_mips32_linux)
-static Addr32 guest_PC_curr_instr;
+static VEX_TLS Addr32 guest_PC_curr_instr;
 #else
-static Addr64 guest_PC_curr_instr;
+static VEX_TLS Addr64 guest_PC_curr_instr;
 #endif
 
 /* MOD: The IRSB* into which we're generating code. */
-static IRSB *irsb;
+static VEX_TLS IRSB *irsb;
 
 /* Is our guest binary 32 or 64bit? Set at each call to
    disInstr_MIPS below. */
-static Bool mode64 = False;
+static VEX_TLS Bool mode64 = False;
 
 /* CPU has FPU and 32 dbl. prec. FP registers. */
-static Bool fp_mode64 = False;
+static VEX_TLS Bool fp_mode64 = False;
 
 /* Define 1.0 in single and double precision. */
 #define ONE_SINGLE 0x3F800000
@@ -11692,8 +11692,8 @@ static DisResult disInstr_MIPS_WRK ( Bool(*resteerOkFn) (/*opaque */void *,
 
    DisResult dres;
 
-   static IRExpr *lastn = NULL;  /* last jump addr */
-   static IRStmt *bstmt = NULL;  /* branch (Exit) stmt */
+   static VEX_TLS IRExpr *lastn = NULL;  /* last jump addr */
+   static VEX_TLS IRStmt *bstmt = NULL;  /* branch (Exit) stmt */
 
    /* The running delta */
    Int delta = (Int) delta64;
@@ -148,24 +148,24 @@
    given insn. */
 
 /* We need to know this to do sub-register accesses correctly. */
-static Bool host_is_bigendian;
+static VEX_TLS Bool host_is_bigendian;
 
 /* Pointer to the guest code area. */
-static UChar* guest_code;
+static VEX_TLS UChar* guest_code;
 
 /* The guest address corresponding to guest_code[0]. */
-static Addr64 guest_CIA_bbstart;
+static VEX_TLS Addr64 guest_CIA_bbstart;
 
 /* The guest address for the instruction currently being
    translated. */
-static Addr64 guest_CIA_curr_instr;
+static VEX_TLS Addr64 guest_CIA_curr_instr;
 
 /* The IRSB* into which we're generating code. */
-static IRSB* irsb;
+static VEX_TLS IRSB* irsb;
 
 /* Is our guest binary 32 or 64bit?  Set at each call to
    disInstr_PPC below. */
-static Bool mode64 = False;
+static VEX_TLS Bool mode64 = False;
 
 // Given a pointer to a function as obtained by "& functionname" in C,
 // produce a pointer to the actual entry point for the function.  For
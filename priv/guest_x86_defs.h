@@ -163,6 +163,9 @@ extern void x86g_dirtyhelper_OUT ( UInt portno, UInt data,
 extern void x86g_dirtyhelper_SxDT ( void* address,
                                     UInt op /* 0 or 1 */ );
 
+extern UInt x86g_dirtyhelper_REP ( VexGuestX86State* gst, UInt op,
+                                   UInt szB, UInt whileEq );
+
 extern VexEmNote
             x86g_dirtyhelper_FXRSTOR ( VexGuestX86State*, HWord );
 
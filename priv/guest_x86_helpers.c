@@ -2496,6 +2496,50 @@ void x86g_dirtyhelper_SxDT ( void *address, UInt op ) {
 #  endif
 }
 
+/* CALLED FROM GENERATED CODE */
+/* DIRTY HELPER (reads guest state, writes guest state, reads and
+   writes guest memory) */
+/* Do a run of iterations of REP MOVS, STOS, CMPS or SCAS (op is one
+   of the X86AMD64_REP_ values), on szB byte elements.  ECX must be
+   nonzero.  CMPS and SCAS stop early as REPE does if whileEq, as
+   REPNE does otherwise.  Leaves ECX, ESI, EDI and, for CMPS and
+   SCAS, the flags thunk as the iterations done so far would have;
+   returns 1 if the insn is not yet finished and must be run
+   again. */
+UInt x86g_dirtyhelper_REP ( VexGuestX86State* gst, UInt op,
+                            UInt szB, UInt whileEq )
+{
+   /* Give the dispatcher a look-in every so many pages. */
+   const Int maxChunks = 64;
+   X86AMD64RepState st;
+   Bool down = gst->guest_DFLAG != 1;
+   Bool more;
+   Int  i;
+
+   st.cx = gst->guest_ECX;
+   st.si = gst->guest_ESI;
+   st.di = gst->guest_EDI;
+   st.ax = gst->guest_EAX;
+   for (i = 0; ; i++) {
+      more = x86amd64g_rep_chunk( &st, op, szB, down, whileEq != 0,
+                                  0xFFFFFFFFULL );
+      gst->guest_ECX = (UInt)st.cx;
+      gst->guest_EDI = (UInt)st.di;
+      if (op == X86AMD64_REP_MOVS || op == X86AMD64_REP_CMPS)
+         gst->guest_ESI = (UInt)st.si;
+      if (op == X86AMD64_REP_CMPS || op == X86AMD64_REP_SCAS) {
+         gst->guest_CC_OP   = X86G_CC_OP_SUBB
+                              + (szB == 1 ? 0 : szB == 2 ? 1 : 2);
+         gst->guest_CC_DEP1 = (UInt)st.dep1;
+         gst->guest_CC_DEP2 = (UInt)st.dep2;
+      }
+      if (!more || st.cx == 0)
+         return 0;
+      if (i == maxChunks-1)
+         return 1;
+   }
+}
+
 /*---------------------------------------------------------------*/
 /*--- Helpers for MMX/SSE/SSE2.                               ---*/
 /*---------------------------------------------------------------*/
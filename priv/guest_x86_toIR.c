@@ -199,21 +199,21 @@
    given insn. */
 
 /* We need to know this to do sub-register accesses correctly. */
-static Bool host_is_bigendian;
+static VEX_TLS Bool host_is_bigendian;
 
 /* Pointer to the guest code area (points to start of BB, not to the
    insn being processed). */
-static UChar* guest_code;
+static VEX_TLS UChar* guest_code;
 
 /* The guest address corresponding to guest_code[0]. */
-static Addr32 guest_EIP_bbstart;
+static VEX_TLS Addr32 guest_EIP_bbstart;
 
 /* The guest address for the instruction currently being
    translated. */
-static Addr32 guest_EIP_curr_instr;
+static VEX_TLS Addr32 guest_EIP_curr_instr;
 
 /* The IRSB* into which we're generating code. */
-static IRSB* irsb;
+static VEX_TLS IRSB* irsb;
 
 
 /*------------------------------------------------------------*/
@@ -3280,6 +3280,83 @@ void dis_SCAS ( Int sz, IRTemp t_inc )
 }
 
 
+/* REP MOVS/STOS and REPE/REPNE CMPS/SCAS as a call to
+   x86g_dirtyhelper_REP, which does up to a few hundred KB worth of
+   iterations and says whether there are any left.  Like the
+   single-iteration version, skips the insn entirely if the count
+   is zero, so that the helper always does at least one iteration
+   and so always sets the flags thunk for CMPS/SCAS. */
+static
+void dis_REP_bulk ( /*MOD*/DisResult* dres,
+                    X86Condcode cond,
+                    void (*dis_OP)(Int, IRTemp),
+                    Int sz, Addr32 eip, Addr32 eip_next )
+{
+   Bool     cmp  = dis_OP == dis_CMPS || dis_OP == dis_SCAS;
+   UInt     op   = dis_OP == dis_MOVS ? X86AMD64_REP_MOVS
+                   : dis_OP == dis_STOS ? X86AMD64_REP_STOS
+                   : dis_OP == dis_CMPS ? X86AMD64_REP_CMPS
+                   : X86AMD64_REP_SCAS;
+   IRTemp   more = newTemp(Ity_I32);
+   IRDirty* d;
+
+   stmt( IRStmt_Exit( binop(Iop_CmpEQ32, getIReg(4,R_ECX), mkU32(0)),
+                      Ijk_Boring,
+                      IRConst_U32(eip_next), OFFB_EIP ) );
+
+   /* So that EIP is right should the helper fault. */
+   stmt( IRStmt_Put( OFFB_EIP, mkU32(eip) ) );
+
+   d = unsafeIRDirty_1_N(
+          more, 0/*regparms*/,
+          "x86g_dirtyhelper_REP", &x86g_dirtyhelper_REP,
+          mkIRExprVec_4( IRExpr_BBPTR(), mkU32(op), mkU32(sz),
+                         mkU32(cond == X86CondZ ? 1 : 0) )
+       );
+   /* The memory accesses are not declared: there is no way to say
+      how many there are.  Hence VexControl.guest_rep_bulk, which is
+      off unless the client asks for it. */
+   d->nFxState = 0;
+   vex_bzero(&d->fxState, sizeof(d->fxState));
+   d->fxState[d->nFxState].fx     = Ifx_Read;
+   d->fxState[d->nFxState].offset = OFFB_EIP;
+   d->fxState[d->nFxState].size   = 4;
+   d->nFxState++;
+   d->fxState[d->nFxState].fx     = Ifx_Read;
+   d->fxState[d->nFxState].offset = OFFB_DFLAG;
+   d->fxState[d->nFxState].size   = 4;
+   d->nFxState++;
+   d->fxState[d->nFxState].fx     = Ifx_Modify;
+   d->fxState[d->nFxState].offset = OFFB_ECX;
+   d->fxState[d->nFxState].size   = 4;
+   d->nFxState++;
+   /* ESI and EDI are adjacent. */
+   d->fxState[d->nFxState].fx     = Ifx_Modify;
+   d->fxState[d->nFxState].offset = OFFB_ESI;
+   d->fxState[d->nFxState].size   = 8;
+   d->nFxState++;
+   if (dis_OP != dis_MOVS && dis_OP != dis_CMPS) {
+      d->fxState[d->nFxState].fx     = Ifx_Read;
+      d->fxState[d->nFxState].offset = OFFB_EAX;
+      d->fxState[d->nFxState].size   = 4;
+      d->nFxState++;
+   }
+   if (cmp) {
+      /* CC_OP, CC_DEP1 and CC_DEP2 are adjacent. */
+      d->fxState[d->nFxState].fx     = Ifx_Write;
+      d->fxState[d->nFxState].offset = OFFB_CC_OP;
+      d->fxState[d->nFxState].size   = 12;
+      d->nFxState++;
+   }
+   stmt( IRStmt_Dirty(d) );
+
+   stmt( IRStmt_Exit( binop(Iop_CmpNE32, mkexpr(more), mkU32(0)),
+                      Ijk_Boring,
+                      IRConst_U32(eip), OFFB_EIP ) );
+   jmp_lit(dres, Ijk_Boring, eip_next);
+   vassert(dres->whatNext == Dis_StopHere);
+}
+
 /* Wrap the appropriate string op inside a REP/REPE/REPNE.
    We assume the insn is the last one in the basic block, and so emit a jump
    to the next insn, rather than just falling through. */
@@ -3292,6 +3369,16 @@ void dis_REP_op ( /*MOD*/DisResult* dres,
    IRTemp t_inc = newTemp(Ity_I32);
    IRTemp tc    = newTemp(Ity_I32);  /*  ECX  */
 
+   if (vex_control.guest_rep_bulk
+       && ((cond == X86CondAlways
+            && (dis_OP == dis_MOVS || dis_OP == dis_STOS))
+           || ((cond == X86CondZ || cond == X86CondNZ)
+               && (dis_OP == dis_CMPS || dis_OP == dis_SCAS)))) {
+      dis_REP_bulk(dres, cond, dis_OP, sz, eip, eip_next);
+      DIP("%s%c\n", name, nameISize(sz));
+      return;
+   }
+
    assign( tc, getIReg(4,R_ECX) );
 
    stmt( IRStmt_Exit( binop(Iop_CmpEQ32,mkexpr(tc),mkU32(0)),
@@ -13336,7 +13423,6 @@ DisResult disInstr_X86_WRK (
       d32 = (((Addr32)guest_EIP_bbstart)+delta+1) + jmpDelta; 
       delta++;
       if (resteerCisOk
-          && vex_control.guest_chase_cond
           && (Addr32)d32 != (Addr32)guest_EIP_bbstart
           && jmpDelta < 0
           && resteerOkFn( callback_opaque, (Addr64)(Addr32)d32) ) {
@@ -13357,7 +13443,6 @@ DisResult disInstr_X86_WRK (
       }
       else
       if (resteerCisOk
-          && vex_control.guest_chase_cond
           && (Addr32)d32 != (Addr32)guest_EIP_bbstart
           && jmpDelta >= 0
           && resteerOkFn( callback_opaque, 
@@ -14900,7 +14985,6 @@ DisResult disInstr_X86_WRK (
          d32 = (((Addr32)guest_EIP_bbstart)+delta+4) + jmpDelta;
          delta += 4;
          if (resteerCisOk
-             && vex_control.guest_chase_cond
              && (Addr32)d32 != (Addr32)guest_EIP_bbstart
              && jmpDelta < 0
              && resteerOkFn( callback_opaque, (Addr64)(Addr32)d32) ) {
@@ -14922,7 +15006,6 @@ DisResult disInstr_X86_WRK (
          }
          else
          if (resteerCisOk
-             && vex_control.guest_chase_cond
              && (Addr32)d32 != (Addr32)guest_EIP_bbstart
              && jmpDelta >= 0
              && resteerOkFn( callback_opaque, 
@@ -72,6 +72,11 @@ void ppHRegAMD64 ( HReg reg )
          vassert(r >= 0 && r < 16);
          vex_printf("%%xmm%d", r);
          return;
+      case HRcVec256:
+         r = hregNumber(reg);
+         vassert(r >= 0 && r < 16);
+         vex_printf("%%ymm%d", r);
+         return;
       default:
          vpanic("ppHRegAMD64");
    }
@@ -118,6 +123,12 @@ HReg hregAMD64_R13 ( void ) { return mkHReg(13, HRcInt64, False); }
 HReg hregAMD64_R14 ( void ) { return mkHReg(14, HRcInt64, False); }
 HReg hregAMD64_R15 ( void ) { return mkHReg(15, HRcInt64, False); }
 
+HReg hregAMD64_CachedGuest ( Int i )
+{
+   vassert(i >= 0 && i < VEX_N_CACHED_GUEST_REGS);
+   return mkHReg(15 - i, HRcInt64, False);
+}
+
 HReg hregAMD64_XMM0  ( void ) { return mkHReg( 0, HRcVec128, False); }
 HReg hregAMD64_XMM1  ( void ) { return mkHReg( 1, HRcVec128, False); }
 HReg hregAMD64_XMM3  ( void ) { return mkHReg( 3, HRcVec128, False); }
@@ -131,9 +142,17 @@ HReg hregAMD64_XMM10 ( void ) { return mkHReg(10, HRcVec128, False); }
 HReg hregAMD64_XMM11 ( void ) { return mkHReg(11, HRcVec128, False); }
 HReg hregAMD64_XMM12 ( void ) { return mkHReg(12, HRcVec128, False); }
 
+/* The 256-bit class lives in the top three registers, which the
+   128-bit class never uses, so the two never alias. */
+HReg hregAMD64_YMM13 ( void ) { return mkHReg(13, HRcVec256, False); }
+HReg hregAMD64_YMM14 ( void ) { return mkHReg(14, HRcVec256, False); }
+HReg hregAMD64_YMM15 ( void ) { return mkHReg(15, HRcVec256, False); }
 
-void getAllocableRegs_AMD64 ( Int* nregs, HReg** arr )
+
+void getAllocableRegs_AMD64 ( Int* nregs, HReg** arr, UInt hwcaps,
+                              VexAbiInfo* vbi )
 {
+   Int i, j, k;
 #if 0
    *nregs = 6;
    *arr = LibVEX_Alloc(*nregs * sizeof(HReg));
@@ -146,7 +165,7 @@ void getAllocableRegs_AMD64 ( Int* nregs, HReg** arr )
    (*arr)[ 5] = hregAMD64_XMM9();
 #endif
 #if 1
-   *nregs = 20;
+   *nregs = (hwcaps & VEX_HWCAPS_AMD64_AVX) ? 23 : 20;
    *arr = LibVEX_Alloc(*nregs * sizeof(HReg));
    (*arr)[ 0] = hregAMD64_RSI();
    (*arr)[ 1] = hregAMD64_RDI();
@@ -169,7 +188,49 @@ void getAllocableRegs_AMD64 ( Int* nregs, HReg** arr )
    (*arr)[17] = hregAMD64_XMM11();
    (*arr)[18] = hregAMD64_XMM12();
    (*arr)[19] = hregAMD64_R10();
+
+   if (hwcaps & VEX_HWCAPS_AMD64_AVX) {
+      (*arr)[20] = hregAMD64_YMM13();
+      (*arr)[21] = hregAMD64_YMM14();
+      (*arr)[22] = hregAMD64_YMM15();
+   }
 #endif
+   /* Take out those holding cached guest registers. */
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++) {
+      if (vbi->host_amd64_cached_guest_offsets[i] == 0)
+         continue;
+      for (j = k = 0; j < *nregs; j++)
+         if (!sameHReg((*arr)[j], hregAMD64_CachedGuest(i)))
+            (*arr)[k++] = (*arr)[j];
+      vassert(k == *nregs - 1);
+      *nregs = k;
+   }
+}
+
+/* The registers which keep values round a loop within a block (see
+   iselSB_AMD64).  They are callee-saved, so that helper calls in the
+   loop leave them alone, and not holding cached guest registers.
+   Only three of them, so as to leave the allocator enough to work
+   with in the loop. */
+void getLoopRegs_AMD64 ( Int* nregs, HReg** arr, VexAbiInfo* vbi )
+{
+   HReg cands[5];
+   Int  i, j;
+   cands[0] = hregAMD64_RBX();
+   cands[1] = hregAMD64_R12();
+   cands[2] = hregAMD64_R13();
+   cands[3] = hregAMD64_R14();
+   cands[4] = hregAMD64_R15();
+   *nregs = 0;
+   *arr   = LibVEX_Alloc(3 * sizeof(HReg));
+   for (i = 0; i < 5 && *nregs < 3; i++) {
+      for (j = 0; j < VEX_N_CACHED_GUEST_REGS; j++)
+         if (vbi->host_amd64_cached_guest_offsets[j] != 0
+             && sameHReg(cands[i], hregAMD64_CachedGuest(j)))
+            break;
+      if (j == VEX_N_CACHED_GUEST_REGS)
+         (*arr)[(*nregs)++] = cands[i];
+   }
 }
 
 
@@ -601,6 +662,11 @@ const HChar* showAMD64SseOp ( AMD64SseOp op ) {
       case Asse_UNPCKLW:  return "punpcklw";
       case Asse_UNPCKLD:  return "punpckld";
       case Asse_UNPCKLQ:  return "punpcklq";
+      case Asse_AESENC:   return "aesenc";
+      case Asse_AESENCLAST: return "aesenclast";
+      case Asse_AESDEC:   return "aesdec";
+      case Asse_AESDECLAST: return "aesdeclast";
+      case Asse_AESIMC:   return "aesimc";
       default: vpanic("showAMD64SseOp");
    }
 }
@@ -735,6 +801,25 @@ AMD64Instr* AMD64Instr_XAssisted ( HReg dstGA, AMD64AMode* amRIP,
    i->Ain.XAssisted.jk    = jk;
    return i;
 }
+AMD64Instr* AMD64Instr_XHost ( HReg dstGA, AMD64AMode* amRIP,
+                               HReg dstHA, AMD64CondCode cond ) {
+   AMD64Instr* i      = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag             = Ain_XHost;
+   i->Ain.XHost.dstGA = dstGA;
+   i->Ain.XHost.amRIP = amRIP;
+   i->Ain.XHost.dstHA = dstHA;
+   i->Ain.XHost.cond  = cond;
+   return i;
+}
+AMD64Instr* AMD64Instr_RSPush ( Addr64 retGA, AMD64AMode* amRIP,
+                                AMD64AMode* amHA ) {
+   AMD64Instr* i       = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag              = Ain_RSPush;
+   i->Ain.RSPush.retGA = retGA;
+   i->Ain.RSPush.amRIP = amRIP;
+   i->Ain.RSPush.amHA  = amHA;
+   return i;
+}
 
 AMD64Instr* AMD64Instr_CMov64 ( AMD64CondCode cond, AMD64RM* src, HReg dst ) {
    AMD64Instr* i      = LibVEX_Alloc(sizeof(AMD64Instr));
@@ -788,6 +873,15 @@ AMD64Instr* AMD64Instr_Bsfr64 ( Bool isFwds, HReg src, HReg dst ) {
    i->Ain.Bsfr64.dst    = dst;
    return i;
 }
+AMD64Instr* AMD64Instr_CRC32C ( Int szB, AMD64RM* src, HReg dst ) {
+   AMD64Instr* i       = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag              = Ain_CRC32C;
+   i->Ain.CRC32C.szB   = toUChar(szB);
+   i->Ain.CRC32C.src   = src;
+   i->Ain.CRC32C.dst   = dst;
+   vassert(szB == 1 || szB == 2 || szB == 4 || szB == 8);
+   return i;
+}
 AMD64Instr* AMD64Instr_MFence ( void ) {
    AMD64Instr* i = LibVEX_Alloc(sizeof(AMD64Instr));
    i->tag        = Ain_MFence;
@@ -930,7 +1024,16 @@ AMD64Instr* AMD64Instr_Sse32FLo ( AMD64SseOp op, HReg src, HReg dst ) {
    AMD64Instr* i       = LibVEX_Alloc(sizeof(AMD64Instr));
    i->tag              = Ain_Sse32FLo;
    i->Ain.Sse32FLo.op  = op;
-   i->Ain.Sse32FLo.src = src;
+   i->Ain.Sse32FLo.src = AMD64RM_Reg(src);
+   i->Ain.Sse32FLo.dst = dst;
+   vassert(op != Asse_MOV);
+   return i;
+}
+AMD64Instr* AMD64Instr_Sse32FLoM ( AMD64SseOp op, AMD64AMode* src, HReg dst ) {
+   AMD64Instr* i       = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag              = Ain_Sse32FLo;
+   i->Ain.Sse32FLo.op  = op;
+   i->Ain.Sse32FLo.src = AMD64RM_Mem(src);
    i->Ain.Sse32FLo.dst = dst;
    vassert(op != Asse_MOV);
    return i;
@@ -948,7 +1051,16 @@ AMD64Instr* AMD64Instr_Sse64FLo ( AMD64SseOp op, HReg src, HReg dst ) {
    AMD64Instr* i       = LibVEX_Alloc(sizeof(AMD64Instr));
    i->tag              = Ain_Sse64FLo;
    i->Ain.Sse64FLo.op  = op;
-   i->Ain.Sse64FLo.src = src;
+   i->Ain.Sse64FLo.src = AMD64RM_Reg(src);
+   i->Ain.Sse64FLo.dst = dst;
+   vassert(op != Asse_MOV);
+   return i;
+}
+AMD64Instr* AMD64Instr_Sse64FLoM ( AMD64SseOp op, AMD64AMode* src, HReg dst ) {
+   AMD64Instr* i       = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag              = Ain_Sse64FLo;
+   i->Ain.Sse64FLo.op  = op;
+   i->Ain.Sse64FLo.src = AMD64RM_Mem(src);
    i->Ain.Sse64FLo.dst = dst;
    vassert(op != Asse_MOV);
    return i;
@@ -979,23 +1091,84 @@ AMD64Instr* AMD64Instr_SseShuf ( Int order, HReg src, HReg dst ) {
    vassert(order >= 0 && order <= 0xFF);
    return i;
 }
-//uu AMD64Instr* AMD64Instr_AvxLdSt ( Bool isLoad,
-//uu                                  HReg reg, AMD64AMode* addr ) {
-//uu    AMD64Instr* i         = LibVEX_Alloc(sizeof(AMD64Instr));
-//uu    i->tag                = Ain_AvxLdSt;
-//uu    i->Ain.AvxLdSt.isLoad = isLoad;
-//uu    i->Ain.AvxLdSt.reg    = reg;
-//uu    i->Ain.AvxLdSt.addr   = addr;
-//uu    return i;
-//uu }
-//uu AMD64Instr* AMD64Instr_AvxReRg ( AMD64SseOp op, HReg re, HReg rg ) {
-//uu    AMD64Instr* i      = LibVEX_Alloc(sizeof(AMD64Instr));
-//uu    i->tag             = Ain_AvxReRg;
-//uu    i->Ain.AvxReRg.op  = op;
-//uu    i->Ain.AvxReRg.src = re;
-//uu    i->Ain.AvxReRg.dst = rg;
-//uu    return i;
-//uu }
+AMD64Instr* AMD64Instr_SseCLMul ( Int imm, HReg src, HReg dst ) {
+   AMD64Instr* i         = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag                = Ain_SseCLMul;
+   i->Ain.SseCLMul.imm   = imm;
+   i->Ain.SseCLMul.src   = src;
+   i->Ain.SseCLMul.dst   = dst;
+   vassert((imm & ~0x11) == 0);
+   return i;
+}
+AMD64Instr* AMD64Instr_SseFMA ( UChar szB, Bool isSub, HReg mul,
+                                HReg add, HReg dst ) {
+   AMD64Instr* i        = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag               = Ain_SseFMA;
+   i->Ain.SseFMA.szB    = szB;
+   i->Ain.SseFMA.isSub  = isSub;
+   i->Ain.SseFMA.mul    = mul;
+   i->Ain.SseFMA.add    = add;
+   i->Ain.SseFMA.dst    = dst;
+   vassert(szB == 4 || szB == 8);
+   return i;
+}
+AMD64Instr* AMD64Instr_AvxLdSt ( Bool isLoad,
+                                 HReg reg, AMD64AMode* addr ) {
+   AMD64Instr* i         = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag                = Ain_AvxLdSt;
+   i->Ain.AvxLdSt.isLoad = isLoad;
+   i->Ain.AvxLdSt.reg    = reg;
+   i->Ain.AvxLdSt.addr   = addr;
+   return i;
+}
+AMD64Instr* AMD64Instr_Avx32Fx8 ( AMD64SseOp op,
+                                  HReg srcL, HReg srcR, HReg dst ) {
+   AMD64Instr* i         = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag                = Ain_Avx32Fx8;
+   i->Ain.Avx32Fx8.op    = op;
+   i->Ain.Avx32Fx8.srcL  = srcL;
+   i->Ain.Avx32Fx8.srcR  = srcR;
+   i->Ain.Avx32Fx8.dst   = dst;
+   vassert(op != Asse_MOV);
+   return i;
+}
+AMD64Instr* AMD64Instr_Avx64Fx4 ( AMD64SseOp op,
+                                  HReg srcL, HReg srcR, HReg dst ) {
+   AMD64Instr* i         = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag                = Ain_Avx64Fx4;
+   i->Ain.Avx64Fx4.op    = op;
+   i->Ain.Avx64Fx4.srcL  = srcL;
+   i->Ain.Avx64Fx4.srcR  = srcR;
+   i->Ain.Avx64Fx4.dst   = dst;
+   vassert(op != Asse_MOV);
+   return i;
+}
+AMD64Instr* AMD64Instr_AvxReRg ( AMD64SseOp op,
+                                 HReg srcL, HReg srcR, HReg dst ) {
+   AMD64Instr* i        = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag               = Ain_AvxReRg;
+   i->Ain.AvxReRg.op    = op;
+   i->Ain.AvxReRg.srcL  = srcL;
+   i->Ain.AvxReRg.srcR  = srcR;
+   i->Ain.AvxReRg.dst   = dst;
+   return i;
+}
+AMD64Instr* AMD64Instr_AvxInsHi ( HReg hi, HReg lo, HReg dst ) {
+   AMD64Instr* i        = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag               = Ain_AvxInsHi;
+   i->Ain.AvxInsHi.hi   = hi;
+   i->Ain.AvxInsHi.lo   = lo;
+   i->Ain.AvxInsHi.dst  = dst;
+   return i;
+}
+AMD64Instr* AMD64Instr_AvxExtract ( Bool hi, HReg src, HReg dst ) {
+   AMD64Instr* i          = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag                 = Ain_AvxExtract;
+   i->Ain.AvxExtract.hi   = hi;
+   i->Ain.AvxExtract.src  = src;
+   i->Ain.AvxExtract.dst  = dst;
+   return i;
+}
 AMD64Instr* AMD64Instr_EvCheck ( AMD64AMode* amCounter,
                                  AMD64AMode* amFailAddr ) {
    AMD64Instr* i             = LibVEX_Alloc(sizeof(AMD64Instr));
@@ -1009,6 +1182,25 @@ AMD64Instr* AMD64Instr_ProfInc ( void ) {
    i->tag        = Ain_ProfInc;
    return i;
 }
+AMD64Instr* AMD64Instr_LoopHead ( void ) {
+   AMD64Instr* i = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag        = Ain_LoopHead;
+   return i;
+}
+AMD64Instr* AMD64Instr_LoopBack ( Addr64 dstGA, AMD64AMode* amRIP,
+                                  AMD64AMode* amCounter,
+                                  AMD64AMode* amFailAddr,
+                                  Int nRegs, HReg* regs ) {
+   AMD64Instr* i              = LibVEX_Alloc(sizeof(AMD64Instr));
+   i->tag                     = Ain_LoopBack;
+   i->Ain.LoopBack.dstGA      = dstGA;
+   i->Ain.LoopBack.amRIP      = amRIP;
+   i->Ain.LoopBack.amCounter  = amCounter;
+   i->Ain.LoopBack.amFailAddr = amFailAddr;
+   i->Ain.LoopBack.nRegs      = nRegs;
+   i->Ain.LoopBack.regs       = regs;
+   return i;
+}
 
 void ppAMD64Instr ( AMD64Instr* i, Bool mode64 ) 
 {
@@ -1114,6 +1306,25 @@ void ppAMD64Instr ( AMD64Instr* i, Bool mode64 )
                     (Int)i->Ain.XAssisted.jk);
          vex_printf("; movabsq $disp_assisted,%%r11; jmp *%%r11 }");
          return;
+      case Ain_XHost:
+         vex_printf("(xHost) ");
+         vex_printf("if (%%rflags.%s) { ",
+                    showAMD64CondCode(i->Ain.XHost.cond));
+         vex_printf("movq ");
+         ppHRegAMD64(i->Ain.XHost.dstGA);
+         vex_printf(",");
+         ppAMD64AMode(i->Ain.XHost.amRIP);
+         vex_printf("; jmp *");
+         ppHRegAMD64(i->Ain.XHost.dstHA);
+         vex_printf(" }");
+         return;
+      case Ain_RSPush:
+         vex_printf("(rsPush) jmp 1f; 0: (xDirect) 0x%llx via ",
+                    i->Ain.RSPush.retGA);
+         ppAMD64AMode(i->Ain.RSPush.amRIP);
+         vex_printf("; 1: leaq 0b(%%rip),%%r11; movq %%r11,");
+         ppAMD64AMode(i->Ain.RSPush.amHA);
+         return;
 
       case Ain_CMov64:
          vex_printf("cmov%s ", showAMD64CondCode(i->Ain.CMov64.cond));
@@ -1161,6 +1372,12 @@ void ppAMD64Instr ( AMD64Instr* i, Bool mode64 )
          vex_printf(",");
          ppHRegAMD64(i->Ain.Bsfr64.dst);
          return;
+      case Ain_CRC32C:
+         vex_printf("crc32%c ", "?bw?l???q"[i->Ain.CRC32C.szB]);
+         ppAMD64RM(i->Ain.CRC32C.src);
+         vex_printf(",");
+         ppHRegAMD64_lo32(i->Ain.CRC32C.dst);
+         return;
       case Ain_MFence:
          vex_printf("mfence" );
          return;
@@ -1258,7 +1475,7 @@ void ppAMD64Instr ( AMD64Instr* i, Bool mode64 )
          return;
       case Ain_Sse32FLo:
          vex_printf("%sss ", showAMD64SseOp(i->Ain.Sse32FLo.op));
-         ppHRegAMD64(i->Ain.Sse32FLo.src);
+         ppAMD64RM(i->Ain.Sse32FLo.src);
          vex_printf(",");
          ppHRegAMD64(i->Ain.Sse32FLo.dst);
          return;
@@ -1270,7 +1487,7 @@ void ppAMD64Instr ( AMD64Instr* i, Bool mode64 )
          return;
       case Ain_Sse64FLo:
          vex_printf("%ssd ", showAMD64SseOp(i->Ain.Sse64FLo.op));
-         ppHRegAMD64(i->Ain.Sse64FLo.src);
+         ppAMD64RM(i->Ain.Sse64FLo.src);
          vex_printf(",");
          ppHRegAMD64(i->Ain.Sse64FLo.dst);
          return;
@@ -1292,24 +1509,71 @@ void ppAMD64Instr ( AMD64Instr* i, Bool mode64 )
          vex_printf(",");
          ppHRegAMD64(i->Ain.SseShuf.dst);
          return;
-      //uu case Ain_AvxLdSt:
-      //uu    vex_printf("vmovups ");
-      //uu    if (i->Ain.AvxLdSt.isLoad) {
-      //uu       ppAMD64AMode(i->Ain.AvxLdSt.addr);
-      //uu       vex_printf(",");
-      //uu       ppHRegAMD64(i->Ain.AvxLdSt.reg);
-      //uu    } else {
-      //uu       ppHRegAMD64(i->Ain.AvxLdSt.reg);
-      //uu       vex_printf(",");
-      //uu       ppAMD64AMode(i->Ain.AvxLdSt.addr);
-      //uu    }
-      //uu    return;
-      //uu case Ain_AvxReRg:
-      //uu    vex_printf("v%s ", showAMD64SseOp(i->Ain.SseReRg.op));
-      //uu    ppHRegAMD64(i->Ain.AvxReRg.src);
-      //uu    vex_printf(",");
-      //uu    ppHRegAMD64(i->Ain.AvxReRg.dst);
-      //uu    return;
+      case Ain_SseCLMul:
+         vex_printf("pclmulqdq $0x%x,", i->Ain.SseCLMul.imm);
+         ppHRegAMD64(i->Ain.SseCLMul.src);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.SseCLMul.dst);
+         return;
+      case Ain_SseFMA:
+         vex_printf("vfm%s213s%c ", i->Ain.SseFMA.isSub ? "sub" : "add",
+                    i->Ain.SseFMA.szB == 8 ? 'd' : 's');
+         ppHRegAMD64(i->Ain.SseFMA.add);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.SseFMA.mul);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.SseFMA.dst);
+         return;
+      case Ain_AvxLdSt:
+         vex_printf("vmovups ");
+         if (i->Ain.AvxLdSt.isLoad) {
+            ppAMD64AMode(i->Ain.AvxLdSt.addr);
+            vex_printf(",");
+            ppHRegAMD64(i->Ain.AvxLdSt.reg);
+         } else {
+            ppHRegAMD64(i->Ain.AvxLdSt.reg);
+            vex_printf(",");
+            ppAMD64AMode(i->Ain.AvxLdSt.addr);
+         }
+         return;
+      case Ain_Avx32Fx8:
+         vex_printf("v%sps ", showAMD64SseOp(i->Ain.Avx32Fx8.op));
+         ppHRegAMD64(i->Ain.Avx32Fx8.srcR);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.Avx32Fx8.srcL);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.Avx32Fx8.dst);
+         return;
+      case Ain_Avx64Fx4:
+         vex_printf("v%spd ", showAMD64SseOp(i->Ain.Avx64Fx4.op));
+         ppHRegAMD64(i->Ain.Avx64Fx4.srcR);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.Avx64Fx4.srcL);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.Avx64Fx4.dst);
+         return;
+      case Ain_AvxReRg:
+         vex_printf("v%s ", showAMD64SseOp(i->Ain.AvxReRg.op));
+         ppHRegAMD64(i->Ain.AvxReRg.srcR);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.AvxReRg.srcL);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.AvxReRg.dst);
+         return;
+      case Ain_AvxInsHi:
+         vex_printf("vinsertf128 $1,");
+         ppHRegAMD64(i->Ain.AvxInsHi.hi);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.AvxInsHi.lo);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.AvxInsHi.dst);
+         return;
+      case Ain_AvxExtract:
+         vex_printf("vextractf128 $%d,", i->Ain.AvxExtract.hi ? 1 : 0);
+         ppHRegAMD64(i->Ain.AvxExtract.src);
+         vex_printf(",");
+         ppHRegAMD64(i->Ain.AvxExtract.dst);
+         return;
       case Ain_EvCheck:
          vex_printf("(evCheck) decl ");
          ppAMD64AMode(i->Ain.EvCheck.amCounter);
@@ -1320,6 +1584,26 @@ void ppAMD64Instr ( AMD64Instr* i, Bool mode64 )
       case Ain_ProfInc:
          vex_printf("(profInc) movabsq $NotKnownYet, %%r11; incq (%%r11)");
          return;
+      case Ain_LoopHead:
+         vex_printf("(loopHead)");
+         return;
+      case Ain_LoopBack: {
+         Int k;
+         vex_printf("(loopBack) movabsq $0x%llx,%%r11; movq %%r11,",
+                    i->Ain.LoopBack.dstGA);
+         ppAMD64AMode(i->Ain.LoopBack.amRIP);
+         vex_printf("; decl ");
+         ppAMD64AMode(i->Ain.LoopBack.amCounter);
+         vex_printf("; jns loopHead; jmp *");
+         ppAMD64AMode(i->Ain.LoopBack.amFailAddr);
+         vex_printf(" {");
+         for (k = 0; k < i->Ain.LoopBack.nRegs; k++) {
+            vex_printf(k == 0 ? "" : ",");
+            ppHRegAMD64(i->Ain.LoopBack.regs[k]);
+         }
+         vex_printf("}");
+         return;
+      }
       default:
          vpanic("ppAMD64Instr");
    }
@@ -1395,7 +1679,7 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
          /* First off, claim it trashes all the caller-saved regs
             which fall within the register allocator's jurisdiction.
             These I believe to be: rax rcx rdx rsi rdi r8 r9 r10 r11 
-            and all the xmm registers.
+            and all the xmm/ymm registers.
          */
          addHRegUse(u, HRmWrite, hregAMD64_RAX());
          addHRegUse(u, HRmWrite, hregAMD64_RCX());
@@ -1418,6 +1702,9 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
          addHRegUse(u, HRmWrite, hregAMD64_XMM10());
          addHRegUse(u, HRmWrite, hregAMD64_XMM11());
          addHRegUse(u, HRmWrite, hregAMD64_XMM12());
+         addHRegUse(u, HRmWrite, hregAMD64_YMM13());
+         addHRegUse(u, HRmWrite, hregAMD64_YMM14());
+         addHRegUse(u, HRmWrite, hregAMD64_YMM15());
 
          /* Now we have to state any parameter-carrying registers
             which might be read.  This depends on the regparmness. */
@@ -1459,6 +1746,16 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
          addHRegUse(u, HRmRead, i->Ain.XAssisted.dstGA);
          addRegUsage_AMD64AMode(u, i->Ain.XAssisted.amRIP);
          return;
+      case Ain_XHost:
+         addHRegUse(u, HRmRead, i->Ain.XHost.dstGA);
+         addRegUsage_AMD64AMode(u, i->Ain.XHost.amRIP);
+         addHRegUse(u, HRmRead, i->Ain.XHost.dstHA);
+         return;
+      case Ain_RSPush:
+         /* Ditto re %r11 */
+         addRegUsage_AMD64AMode(u, i->Ain.RSPush.amRIP);
+         addRegUsage_AMD64AMode(u, i->Ain.RSPush.amHA);
+         return;
       case Ain_CMov64:
          addRegUsage_AMD64RM(u, i->Ain.CMov64.src, HRmRead);
          addHRegUse(u, HRmModify, i->Ain.CMov64.dst);
@@ -1482,6 +1779,10 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
          addHRegUse(u, HRmRead, i->Ain.Bsfr64.src);
          addHRegUse(u, HRmWrite, i->Ain.Bsfr64.dst);
          return;
+      case Ain_CRC32C:
+         addRegUsage_AMD64RM(u, i->Ain.CRC32C.src, HRmRead);
+         addHRegUse(u, HRmModify, i->Ain.CRC32C.dst);
+         return;
       case Ain_MFence:
          return;
       case Ain_ACAS:
@@ -1552,7 +1853,7 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
          unary = toBool( i->Ain.Sse32FLo.op == Asse_RCPF
                          || i->Ain.Sse32FLo.op == Asse_RSQRTF
                          || i->Ain.Sse32FLo.op == Asse_SQRTF );
-         addHRegUse(u, HRmRead, i->Ain.Sse32FLo.src);
+         addRegUsage_AMD64RM(u, i->Ain.Sse32FLo.src, HRmRead);
          addHRegUse(u, unary ? HRmWrite : HRmModify, 
                        i->Ain.Sse32FLo.dst);
          return;
@@ -1570,7 +1871,7 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
          unary = toBool( i->Ain.Sse64FLo.op == Asse_RCPF
                          || i->Ain.Sse64FLo.op == Asse_RSQRTF
                          || i->Ain.Sse64FLo.op == Asse_SQRTF );
-         addHRegUse(u, HRmRead, i->Ain.Sse64FLo.src);
+         addRegUsage_AMD64RM(u, i->Ain.Sse64FLo.src, HRmRead);
          addHRegUse(u, unary ? HRmWrite : HRmModify, 
                        i->Ain.Sse64FLo.dst);
          return;
@@ -1598,24 +1899,61 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
          addHRegUse(u, HRmRead,  i->Ain.SseShuf.src);
          addHRegUse(u, HRmWrite, i->Ain.SseShuf.dst);
          return;
-      //uu case Ain_AvxLdSt:
-      //uu addRegUsage_AMD64AMode(u, i->Ain.AvxLdSt.addr);
-      //uu addHRegUse(u, i->Ain.AvxLdSt.isLoad ? HRmWrite : HRmRead,
-      //uu               i->Ain.AvxLdSt.reg);
-      //uu return;
-      //uu case Ain_AvxReRg:
-      //uu    if ( (i->Ain.AvxReRg.op == Asse_XOR
-      //uu          || i->Ain.AvxReRg.op == Asse_CMPEQ32)
-      //uu         && i->Ain.AvxReRg.src == i->Ain.AvxReRg.dst) {
-      //uu       /* See comments on the case for Ain_SseReRg. */
-      //uu       addHRegUse(u, HRmWrite, i->Ain.AvxReRg.dst);
-      //uu    } else {
-      //uu       addHRegUse(u, HRmRead, i->Ain.AvxReRg.src);
-      //uu       addHRegUse(u, i->Ain.AvxReRg.op == Asse_MOV 
-      //uu                        ? HRmWrite : HRmModify, 
-      //uu                     i->Ain.AvxReRg.dst);
-      //uu    }
-      //uu    return;
+      case Ain_SseCLMul:
+         addHRegUse(u, HRmRead,   i->Ain.SseCLMul.src);
+         addHRegUse(u, HRmModify, i->Ain.SseCLMul.dst);
+         return;
+      case Ain_SseFMA:
+         addHRegUse(u, HRmRead,   i->Ain.SseFMA.mul);
+         addHRegUse(u, HRmRead,   i->Ain.SseFMA.add);
+         addHRegUse(u, HRmModify, i->Ain.SseFMA.dst);
+         return;
+      case Ain_AvxLdSt:
+         addRegUsage_AMD64AMode(u, i->Ain.AvxLdSt.addr);
+         addHRegUse(u, i->Ain.AvxLdSt.isLoad ? HRmWrite : HRmRead,
+                       i->Ain.AvxLdSt.reg);
+         return;
+      case Ain_Avx32Fx8:
+         vassert(i->Ain.Avx32Fx8.op != Asse_MOV);
+         unary = toBool( i->Ain.Avx32Fx8.op == Asse_RCPF
+                         || i->Ain.Avx32Fx8.op == Asse_RSQRTF
+                         || i->Ain.Avx32Fx8.op == Asse_SQRTF );
+         if (!unary)
+            addHRegUse(u, HRmRead, i->Ain.Avx32Fx8.srcL);
+         addHRegUse(u, HRmRead,  i->Ain.Avx32Fx8.srcR);
+         addHRegUse(u, HRmWrite, i->Ain.Avx32Fx8.dst);
+         return;
+      case Ain_Avx64Fx4:
+         vassert(i->Ain.Avx64Fx4.op != Asse_MOV);
+         unary = toBool( i->Ain.Avx64Fx4.op == Asse_SQRTF );
+         if (!unary)
+            addHRegUse(u, HRmRead, i->Ain.Avx64Fx4.srcL);
+         addHRegUse(u, HRmRead,  i->Ain.Avx64Fx4.srcR);
+         addHRegUse(u, HRmWrite, i->Ain.Avx64Fx4.dst);
+         return;
+      case Ain_AvxReRg:
+         if ( (i->Ain.AvxReRg.op == Asse_XOR
+               || i->Ain.AvxReRg.op == Asse_CMPEQ32)
+              && sameHReg(i->Ain.AvxReRg.srcL, i->Ain.AvxReRg.srcR)
+              && sameHReg(i->Ain.AvxReRg.srcR, i->Ain.AvxReRg.dst)) {
+            /* See comments on the case for Ain_SseReRg. */
+            addHRegUse(u, HRmWrite, i->Ain.AvxReRg.dst);
+         } else {
+            if (i->Ain.AvxReRg.op != Asse_MOV)
+               addHRegUse(u, HRmRead, i->Ain.AvxReRg.srcL);
+            addHRegUse(u, HRmRead,  i->Ain.AvxReRg.srcR);
+            addHRegUse(u, HRmWrite, i->Ain.AvxReRg.dst);
+         }
+         return;
+      case Ain_AvxInsHi:
+         addHRegUse(u, HRmRead,  i->Ain.AvxInsHi.hi);
+         addHRegUse(u, HRmRead,  i->Ain.AvxInsHi.lo);
+         addHRegUse(u, HRmWrite, i->Ain.AvxInsHi.dst);
+         return;
+      case Ain_AvxExtract:
+         addHRegUse(u, HRmRead,  i->Ain.AvxExtract.src);
+         addHRegUse(u, HRmWrite, i->Ain.AvxExtract.dst);
+         return;
       case Ain_EvCheck:
          /* We expect both amodes only to mention %rbp, so this is in
             fact pointless, since %rbp isn't allocatable, but anyway.. */
@@ -1625,6 +1963,19 @@ void getRegUsage_AMD64Instr ( HRegUsage* u, AMD64Instr* i, Bool mode64 )
       case Ain_ProfInc:
          addHRegUse(u, HRmWrite, hregAMD64_R11());
          return;
+      case Ain_LoopHead:
+         return;
+      case Ain_LoopBack: {
+         /* Ditto re %r11.  The loop registers are read on the next
+            iteration, so are live up to here. */
+         Int k;
+         addRegUsage_AMD64AMode(u, i->Ain.LoopBack.amRIP);
+         addRegUsage_AMD64AMode(u, i->Ain.LoopBack.amCounter);
+         addRegUsage_AMD64AMode(u, i->Ain.LoopBack.amFailAddr);
+         for (k = 0; k < i->Ain.LoopBack.nRegs; k++)
+            addHRegUse(u, HRmRead, i->Ain.LoopBack.regs[k]);
+         return;
+      }
       default:
          ppAMD64Instr(i, mode64);
          vpanic("getRegUsage_AMD64Instr");
@@ -1691,6 +2042,15 @@ void mapRegs_AMD64Instr ( HRegRemap* m, AMD64Instr* i, Bool mode64 )
          mapReg(m, &i->Ain.XAssisted.dstGA);
          mapRegs_AMD64AMode(m, i->Ain.XAssisted.amRIP);
          return;
+      case Ain_XHost:
+         mapReg(m, &i->Ain.XHost.dstGA);
+         mapRegs_AMD64AMode(m, i->Ain.XHost.amRIP);
+         mapReg(m, &i->Ain.XHost.dstHA);
+         return;
+      case Ain_RSPush:
+         mapRegs_AMD64AMode(m, i->Ain.RSPush.amRIP);
+         mapRegs_AMD64AMode(m, i->Ain.RSPush.amHA);
+         return;
       case Ain_CMov64:
          mapRegs_AMD64RM(m, i->Ain.CMov64.src);
          mapReg(m, &i->Ain.CMov64.dst);
@@ -1714,6 +2074,10 @@ void mapRegs_AMD64Instr ( HRegRemap* m, AMD64Instr* i, Bool mode64 )
          mapReg(m, &i->Ain.Bsfr64.src);
          mapReg(m, &i->Ain.Bsfr64.dst);
          return;
+      case Ain_CRC32C:
+         mapRegs_AMD64RM(m, i->Ain.CRC32C.src);
+         mapReg(m, &i->Ain.CRC32C.dst);
+         return;
       case Ain_MFence:
          return;
       case Ain_ACAS:
@@ -1768,7 +2132,7 @@ void mapRegs_AMD64Instr ( HRegRemap* m, AMD64Instr* i, Bool mode64 )
          mapReg(m, &i->Ain.Sse32Fx4.dst);
          return;
       case Ain_Sse32FLo:
-         mapReg(m, &i->Ain.Sse32FLo.src);
+         mapRegs_AMD64RM(m, i->Ain.Sse32FLo.src);
          mapReg(m, &i->Ain.Sse32FLo.dst);
          return;
       case Ain_Sse64Fx2:
@@ -1776,7 +2140,7 @@ void mapRegs_AMD64Instr ( HRegRemap* m, AMD64Instr* i, Bool mode64 )
          mapReg(m, &i->Ain.Sse64Fx2.dst);
          return;
       case Ain_Sse64FLo:
-         mapReg(m, &i->Ain.Sse64FLo.src);
+         mapRegs_AMD64RM(m, i->Ain.Sse64FLo.src);
          mapReg(m, &i->Ain.Sse64FLo.dst);
          return;
       case Ain_SseReRg:
@@ -1791,14 +2155,43 @@ void mapRegs_AMD64Instr ( HRegRemap* m, AMD64Instr* i, Bool mode64 )
          mapReg(m, &i->Ain.SseShuf.src);
          mapReg(m, &i->Ain.SseShuf.dst);
          return;
-      //uu case Ain_AvxLdSt:
-      //uu    mapReg(m, &i->Ain.AvxLdSt.reg);
-      //uu    mapRegs_AMD64AMode(m, i->Ain.AvxLdSt.addr);
-      //uu    break;
-      //uu case Ain_AvxReRg:
-      //uu    mapReg(m, &i->Ain.AvxReRg.src);
-      //uu    mapReg(m, &i->Ain.AvxReRg.dst);
-      //uu    return;
+      case Ain_SseCLMul:
+         mapReg(m, &i->Ain.SseCLMul.src);
+         mapReg(m, &i->Ain.SseCLMul.dst);
+         return;
+      case Ain_SseFMA:
+         mapReg(m, &i->Ain.SseFMA.mul);
+         mapReg(m, &i->Ain.SseFMA.add);
+         mapReg(m, &i->Ain.SseFMA.dst);
+         return;
+      case Ain_AvxLdSt:
+         mapReg(m, &i->Ain.AvxLdSt.reg);
+         mapRegs_AMD64AMode(m, i->Ain.AvxLdSt.addr);
+         return;
+      case Ain_Avx32Fx8:
+         mapReg(m, &i->Ain.Avx32Fx8.srcL);
+         mapReg(m, &i->Ain.Avx32Fx8.srcR);
+         mapReg(m, &i->Ain.Avx32Fx8.dst);
+         return;
+      case Ain_Avx64Fx4:
+         mapReg(m, &i->Ain.Avx64Fx4.srcL);
+         mapReg(m, &i->Ain.Avx64Fx4.srcR);
+         mapReg(m, &i->Ain.Avx64Fx4.dst);
+         return;
+      case Ain_AvxReRg:
+         mapReg(m, &i->Ain.AvxReRg.srcL);
+         mapReg(m, &i->Ain.AvxReRg.srcR);
+         mapReg(m, &i->Ain.AvxReRg.dst);
+         return;
+      case Ain_AvxInsHi:
+         mapReg(m, &i->Ain.AvxInsHi.hi);
+         mapReg(m, &i->Ain.AvxInsHi.lo);
+         mapReg(m, &i->Ain.AvxInsHi.dst);
+         return;
+      case Ain_AvxExtract:
+         mapReg(m, &i->Ain.AvxExtract.src);
+         mapReg(m, &i->Ain.AvxExtract.dst);
+         return;
       case Ain_EvCheck:
          /* We expect both amodes only to mention %rbp, so this is in
             fact pointless, since %rbp isn't allocatable, but anyway.. */
@@ -1808,6 +2201,17 @@ void mapRegs_AMD64Instr ( HRegRemap* m, AMD64Instr* i, Bool mode64 )
       case Ain_ProfInc:
          /* hardwires r11 -- nothing to modify. */
          return;
+      case Ain_LoopHead:
+         return;
+      case Ain_LoopBack: {
+         Int k;
+         mapRegs_AMD64AMode(m, i->Ain.LoopBack.amRIP);
+         mapRegs_AMD64AMode(m, i->Ain.LoopBack.amCounter);
+         mapRegs_AMD64AMode(m, i->Ain.LoopBack.amFailAddr);
+         for (k = 0; k < i->Ain.LoopBack.nRegs; k++)
+            mapReg(m, &i->Ain.LoopBack.regs[k]);
+         return;
+      }
       default:
          ppAMD64Instr(i, mode64);
          vpanic("mapRegs_AMD64Instr");
@@ -1837,13 +2241,13 @@ Bool isMove_AMD64Instr ( AMD64Instr* i, HReg* src, HReg* dst )
          *src = i->Ain.SseReRg.src;
          *dst = i->Ain.SseReRg.dst;
          return True;
-      //uu case Ain_AvxReRg:
-      //uu    /* Moves between AVX regs */
-      //uu    if (i->Ain.AvxReRg.op != Asse_MOV)
-      //uu       return False;
-      //uu    *src = i->Ain.AvxReRg.src;
-      //uu    *dst = i->Ain.AvxReRg.dst;
-      //uu    return True;
+      case Ain_AvxReRg:
+         /* Moves between AVX regs */
+         if (i->Ain.AvxReRg.op != Asse_MOV)
+            return False;
+         *src = i->Ain.AvxReRg.srcR;
+         *dst = i->Ain.AvxReRg.dst;
+         return True;
       default:
          return False;
    }
@@ -1871,6 +2275,9 @@ void genSpill_AMD64 ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
       case HRcVec128:
          *i1 = AMD64Instr_SseLdSt ( False/*store*/, 16, rreg, am );
          return;
+      case HRcVec256:
+         *i1 = AMD64Instr_AvxLdSt ( False/*store*/, rreg, am );
+         return;
       default: 
          ppHRegClass(hregClass(rreg));
          vpanic("genSpill_AMD64: unimplemented regclass");
@@ -1893,6 +2300,9 @@ void genReload_AMD64 ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
       case HRcVec128:
          *i1 = AMD64Instr_SseLdSt ( True/*load*/, 16, rreg, am );
          return;
+      case HRcVec256:
+         *i1 = AMD64Instr_AvxLdSt ( True/*load*/, rreg, am );
+         return;
       default: 
          ppHRegClass(hregClass(rreg));
          vpanic("genReload_AMD64: unimplemented regclass");
@@ -1900,6 +2310,110 @@ void genReload_AMD64 ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
 }
 
 
+/* --------- Peephole rules, for register-allocated code --------- */
+
+/* Is am an offset from %rbp?  Then it is in the guest state or a
+   spill slot, which only generated code writes. */
+static Bool isRBPAMode ( AMD64AMode* am, UInt* off )
+{
+   if (am->tag != Aam_IR || !sameHReg(am->Aam.IR.reg, hregAMD64_RBP()))
+      return False;
+   *off = am->Aam.IR.imm;
+   return True;
+}
+
+/* Is i a whole-register load or store (as genSpill_AMD64 and
+   genReload_AMD64 make) to or from an offset from %rbp?  If so,
+   return the register, the offset and the size. */
+static Bool isRBPLdSt ( AMD64Instr* i, Bool isLoad,
+                        HReg* r, UInt* off, Int* szB )
+{
+   switch (i->tag) {
+      case Ain_Alu64R:
+         if (!isLoad || i->Ain.Alu64R.op != Aalu_MOV
+             || i->Ain.Alu64R.src->tag != Armi_Mem)
+            return False;
+         *r   = i->Ain.Alu64R.dst;
+         *szB = 8;
+         return isRBPAMode(i->Ain.Alu64R.src->Armi.Mem.am, off);
+      case Ain_Alu64M:
+         if (isLoad || i->Ain.Alu64M.op != Aalu_MOV
+             || i->Ain.Alu64M.src->tag != Ari_Reg)
+            return False;
+         *r   = i->Ain.Alu64M.src->Ari.Reg.reg;
+         *szB = 8;
+         return isRBPAMode(i->Ain.Alu64M.dst, off);
+      case Ain_SseLdSt:
+         if (i->Ain.SseLdSt.isLoad != isLoad || i->Ain.SseLdSt.sz != 16)
+            return False;
+         *r   = i->Ain.SseLdSt.reg;
+         *szB = 16;
+         return isRBPAMode(i->Ain.SseLdSt.addr, off);
+      case Ain_AvxLdSt:
+         if (i->Ain.AvxLdSt.isLoad != isLoad)
+            return False;
+         *r   = i->Ain.AvxLdSt.reg;
+         *szB = 32;
+         return isRBPAMode(i->Ain.AvxLdSt.addr, off);
+      default:
+         return False;
+   }
+}
+
+/* See doPeephole and VexPeepholeRule. */
+Int peephole_AMD64Instr ( HInstr* prevH, HInstr** curH, Bool mode64 )
+{
+   AMD64Instr* prev = (AMD64Instr*)prevH;
+   AMD64Instr* cur  = (AMD64Instr*)*curH;
+   HReg        src, dst, src2, dst2;
+   UInt        off, off2;
+   Int         szB, szB2;
+   vassert(mode64 == True);
+
+   if (isMove_AMD64Instr(cur, &src, &dst) && sameHReg(src, dst)) {
+      *curH = NULL;
+      return VexPeepSelfMove;
+   }
+   if (prev == NULL)
+      return VexPeep_N;
+
+   if (isMove_AMD64Instr(cur, &src, &dst)
+       && isMove_AMD64Instr(prev, &src2, &dst2)
+       && sameHReg(src, dst2) && sameHReg(dst, src2)) {
+      *curH = NULL;
+      return VexPeepMoveBack;
+   }
+
+   if (isRBPLdSt(cur, True/*load*/, &dst, &off, &szB)
+       && isRBPLdSt(prev, False/*store*/, &src, &off2, &szB2)
+       && off == off2 && szB == szB2) {
+      if (sameHReg(src, dst)) {
+         *curH = NULL;
+         return VexPeepStoreReload;
+      }
+      switch (szB) {
+         case 8:
+            *curH = AMD64Instr_Alu64R(Aalu_MOV, AMD64RMI_Reg(src), dst);
+            return VexPeepStoreReload;
+         case 16:
+            *curH = AMD64Instr_SseReRg(Asse_MOV, src, dst);
+            return VexPeepStoreReload;
+         default:
+            return VexPeep_N;
+      }
+   }
+
+   if (isRBPLdSt(cur, False/*store*/, &src, &off, &szB)
+       && isRBPLdSt(prev, True/*load*/, &dst, &off2, &szB2)
+       && off == off2 && szB == szB2 && sameHReg(src, dst)) {
+      *curH = NULL;
+      return VexPeepLoadStore;
+   }
+
+   return VexPeep_N;
+}
+
+
 /* --------- The amd64 assembler (bleh.) --------- */
 
 /* Produce the low three bits of an integer register number. */
@@ -1950,16 +2464,16 @@ static HReg vreg2ireg ( HReg r )
    return mkHReg(n, HRcInt64, False);
 }
 
-//uu /* Ditto for ymm regs. */
-//uu static HReg dvreg2ireg ( HReg r )
-//uu {
-//uu    UInt n;
-//uu    vassert(hregClass(r) == HRcVec256);
-//uu    vassert(!hregIsVirtual(r));
-//uu    n = hregNumber(r);
-//uu    vassert(n <= 15);
-//uu    return mkHReg(n, HRcInt64, False);
-//uu }
+/* Ditto for ymm regs. */
+static HReg dvreg2ireg ( HReg r )
+{
+   UInt n;
+   vassert(hregClass(r) == HRcVec256);
+   vassert(!hregIsVirtual(r));
+   n = hregNumber(r);
+   vassert(n <= 15);
+   return mkHReg(n, HRcInt64, False);
+}
 
 static UChar mkModRegRM ( UInt mod, UInt reg, UInt regmem )
 {
@@ -2167,86 +2681,95 @@ static UChar rexAMode_R ( HReg greg, HReg ereg )
 }
 
 
-//uu /* May 2012: this VEX prefix stuff is currently unused, but has
-//uu    verified correct (I reckon).  Certainly it has been known to
-//uu    produce correct VEX prefixes during testing. */
-//uu 
-//uu /* Assemble a 2 or 3 byte VEX prefix from parts.  rexR, rexX, rexB and
-//uu    notVvvvv need to be not-ed before packing.  mmmmm, rexW, L and pp go
-//uu    in verbatim.  There's no range checking on the bits. */
-//uu static UInt packVexPrefix ( UInt rexR, UInt rexX, UInt rexB,
-//uu                             UInt mmmmm, UInt rexW, UInt notVvvv,
-//uu                             UInt L, UInt pp )
-//uu {
-//uu    UChar byte0 = 0;
-//uu    UChar byte1 = 0;
-//uu    UChar byte2 = 0;
-//uu    if (rexX == 0 && rexB == 0 && mmmmm == 1 && rexW == 0) {
-//uu       /* 2 byte encoding is possible. */
-//uu       byte0 = 0xC5;
-//uu       byte1 = ((rexR ^ 1) << 7) | ((notVvvv ^ 0xF) << 3) 
-//uu               | (L << 2) | pp;
-//uu    } else {
-//uu       /* 3 byte encoding is needed. */
-//uu       byte0 = 0xC4;
-//uu       byte1 = ((rexR ^ 1) << 7) | ((rexX ^ 1) << 6)
-//uu               | ((rexB ^ 1) << 5) | mmmmm;
-//uu       byte2 = (rexW << 7) | ((notVvvv ^ 0xF) << 3) | (L << 2) | pp;
-//uu    }
-//uu    return (((UInt)byte2) << 16) | (((UInt)byte1) << 8) | ((UInt)byte0);
-//uu }
-//uu 
-//uu /* Make up a VEX prefix for a (greg,amode) pair.  First byte in bits
-//uu    7:0 of result, second in 15:8, third (for a 3 byte prefix) in
-//uu    23:16.  Has m-mmmm set to indicate a prefix of 0F, pp set to
-//uu    indicate no SIMD prefix, W=0 (ignore), L=1 (size=256), and
-//uu    vvvv=1111 (unused 3rd reg). */
-//uu static UInt vexAMode_M ( HReg greg, AMD64AMode* am )
-//uu {
-//uu    UChar L       = 1; /* size = 256 */
-//uu    UChar pp      = 0; /* no SIMD prefix */
-//uu    UChar mmmmm   = 1; /* 0F */
-//uu    UChar notVvvv = 0; /* unused */
-//uu    UChar rexW    = 0;
-//uu    UChar rexR    = 0;
-//uu    UChar rexX    = 0;
-//uu    UChar rexB    = 0;
-//uu    /* Same logic as in rexAMode_M. */
-//uu    if (am->tag == Aam_IR) {
-//uu       rexR = iregBit3(greg);
-//uu       rexX = 0; /* not relevant */
-//uu       rexB = iregBit3(am->Aam.IR.reg);
-//uu    }
-//uu    else if (am->tag == Aam_IRRS) {
-//uu       rexR = iregBit3(greg);
-//uu       rexX = iregBit3(am->Aam.IRRS.index);
-//uu       rexB = iregBit3(am->Aam.IRRS.base);
-//uu    } else {
-//uu       vassert(0);
-//uu    }
-//uu    return packVexPrefix( rexR, rexX, rexB, mmmmm, rexW, notVvvv, L, pp );
-//uu }
-//uu 
-//uu static UChar* emitVexPrefix ( UChar* p, UInt vex )
-//uu {
-//uu    switch (vex & 0xFF) {
-//uu       case 0xC5:
-//uu          *p++ = 0xC5;
-//uu          *p++ = (vex >> 8) & 0xFF;
-//uu          vassert(0 == (vex >> 16));
-//uu          break;
-//uu       case 0xC4:
-//uu          *p++ = 0xC4;
-//uu          *p++ = (vex >> 8) & 0xFF;
-//uu          *p++ = (vex >> 16) & 0xFF;
-//uu          vassert(0 == (vex >> 24));
-//uu          break;
-//uu       default:
-//uu          vassert(0);
-//uu    }
-//uu    return p;
-//uu }
+/* Assemble a 2 or 3 byte VEX prefix from parts.  rexR, rexX, rexB and
+   notVvvvv need to be not-ed before packing.  mmmmm, rexW, L and pp go
+   in verbatim.  There's no range checking on the bits. */
+static UInt packVexPrefix ( UInt rexR, UInt rexX, UInt rexB,
+                            UInt mmmmm, UInt rexW, UInt notVvvv,
+                            UInt L, UInt pp )
+{
+   UChar byte0 = 0;
+   UChar byte1 = 0;
+   UChar byte2 = 0;
+   if (rexX == 0 && rexB == 0 && mmmmm == 1 && rexW == 0) {
+      /* 2 byte encoding is possible. */
+      byte0 = 0xC5;
+      byte1 = ((rexR ^ 1) << 7) | ((notVvvv ^ 0xF) << 3) 
+              | (L << 2) | pp;
+   } else {
+      /* 3 byte encoding is needed. */
+      byte0 = 0xC4;
+      byte1 = ((rexR ^ 1) << 7) | ((rexX ^ 1) << 6)
+              | ((rexB ^ 1) << 5) | mmmmm;
+      byte2 = (rexW << 7) | ((notVvvv ^ 0xF) << 3) | (L << 2) | pp;
+   }
+   return (((UInt)byte2) << 16) | (((UInt)byte1) << 8) | ((UInt)byte0);
+}
+
+/* Make up a VEX prefix for a (greg,amode) pair.  First byte in bits
+   7:0 of result, second in 15:8, third (for a 3 byte prefix) in
+   23:16.  Has m-mmmm set to indicate a prefix of 0F, pp set to
+   indicate no SIMD prefix, W=0 (ignore), L=1 (size=256), and
+   vvvv=1111 (unused 3rd reg). */
+static UInt vexAMode_M ( HReg greg, AMD64AMode* am )
+{
+   UChar L       = 1; /* size = 256 */
+   UChar pp      = 0; /* no SIMD prefix */
+   UChar mmmmm   = 1; /* 0F */
+   UChar notVvvv = 0; /* unused */
+   UChar rexW    = 0;
+   UChar rexR    = 0;
+   UChar rexX    = 0;
+   UChar rexB    = 0;
+   /* Same logic as in rexAMode_M. */
+   if (am->tag == Aam_IR) {
+      rexR = iregBit3(greg);
+      rexX = 0; /* not relevant */
+      rexB = iregBit3(am->Aam.IR.reg);
+   }
+   else if (am->tag == Aam_IRRS) {
+      rexR = iregBit3(greg);
+      rexX = iregBit3(am->Aam.IRRS.index);
+      rexB = iregBit3(am->Aam.IRRS.base);
+   } else {
+      vassert(0);
+   }
+   return packVexPrefix( rexR, rexX, rexB, mmmmm, rexW, notVvvv, L, pp );
+}
 
+/* Ditto for a register-register form, with L=1 (size=256).  vreg is
+   the extra source register carried in VEX.vvvv; pass INVALID_HREG
+   if the instruction doesn't have one.  mmmmm selects the opcode map
+   (1 = 0F, 2 = 0F38, 3 = 0F3A) and pp the implied SIMD prefix
+   (0 = none, 1 = 66, 2 = F3, 3 = F2).  All registers must already
+   have been converted to integer-class numbering. */
+static UInt vexAMode_R ( HReg greg, HReg vreg, HReg ereg,
+                         UInt mmmmm, UInt pp )
+{
+   UInt vvvv = hregIsInvalid(vreg) ? 0 : iregBits3210(vreg);
+   return packVexPrefix( iregBit3(greg), 0/*rexX*/, iregBit3(ereg),
+                         mmmmm, 0/*rexW*/, vvvv, 1/*L*/, pp );
+}
+
+static UChar* emitVexPrefix ( UChar* p, UInt vex )
+{
+   switch (vex & 0xFF) {
+      case 0xC5:
+         *p++ = 0xC5;
+         *p++ = (vex >> 8) & 0xFF;
+         vassert(0 == (vex >> 16));
+         break;
+      case 0xC4:
+         *p++ = 0xC4;
+         *p++ = (vex >> 8) & 0xFF;
+         *p++ = (vex >> 16) & 0xFF;
+         vassert(0 == (vex >> 24));
+         break;
+      default:
+         vassert(0);
+   }
+   return p;
+}
 
 /* Emit ffree %st(N) */
 static UChar* do_ffree_st ( UChar* p, Int n )
@@ -2269,6 +2792,7 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
                       void* disp_cp_chain_me_to_slowEP,
                       void* disp_cp_chain_me_to_fastEP,
                       void* disp_cp_xindir,
+                      void* disp_cp_xindir_miss,
                       void* disp_cp_xassisted )
 {
    UInt /*irno,*/ opc, opc_rr, subopc_imm, opc_imma, opc_cl, opc_imm, subopc;
@@ -2278,7 +2802,7 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
    UChar* p = &buf[0];
    UChar* ptmp;
    Int    j;
-   vassert(nbuf >= 32);
+   vassert(nbuf >= 64);
    vassert(mode64 == True);
 
    /* Wrap an integer as a int register, for use assembling
@@ -2807,28 +3331,106 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
       *p++ = 0x89;
       p = doAMode_M(p, i->Ain.XIndir.dstGA, i->Ain.XIndir.amRIP);
 
-      /* get $disp_cp_xindir into %r11 */
-      if (fitsIn32Bits(Ptr_to_ULong(disp_cp_xindir))) {
-         /* use a shorter encoding */
-         /* movl sign-extend(disp_cp_xindir), %r11 */
+      if (disp_cp_xindir_miss != NULL) {
+         /* An inline cache.  NB: what goes on here has to be very
+            closely coordinated with chainXIndir_AMD64 and
+            unchainXIndir_AMD64 below. */
+         HReg r11 = hregAMD64_R11();
+
+         /* --- FIRST PATCHABLE BYTE follows --- */
+         /* disp_cp_xindir_miss backs up the return address by 41 to
+            find the first patchable byte, so don't change the length
+            of any of the instructions below.  The site starts out
+            empty: the cached guest address is zero, and matching it
+            just goes to disp_cp_xindir anyway. */
+         /* movabsq $0, %r11 */
          *p++ = 0x49;
-         *p++ = 0xC7;
-         *p++ = 0xC3;
-         p = emit32(p, (UInt)Ptr_to_ULong(disp_cp_xindir));
-      } else {
+         *p++ = 0xBB;
+         p = emit64(p, 0);
+         /* cmpq %r11, dstGA */
+         *p++ = rexAMode_R(r11, i->Ain.XIndir.dstGA);
+         *p++ = 0x39;
+         p = doAMode_R(p, r11, i->Ain.XIndir.dstGA);
+         /* jne miss */
+         *p++ = 0x75;
+         *p++ = 13;
          /* movabsq $disp_cp_xindir, %r11 */
          *p++ = 0x49;
          *p++ = 0xBB;
          p = emit64(p, Ptr_to_ULong(disp_cp_xindir));
+         /* jmp *%r11 */
+         *p++ = 0x41;
+         *p++ = 0xFF;
+         *p++ = 0xE3;
+         /* miss: movabsq $disp_cp_xindir_miss, %r11 */
+         *p++ = 0x49;
+         *p++ = 0xBB;
+         p = emit64(p, Ptr_to_ULong(disp_cp_xindir_miss));
+         /* call *%r11 */
+         *p++ = 0x41;
+         *p++ = 0xFF;
+         *p++ = 0xD3;
+         /* --- END of PATCHABLE BYTES --- */
+      } else {
+         /* get $disp_cp_xindir into %r11 */
+         if (fitsIn32Bits(Ptr_to_ULong(disp_cp_xindir))) {
+            /* use a shorter encoding */
+            /* movl sign-extend(disp_cp_xindir), %r11 */
+            *p++ = 0x49;
+            *p++ = 0xC7;
+            *p++ = 0xC3;
+            p = emit32(p, (UInt)Ptr_to_ULong(disp_cp_xindir));
+         } else {
+            /* movabsq $disp_cp_xindir, %r11 */
+            *p++ = 0x49;
+            *p++ = 0xBB;
+            p = emit64(p, Ptr_to_ULong(disp_cp_xindir));
+         }
+
+         /* jmp *%r11 */
+         *p++ = 0x41;
+         *p++ = 0xFF;
+         *p++ = 0xE3;
       }
 
-      /* jmp *%r11 */
-      *p++ = 0x41;
+      /* Fix up the conditional jump, if there was one. */
+      if (i->Ain.XIndir.cond != Acc_ALWAYS) {
+         Int delta = p - ptmp;
+         vassert(delta > 0 && delta < 128);
+         *ptmp = toUChar(delta-1);
+      }
+      goto done;
+   }
+
+   case Ain_XHost: {
+      /* As for XIndir, this must not appear in no-redir
+         translations. */
+      vassert(disp_cp_xindir != NULL);
+
+      /* Use ptmp for backpatching conditional jumps. */
+      ptmp = NULL;
+
+      /* First off, if this is conditional, create a conditional
+         jump over the rest of it. */
+      if (i->Ain.XHost.cond != Acc_ALWAYS) {
+         /* jmp fwds if !condition */
+         *p++ = toUChar(0x70 + (0xF & (i->Ain.XHost.cond ^ 1)));
+         ptmp = p; /* fill in this bit later */
+         *p++ = 0; /* # of bytes to jump over; don't know how many yet. */
+      }
+
+      /* movq dstGA(a reg), amRIP */
+      *p++ = rexAMode_M(i->Ain.XHost.dstGA, i->Ain.XHost.amRIP);
+      *p++ = 0x89;
+      p = doAMode_M(p, i->Ain.XHost.dstGA, i->Ain.XHost.amRIP);
+
+      /* jmp *dstHA */
+      *p++ = rexAMode_R(fake(0), i->Ain.XHost.dstHA);
       *p++ = 0xFF;
-      *p++ = 0xE3;
+      p = doAMode_R(p, fake(4), i->Ain.XHost.dstHA);
 
       /* Fix up the conditional jump, if there was one. */
-      if (i->Ain.XIndir.cond != Acc_ALWAYS) {
+      if (i->Ain.XHost.cond != Acc_ALWAYS) {
          Int delta = p - ptmp;
          vassert(delta > 0 && delta < 40);
          *ptmp = toUChar(delta-1);
@@ -2836,6 +3438,49 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
       goto done;
    }
 
+   case Ain_RSPush: {
+      /* The stub is an ordinary unconditional XDirect to the slow
+         entry point, so it is chained and unchained just like any
+         other. */
+      HReg   r11 = hregAMD64_R11();
+      UChar  stubBuf[64];
+      UChar* stub;
+      Int    stubLen;
+      Long   delta;
+
+      stubLen = emit_AMD64Instr( is_profInc, stubBuf, sizeof(stubBuf),
+                                 AMD64Instr_XDirect(i->Ain.RSPush.retGA,
+                                                    i->Ain.RSPush.amRIP,
+                                                    Acc_ALWAYS,
+                                                    False/*!toFastEP*/),
+                                 mode64,
+                                 disp_cp_chain_me_to_slowEP,
+                                 disp_cp_chain_me_to_fastEP,
+                                 disp_cp_xindir, disp_cp_xindir_miss,
+                                 disp_cp_xassisted );
+      vassert(stubLen > 0 && stubLen < 40);
+
+      /* jmp over the stub */
+      *p++ = 0xEB;
+      *p++ = toUChar(stubLen);
+      stub = p;
+      for (j = 0; j < stubLen; j++)
+         *p++ = stubBuf[j];
+
+      /* leaq stub(%rip), %r11 */
+      *p++ = 0x4C;
+      *p++ = 0x8D;
+      *p++ = 0x1D;
+      delta = (Long)(stub - (p + 4));
+      p = emit32(p, (UInt)(Int)delta);
+
+      /* movq %r11, amHA */
+      *p++ = rexAMode_M(r11, i->Ain.RSPush.amHA);
+      *p++ = 0x89;
+      p = doAMode_M(p, r11, i->Ain.RSPush.amHA);
+      goto done;
+   }
+
    case Ain_XAssisted: {
       /* Use ptmp for backpatching conditional jumps. */
       ptmp = NULL;
@@ -3000,6 +3645,38 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
       p = doAMode_R(p, i->Ain.Bsfr64.dst, i->Ain.Bsfr64.src);
       goto done;
 
+   case Ain_CRC32C: {
+      /* crc32{b,w,l,q} src, dst32/64.  The 16-bit form needs 0x66
+         ahead of the mandatory 0xF2; the 64-bit form is REX.W. */
+      UChar szB = i->Ain.CRC32C.szB;
+      if (szB == 2)
+         *p++ = 0x66;
+      *p++ = 0xF2;
+      switch (i->Ain.CRC32C.src->tag) {
+         case Arm_Mem:
+            rex = rexAMode_M(i->Ain.CRC32C.dst,
+                             i->Ain.CRC32C.src->Arm.Mem.am);
+            break;
+         case Arm_Reg:
+            rex = rexAMode_R(i->Ain.CRC32C.dst,
+                             i->Ain.CRC32C.src->Arm.Reg.reg);
+            break;
+         default:
+            goto bad;
+      }
+      *p++ = szB == 8 ? rex : clearWBit(rex);
+      *p++ = 0x0F;
+      *p++ = 0x38;
+      *p++ = toUChar(szB == 1 ? 0xF0 : 0xF1);
+      if (i->Ain.CRC32C.src->tag == Arm_Mem)
+         p = doAMode_M(p, i->Ain.CRC32C.dst,
+                          i->Ain.CRC32C.src->Arm.Mem.am);
+      else
+         p = doAMode_R(p, i->Ain.CRC32C.dst,
+                          i->Ain.CRC32C.src->Arm.Reg.reg);
+      goto done;
+   }
+
    case Ain_MFence:
       /* mfence */
       *p++ = 0x0F; *p++ = 0xAE; *p++ = 0xF0;
@@ -3279,9 +3956,14 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
    case Ain_Sse32FLo:
       xtra = 0;
       *p++ = 0xF3;
-      *p++ = clearWBit(
-             rexAMode_R( vreg2ireg(i->Ain.Sse32FLo.dst),
-                         vreg2ireg(i->Ain.Sse32FLo.src) ));
+      if (i->Ain.Sse32FLo.src->tag == Arm_Reg)
+         *p++ = clearWBit(
+                rexAMode_R( vreg2ireg(i->Ain.Sse32FLo.dst),
+                            vreg2ireg(i->Ain.Sse32FLo.src->Arm.Reg.reg) ));
+      else
+         *p++ = clearWBit(
+                rexAMode_M( vreg2ireg(i->Ain.Sse32FLo.dst),
+                            i->Ain.Sse32FLo.src->Arm.Mem.am ));
       *p++ = 0x0F;
       switch (i->Ain.Sse32FLo.op) {
          case Asse_ADDF:   *p++ = 0x58; break;
@@ -3299,8 +3981,12 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
          case Asse_CMPUNF: *p++ = 0xC2; xtra = 0x103; break;
          default: goto bad;
       }
-      p = doAMode_R(p, vreg2ireg(i->Ain.Sse32FLo.dst),
-                       vreg2ireg(i->Ain.Sse32FLo.src) );
+      if (i->Ain.Sse32FLo.src->tag == Arm_Reg)
+         p = doAMode_R(p, vreg2ireg(i->Ain.Sse32FLo.dst),
+                          vreg2ireg(i->Ain.Sse32FLo.src->Arm.Reg.reg) );
+      else
+         p = doAMode_M(p, vreg2ireg(i->Ain.Sse32FLo.dst),
+                          i->Ain.Sse32FLo.src->Arm.Mem.am );
       if (xtra & 0x100)
          *p++ = toUChar(xtra & 0xFF);
       goto done;
@@ -3308,9 +3994,14 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
    case Ain_Sse64FLo:
       xtra = 0;
       *p++ = 0xF2;
-      *p++ = clearWBit(
-             rexAMode_R( vreg2ireg(i->Ain.Sse64FLo.dst),
-                         vreg2ireg(i->Ain.Sse64FLo.src) ));
+      if (i->Ain.Sse64FLo.src->tag == Arm_Reg)
+         *p++ = clearWBit(
+                rexAMode_R( vreg2ireg(i->Ain.Sse64FLo.dst),
+                            vreg2ireg(i->Ain.Sse64FLo.src->Arm.Reg.reg) ));
+      else
+         *p++ = clearWBit(
+                rexAMode_M( vreg2ireg(i->Ain.Sse64FLo.dst),
+                            i->Ain.Sse64FLo.src->Arm.Mem.am ));
       *p++ = 0x0F;
       switch (i->Ain.Sse64FLo.op) {
          case Asse_ADDF:   *p++ = 0x58; break;
@@ -3326,8 +4017,12 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
          case Asse_CMPUNF: *p++ = 0xC2; xtra = 0x103; break;
          default: goto bad;
       }
-      p = doAMode_R(p, vreg2ireg(i->Ain.Sse64FLo.dst),
-                       vreg2ireg(i->Ain.Sse64FLo.src) );
+      if (i->Ain.Sse64FLo.src->tag == Arm_Reg)
+         p = doAMode_R(p, vreg2ireg(i->Ain.Sse64FLo.dst),
+                          vreg2ireg(i->Ain.Sse64FLo.src->Arm.Reg.reg) );
+      else
+         p = doAMode_M(p, vreg2ireg(i->Ain.Sse64FLo.dst),
+                          i->Ain.Sse64FLo.src->Arm.Mem.am );
       if (xtra & 0x100)
          *p++ = toUChar(xtra & 0xFF);
       goto done;
@@ -3395,6 +4090,16 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
          case Asse_UNPCKLW:  XX(0x66); XX(rex); XX(0x0F); XX(0x61); break;
          case Asse_UNPCKLD:  XX(0x66); XX(rex); XX(0x0F); XX(0x62); break;
          case Asse_UNPCKLQ:  XX(0x66); XX(rex); XX(0x0F); XX(0x6C); break;
+         case Asse_AESENC:   XX(0x66); XX(rex); XX(0x0F); XX(0x38);
+                             XX(0xDC); break;
+         case Asse_AESENCLAST: XX(0x66); XX(rex); XX(0x0F); XX(0x38);
+                             XX(0xDD); break;
+         case Asse_AESDEC:   XX(0x66); XX(rex); XX(0x0F); XX(0x38);
+                             XX(0xDE); break;
+         case Asse_AESDECLAST: XX(0x66); XX(rex); XX(0x0F); XX(0x38);
+                             XX(0xDF); break;
+         case Asse_AESIMC:   XX(0x66); XX(rex); XX(0x0F); XX(0x38);
+                             XX(0xDB); break;
          default: goto bad;
       }
       p = doAMode_R(p, vreg2ireg(i->Ain.SseReRg.dst),
@@ -3433,14 +4138,169 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
       *p++ = (UChar)(i->Ain.SseShuf.order);
       goto done;
 
-   //uu case Ain_AvxLdSt: {
-   //uu    UInt vex = vexAMode_M( dvreg2ireg(i->Ain.AvxLdSt.reg),
-   //uu                           i->Ain.AvxLdSt.addr );
-   //uu    p = emitVexPrefix(p, vex);
-   //uu    *p++ = toUChar(i->Ain.AvxLdSt.isLoad ? 0x10 : 0x11);
-   //uu    p = doAMode_M(p, dvreg2ireg(i->Ain.AvxLdSt.reg), i->Ain.AvxLdSt.addr);
-   //uu      goto done;
-   //uu }
+   case Ain_SseCLMul:
+      /* pclmulqdq $imm, src, dst */
+      *p++ = 0x66; 
+      *p++ = clearWBit(
+             rexAMode_R( vreg2ireg(i->Ain.SseCLMul.dst),
+                         vreg2ireg(i->Ain.SseCLMul.src) ));
+      *p++ = 0x0F; 
+      *p++ = 0x3A; 
+      *p++ = 0x44; 
+      p = doAMode_R(p, vreg2ireg(i->Ain.SseCLMul.dst),
+                       vreg2ireg(i->Ain.SseCLMul.src) );
+      *p++ = (UChar)(i->Ain.SseCLMul.imm);
+      goto done;
+
+   case Ain_SseFMA: {
+      /* vfm{add,sub}213s{s,d} %add, %mul, %dst
+         = VEX.LIG.66.0F38.W{0,1} A9/AB /r, with reg = dst,
+         vvvv = mul, rm = add. */
+      HReg dst = vreg2ireg(i->Ain.SseFMA.dst);
+      HReg mul = vreg2ireg(i->Ain.SseFMA.mul);
+      HReg add = vreg2ireg(i->Ain.SseFMA.add);
+      p = emitVexPrefix(p, packVexPrefix( iregBit3(dst), 0/*rexX*/,
+                                          iregBit3(add), 2/*0F38*/,
+                                          i->Ain.SseFMA.szB == 8 ? 1 : 0,
+                                          iregBits3210(mul),
+                                          0/*L*/, 1/*66*/ ));
+      *p++ = toUChar(i->Ain.SseFMA.isSub ? 0xAB : 0xA9);
+      p = doAMode_R(p, dst, add);
+      goto done;
+   }
+
+   case Ain_AvxLdSt: {
+      UInt vex = vexAMode_M( dvreg2ireg(i->Ain.AvxLdSt.reg),
+                             i->Ain.AvxLdSt.addr );
+      p = emitVexPrefix(p, vex);
+      *p++ = toUChar(i->Ain.AvxLdSt.isLoad ? 0x10 : 0x11);
+      p = doAMode_M(p, dvreg2ireg(i->Ain.AvxLdSt.reg), i->Ain.AvxLdSt.addr);
+      goto done;
+   }
+
+   case Ain_Avx32Fx8:
+   case Ain_Avx64Fx4: {
+      Bool is64 = toBool(i->tag == Ain_Avx64Fx4);
+      AMD64SseOp op = is64 ? i->Ain.Avx64Fx4.op   : i->Ain.Avx32Fx8.op;
+      HReg srcL     = is64 ? i->Ain.Avx64Fx4.srcL : i->Ain.Avx32Fx8.srcL;
+      HReg srcR     = is64 ? i->Ain.Avx64Fx4.srcR : i->Ain.Avx32Fx8.srcR;
+      HReg dst      = is64 ? i->Ain.Avx64Fx4.dst  : i->Ain.Avx32Fx8.dst;
+      Bool  unary = False;
+      xtra = 0;
+      switch (op) {
+         case Asse_ADDF:   opc = 0x58; break;
+         case Asse_DIVF:   opc = 0x5E; break;
+         case Asse_MAXF:   opc = 0x5F; break;
+         case Asse_MINF:   opc = 0x5D; break;
+         case Asse_MULF:   opc = 0x59; break;
+         case Asse_SUBF:   opc = 0x5C; break;
+         case Asse_SQRTF:  opc = 0x51; unary = True; break;
+         case Asse_RCPF:   if (is64) goto bad;
+                           opc = 0x53; unary = True; break;
+         case Asse_RSQRTF: if (is64) goto bad;
+                           opc = 0x52; unary = True; break;
+         case Asse_CMPEQF: opc = 0xC2; xtra = 0x100; break;
+         case Asse_CMPLTF: opc = 0xC2; xtra = 0x101; break;
+         case Asse_CMPLEF: opc = 0xC2; xtra = 0x102; break;
+         case Asse_CMPUNF: opc = 0xC2; xtra = 0x103; break;
+         default: goto bad;
+      }
+      /* vOPps/pd %srcR, %srcL, %dst.  pp = 66 for the pd forms. */
+      p = emitVexPrefix(p, vexAMode_R( dvreg2ireg(dst),
+                                       unary ? INVALID_HREG
+                                             : dvreg2ireg(srcL),
+                                       dvreg2ireg(srcR),
+                                       1/*0F*/, is64 ? 1 : 0 ));
+      *p++ = toUChar(opc);
+      p = doAMode_R(p, dvreg2ireg(dst), dvreg2ireg(srcR));
+      if (xtra & 0x100)
+         *p++ = toUChar(xtra & 0xFF);
+      goto done;
+   }
+
+   case Ain_AvxReRg: {
+      /* Same opcodes as Ain_SseReRg.  The logical ops and MOV use the
+         ps forms (pp = none), which are plain AVX; the integer ops
+         need the 66 prefix and are AVX2-only at this width.  Pack and
+         unpack work within 128-bit lanes and so are not offered. */
+      UInt  pp = 1; /* 66 */
+      Bool  useL = True;
+      switch (i->Ain.AvxReRg.op) {
+         case Asse_MOV:      pp = 0; opc = 0x10; useL = False; break;
+         case Asse_AND:      pp = 0; opc = 0x54; break;
+         case Asse_ANDN:     pp = 0; opc = 0x55; break;
+         case Asse_OR:       pp = 0; opc = 0x56; break;
+         case Asse_XOR:      pp = 0; opc = 0x57; break;
+         case Asse_ADD8:     opc = 0xFC; break;
+         case Asse_ADD16:    opc = 0xFD; break;
+         case Asse_ADD32:    opc = 0xFE; break;
+         case Asse_ADD64:    opc = 0xD4; break;
+         case Asse_QADD8S:   opc = 0xEC; break;
+         case Asse_QADD16S:  opc = 0xED; break;
+         case Asse_QADD8U:   opc = 0xDC; break;
+         case Asse_QADD16U:  opc = 0xDD; break;
+         case Asse_AVG8U:    opc = 0xE0; break;
+         case Asse_AVG16U:   opc = 0xE3; break;
+         case Asse_CMPEQ8:   opc = 0x74; break;
+         case Asse_CMPEQ16:  opc = 0x75; break;
+         case Asse_CMPEQ32:  opc = 0x76; break;
+         case Asse_CMPGT8S:  opc = 0x64; break;
+         case Asse_CMPGT16S: opc = 0x65; break;
+         case Asse_CMPGT32S: opc = 0x66; break;
+         case Asse_MAX16S:   opc = 0xEE; break;
+         case Asse_MAX8U:    opc = 0xDE; break;
+         case Asse_MIN16S:   opc = 0xEA; break;
+         case Asse_MIN8U:    opc = 0xDA; break;
+         case Asse_MULHI16U: opc = 0xE4; break;
+         case Asse_MULHI16S: opc = 0xE5; break;
+         case Asse_MUL16:    opc = 0xD5; break;
+         case Asse_SUB8:     opc = 0xF8; break;
+         case Asse_SUB16:    opc = 0xF9; break;
+         case Asse_SUB32:    opc = 0xFA; break;
+         case Asse_SUB64:    opc = 0xFB; break;
+         case Asse_QSUB8S:   opc = 0xE8; break;
+         case Asse_QSUB16S:  opc = 0xE9; break;
+         case Asse_QSUB8U:   opc = 0xD8; break;
+         case Asse_QSUB16U:  opc = 0xD9; break;
+         default: goto bad;
+      }
+      p = emitVexPrefix(p, vexAMode_R( dvreg2ireg(i->Ain.AvxReRg.dst),
+                                       useL ? dvreg2ireg(i->Ain.AvxReRg.srcL)
+                                            : INVALID_HREG,
+                                       dvreg2ireg(i->Ain.AvxReRg.srcR),
+                                       1/*0F*/, pp ));
+      *p++ = toUChar(opc);
+      p = doAMode_R(p, dvreg2ireg(i->Ain.AvxReRg.dst),
+                       dvreg2ireg(i->Ain.AvxReRg.srcR));
+      goto done;
+   }
+
+   case Ain_AvxInsHi:
+      /* vinsertf128 $1, %xmmHi, %ymmLo, %ymmDst
+         = VEX.256.66.0F3A 18 /r ib, with reg = dst, vvvv = lo,
+         rm = hi.  Only the low half of %ymmLo is read. */
+      p = emitVexPrefix(p, vexAMode_R( dvreg2ireg(i->Ain.AvxInsHi.dst),
+                                       vreg2ireg(i->Ain.AvxInsHi.lo),
+                                       vreg2ireg(i->Ain.AvxInsHi.hi),
+                                       3/*0F3A*/, 1/*66*/ ));
+      *p++ = 0x18;
+      p = doAMode_R(p, dvreg2ireg(i->Ain.AvxInsHi.dst),
+                       vreg2ireg(i->Ain.AvxInsHi.hi));
+      *p++ = 1;
+      goto done;
+
+   case Ain_AvxExtract:
+      /* vextractf128 $imm, %ymmSrc, %xmmDst
+         = VEX.256.66.0F3A 19 /r ib, with reg = src, rm = dst. */
+      p = emitVexPrefix(p, vexAMode_R( dvreg2ireg(i->Ain.AvxExtract.src),
+                                       INVALID_HREG,
+                                       vreg2ireg(i->Ain.AvxExtract.dst),
+                                       3/*0F3A*/, 1/*66*/ ));
+      *p++ = 0x19;
+      p = doAMode_R(p, dvreg2ireg(i->Ain.AvxExtract.src),
+                       vreg2ireg(i->Ain.AvxExtract.dst));
+      *p++ = toUChar(i->Ain.AvxExtract.hi ? 1 : 0);
+      goto done;
 
    case Ain_EvCheck: {
       /* We generate:
@@ -3506,6 +4366,11 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
       goto done;
    }
 
+   case Ain_LoopHead:
+      /* Nothing; the back edge is emitted by emitLoopBack_AMD64,
+         once it is known how far back the head is. */
+      goto done;
+
    default: 
       goto bad;
    }
@@ -3516,7 +4381,7 @@ Int emit_AMD64Instr ( /*MB_MOD*/Bool* is_profInc,
    /*NOTREACHED*/
    
   done:
-   vassert(p - &buf[0] <= 32);
+   vassert(p - &buf[0] <= 64);
    return p - &buf[0];
 
 #  undef fake
@@ -3532,6 +4397,221 @@ Int evCheckSzB_AMD64 ( void )
 }
 
 
+/* Hot/cold layout.  If i is a conditional exit, return an
+   unconditional copy of it, to be emitted out of line, else NULL. */
+AMD64Instr* coldExit_AMD64Instr ( AMD64Instr* i )
+{
+   AMD64Instr* stub;
+   switch (i->tag) {
+      case Ain_XDirect:
+         if (i->Ain.XDirect.cond == Acc_ALWAYS) return NULL;
+         break;
+      case Ain_XIndir:
+         if (i->Ain.XIndir.cond == Acc_ALWAYS) return NULL;
+         break;
+      case Ain_XAssisted:
+         if (i->Ain.XAssisted.cond == Acc_ALWAYS) return NULL;
+         break;
+      case Ain_XHost:
+         if (i->Ain.XHost.cond == Acc_ALWAYS) return NULL;
+         break;
+      default:
+         return NULL;
+   }
+   stub  = LibVEX_Alloc(sizeof(AMD64Instr));
+   *stub = *i;
+   switch (i->tag) {
+      case Ain_XDirect:   stub->Ain.XDirect.cond   = Acc_ALWAYS; break;
+      case Ain_XIndir:    stub->Ain.XIndir.cond    = Acc_ALWAYS; break;
+      case Ain_XAssisted: stub->Ain.XAssisted.cond = Acc_ALWAYS; break;
+      case Ain_XHost:     stub->Ain.XHost.cond     = Acc_ALWAYS; break;
+      default: vassert(0);
+   }
+   return stub;
+}
+
+/* Emit the branch to cold exit i's out of line copy, which is delta
+   bytes from the start of the branch.  This is the 2 byte rel8 form
+   if delta is in reach of it and the 6 byte rel32 form otherwise, so
+   the length depends only on delta, and never shrinks as delta
+   grows. */
+Int emitColdBranch_AMD64 ( UChar* buf, Int nbuf, AMD64Instr* i, Int delta )
+{
+   AMD64CondCode cond = Acc_ALWAYS;
+   UChar*        p    = &buf[0];
+   vassert(nbuf >= 6);
+   switch (i->tag) {
+      case Ain_XDirect:   cond = i->Ain.XDirect.cond;   break;
+      case Ain_XIndir:    cond = i->Ain.XIndir.cond;    break;
+      case Ain_XAssisted: cond = i->Ain.XAssisted.cond; break;
+      case Ain_XHost:     cond = i->Ain.XHost.cond;     break;
+      default: vpanic("emitColdBranch_AMD64");
+   }
+   vassert(cond != Acc_ALWAYS);
+   if (fits8bits(delta - 2)) {
+      /* jcc rel8 */
+      *p++ = toUChar(0x70 + (0xF & cond));
+      *p++ = toUChar(delta - 2);
+   } else {
+      /* jcc rel32 */
+      *p++ = 0x0F;
+      *p++ = toUChar(0x80 + (0xF & cond));
+      p = emit32(p, (UInt)(delta - 6));
+   }
+   return p - &buf[0];
+}
+
+
+/* Loops within a block.  The LoopHead marks where the loop starts. */
+Bool isLoopHead_AMD64Instr ( AMD64Instr* i )
+{
+   return i->tag == Ain_LoopHead;
+}
+
+/* Emit LoopBack i, whose LoopHead is delta bytes from the start of
+   it (so delta <= 0).  This is:
+
+      movl/movabsq $dstGA, %r11;  movq %r11, amRIP
+      decl amCounter
+      jns  loopHead              always rel32, so the length
+                                 doesn't depend on delta
+      jmp* amFailAddr
+
+   The last two are EvCheck's, with the sense of the jns turned
+   round so the loop is the taken case. */
+Int emitLoopBack_AMD64 ( UChar* buf, Int nbuf, AMD64Instr* i, Int delta )
+{
+   UChar* p   = &buf[0];
+   HReg   r11 = hregAMD64_R11();
+   UChar  rex;
+   vassert(nbuf >= 32);
+   vassert(i->tag == Ain_LoopBack);
+   vassert(delta <= 0);
+
+   /* Update the guest RIP, as XDirect does. */
+   if (fitsIn32Bits(i->Ain.LoopBack.dstGA)) {
+      /* movl sign-extend(dstGA), %r11 */
+      *p++ = 0x49;
+      *p++ = 0xC7;
+      *p++ = 0xC3;
+      p = emit32(p, (UInt)i->Ain.LoopBack.dstGA);
+   } else {
+      /* movabsq $dstGA, %r11 */
+      *p++ = 0x49;
+      *p++ = 0xBB;
+      p = emit64(p, i->Ain.LoopBack.dstGA);
+   }
+   /* movq %r11, amRIP */
+   *p++ = rexAMode_M(r11, i->Ain.LoopBack.amRIP);
+   *p++ = 0x89;
+   p = doAMode_M(p, r11, i->Ain.LoopBack.amRIP);
+
+   /* decl amCounter; as for EvCheck, no REX byte is needed.  The
+      encoding is FF /1. */
+   rex = clearWBit(rexAMode_M(mkHReg(1, HRcInt64, False),
+                              i->Ain.LoopBack.amCounter));
+   vassert(rex == 0x40);
+   *p++ = 0xFF;
+   p = doAMode_M(p, mkHReg(1, HRcInt64, False), i->Ain.LoopBack.amCounter);
+
+   /* jns rel32 loopHead */
+   *p++ = 0x0F;
+   *p++ = 0x89;
+   p = emit32(p, (UInt)(delta - (p + 4 - &buf[0])));
+
+   /* jmp* amFailAddr; FF /4, again with no REX byte */
+   rex = clearWBit(rexAMode_M(mkHReg(4, HRcInt64, False),
+                              i->Ain.LoopBack.amFailAddr));
+   vassert(rex == 0x40);
+   *p++ = 0xFF;
+   p = doAMode_M(p, mkHReg(4, HRcInt64, False), i->Ain.LoopBack.amFailAddr);
+   return p - &buf[0];
+}
+
+
+/* Relocations.  code[0 .. len-1] is what emit_AMD64Instr made of i,
+   given the same disp_cp_xindir and disp_cp_xindir_miss.  Write the
+   host addresses in it which depend on where things are loaded to
+   relocs[0 ..], with offsets from code, and return how many there
+   are, which is at most 2.  NB: what goes on here has to be very
+   closely coordinated with the emit_AMD64Instr cases concerned. */
+static HReloc mkHReloc ( Int offs, HRelocKind kind, Int szB, Int back )
+{
+   HReloc r;
+   r.offs = offs;
+   r.kind = toUChar(kind);
+   r.szB  = toUChar(szB);
+   r.back = toUChar(back);
+   return r;
+}
+
+Int getRelocs_AMD64Instr ( /*OUT*/HReloc* relocs,
+                           AMD64Instr* i, UChar* code, Int len,
+                           void* disp_cp_xindir,
+                           void* disp_cp_xindir_miss )
+{
+   Int offs;
+   switch (i->tag) {
+      case Ain_Call:
+         /* [jcc over] movl/movabsq $target, %r11; call *%r11 */
+         offs = i->Ain.Call.cond != Acc_ALWAYS ? 2 : 0;
+         if (fitsIn32Bits(i->Ain.Call.target)) {
+            vassert(*(Int*)(&code[offs+3]) == (Int)i->Ain.Call.target);
+            relocs[0] = mkHReloc(offs+3, HReloc_Helper, 4, 0);
+         } else {
+            vassert(*(ULong*)(&code[offs+2]) == i->Ain.Call.target);
+            relocs[0] = mkHReloc(offs+2, HReloc_Helper, 8, 0);
+         }
+         return 1;
+      case Ain_XDirect:
+         /* ends with the 13 byte chain site
+            movabsq $disp_cp_chain_me_to_{slow,fast}EP, %r11; call *%r11 */
+         vassert(code[len-13] == 0x49 && code[len-12] == 0xBB);
+         relocs[0] = mkHReloc(len-11, i->Ain.XDirect.toFastEP
+                                         ? HReloc_ChainMeFast
+                                         : HReloc_ChainMeSlow, 8, 2);
+         return 1;
+      case Ain_RSPush:
+         /* jmp over an unconditional XDirect to the slow entry point,
+            which is at code[2 .. 2+code[1]-1]. */
+         offs = 2 + code[1];
+         vassert(code[offs-13] == 0x49 && code[offs-12] == 0xBB);
+         relocs[0] = mkHReloc(offs-11, HReloc_ChainMeSlow, 8, 2);
+         return 1;
+      case Ain_XIndir:
+         if (disp_cp_xindir_miss != NULL) {
+            /* ends with the 41 byte inline cache, whose last 26 bytes
+               are
+                 movabsq $disp_cp_xindir, %r11; jmp *%r11
+                 movabsq $disp_cp_xindir_miss, %r11; call *%r11 */
+            vassert(*(ULong*)(&code[len-24]) == Ptr_to_ULong(disp_cp_xindir));
+            vassert(*(ULong*)(&code[len-11])
+                    == Ptr_to_ULong(disp_cp_xindir_miss));
+            relocs[0] = mkHReloc(len-24, HReloc_XIndir, 8, 0);
+            relocs[1] = mkHReloc(len-11, HReloc_XIndirMiss, 8, 0);
+            return 2;
+         }
+         /* ends with movl/movabsq $disp_cp_xindir, %r11; jmp *%r11 */
+         if (fitsIn32Bits(Ptr_to_ULong(disp_cp_xindir))) {
+            vassert(*(Int*)(&code[len-7])
+                    == (Int)Ptr_to_ULong(disp_cp_xindir));
+            relocs[0] = mkHReloc(len-7, HReloc_XIndir, 4, 0);
+         } else {
+            vassert(*(ULong*)(&code[len-11]) == Ptr_to_ULong(disp_cp_xindir));
+            relocs[0] = mkHReloc(len-11, HReloc_XIndir, 8, 0);
+         }
+         return 1;
+      case Ain_XAssisted:
+         /* ends with movabsq $disp_cp_xassisted, %r11; jmp *%r11 */
+         vassert(code[len-13] == 0x49 && code[len-12] == 0xBB);
+         relocs[0] = mkHReloc(len-11, HReloc_XAssisted, 8, 0);
+         return 1;
+      default:
+         return 0;
+   }
+}
+
+
 /* NB: what goes on here has to be very closely coordinated with the
    emitInstr case for XDirect, above. */
 VexInvalRange chainXDirect_AMD64 ( void* place_to_chain,
@@ -3682,6 +4762,131 @@ VexInvalRange unchainXDirect_AMD64 ( void* place_to_unchain,
 }
 
 
+/* NB: what goes on here has to be very closely coordinated with the
+   emitInstr case for XIndir, above. */
+VexInvalRange chainXIndir_AMD64 ( void*  place_to_chain,
+                                  void*  disp_cp_xindir_miss_EXPECTED,
+                                  Addr64 guest_addr,
+                                  void*  place_to_jump_to,
+                                  void*  disp_cp_xindir )
+{
+   /* What we're expecting to see is the empty inline cache:
+         0  movabsq $0, %r11
+        10  cmpq %r11, dstGA
+        13  jne 28
+        15  movabsq $disp_cp_xindir, %r11
+        25  jmpq *%r11
+        28  movabsq $disp_cp_xindir_miss_EXPECTED, %r11
+        38  call *%r11
+      viz
+        49 BB <8 bytes value == 0>
+        4x 39 xx
+        75 0D
+        49 BB <8 bytes value == disp_cp_xindir>
+        41 FF E3
+        49 BB <8 bytes value == disp_cp_xindir_miss_EXPECTED>
+        41 FF D3
+   */
+   UChar* p = (UChar*)place_to_chain;
+   vassert(p[0] == 0x49 && p[1] == 0xBB);
+   vassert(*(ULong*)(&p[2]) == 0);
+   vassert(p[11] == 0x39);
+   vassert(p[13] == 0x75 && p[14] == 0x0D);
+   vassert(p[15] == 0x49 && p[16] == 0xBB);
+   vassert(*(ULong*)(&p[17]) == Ptr_to_ULong(disp_cp_xindir));
+   vassert(p[25] == 0x41 && p[26] == 0xFF && p[27] == 0xE3);
+   vassert(p[28] == 0x49 && p[29] == 0xBB);
+   vassert(*(ULong*)(&p[30]) == Ptr_to_ULong(disp_cp_xindir_miss_EXPECTED));
+   vassert(p[38] == 0x41 && p[39] == 0xFF && p[40] == 0xD3);
+   /* What we want to change it to is:
+         0  movabsq $guest_addr, %r11
+        10  cmpq %r11, dstGA
+        13  jne 28
+        15  movabsq $place_to_jump_to, %r11     (or jmpq disp32;
+        25  jmpq *%r11                           ud2; ud2; ud2; ud2)
+        28  movabsq $disp_cp_xindir, %r11
+        38  jmpq *%r11
+      using the short form of the hit jump where the displacement
+      allows, as chainXDirect_AMD64 does.  Either way the lengths
+      are unchanged. */
+   *(ULong*)(&p[2]) = guest_addr;
+
+   Long delta   = (Long)((UChar*)place_to_jump_to - (UChar*)&p[15])
+                  - (Long)5;
+   Bool shortOK = delta >= -1000*1000*1000 && delta < 1000*1000*1000;
+   if (shortOK) {
+      p[15] = 0xE9;
+      p[16] = (delta >> 0) & 0xFF;
+      p[17] = (delta >> 8) & 0xFF;
+      p[18] = (delta >> 16) & 0xFF;
+      p[19] = (delta >> 24) & 0xFF;
+      p[20] = 0x0F; p[21] = 0x0B;
+      p[22] = 0x0F; p[23] = 0x0B;
+      p[24] = 0x0F; p[25] = 0x0B;
+      p[26] = 0x0F; p[27] = 0x0B;
+   } else {
+      *(ULong*)(&p[17]) = Ptr_to_ULong(place_to_jump_to);
+   }
+
+   *(ULong*)(&p[30]) = Ptr_to_ULong(disp_cp_xindir);
+   p[40] = 0xE3;
+   VexInvalRange vir = { (HWord)place_to_chain, 41 };
+   return vir;
+}
+
+
+/* NB: what goes on here has to be very closely coordinated with the
+   emitInstr case for XIndir, above. */
+VexInvalRange unchainXIndir_AMD64 ( void* place_to_unchain,
+                                    void* place_to_jump_to_EXPECTED,
+                                    void* disp_cp_xindir,
+                                    void* disp_cp_xindir_miss )
+{
+   /* What we're expecting to see is an inline cache as left by
+      chainXIndir_AMD64, whose hit jump is either the long or the
+      short form, going to place_to_jump_to_EXPECTED. */
+   UChar* p     = (UChar*)place_to_unchain;
+   Bool   valid = False;
+   vassert(p[0] == 0x49 && p[1] == 0xBB);
+   vassert(p[11] == 0x39);
+   vassert(p[13] == 0x75 && p[14] == 0x0D);
+   if (p[15] == 0x49 && p[16] == 0xBB
+       && *(ULong*)(&p[17]) == Ptr_to_ULong(place_to_jump_to_EXPECTED)
+       && p[25] == 0x41 && p[26] == 0xFF && p[27] == 0xE3) {
+      /* it's the long form */
+      valid = True;
+   }
+   else
+   if (p[15] == 0xE9
+       && p[20] == 0x0F && p[21] == 0x0B
+       && p[22] == 0x0F && p[23] == 0x0B
+       && p[24] == 0x0F && p[25] == 0x0B
+       && p[26] == 0x0F && p[27] == 0x0B) {
+      /* It's the short form.  Check the offset is right. */
+      Int  s32 = *(Int*)(&p[16]);
+      Long s64 = (Long)s32;
+      if (&p[15] + 5 + s64 == (UChar*)place_to_jump_to_EXPECTED)
+         valid = True;
+   }
+   vassert(valid);
+   vassert(p[28] == 0x49 && p[29] == 0xBB);
+   vassert(*(ULong*)(&p[30]) == Ptr_to_ULong(disp_cp_xindir));
+   vassert(p[38] == 0x41 && p[39] == 0xFF && p[40] == 0xE3);
+   /* And put back the empty inline cache, as generated. */
+   *(ULong*)(&p[2]) = 0;
+   p[15] = 0x49;
+   p[16] = 0xBB;
+   *(ULong*)(&p[17]) = Ptr_to_ULong(disp_cp_xindir);
+   p[25] = 0x41;
+   p[26] = 0xFF;
+   p[27] = 0xE3;
+   *(ULong*)(&p[30]) = Ptr_to_ULong(disp_cp_xindir_miss);
+   p[40] = 0xD3;
+   VexInvalRange vir = { (HWord)place_to_unchain, 41 };
+   return vir;
+}
+
+
 /* Patch the counter address into a profile inc point, as previously
    created by the Ain_ProfInc case for emit_AMD64Instr. */
 VexInvalRange patchProfInc_AMD64 ( void*  place_to_patch,
@@ -65,6 +65,10 @@ extern HReg hregAMD64_R13 ( void );
 extern HReg hregAMD64_R14 ( void );
 extern HReg hregAMD64_R15 ( void );
 
+/* The host register holding cached guest register slot i (see
+   VexAbiInfo.host_amd64_cached_guest_offsets). */
+extern HReg hregAMD64_CachedGuest ( Int i );
+
 extern HReg hregAMD64_FAKE0 ( void );
 extern HReg hregAMD64_FAKE1 ( void );
 extern HReg hregAMD64_FAKE2 ( void );
@@ -85,6 +89,10 @@ extern HReg hregAMD64_XMM10 ( void );
 extern HReg hregAMD64_XMM11 ( void );
 extern HReg hregAMD64_XMM12 ( void );
 
+extern HReg hregAMD64_YMM13 ( void );
+extern HReg hregAMD64_YMM14 ( void );
+extern HReg hregAMD64_YMM15 ( void );
+
 
 /* --------- Condition codes, AMD encoding. --------- */
 
@@ -342,7 +350,11 @@ typedef
       Asse_SAR16, Asse_SAR32, 
       Asse_PACKSSD, Asse_PACKSSW, Asse_PACKUSW,
       Asse_UNPCKHB, Asse_UNPCKHW, Asse_UNPCKHD, Asse_UNPCKHQ,
-      Asse_UNPCKLB, Asse_UNPCKLW, Asse_UNPCKLD, Asse_UNPCKLQ
+      Asse_UNPCKLB, Asse_UNPCKLW, Asse_UNPCKLD, Asse_UNPCKLQ,
+      /* AES-NI rounds.  AESIMC only reads src, but is done here as
+         dst := op(src, dst) like the rest; see iselVecExpr_wrk. */
+      Asse_AESENC, Asse_AESENCLAST, Asse_AESDEC, Asse_AESDECLAST,
+      Asse_AESIMC
    }
    AMD64SseOp;
 
@@ -367,12 +379,15 @@ typedef
       Ain_XDirect,     /* direct transfer to GA */
       Ain_XIndir,      /* indirect transfer to GA */
       Ain_XAssisted,   /* assisted transfer to GA */
+      Ain_XHost,       /* transfer to GA, continuing at a known HA */
+      Ain_RSPush,      /* push onto the shadow return stack */
       Ain_CMov64,      /* conditional move */
       Ain_MovxLQ,      /* reg-reg move, zx-ing/sx-ing top half */
       Ain_LoadEX,      /* mov{s,z}{b,w,l}q from mem to reg */
       Ain_Store,       /* store 32/16/8 bit value in memory */
       Ain_Set64,       /* convert condition code to 64-bit value */
       Ain_Bsfr64,      /* 64-bit bsf/bsr */
+      Ain_CRC32C,      /* SSE4.2 crc32{b,w,l,q} */
       Ain_MFence,      /* mem fence */
       Ain_ACAS,        /* 8/16/32/64-bit lock;cmpxchg */
       Ain_DACAS,       /* lock;cmpxchg8b/16b (doubleword ACAS, 2 x
@@ -398,11 +413,19 @@ typedef
       Ain_SseReRg,     /* SSE binary general reg-reg, Re, Rg */
       Ain_SseCMov,     /* SSE conditional move */
       Ain_SseShuf,     /* SSE2 shuffle (pshufd) */
-      //uu Ain_AvxLdSt,     /* AVX load/store 256 bits,
-      //uu                     no alignment constraints */
-      //uu Ain_AvxReRg,     /* AVX binary general reg-reg, Re, Rg */
+      Ain_SseCLMul,    /* carry-less multiply (pclmulqdq) */
+      Ain_SseFMA,      /* scalar fused multiply-add/sub (FMA3) */
+      Ain_AvxLdSt,     /* AVX load/store 256 bits,
+                          no alignment constraints */
+      Ain_Avx32Fx8,    /* AVX binary, 32Fx8, 3-operand */
+      Ain_Avx64Fx4,    /* AVX binary, 64Fx4, 3-operand */
+      Ain_AvxReRg,     /* AVX binary general reg-reg, 3-operand */
+      Ain_AvxInsHi,    /* AVX join two 128-bit regs into one 256 */
+      Ain_AvxExtract,  /* AVX extract 128-bit half of a 256 */
       Ain_EvCheck,     /* Event check */
-      Ain_ProfInc      /* 64-bit profile counter increment */
+      Ain_ProfInc,     /* 64-bit profile counter increment */
+      Ain_LoopHead,    /* start of a loop within the block */
+      Ain_LoopBack     /* event check and jump back to the loop head */
    }
    AMD64InstrTag;
 
@@ -498,6 +521,24 @@ typedef
             AMD64CondCode cond; /* can be Acc_ALWAYS */
             IRJumpKind    jk;
          } XAssisted;
+         /* Update the guest RIP value, then jump to the host address
+            in dstHA, which must be code that continues at the guest
+            address dstGA.  May be conditional. */
+         struct {
+            HReg          dstGA;
+            AMD64AMode*   amRIP;
+            HReg          dstHA;
+            AMD64CondCode cond; /* can be Acc_ALWAYS */
+         } XHost;
+         /* Generate an out-of-line chain-me stub to retGA, which
+            updates the guest RIP via amRIP like an XDirect to the
+            slow entry point, and store the stub's address at amHA.
+            Control flows around the stub. */
+         struct {
+            Addr64        retGA;
+            AMD64AMode*   amRIP;
+            AMD64AMode*   amHA;
+         } RSPush;
          /* Mov src to dst on the given condition, which may not
             be the bogus Acc_ALWAYS. */
          struct {
@@ -535,6 +576,12 @@ typedef
             HReg src;
             HReg dst;
          } Bsfr64;
+         /* dst := CRC32C of dst and the low szB bytes of src. */
+         struct {
+            UChar    szB; /* 1, 2, 4 or 8 */
+            AMD64RM* src;
+            HReg     dst;
+         } CRC32C;
          /* Mem fence.  In short, an insn which flushes all preceding
             loads and stores as much as possible before continuing.
             On AMD64 we emit a real "mfence". */
@@ -637,7 +684,7 @@ typedef
          } Sse32Fx4;
          struct {
             AMD64SseOp op;
-            HReg       src;
+            AMD64RM*   src;
             HReg       dst;
          } Sse32FLo;
          struct {
@@ -647,7 +694,7 @@ typedef
          } Sse64Fx2;
          struct {
             AMD64SseOp op;
-            HReg       src;
+            AMD64RM*   src;
             HReg       dst;
          } Sse64FLo;
          struct {
@@ -667,16 +714,60 @@ typedef
             HReg   src;
             HReg   dst;
          } SseShuf;
-         //uu struct {
-         //uu    Bool        isLoad;
-         //uu    HReg        reg;
-         //uu    AMD64AMode* addr;
-         //uu } AvxLdSt;
-         //uu struct {
-         //uu    AMD64SseOp op;
-         //uu    HReg       src;
-         //uu    HReg       dst;
-         //uu } AvxReRg;
+         /* dst := the 128-bit carry-less product of a 64-bit half of
+            each of dst and src, as selected by imm bits 0 and 4. */
+         struct {
+            Int    imm; /* 0x00, 0x01, 0x10 or 0x11 */
+            HReg   src;
+            HReg   dst;
+         } SseCLMul;
+         /* dst := dst * mul + add (or - add, if isSub), rounded once,
+            in the lowest 32- or 64-bit lane. */
+         struct {
+            UChar  szB; /* 4 or 8 */
+            Bool   isSub;
+            HReg   mul;
+            HReg   add;
+            HReg   dst;
+         } SseFMA;
+         struct {
+            Bool        isLoad;
+            HReg        reg;
+            AMD64AMode* addr;
+         } AvxLdSt;
+         /* The 256-bit forms use the non-destructive VEX encoding:
+            dst = srcL `op` srcR.  For unary ops (sqrt etc) and
+            MOV, only srcR is read; srcL must be the same as srcR. */
+         struct {
+            AMD64SseOp op;
+            HReg       srcL;
+            HReg       srcR;
+            HReg       dst;
+         } Avx32Fx8;
+         struct {
+            AMD64SseOp op;
+            HReg       srcL;
+            HReg       srcR;
+            HReg       dst;
+         } Avx64Fx4;
+         struct {
+            AMD64SseOp op;
+            HReg       srcL;
+            HReg       srcR;
+            HReg       dst;
+         } AvxReRg;
+         /* dst[255:128] = hi, dst[127:0] = lo (vinsertf128 $1) */
+         struct {
+            HReg       hi;   /* Vec128 */
+            HReg       lo;   /* Vec128 */
+            HReg       dst;  /* Vec256 */
+         } AvxInsHi;
+         /* dst = src[255:128] or src[127:0] (vextractf128) */
+         struct {
+            Bool       hi;
+            HReg       src;  /* Vec256 */
+            HReg       dst;  /* Vec128 */
+         } AvxExtract;
          struct {
             AMD64AMode* amCounter;
             AMD64AMode* amFailAddr;
@@ -686,6 +777,23 @@ typedef
                installed later, post-translation, by patching it in,
                as it is not known at translation time. */
          } ProfInc;
+         struct {
+            /* No fields.  Marks where LoopBack goes back to, and
+               generates no code. */
+         } LoopHead;
+         /* Set the guest RIP to dstGA, which is the block's own
+            start, then do an event check.  If it passes go back to
+            the LoopHead, else leave via amFailAddr as EvCheck does.
+            regs[0 .. nRegs-1] hold values kept round the loop, so
+            are read here. */
+         struct {
+            Addr64      dstGA;
+            AMD64AMode* amRIP;
+            AMD64AMode* amCounter;
+            AMD64AMode* amFailAddr;
+            Int         nRegs;
+            HReg*       regs;
+         } LoopBack;
 
       } Ain;
    }
@@ -709,6 +817,10 @@ extern AMD64Instr* AMD64Instr_XIndir     ( HReg dstGA, AMD64AMode* amRIP,
                                            AMD64CondCode cond );
 extern AMD64Instr* AMD64Instr_XAssisted  ( HReg dstGA, AMD64AMode* amRIP,
                                            AMD64CondCode cond, IRJumpKind jk );
+extern AMD64Instr* AMD64Instr_XHost      ( HReg dstGA, AMD64AMode* amRIP,
+                                           HReg dstHA, AMD64CondCode cond );
+extern AMD64Instr* AMD64Instr_RSPush     ( Addr64 retGA, AMD64AMode* amRIP,
+                                           AMD64AMode* amHA );
 extern AMD64Instr* AMD64Instr_CMov64     ( AMD64CondCode, AMD64RM* src, HReg dst );
 extern AMD64Instr* AMD64Instr_MovxLQ     ( Bool syned, HReg src, HReg dst );
 extern AMD64Instr* AMD64Instr_LoadEX     ( UChar szSmall, Bool syned,
@@ -716,6 +828,7 @@ extern AMD64Instr* AMD64Instr_LoadEX     ( UChar szSmall, Bool syned,
 extern AMD64Instr* AMD64Instr_Store      ( UChar sz, HReg src, AMD64AMode* dst );
 extern AMD64Instr* AMD64Instr_Set64      ( AMD64CondCode cond, HReg dst );
 extern AMD64Instr* AMD64Instr_Bsfr64     ( Bool isFwds, HReg src, HReg dst );
+extern AMD64Instr* AMD64Instr_CRC32C     ( Int szB, AMD64RM* src, HReg dst );
 extern AMD64Instr* AMD64Instr_MFence     ( void );
 extern AMD64Instr* AMD64Instr_ACAS       ( AMD64AMode* addr, UChar sz );
 extern AMD64Instr* AMD64Instr_DACAS      ( AMD64AMode* addr, UChar sz );
@@ -734,16 +847,33 @@ extern AMD64Instr* AMD64Instr_SseLdSt    ( Bool isLoad, Int sz, HReg, AMD64AMode
 extern AMD64Instr* AMD64Instr_SseLdzLO   ( Int sz, HReg, AMD64AMode* );
 extern AMD64Instr* AMD64Instr_Sse32Fx4   ( AMD64SseOp, HReg, HReg );
 extern AMD64Instr* AMD64Instr_Sse32FLo   ( AMD64SseOp, HReg, HReg );
+extern AMD64Instr* AMD64Instr_Sse32FLoM  ( AMD64SseOp, AMD64AMode*, HReg );
 extern AMD64Instr* AMD64Instr_Sse64Fx2   ( AMD64SseOp, HReg, HReg );
 extern AMD64Instr* AMD64Instr_Sse64FLo   ( AMD64SseOp, HReg, HReg );
+extern AMD64Instr* AMD64Instr_Sse64FLoM  ( AMD64SseOp, AMD64AMode*, HReg );
 extern AMD64Instr* AMD64Instr_SseReRg    ( AMD64SseOp, HReg, HReg );
 extern AMD64Instr* AMD64Instr_SseCMov    ( AMD64CondCode, HReg src, HReg dst );
 extern AMD64Instr* AMD64Instr_SseShuf    ( Int order, HReg src, HReg dst );
-//uu extern AMD64Instr* AMD64Instr_AvxLdSt    ( Bool isLoad, HReg, AMD64AMode* );
-//uu extern AMD64Instr* AMD64Instr_AvxReRg    ( AMD64SseOp, HReg, HReg );
+extern AMD64Instr* AMD64Instr_SseCLMul   ( Int imm, HReg src, HReg dst );
+extern AMD64Instr* AMD64Instr_SseFMA     ( UChar szB, Bool isSub, HReg mul,
+                                           HReg add, HReg dst );
+extern AMD64Instr* AMD64Instr_AvxLdSt    ( Bool isLoad, HReg, AMD64AMode* );
+extern AMD64Instr* AMD64Instr_Avx32Fx8   ( AMD64SseOp, HReg srcL, HReg srcR,
+                                           HReg dst );
+extern AMD64Instr* AMD64Instr_Avx64Fx4   ( AMD64SseOp, HReg srcL, HReg srcR,
+                                           HReg dst );
+extern AMD64Instr* AMD64Instr_AvxReRg    ( AMD64SseOp, HReg srcL, HReg srcR,
+                                           HReg dst );
+extern AMD64Instr* AMD64Instr_AvxInsHi   ( HReg hi, HReg lo, HReg dst );
+extern AMD64Instr* AMD64Instr_AvxExtract ( Bool hi, HReg src, HReg dst );
 extern AMD64Instr* AMD64Instr_EvCheck    ( AMD64AMode* amCounter,
                                            AMD64AMode* amFailAddr );
 extern AMD64Instr* AMD64Instr_ProfInc    ( void );
+extern AMD64Instr* AMD64Instr_LoopHead   ( void );
+extern AMD64Instr* AMD64Instr_LoopBack   ( Addr64 dstGA, AMD64AMode* amRIP,
+                                           AMD64AMode* amCounter,
+                                           AMD64AMode* amFailAddr,
+                                           Int nRegs, HReg* regs );
 
 
 extern void ppAMD64Instr ( AMD64Instr*, Bool );
@@ -759,23 +889,29 @@ extern Int          emit_AMD64Instr        ( /*MB_MOD*/Bool* is_profInc,
                                              void* disp_cp_chain_me_to_slowEP,
                                              void* disp_cp_chain_me_to_fastEP,
                                              void* disp_cp_xindir,
+                                             void* disp_cp_xindir_miss,
                                              void* disp_cp_xassisted );
 
 extern void genSpill_AMD64  ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
                               HReg rreg, Int offset, Bool );
 extern void genReload_AMD64 ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
                               HReg rreg, Int offset, Bool );
+extern Int  peephole_AMD64Instr ( HInstr* prev, HInstr** cur, Bool );
 
-extern void         getAllocableRegs_AMD64 ( Int*, HReg** );
+extern void         getAllocableRegs_AMD64 ( Int*, HReg**, UInt hwcaps,
+                                             VexAbiInfo* );
+extern void         getLoopRegs_AMD64      ( Int*, HReg**, VexAbiInfo* );
 extern HInstrArray* iselSB_AMD64           ( IRSB*, 
                                              VexArch,
                                              VexArchInfo*,
                                              VexAbiInfo*,
                                              Int offs_Host_EvC_Counter,
                                              Int offs_Host_EvC_FailAddr,
+                                             Int offs_Host_RetStack,
                                              Bool chainingAllowed,
                                              Bool addProfInc,
-                                             Addr64 max_ga );
+                                             Addr64 max_ga,
+                                             Bool selfLoop );
 
 /* How big is an event check?  This is kind of a kludge because it
    depends on the offsets of host_EvC_FAILADDR and host_EvC_COUNTER,
@@ -784,6 +920,23 @@ extern HInstrArray* iselSB_AMD64           ( IRSB*,
    worst case we will merely assert at startup. */
 extern Int evCheckSzB_AMD64 ( void );
 
+/* Move conditional exits out of line; see LibVEX_Translate. */
+extern AMD64Instr* coldExit_AMD64Instr  ( AMD64Instr* i );
+extern Int         emitColdBranch_AMD64 ( UChar* buf, Int nbuf,
+                                          AMD64Instr* i, Int delta );
+
+/* Loops within a block; see LibVEX_Translate. */
+extern Bool isLoopHead_AMD64Instr ( AMD64Instr* i );
+extern Int  emitLoopBack_AMD64    ( UChar* buf, Int nbuf,
+                                    AMD64Instr* i, Int delta );
+
+/* Where the code for an insn depends on load addresses; see
+   HReloc. */
+extern Int getRelocs_AMD64Instr ( /*OUT*/HReloc* relocs,
+                                  AMD64Instr* i, UChar* code, Int len,
+                                  void* disp_cp_xindir,
+                                  void* disp_cp_xindir_miss );
+
 /* Perform a chaining and unchaining of an XDirect jump. */
 extern VexInvalRange chainXDirect_AMD64 ( void* place_to_chain,
                                           void* disp_cp_chain_me_EXPECTED,
@@ -793,6 +946,18 @@ extern VexInvalRange unchainXDirect_AMD64 ( void* place_to_unchain,
                                             void* place_to_jump_to_EXPECTED,
                                             void* disp_cp_chain_me );
 
+/* Populate and empty an XIndir inline cache. */
+extern VexInvalRange chainXIndir_AMD64 ( void*  place_to_chain,
+                                         void*  disp_cp_xindir_miss_EXPECTED,
+                                         Addr64 guest_addr,
+                                         void*  place_to_jump_to,
+                                         void*  disp_cp_xindir );
+
+extern VexInvalRange unchainXIndir_AMD64 ( void* place_to_unchain,
+                                           void* place_to_jump_to_EXPECTED,
+                                           void* disp_cp_xindir,
+                                           void* disp_cp_xindir_miss );
+
 /* Patch the counter location into an existing ProfInc point. */
 extern VexInvalRange patchProfInc_AMD64 ( void*  place_to_patch,
                                           ULong* location_of_counter );
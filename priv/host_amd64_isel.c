@@ -119,7 +119,10 @@ static Bool isZeroU8 ( IRExpr* e )
         - vregmapHI is only used for 128-bit integer-typed
              IRTemps.  It holds the identity of a second
              64-bit virtual HReg, which holds the high half
-             of the value.
+             of the value.  It is also used for V256 IRTemps
+             on hosts without AVX, which are kept in pairs of
+             128-bit vregs.  With AVX they get a single
+             HRcVec256 vreg and vregmapHI is unused.
 
    - The host subarchitecture we are selecting insns for.  
      This is set at the start and does not change.
@@ -140,6 +143,24 @@ static Bool isZeroU8 ( IRExpr* e )
      point of the destination, thereby avoiding the destination's
      event check.
 
+   - The guest state offset of the shadow return stack, or -1 if
+     call/return prediction is not wanted.  Set at the start and does
+     not change.
+
+   - The address just past the most recently seen guest insn (from
+     its IMark).  For a block ending in a call, this is the return
+     address.
+
+   - The guest state offsets of guest registers cached in host
+     registers (zero for unused slots), copied from the
+     VexAbiInfo, and whether there are any.  Set at the start and do
+     not change.
+
+   - For a block which loops within itself (see iselSB_AMD64), the
+     real register holding each IRTemp the preheader computes, or
+     INVALID_HREG.  Filled in as the preheader is selected.  Uses
+     of such a temp copy the real register to a fresh vreg.
+
    Note, this is all host-independent.  (JRS 20050201: well, kinda
    ... not completely.  Compare with ISelEnv for X86.)
 */
@@ -158,17 +179,33 @@ typedef
       Bool         chainingAllowed;
       Addr64       max_ga;
 
+      Int          offs_RS;
+
+      Int          cachedOffs[VEX_N_CACHED_GUEST_REGS];
+      Bool         anyCached;
+
       /* These are modified as we go along. */
+      HReg*        loopregmap;
       HInstrArray* code;
       Int          vreg_ctr;
+      Addr64       last_insn_end;
    }
    ISelEnv;
 
 
+static void        addInstr     ( ISelEnv* env, AMD64Instr* instr );
+static HReg        newVRegI     ( ISelEnv* env );
+static AMD64Instr* mk_iMOVsd_RR ( HReg src, HReg dst );
+
 static HReg lookupIRTemp ( ISelEnv* env, IRTemp tmp )
 {
    vassert(tmp >= 0);
    vassert(tmp < env->n_vregmap);
+   if (env->loopregmap && !hregIsInvalid(env->loopregmap[tmp])) {
+      HReg dst = newVRegI(env);
+      addInstr(env, mk_iMOVsd_RR(env->loopregmap[tmp], dst));
+      return dst;
+   }
    return env->vregmap[tmp];
 }
 
@@ -205,6 +242,75 @@ static HReg newVRegV ( ISelEnv* env )
    return reg;
 }
 
+static HReg newVRegDV ( ISelEnv* env )
+{
+   HReg reg = mkHReg(env->vreg_ctr, HRcVec256, True/*virtual reg*/);
+   env->vreg_ctr++;
+   return reg;
+}
+
+/* Are V256 values kept in single 256-bit registers? */
+static inline Bool nativeV256 ( ISelEnv* env )
+{
+   return toBool(env->hwcaps & VEX_HWCAPS_AMD64_AVX);
+}
+
+
+/* Guest registers cached in host registers.  An exact 64-bit GET
+   or PUT of a cached slot becomes a register move.  Anything else
+   touching a slot goes via the guest state: the slot is written back
+   beforehand, and if the access writes, reloaded afterwards.  See
+   "Cached guest registers" in libvex.h. */
+
+/* The host register caching the 64-bit guest register at 'offset',
+   or INVALID_HREG if it is not cached. */
+static HReg lookupCachedGuest ( ISelEnv* env, Int offset )
+{
+   Int i;
+   if (LIKELY(!env->anyCached))
+      return INVALID_HREG;
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++)
+      if (env->cachedOffs[i] != 0 && env->cachedOffs[i] == offset)
+         return hregAMD64_CachedGuest(i);
+   return INVALID_HREG;
+}
+
+static Bool overlapsCachedGuest ( ISelEnv* env, Int offset, Int szB )
+{
+   Int i;
+   if (LIKELY(!env->anyCached))
+      return False;
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++) {
+      Int c = env->cachedOffs[i];
+      if (c != 0 && c < offset + szB && offset < c + 8)
+         return True;
+   }
+   return False;
+}
+
+/* Write back (isStore) or reload the cached guest registers which
+   overlap [offset, +szB). */
+static void syncCachedGuest ( ISelEnv* env, Bool isStore,
+                              Int offset, Int szB )
+{
+   Int i;
+   if (LIKELY(!env->anyCached))
+      return;
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++) {
+      Int c = env->cachedOffs[i];
+      if (c == 0 || c >= offset + szB || offset >= c + 8)
+         continue;
+      AMD64AMode* am = AMD64AMode_IR(c, hregAMD64_RBP());
+      HReg        r  = hregAMD64_CachedGuest(i);
+      if (isStore)
+         addInstr(env, AMD64Instr_Alu64M(Aalu_MOV, AMD64RI_Reg(r), am));
+      else
+         addInstr(env, AMD64Instr_Alu64R(Aalu_MOV, AMD64RMI_Mem(am), r));
+   }
+}
+
+#define ALL_GUEST_STATE 0x40000000
+
 
 /*---------------------------------------------------------*/
 /*--- ISEL: Forward declarations                        ---*/
@@ -253,6 +359,9 @@ static void          iselDVecExpr_wrk ( /*OUT*/HReg* rHi, HReg* rLo,
 static void          iselDVecExpr     ( /*OUT*/HReg* rHi, HReg* rLo, 
                                         ISelEnv* env, IRExpr* e );
 
+static HReg          iselV256Expr_wrk ( ISelEnv* env, IRExpr* e );
+static HReg          iselV256Expr     ( ISelEnv* env, IRExpr* e );
+
 
 /*---------------------------------------------------------*/
 /*--- ISEL: Misc helpers                                ---*/
@@ -397,6 +506,11 @@ static AMD64Instr* iselIntExpr_single_instruction ( ISelEnv* env,
 
    if (e->tag == Iex_Get) {
       vassert(e->Iex.Get.ty == Ity_I64);
+      HReg rc = lookupCachedGuest(env, e->Iex.Get.offset);
+      if (!hregIsInvalid(rc))
+         return mk_iMOVsd_RR(rc, dst);
+      if (overlapsCachedGuest(env, e->Iex.Get.offset, 8))
+         return NULL;
       return AMD64Instr_Alu64R(
                 Aalu_MOV,
                 AMD64RMI_Mem(
@@ -697,7 +811,8 @@ void doHelperCall ( /*OUT*/UInt*   stackAdjustAfterCall,
 
 /* Given a guest-state array descriptor, an index expression and a
    bias, generate an AMD64AMode holding the relevant guest state
-   offset. */
+   offset.  Any cached guest registers in the array are written back
+   first. */
 
 static
 AMD64AMode* genGuestArrayOffset ( ISelEnv* env, IRRegArray* descr, 
@@ -714,6 +829,8 @@ AMD64AMode* genGuestArrayOffset ( ISelEnv* env, IRRegArray* descr,
    if (nElems != 8 || (elemSz != 1 && elemSz != 8))
       vpanic("genGuestArrayOffset(amd64 host)");
 
+   syncCachedGuest(env, True/*store*/, descr->base, nElems * elemSz);
+
    /* Compute off into a reg, %off.  Then return:
 
          movq %off, %tmp
@@ -740,6 +857,55 @@ AMD64AMode* genGuestArrayOffset ( ISelEnv* env, IRRegArray* descr,
 }
 
 
+/* Memory operands.  A little-endian load, or a GET which doesn't
+   touch a cached guest register, can be read by many instructions
+   straight from memory rather than first being loaded into a
+   register.  Loads only appear inside trees if they are used once,
+   so this never duplicates a memory access. */
+
+static Bool isMemOperand ( ISelEnv* env, IRExpr* e, IRType ty )
+{
+   switch (e->tag) {
+      case Iex_Load:
+         return toBool(e->Iex.Load.end == Iend_LE && e->Iex.Load.ty == ty);
+      case Iex_Get:
+         return toBool(e->Iex.Get.ty == ty
+                       && !overlapsCachedGuest(env, e->Iex.Get.offset,
+                                               sizeofIRType(ty)));
+      default:
+         return False;
+   }
+}
+
+static AMD64AMode* iselMemOperand ( ISelEnv* env, IRExpr* e )
+{
+   if (e->tag == Iex_Load)
+      return iselIntExpr_AMode(env, e->Iex.Load.addr);
+   vassert(e->tag == Iex_Get);
+   return AMD64AMode_IR(e->Iex.Get.offset, hregAMD64_RBP());
+}
+
+/* If e, the second operand of a scalar SSE op on the lowest szB
+   bytes, can be read straight from memory, return the part of it to
+   read, else NULL.  That is so for a memory operand of the scalar
+   type, such a value widened with 32UtoV128 or 64UtoV128, or a V128
+   GET (but not a V128 load, as reading less of it could miss a
+   fault). */
+static IRExpr* sseLoMemOperand ( ISelEnv* env, IRExpr* e, Int szB )
+{
+   IRType tyF = szB == 8 ? Ity_F64 : Ity_F32;
+   IRType tyI = szB == 8 ? Ity_I64 : Ity_I32;
+   vassert(szB == 4 || szB == 8);
+   if (e->tag == Iex_Unop
+       && e->Iex.Unop.op == (szB == 8 ? Iop_64UtoV128 : Iop_32UtoV128))
+      e = e->Iex.Unop.arg;
+   if (isMemOperand(env, e, tyF) || isMemOperand(env, e, tyI)
+       || (e->tag == Iex_Get && isMemOperand(env, e, Ity_V128)))
+      return e;
+   return NULL;
+}
+
+
 /* Set the SSE unit's rounding mode to default (%mxcsr = 0x1F80) */
 static
 void set_SSE_rounding_default ( ISelEnv* env )
@@ -999,9 +1165,34 @@ static HReg iselIntExpr_R_wrk ( ISelEnv* env, IRExpr* e )
       /* For commutative ops we assume any literal
          values are on the second operand. */
       if (aluOp != Aalu_INVALID) {
-         HReg dst      = newVRegI(env);
-         HReg reg      = iselIntExpr_R(env, e->Iex.Binop.arg1);
-         AMD64RMI* rmi = iselIntExpr_RMI(env, e->Iex.Binop.arg2);
+         HReg      dst  = newVRegI(env);
+         IRExpr*   argL = e->Iex.Binop.arg1;
+         IRExpr*   argR = e->Iex.Binop.arg2;
+         HReg      reg;
+         AMD64RMI* rmi;
+         /* Put a memory operand second if we can, so it can be
+            folded into the op. */
+         if (aluOp != Aalu_SUB
+             && (ty == Ity_I64 || (ty == Ity_I32 && aluOp != Aalu_MUL))
+             && isMemOperand(env, argL, ty)
+             && !isMemOperand(env, argR, ty)
+             && argR->tag != Iex_Const) {
+            argL = e->Iex.Binop.arg2;
+            argR = e->Iex.Binop.arg1;
+         }
+         reg = iselIntExpr_R(env, argL);
+         /* iselIntExpr_RMI only folds 64-bit memory operands, since
+            it can't know that the consumer reads only 32 bits.  Here
+            we do, so use the 32-bit form of the op; it leaves the
+            upper half zero, which is as good as the usual junk. */
+         if (ty == Ity_I32 && aluOp != Aalu_MUL
+             && isMemOperand(env, argR, Ity_I32)) {
+            AMD64AMode* am = iselMemOperand(env, argR);
+            addInstr(env, mk_iMOVsd_RR(reg,dst));
+            addInstr(env, AMD64Instr_Alu32R(aluOp, AMD64RMI_Mem(am), dst));
+            return dst;
+         }
+         rmi = iselIntExpr_RMI(env, argR);
          addInstr(env, mk_iMOVsd_RR(reg,dst));
          addInstr(env, AMD64Instr_Alu64R(aluOp, rmi, dst));
          return dst;
@@ -1369,6 +1560,27 @@ static HReg iselIntExpr_R_wrk ( ISelEnv* env, IRExpr* e )
          return dst;
       }
 
+      if ((e->Iex.Binop.op == Iop_CRC32C8
+           || e->Iex.Binop.op == Iop_CRC32C16
+           || e->Iex.Binop.op == Iop_CRC32C32
+           || e->Iex.Binop.op == Iop_CRC32C64)
+          && (env->hwcaps & VEX_HWCAPS_AMD64_SSE42)) {
+         HReg     dst = newVRegI(env);
+         HReg     crc = iselIntExpr_R(env, e->Iex.Binop.arg1);
+         AMD64RM* src = iselIntExpr_RM(env, e->Iex.Binop.arg2);
+         Int      szB = 0;
+         switch (e->Iex.Binop.op) {
+            case Iop_CRC32C8:  szB = 1; break;
+            case Iop_CRC32C16: szB = 2; break;
+            case Iop_CRC32C32: szB = 4; break;
+            case Iop_CRC32C64: szB = 8; break;
+            default: vassert(0);
+         }
+         addInstr(env, mk_iMOVsd_RR(crc, dst));
+         addInstr(env, AMD64Instr_CRC32C(szB, src, dst));
+         return dst;
+      }
+
       break;
    }
 
@@ -1777,6 +1989,12 @@ static HReg iselIntExpr_R_wrk ( ISelEnv* env, IRExpr* e )
    case Iex_Get: {
       if (ty == Ity_I64) {
          HReg dst = newVRegI(env);
+         HReg rc  = lookupCachedGuest(env, e->Iex.Get.offset);
+         if (!hregIsInvalid(rc)) {
+            addInstr(env, mk_iMOVsd_RR(rc, dst));
+            return dst;
+         }
+         syncCachedGuest(env, True/*store*/, e->Iex.Get.offset, 8);
          addInstr(env, AMD64Instr_Alu64R(
                           Aalu_MOV, 
                           AMD64RMI_Mem(
@@ -1787,6 +2005,8 @@ static HReg iselIntExpr_R_wrk ( ISelEnv* env, IRExpr* e )
       }
       if (ty == Ity_I8 || ty == Ity_I16 || ty == Ity_I32) {
          HReg dst = newVRegI(env);
+         syncCachedGuest(env, True/*store*/, e->Iex.Get.offset,
+                         sizeofIRType(ty));
          addInstr(env, AMD64Instr_LoadEX(
                           toUChar(ty==Ity_I8 ? 1 : (ty==Ity_I16 ? 2 : 4)),
                           False,
@@ -2070,7 +2290,8 @@ static AMD64RMI* iselIntExpr_RMI_wrk ( ISelEnv* env, IRExpr* e )
    }
 
    /* special case: 64-bit GET */
-   if (e->tag == Iex_Get && ty == Ity_I64) {
+   if (e->tag == Iex_Get && ty == Ity_I64
+       && !overlapsCachedGuest(env, e->Iex.Get.offset, 8)) {
       return AMD64RMI_Mem(AMD64AMode_IR(e->Iex.Get.offset,
                                         hregAMD64_RBP()));
    }
@@ -2176,7 +2397,8 @@ static AMD64RM* iselIntExpr_RM_wrk ( ISelEnv* env, IRExpr* e )
    vassert(ty == Ity_I64 || ty == Ity_I32 || ty == Ity_I16 || ty == Ity_I8);
 
    /* special case: 64-bit GET */
-   if (e->tag == Iex_Get && ty == Ity_I64) {
+   if (e->tag == Iex_Get && ty == Ity_I64
+       && !overlapsCachedGuest(env, e->Iex.Get.offset, 8)) {
       return AMD64RM_Mem(AMD64AMode_IR(e->Iex.Get.offset,
                                        hregAMD64_RBP()));
    }
@@ -2429,7 +2651,10 @@ static AMD64CondCode iselCondCode_wrk ( ISelEnv* env, IRExpr* e )
            || e->Iex.Binop.op == Iop_CasCmpNE32
            || e->Iex.Binop.op == Iop_ExpCmpNE32)) {
       HReg      r1   = iselIntExpr_R(env, e->Iex.Binop.arg1);
-      AMD64RMI* rmi2 = iselIntExpr_RMI(env, e->Iex.Binop.arg2);
+      AMD64RMI* rmi2 = isMemOperand(env, e->Iex.Binop.arg2, Ity_I32)
+                          ? AMD64RMI_Mem(iselMemOperand(env,
+                                                        e->Iex.Binop.arg2))
+                          : iselIntExpr_RMI(env, e->Iex.Binop.arg2);
       addInstr(env, AMD64Instr_Alu32R(Aalu_CMP,rmi2,r1));
       switch (e->Iex.Binop.op) {
          case Iop_CmpEQ32: case Iop_CasCmpEQ32: return Acc_Z;
@@ -2598,6 +2823,7 @@ static HReg iselFltExpr_wrk ( ISelEnv* env, IRExpr* e )
       AMD64AMode* am = AMD64AMode_IR( e->Iex.Get.offset,
                                        hregAMD64_RBP() );
       HReg res = newVRegV(env);
+      syncCachedGuest(env, True/*store*/, e->Iex.Get.offset, 4);
       addInstr(env, AMD64Instr_SseLdSt( True/*load*/, 4, res, am ));
       return res;
    }
@@ -2657,6 +2883,24 @@ static HReg iselFltExpr_wrk ( ISelEnv* env, IRExpr* e )
       return dst;
    }
 
+   if (e->tag == Iex_Qop
+       && (e->Iex.Qop.details->op == Iop_MAddF32
+           || e->Iex.Qop.details->op == Iop_MSubF32)
+       && (env->hwcaps & VEX_HWCAPS_AMD64_FMA3)) {
+      IRQop *qop = e->Iex.Qop.details;
+      HReg dst  = newVRegV(env);
+      HReg argX = iselFltExpr(env, qop->arg2);
+      HReg argY = iselFltExpr(env, qop->arg3);
+      HReg argZ = iselFltExpr(env, qop->arg4);
+      /* XXXROUNDINGFIXME */
+      /* set roundingmode here */
+      /* dst = argX; vfm{add,sub}213ss %argZ, %argY, %dst */
+      addInstr(env, mk_vMOVsd_RR(argX, dst));
+      addInstr(env, AMD64Instr_SseFMA(4, qop->op == Iop_MSubF32,
+                                      argY, argZ, dst));
+      return dst;
+   }
+
    if (e->tag == Iex_Qop && e->Iex.Qop.details->op == Iop_MAddF32) {
       IRQop *qop = e->Iex.Qop.details;
       HReg dst  = newVRegV(env);
@@ -2800,6 +3044,7 @@ static HReg iselDblExpr_wrk ( ISelEnv* env, IRExpr* e )
       AMD64AMode* am = AMD64AMode_IR( e->Iex.Get.offset,
                                       hregAMD64_RBP() );
       HReg res = newVRegV(env);
+      syncCachedGuest(env, True/*store*/, e->Iex.Get.offset, 8);
       addInstr(env, AMD64Instr_SseLdSt( True/*load*/, 8, res, am ));
       return res;
    }
@@ -2827,15 +3072,38 @@ static HReg iselDblExpr_wrk ( ISelEnv* env, IRExpr* e )
       if (op != Asse_INVALID) {
          HReg dst  = newVRegV(env);
          HReg argL = iselDblExpr(env, triop->arg2);
-         HReg argR = iselDblExpr(env, triop->arg3);
          addInstr(env, mk_vMOVsd_RR(argL, dst));
          /* XXXROUNDINGFIXME */
          /* set roundingmode here */
-         addInstr(env, AMD64Instr_Sse64FLo(op, argR, dst));
+         if (isMemOperand(env, triop->arg3, Ity_F64)) {
+            AMD64AMode* am = iselMemOperand(env, triop->arg3);
+            addInstr(env, AMD64Instr_Sse64FLoM(op, am, dst));
+         } else {
+            HReg argR = iselDblExpr(env, triop->arg3);
+            addInstr(env, AMD64Instr_Sse64FLo(op, argR, dst));
+         }
          return dst;
       }
    }
 
+   if (e->tag == Iex_Qop
+       && (e->Iex.Qop.details->op == Iop_MAddF64
+           || e->Iex.Qop.details->op == Iop_MSubF64)
+       && (env->hwcaps & VEX_HWCAPS_AMD64_FMA3)) {
+      IRQop *qop = e->Iex.Qop.details;
+      HReg dst  = newVRegV(env);
+      HReg argX = iselDblExpr(env, qop->arg2);
+      HReg argY = iselDblExpr(env, qop->arg3);
+      HReg argZ = iselDblExpr(env, qop->arg4);
+      /* XXXROUNDINGFIXME */
+      /* set roundingmode here */
+      /* dst = argX; vfm{add,sub}213sd %argZ, %argY, %dst */
+      addInstr(env, mk_vMOVsd_RR(argX, dst));
+      addInstr(env, AMD64Instr_SseFMA(8, qop->op == Iop_MSubF64,
+                                      argY, argZ, dst));
+      return dst;
+   }
+
    if (e->tag == Iex_Qop && e->Iex.Qop.details->op == Iop_MAddF64) {
       IRQop *qop = e->Iex.Qop.details;
       HReg dst  = newVRegV(env);
@@ -3132,6 +3400,7 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
 
    if (e->tag == Iex_Get) {
       HReg dst = newVRegV(env);
+      syncCachedGuest(env, True/*store*/, e->Iex.Get.offset, 16);
       addInstr(env, AMD64Instr_SseLdSt(
                        True/*load*/, 
                        16,
@@ -3184,6 +3453,19 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
          return do_sse_NotV128(env, arg);
       }
 
+      case Iop_AESIMC128: {
+         /* aesimc only reads its source, but is done in place so that
+            SseReRg's modify-dst register usage stays correct. */
+         HReg arg, dst;
+         if (!(env->hwcaps & VEX_HWCAPS_AMD64_AES))
+            break;
+         arg = iselVecExpr(env, e->Iex.Unop.arg);
+         dst = newVRegV(env);
+         addInstr(env, mk_vMOVsd_RR(arg, dst));
+         addInstr(env, AMD64Instr_SseReRg(Asse_AESIMC, dst, dst));
+         return dst;
+      }
+
       case Iop_CmpNEZ64x2: {
          /* We can use SSE2 instructions for this. */
          /* Ideally, we want to do a 64Ix2 comparison against zero of
@@ -3301,6 +3583,14 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
       case Iop_V256toV128_0:
       case Iop_V256toV128_1: {
          HReg vHi, vLo;
+         if (nativeV256(env)) {
+            HReg src = iselV256Expr(env, e->Iex.Unop.arg);
+            HReg dst = newVRegV(env);
+            addInstr(env, AMD64Instr_AvxExtract(
+                             toBool(e->Iex.Unop.op == Iop_V256toV128_1),
+                             src, dst));
+            return dst;
+         }
          iselDVecExpr(&vHi, &vLo, env, e->Iex.Unop.arg);
          return (e->Iex.Unop.op == Iop_V256toV128_1) ? vHi : vLo;
       }
@@ -3394,11 +3684,17 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
       case Iop_Mul32F0x4:   op = Asse_MULF;   goto do_32F0x4;
       case Iop_Sub32F0x4:   op = Asse_SUBF;   goto do_32F0x4;
       do_32F0x4: {
-         HReg argL = iselVecExpr(env, e->Iex.Binop.arg1);
-         HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
-         HReg dst = newVRegV(env);
+         HReg    argL = iselVecExpr(env, e->Iex.Binop.arg1);
+         IRExpr* argM = sseLoMemOperand(env, e->Iex.Binop.arg2, 4);
+         HReg    dst  = newVRegV(env);
          addInstr(env, mk_vMOVsd_RR(argL, dst));
-         addInstr(env, AMD64Instr_Sse32FLo(op, argR, dst));
+         if (argM) {
+            AMD64AMode* am = iselMemOperand(env, argM);
+            addInstr(env, AMD64Instr_Sse32FLoM(op, am, dst));
+         } else {
+            HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
+            addInstr(env, AMD64Instr_Sse32FLo(op, argR, dst));
+         }
          return dst;
       }
 
@@ -3413,11 +3709,17 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
       case Iop_Mul64F0x2:   op = Asse_MULF;   goto do_64F0x2;
       case Iop_Sub64F0x2:   op = Asse_SUBF;   goto do_64F0x2;
       do_64F0x2: {
-         HReg argL = iselVecExpr(env, e->Iex.Binop.arg1);
-         HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
-         HReg dst = newVRegV(env);
+         HReg    argL = iselVecExpr(env, e->Iex.Binop.arg1);
+         IRExpr* argM = sseLoMemOperand(env, e->Iex.Binop.arg2, 8);
+         HReg    dst  = newVRegV(env);
          addInstr(env, mk_vMOVsd_RR(argL, dst));
-         addInstr(env, AMD64Instr_Sse64FLo(op, argR, dst));
+         if (argM) {
+            AMD64AMode* am = iselMemOperand(env, argM);
+            addInstr(env, AMD64Instr_Sse64FLoM(op, am, dst));
+         } else {
+            HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
+            addInstr(env, AMD64Instr_Sse64FLo(op, argR, dst));
+         }
          return dst;
       }
 
@@ -3480,6 +3782,17 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
       case Iop_QSub16Sx8:  op = Asse_QSUB16S;  goto do_SseReRg;
       case Iop_QSub8Ux16:  op = Asse_QSUB8U;   goto do_SseReRg;
       case Iop_QSub16Ux8:  op = Asse_QSUB16U;  goto do_SseReRg;
+
+      /* The AES rounds are dst := op(state=arg1, roundkey=arg2). */
+      case Iop_AESEnc128:     op = Asse_AESENC;     goto do_AES;
+      case Iop_AESEncLast128: op = Asse_AESENCLAST; goto do_AES;
+      case Iop_AESDec128:     op = Asse_AESDEC;     goto do_AES;
+      case Iop_AESDecLast128: op = Asse_AESDECLAST; goto do_AES;
+      do_AES:
+         if (!(env->hwcaps & VEX_HWCAPS_AMD64_AES))
+            break;
+         goto do_SseReRg;
+
       do_SseReRg: {
          HReg arg1 = iselVecExpr(env, e->Iex.Binop.arg1);
          HReg arg2 = iselVecExpr(env, e->Iex.Binop.arg2);
@@ -3494,6 +3807,42 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
          return dst;
       }
 
+      case Iop_PolynomialMull64: {
+         /* pclmulqdq picks either 64-bit half of each operand, so a
+            high half fed in via InterleaveHI64x2(t,t) is taken
+            straight from t. */
+         IRExpr* argL = e->Iex.Binop.arg1;
+         IRExpr* argR = e->Iex.Binop.arg2;
+         Int     imm  = 0;
+         HReg    srcL, srcR, dst;
+         if (!(env->hwcaps & VEX_HWCAPS_AMD64_PCLMUL))
+            break;
+         if (argL->tag == Iex_Binop
+             && argL->Iex.Binop.op == Iop_InterleaveHI64x2
+             && argL->Iex.Binop.arg1->tag == Iex_RdTmp
+             && argL->Iex.Binop.arg2->tag == Iex_RdTmp
+             && argL->Iex.Binop.arg1->Iex.RdTmp.tmp
+                == argL->Iex.Binop.arg2->Iex.RdTmp.tmp) {
+            argL = argL->Iex.Binop.arg1;
+            imm |= 0x01;
+         }
+         if (argR->tag == Iex_Binop
+             && argR->Iex.Binop.op == Iop_InterleaveHI64x2
+             && argR->Iex.Binop.arg1->tag == Iex_RdTmp
+             && argR->Iex.Binop.arg2->tag == Iex_RdTmp
+             && argR->Iex.Binop.arg1->Iex.RdTmp.tmp
+                == argR->Iex.Binop.arg2->Iex.RdTmp.tmp) {
+            argR = argR->Iex.Binop.arg1;
+            imm |= 0x10;
+         }
+         srcL = iselVecExpr(env, argL);
+         srcR = iselVecExpr(env, argR);
+         dst  = newVRegV(env);
+         addInstr(env, mk_vMOVsd_RR(srcL, dst));
+         addInstr(env, AMD64Instr_SseCLMul(imm, srcR, dst));
+         return dst;
+      }
+
       case Iop_ShlN16x8: op = Asse_SHL16; goto do_SseShift;
       case Iop_ShlN32x4: op = Asse_SHL32; goto do_SseShift;
       case Iop_ShlN64x2: op = Asse_SHL64; goto do_SseShift;
@@ -3742,6 +4091,17 @@ static void iselDVecExpr_wrk ( /*OUT*/HReg* rHi, /*OUT*/HReg* rLo,
 
    /* read 256-bit IRTemp */
    if (e->tag == Iex_RdTmp) {
+      if (nativeV256(env)) {
+         /* It lives in a single 256-bit register; split it. */
+         HReg src = lookupIRTemp(env, e->Iex.RdTmp.tmp);
+         HReg vHi = newVRegV(env);
+         HReg vLo = newVRegV(env);
+         addInstr(env, AMD64Instr_AvxExtract(True/*hi*/,  src, vHi));
+         addInstr(env, AMD64Instr_AvxExtract(False/*lo*/, src, vLo));
+         *rHi = vHi;
+         *rLo = vLo;
+         return;
+      }
       lookupIRTempPair( rHi, rLo, env, e->Iex.RdTmp.tmp);
       return;
    }
@@ -3752,6 +4112,7 @@ static void iselDVecExpr_wrk ( /*OUT*/HReg* rHi, /*OUT*/HReg* rLo,
       HReg        rbp  = hregAMD64_RBP();
       AMD64AMode* am0  = AMD64AMode_IR(e->Iex.Get.offset + 0,  rbp);
       AMD64AMode* am16 = AMD64AMode_IR(e->Iex.Get.offset + 16, rbp);
+      syncCachedGuest(env, True/*store*/, e->Iex.Get.offset, 32);
       addInstr(env, AMD64Instr_SseLdSt(True/*load*/, 16, vLo, am0));
       addInstr(env, AMD64Instr_SseLdSt(True/*load*/, 16, vHi, am16));
       *rHi = vHi;
@@ -4273,18 +4634,311 @@ static void iselDVecExpr_wrk ( /*OUT*/HReg* rHi, /*OUT*/HReg* rLo,
 }
 
 
+/*---------------------------------------------------------*/
+/*--- ISEL: SIMD (V256) expressions, into 1 YMM reg.     --*/
+/*---------------------------------------------------------*/
+
+/* Only used when the host has AVX.  The commonly occurring
+   operations are done at full width; anything else is computed as a
+   pair by iselDVecExpr and then joined. */
+
+static HReg iselV256Expr ( ISelEnv* env, IRExpr* e )
+{
+   HReg r = iselV256Expr_wrk( env, e );
+#  if 0
+   vex_printf("\n"); ppIRExpr(e); vex_printf("\n");
+#  endif
+   vassert(hregClass(r) == HRcVec256);
+   vassert(hregIsVirtual(r));
+   return r;
+}
+
+
+/* DO NOT CALL THIS DIRECTLY */
+static HReg iselV256Expr_wrk ( ISelEnv* env, IRExpr* e )
+{
+   vassert(e);
+   vassert(nativeV256(env));
+   IRType ty = typeOfIRExpr(env->type_env,e);
+   vassert(ty == Ity_V256);
+
+   Bool       avx2 = toBool(env->hwcaps & VEX_HWCAPS_AMD64_AVX2);
+   AMD64SseOp op   = Asse_INVALID;
+
+   if (e->tag == Iex_RdTmp) {
+      return lookupIRTemp(env, e->Iex.RdTmp.tmp);
+   }
+
+   if (e->tag == Iex_Get) {
+      HReg        dst = newVRegDV(env);
+      AMD64AMode* am  = AMD64AMode_IR(e->Iex.Get.offset, hregAMD64_RBP());
+      syncCachedGuest(env, True/*store*/, e->Iex.Get.offset, 32);
+      addInstr(env, AMD64Instr_AvxLdSt(True/*load*/, dst, am));
+      return dst;
+   }
+
+   if (e->tag == Iex_Load) {
+      HReg        dst = newVRegDV(env);
+      AMD64AMode* am  = iselIntExpr_AMode(env, e->Iex.Load.addr);
+      addInstr(env, AMD64Instr_AvxLdSt(True/*load*/, dst, am));
+      return dst;
+   }
+
+   if (e->tag == Iex_Const) {
+      vassert(e->Iex.Const.con->tag == Ico_V256);
+      if (e->Iex.Const.con->Ico.V256 == 0x00000000) {
+         HReg dst = newVRegDV(env);
+         addInstr(env, AMD64Instr_AvxReRg(Asse_XOR, dst, dst, dst));
+         return dst;
+      }
+      /* else fall through to the pair version */
+   }
+
+   if (e->tag == Iex_Unop) {
+   switch (e->Iex.Unop.op) {
+
+      case Iop_NotV256: {
+         if (!avx2) break;
+         HReg arg  = iselV256Expr(env, e->Iex.Unop.arg);
+         HReg ones = newVRegDV(env);
+         HReg dst  = newVRegDV(env);
+         addInstr(env, AMD64Instr_AvxReRg(Asse_CMPEQ32, ones, ones, ones));
+         addInstr(env, AMD64Instr_AvxReRg(Asse_XOR, ones, arg, dst));
+         return dst;
+      }
+
+      case Iop_Recip32Fx8: op = Asse_RCPF;   goto do_32Fx8_unary;
+      case Iop_Sqrt32Fx8:  op = Asse_SQRTF;  goto do_32Fx8_unary;
+      case Iop_RSqrt32Fx8: op = Asse_RSQRTF; goto do_32Fx8_unary;
+      do_32Fx8_unary:
+      {
+         HReg arg = iselV256Expr(env, e->Iex.Unop.arg);
+         HReg dst = newVRegDV(env);
+         addInstr(env, AMD64Instr_Avx32Fx8(op, arg, arg, dst));
+         return dst;
+      }
+
+      case Iop_Sqrt64Fx4:  op = Asse_SQRTF;  goto do_64Fx4_unary;
+      do_64Fx4_unary:
+      {
+         HReg arg = iselV256Expr(env, e->Iex.Unop.arg);
+         HReg dst = newVRegDV(env);
+         addInstr(env, AMD64Instr_Avx64Fx4(op, arg, arg, dst));
+         return dst;
+      }
+
+      default:
+         break;
+   } /* switch (e->Iex.Unop.op) */
+   } /* if (e->tag == Iex_Unop) */
+
+   if (e->tag == Iex_Binop) {
+   switch (e->Iex.Binop.op) {
+
+      case Iop_Max64Fx4:   op = Asse_MAXF;   goto do_64Fx4;
+      case Iop_Min64Fx4:   op = Asse_MINF;   goto do_64Fx4;
+      do_64Fx4:
+      {
+         HReg argL = iselV256Expr(env, e->Iex.Binop.arg1);
+         HReg argR = iselV256Expr(env, e->Iex.Binop.arg2);
+         HReg dst  = newVRegDV(env);
+         addInstr(env, AMD64Instr_Avx64Fx4(op, argL, argR, dst));
+         return dst;
+      }
+
+      case Iop_Max32Fx8:   op = Asse_MAXF;   goto do_32Fx8;
+      case Iop_Min32Fx8:   op = Asse_MINF;   goto do_32Fx8;
+      do_32Fx8:
+      {
+         HReg argL = iselV256Expr(env, e->Iex.Binop.arg1);
+         HReg argR = iselV256Expr(env, e->Iex.Binop.arg2);
+         HReg dst  = newVRegDV(env);
+         addInstr(env, AMD64Instr_Avx32Fx8(op, argL, argR, dst));
+         return dst;
+      }
+
+      case Iop_AndV256:    op = Asse_AND;      goto do_AvxReRg;
+      case Iop_OrV256:     op = Asse_OR;       goto do_AvxReRg;
+      case Iop_XorV256:    op = Asse_XOR;      goto do_AvxReRg;
+      do_AvxReRg:
+      {
+         HReg argL = iselV256Expr(env, e->Iex.Binop.arg1);
+         HReg argR = iselV256Expr(env, e->Iex.Binop.arg2);
+         HReg dst  = newVRegDV(env);
+         addInstr(env, AMD64Instr_AvxReRg(op, argL, argR, dst));
+         return dst;
+      }
+
+      case Iop_Add8x32:    op = Asse_ADD8;     goto do_Avx2ReRg;
+      case Iop_Add16x16:   op = Asse_ADD16;    goto do_Avx2ReRg;
+      case Iop_Add32x8:    op = Asse_ADD32;    goto do_Avx2ReRg;
+      case Iop_Add64x4:    op = Asse_ADD64;    goto do_Avx2ReRg;
+      case Iop_QAdd8Sx32:  op = Asse_QADD8S;   goto do_Avx2ReRg;
+      case Iop_QAdd16Sx16: op = Asse_QADD16S;  goto do_Avx2ReRg;
+      case Iop_QAdd8Ux32:  op = Asse_QADD8U;   goto do_Avx2ReRg;
+      case Iop_QAdd16Ux16: op = Asse_QADD16U;  goto do_Avx2ReRg;
+      case Iop_Avg8Ux32:   op = Asse_AVG8U;    goto do_Avx2ReRg;
+      case Iop_Avg16Ux16:  op = Asse_AVG16U;   goto do_Avx2ReRg;
+      case Iop_CmpEQ8x32:  op = Asse_CMPEQ8;   goto do_Avx2ReRg;
+      case Iop_CmpEQ16x16: op = Asse_CMPEQ16;  goto do_Avx2ReRg;
+      case Iop_CmpEQ32x8:  op = Asse_CMPEQ32;  goto do_Avx2ReRg;
+      case Iop_CmpGT8Sx32: op = Asse_CMPGT8S;  goto do_Avx2ReRg;
+      case Iop_CmpGT16Sx16: op = Asse_CMPGT16S; goto do_Avx2ReRg;
+      case Iop_CmpGT32Sx8: op = Asse_CMPGT32S; goto do_Avx2ReRg;
+      case Iop_Max16Sx16:  op = Asse_MAX16S;   goto do_Avx2ReRg;
+      case Iop_Max8Ux32:   op = Asse_MAX8U;    goto do_Avx2ReRg;
+      case Iop_Min16Sx16:  op = Asse_MIN16S;   goto do_Avx2ReRg;
+      case Iop_Min8Ux32:   op = Asse_MIN8U;    goto do_Avx2ReRg;
+      case Iop_MulHi16Ux16: op = Asse_MULHI16U; goto do_Avx2ReRg;
+      case Iop_MulHi16Sx16: op = Asse_MULHI16S; goto do_Avx2ReRg;
+      case Iop_Mul16x16:   op = Asse_MUL16;    goto do_Avx2ReRg;
+      case Iop_Sub8x32:    op = Asse_SUB8;     goto do_Avx2ReRg;
+      case Iop_Sub16x16:   op = Asse_SUB16;    goto do_Avx2ReRg;
+      case Iop_Sub32x8:    op = Asse_SUB32;    goto do_Avx2ReRg;
+      case Iop_Sub64x4:    op = Asse_SUB64;    goto do_Avx2ReRg;
+      case Iop_QSub8Sx32:  op = Asse_QSUB8S;   goto do_Avx2ReRg;
+      case Iop_QSub16Sx16: op = Asse_QSUB16S;  goto do_Avx2ReRg;
+      case Iop_QSub8Ux32:  op = Asse_QSUB8U;   goto do_Avx2ReRg;
+      case Iop_QSub16Ux16: op = Asse_QSUB16U;  goto do_Avx2ReRg;
+      do_Avx2ReRg:
+      {
+         if (!avx2) break;
+         HReg argL = iselV256Expr(env, e->Iex.Binop.arg1);
+         HReg argR = iselV256Expr(env, e->Iex.Binop.arg2);
+         HReg dst  = newVRegDV(env);
+         addInstr(env, AMD64Instr_AvxReRg(op, argL, argR, dst));
+         return dst;
+      }
+
+      case Iop_V128HLtoV256: {
+         HReg vHi = iselVecExpr(env, e->Iex.Binop.arg1);
+         HReg vLo = iselVecExpr(env, e->Iex.Binop.arg2);
+         HReg dst = newVRegDV(env);
+         addInstr(env, AMD64Instr_AvxInsHi(vHi, vLo, dst));
+         return dst;
+      }
+
+      default:
+         break;
+   } /* switch (e->Iex.Binop.op) */
+   } /* if (e->tag == Iex_Binop) */
+
+   if (e->tag == Iex_Triop) {
+   IRTriop *triop = e->Iex.Triop.details;
+   switch (triop->op) {
+
+      case Iop_Add64Fx4: op = Asse_ADDF; goto do_64Fx4_w_rm;
+      case Iop_Sub64Fx4: op = Asse_SUBF; goto do_64Fx4_w_rm;
+      case Iop_Mul64Fx4: op = Asse_MULF; goto do_64Fx4_w_rm;
+      case Iop_Div64Fx4: op = Asse_DIVF; goto do_64Fx4_w_rm;
+      do_64Fx4_w_rm:
+      {
+         HReg argL = iselV256Expr(env, triop->arg2);
+         HReg argR = iselV256Expr(env, triop->arg3);
+         HReg dst  = newVRegDV(env);
+         /* XXXROUNDINGFIXME */
+         /* set roundingmode here */
+         addInstr(env, AMD64Instr_Avx64Fx4(op, argL, argR, dst));
+         return dst;
+      }
+
+      case Iop_Add32Fx8: op = Asse_ADDF; goto do_32Fx8_w_rm;
+      case Iop_Sub32Fx8: op = Asse_SUBF; goto do_32Fx8_w_rm;
+      case Iop_Mul32Fx8: op = Asse_MULF; goto do_32Fx8_w_rm;
+      case Iop_Div32Fx8: op = Asse_DIVF; goto do_32Fx8_w_rm;
+      do_32Fx8_w_rm:
+      {
+         HReg argL = iselV256Expr(env, triop->arg2);
+         HReg argR = iselV256Expr(env, triop->arg3);
+         HReg dst  = newVRegDV(env);
+         /* XXXROUNDINGFIXME */
+         /* set roundingmode here */
+         addInstr(env, AMD64Instr_Avx32Fx8(op, argL, argR, dst));
+         return dst;
+      }
+
+      default:
+         break;
+   } /* switch (triop->op) */
+   } /* if (e->tag == Iex_Triop) */
+
+   /* Not something we do at full width.  Compute it as two halves
+      and join them. */
+   {
+      HReg vHi, vLo;
+      iselDVecExpr(&vHi, &vLo, env, e);
+      HReg dst = newVRegDV(env);
+      addInstr(env, AMD64Instr_AvxInsHi(vHi, vLo, dst));
+      return dst;
+   }
+}
+
+
 /*---------------------------------------------------------*/
 /*--- ISEL: Statements                                  ---*/
 /*---------------------------------------------------------*/
 
+static void iselStmt_wrk ( ISelEnv* env, IRStmt* stmt );
+
+/* Statements which write the guest state other than by an exact
+   PUT of a cached guest register are done via the guest state, with
+   the affected cached registers written back before and reloaded
+   after.  For PUTI, genGuestArrayOffset does the writing back. */
 static void iselStmt ( ISelEnv* env, IRStmt* stmt )
 {
+   Int offset = 0, szB = 0, i;
+
    if (vex_traceflags & VEX_TRACE_VCODE) {
       vex_printf("\n-- ");
       ppIRStmt(stmt);
       vex_printf("\n");
    }
 
+   if (LIKELY(!env->anyCached)) {
+      iselStmt_wrk(env, stmt);
+      return;
+   }
+
+   switch (stmt->tag) {
+      case Ist_Put: {
+         IRType ty = typeOfIRExpr(env->type_env, stmt->Ist.Put.data);
+         offset = stmt->Ist.Put.offset;
+         szB    = sizeofIRType(ty);
+         if (ty == Ity_I64 && !hregIsInvalid(lookupCachedGuest(env, offset)))
+            szB = 0;
+         break;
+      }
+      case Ist_PutI: {
+         IRRegArray* descr = stmt->Ist.PutI.details->descr;
+         offset = descr->base;
+         szB    = descr->nElems * sizeofIRType(descr->elemTy);
+         break;
+      }
+      case Ist_Dirty: {
+         /* The helper can see the guest state only if it is handed
+            the guest state pointer. */
+         IRDirty* d = stmt->Ist.Dirty.details;
+         for (i = 0; d->args[i]; i++)
+            if (d->args[i]->tag == Iex_BBPTR)
+               szB = ALL_GUEST_STATE;
+         break;
+      }
+      default:
+         break;
+   }
+
+   if (szB == 0 || !overlapsCachedGuest(env, offset, szB)) {
+      iselStmt_wrk(env, stmt);
+      return;
+   }
+   if (stmt->tag != Ist_PutI)
+      syncCachedGuest(env, True/*store*/, offset, szB);
+   iselStmt_wrk(env, stmt);
+   syncCachedGuest(env, False/*reload*/, offset, szB);
+}
+
+static void iselStmt_wrk ( ISelEnv* env, IRStmt* stmt )
+{
    switch (stmt->tag) {
 
    /* --------- STORE --------- */
@@ -4328,6 +4982,12 @@ static void iselStmt ( ISelEnv* env, IRStmt* stmt )
          addInstr(env, AMD64Instr_SseLdSt(False/*store*/, 16, r, am));
          return;
       }
+      if (tyd == Ity_V256 && nativeV256(env)) {
+         AMD64AMode* am = iselIntExpr_AMode(env, stmt->Ist.Store.addr);
+         HReg        r  = iselV256Expr(env, stmt->Ist.Store.data);
+         addInstr(env, AMD64Instr_AvxLdSt(False/*store*/, r, am));
+         return;
+      }
       if (tyd == Ity_V256) {
          HReg        rA   = iselIntExpr_R(env, stmt->Ist.Store.addr);
          AMD64AMode* am0  = AMD64AMode_IR(0,  rA);
@@ -4344,6 +5004,15 @@ static void iselStmt ( ISelEnv* env, IRStmt* stmt )
    /* --------- PUT --------- */
    case Ist_Put: {
       IRType ty = typeOfIRExpr(env->type_env, stmt->Ist.Put.data);
+      if (ty == Ity_I64
+          && !hregIsInvalid(lookupCachedGuest(env, stmt->Ist.Put.offset))) {
+         HReg rc = lookupCachedGuest(env, stmt->Ist.Put.offset);
+         addInstr(env, AMD64Instr_Alu64R(
+                          Aalu_MOV,
+                          iselIntExpr_RMI(env, stmt->Ist.Put.data),
+                          rc));
+         return;
+      }
       if (ty == Ity_I64) {
          /* We're going to write to memory, so compute the RHS into an
             AMD64RI. */
@@ -4387,6 +5056,13 @@ static void iselStmt ( ISelEnv* env, IRStmt* stmt )
          addInstr(env, AMD64Instr_SseLdSt(False/*store*/, 16, vec, am));
          return;
       }
+      if (ty == Ity_V256 && nativeV256(env)) {
+         HReg        vec = iselV256Expr(env, stmt->Ist.Put.data);
+         AMD64AMode* am  = AMD64AMode_IR(stmt->Ist.Put.offset, 
+                                         hregAMD64_RBP());
+         addInstr(env, AMD64Instr_AvxLdSt(False/*store*/, vec, am));
+         return;
+      }
       if (ty == Ity_V256) {
          HReg vHi, vLo;
          iselDVecExpr(&vHi, &vLo, env, stmt->Ist.Put.data);
@@ -4495,6 +5171,12 @@ static void iselStmt ( ISelEnv* env, IRStmt* stmt )
          addInstr(env, mk_vMOVsd_RR(src, dst));
          return;
       }
+      if (ty == Ity_V256 && nativeV256(env)) {
+         HReg dst = lookupIRTemp(env, tmp);
+         HReg src = iselV256Expr(env, stmt->Ist.WrTmp.data);
+         addInstr(env, AMD64Instr_AvxReRg(Asse_MOV, src, src, dst));
+         return;
+      }
       if (ty == Ity_V256) {
          HReg rHi, rLo, dstHi, dstLo;
          iselDVecExpr(&rHi,&rLo, env, stmt->Ist.WrTmp.data);
@@ -4571,6 +5253,13 @@ static void iselStmt ( ISelEnv* env, IRStmt* stmt )
             /* See comments for Ity_V128. */
             vassert(rloc.pri == RLPri_V256SpRel);
             vassert(addToSp >= 32);
+            if (nativeV256(env)) {
+               HReg        dst = lookupIRTemp(env, d->tmp);
+               AMD64AMode* am  = AMD64AMode_IR(rloc.spOff, hregAMD64_RSP());
+               addInstr(env, AMD64Instr_AvxLdSt( True/*load*/, dst, am ));
+               add_to_rsp(env, addToSp);
+               return;
+            }
             HReg        dstLo, dstHi;
             lookupIRTempPair(&dstHi, &dstLo, env, d->tmp);
             AMD64AMode* amLo  = AMD64AMode_IR(rloc.spOff, hregAMD64_RSP());
@@ -4676,6 +5365,7 @@ static void iselStmt ( ISelEnv* env, IRStmt* stmt )
    /* --------- INSTR MARK --------- */
    /* Doesn't generate any executable code ... */
    case Ist_IMark:
+       env->last_insn_end = stmt->Ist.IMark.addr + stmt->Ist.IMark.len;
        return;
 
    /* --------- ABI HINT --------- */
@@ -4755,6 +5445,104 @@ static void iselStmt ( ISelEnv* env, IRStmt* stmt )
 /*--- ISEL: Basic block terminators (Nexts)             ---*/
 /*---------------------------------------------------------*/
 
+/* Shadow return stack support.  The guest state holds, at offs_RS,
+   the stack top index, hit and miss counters and a pad word, followed
+   by VEX_RET_STACK_SIZE guest return addresses and then the same
+   number of host addresses.  A call pushes its return address
+   together with the address of a chain-me stub, placed in this
+   translation, that continues at the return address.  A return whose
+   target matches the top entry pops it and jumps straight to that
+   stub, avoiding the dispatcher. */
+
+static AMD64AMode* rs_field ( ISelEnv* env, Int offs )
+{
+   return AMD64AMode_IR(env->offs_RS + offs, hregAMD64_RBP());
+}
+
+static AMD64AMode* rs_entry ( ISelEnv* env, Bool isHA, HReg idx )
+{
+   Int offs = env->offs_RS + 32 + (isHA ? 8 * VEX_RET_STACK_SIZE : 0);
+   return AMD64AMode_IRRS(offs, hregAMD64_RBP(), idx, 3);
+}
+
+static void rs_push ( ISelEnv* env, Int offsIP )
+{
+   Addr64      retGA = env->last_insn_end;
+   HReg        rTop  = newVRegI(env);
+   AMD64AMode* amRIP = AMD64AMode_IR(offsIP, hregAMD64_RBP());
+
+   vassert(retGA != 0);
+   addInstr(env, AMD64Instr_Alu64R(Aalu_MOV,
+                                   AMD64RMI_Mem(rs_field(env, 0)), rTop));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_ADD, AMD64RMI_Imm(1), rTop));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_AND,
+                                   AMD64RMI_Imm(VEX_RET_STACK_SIZE-1),
+                                   rTop));
+   addInstr(env, AMD64Instr_Alu64M(Aalu_MOV, AMD64RI_Reg(rTop),
+                                   rs_field(env, 0)));
+   if (fitsIn32Bits(retGA)) {
+      addInstr(env, AMD64Instr_Alu64M(Aalu_MOV, AMD64RI_Imm(toUInt(retGA)),
+                                      rs_entry(env, False, rTop)));
+   } else {
+      HReg rGA = newVRegI(env);
+      addInstr(env, AMD64Instr_Imm64(retGA, rGA));
+      addInstr(env, AMD64Instr_Alu64M(Aalu_MOV, AMD64RI_Reg(rGA),
+                                      rs_entry(env, False, rTop)));
+   }
+   addInstr(env, AMD64Instr_RSPush(retGA, amRIP,
+                                   rs_entry(env, True, rTop)));
+}
+
+static void rs_pop ( ISelEnv* env, HReg dstGA, Int offsIP )
+{
+   HReg        rTop  = newVRegI(env);
+   HReg        rNew  = newVRegI(env);
+   HReg        rHit  = newVRegI(env);
+   HReg        rCnt  = newVRegI(env);
+   HReg        rHA   = newVRegI(env);
+   AMD64AMode* amRIP = AMD64AMode_IR(offsIP, hregAMD64_RBP());
+
+   addInstr(env, AMD64Instr_Alu64R(Aalu_MOV,
+                                   AMD64RMI_Mem(rs_field(env, 0)), rTop));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_CMP,
+                                   AMD64RMI_Mem(rs_entry(env, False, rTop)),
+                                   dstGA));
+   addInstr(env, AMD64Instr_Set64(Acc_Z, rHit));
+
+   /* Count hits and misses. */
+   addInstr(env, AMD64Instr_Alu64R(Aalu_MOV,
+                                   AMD64RMI_Mem(rs_field(env, 8)), rCnt));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_ADD, AMD64RMI_Reg(rHit), rCnt));
+   addInstr(env, AMD64Instr_Alu64M(Aalu_MOV, AMD64RI_Reg(rCnt),
+                                   rs_field(env, 8)));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_MOV,
+                                   AMD64RMI_Mem(rs_field(env, 16)), rCnt));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_ADD, AMD64RMI_Imm(1), rCnt));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_SUB, AMD64RMI_Reg(rHit), rCnt));
+   addInstr(env, AMD64Instr_Alu64M(Aalu_MOV, AMD64RI_Reg(rCnt),
+                                   rs_field(env, 16)));
+
+   /* Fetch the host address before popping, then pop only on a hit,
+      so that a mispredicted return (longjmp, a return address
+      overwritten by the guest) leaves the stack for the frames
+      still live below it. */
+   addInstr(env, AMD64Instr_Alu64R(Aalu_MOV,
+                                   AMD64RMI_Mem(rs_entry(env, True, rTop)),
+                                   rHA));
+   addInstr(env, mk_iMOVsd_RR(rTop, rNew));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_SUB, AMD64RMI_Imm(1), rNew));
+   addInstr(env, AMD64Instr_Alu64R(Aalu_AND,
+                                   AMD64RMI_Imm(VEX_RET_STACK_SIZE-1),
+                                   rNew));
+   addInstr(env, AMD64Instr_Test64(1, rHit));
+   addInstr(env, AMD64Instr_CMov64(Acc_NZ, AMD64RM_Reg(rNew), rTop));
+   addInstr(env, AMD64Instr_Alu64M(Aalu_MOV, AMD64RI_Reg(rTop),
+                                   rs_field(env, 0)));
+
+   addInstr(env, AMD64Instr_Test64(1, rHit));
+   addInstr(env, AMD64Instr_XHost(dstGA, amRIP, rHA, Acc_NZ));
+}
+
 static void iselNext ( ISelEnv* env,
                        IRExpr* next, IRJumpKind jk, Int offsIP )
 {
@@ -4773,6 +5561,8 @@ static void iselNext ( ISelEnv* env,
       if (jk == Ijk_Boring || jk == Ijk_Call) {
          /* Boring transfer to known address */
          AMD64AMode* amRIP = AMD64AMode_IR(offsIP, hregAMD64_RBP());
+         if (jk == Ijk_Call && env->offs_RS >= 0)
+            rs_push(env, offsIP);
          if (env->chainingAllowed) {
             /* .. almost always true .. */
             /* Skip the event check at the dst if this is a forwards
@@ -4801,6 +5591,13 @@ static void iselNext ( ISelEnv* env,
       case Ijk_Boring: case Ijk_Ret: case Ijk_Call: {
          HReg        r     = iselIntExpr_R(env, next);
          AMD64AMode* amRIP = AMD64AMode_IR(offsIP, hregAMD64_RBP());
+         if (env->offs_RS >= 0) {
+            vassert(env->chainingAllowed);
+            if (jk == Ijk_Call)
+               rs_push(env, offsIP);
+            else if (jk == Ijk_Ret)
+               rs_pop(env, r, offsIP);
+         }
          if (env->chainingAllowed) {
             addInstr(env, AMD64Instr_XIndir(r, amRIP, Acc_ALWAYS));
          } else {
@@ -4847,20 +5644,30 @@ static void iselNext ( ISelEnv* env,
 /*--- Insn selector top-level                           ---*/
 /*---------------------------------------------------------*/
 
-/* Translate an entire SB to amd64 code. */
+/* Translate an entire SB to amd64 code.  If selfLoop, bb jumps back
+   to its own start, and do_loop_hoist_BB has given it a preheader:
+   the stmts before the first IMark.  Those are done once, after the
+   event check, with each temp they bind copied to a loop register
+   (see getLoopRegs_AMD64).  The rest of the block is then a loop,
+   whose back edge does the event check the block would have done
+   on being entered again, and which reads the temps from the loop
+   registers. */
 
 HInstrArray* iselSB_AMD64 ( IRSB* bb,
                             VexArch      arch_host,
                             VexArchInfo* archinfo_host,
-                            VexAbiInfo*  vbi/*UNUSED*/,
+                            VexAbiInfo*  vbi,
                             Int offs_Host_EvC_Counter,
                             Int offs_Host_EvC_FailAddr,
+                            Int offs_Host_RetStack,
                             Bool chainingAllowed,
                             Bool addProfInc,
-                            Addr64 max_ga )
+                            Addr64 max_ga,
+                            Bool selfLoop )
 {
-   Int        i, j;
+   Int        i, j, n_loop_regs, n_used;
    HReg       hreg, hregHI;
+   HReg*      loop_regs;
    ISelEnv*   env;
    UInt       hwcaps_host = archinfo_host->hwcaps;
    AMD64AMode *amCounter, *amFailAddr;
@@ -4874,7 +5681,11 @@ HInstrArray* iselSB_AMD64 ( IRSB* bb,
                      | VEX_HWCAPS_AMD64_AVX
                      | VEX_HWCAPS_AMD64_RDTSCP
                      | VEX_HWCAPS_AMD64_BMI
-                     | VEX_HWCAPS_AMD64_AVX2)));
+                     | VEX_HWCAPS_AMD64_AVX2
+                     | VEX_HWCAPS_AMD64_SSE42
+                     | VEX_HWCAPS_AMD64_AES
+                     | VEX_HWCAPS_AMD64_PCLMUL
+                     | VEX_HWCAPS_AMD64_FMA3)));
 
    /* Make up an initial environment to use. */
    env = LibVEX_Alloc(sizeof(ISelEnv));
@@ -4896,6 +5707,15 @@ HInstrArray* iselSB_AMD64 ( IRSB* bb,
    env->chainingAllowed = chainingAllowed;
    env->hwcaps          = hwcaps_host;
    env->max_ga          = max_ga;
+   env->offs_RS         = offs_Host_RetStack;
+   env->anyCached       = False;
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++) {
+      env->cachedOffs[i] = vbi->host_amd64_cached_guest_offsets[i];
+      if (env->cachedOffs[i] != 0)
+         env->anyCached = True;
+   }
+   env->last_insn_end   = 0;
+   env->loopregmap      = NULL;
 
    /* For each IR temporary, allocate a suitably-kinded virtual
       register. */
@@ -4917,6 +5737,10 @@ HInstrArray* iselSB_AMD64 ( IRSB* bb,
             hreg = mkHReg(j++, HRcVec128, True);
             break;
          case Ity_V256:
+            if (nativeV256(env)) {
+               hreg = mkHReg(j++, HRcVec256, True);
+               break;
+            }
             hreg   = mkHReg(j++, HRcVec128, True);
             hregHI = mkHReg(j++, HRcVec128, True);
             break;
@@ -4934,20 +5758,58 @@ HInstrArray* iselSB_AMD64 ( IRSB* bb,
    amFailAddr = AMD64AMode_IR(offs_Host_EvC_FailAddr, hregAMD64_RBP());
    addInstr(env, AMD64Instr_EvCheck(amCounter, amFailAddr));
 
+   /* The preheader, if any. */
+   i         = 0;
+   n_used    = 0;
+   loop_regs = NULL;
+   if (selfLoop) {
+      getLoopRegs_AMD64(&n_loop_regs, &loop_regs, vbi);
+      env->loopregmap = LibVEX_Alloc(env->n_vregmap * sizeof(HReg));
+      for (j = 0; j < env->n_vregmap; j++)
+         env->loopregmap[j] = INVALID_HREG;
+      for (; i < bb->stmts_used; i++) {
+         IRStmt* st = bb->stmts[i];
+         if (!st)
+            continue;
+         if (st->tag == Ist_IMark)
+            break;
+         iselStmt(env, st);
+         if (st->tag == Ist_WrTmp) {
+            vassert(n_used < n_loop_regs);
+            addInstr(env, mk_iMOVsd_RR(lookupIRTemp(env, st->Ist.WrTmp.tmp),
+                                       loop_regs[n_used]));
+            env->loopregmap[st->Ist.WrTmp.tmp] = loop_regs[n_used];
+            n_used++;
+         }
+      }
+      addInstr(env, AMD64Instr_LoopHead());
+   }
+
    /* Possibly a block counter increment (for profiling).  At this
       point we don't know the address of the counter, so just pretend
       it is zero.  It will have to be patched later, but before this
-      translation is used, by a call to LibVEX_patchProfCtr. */
+      translation is used, by a call to LibVEX_patchProfCtr.  In a
+      loop it counts the iterations. */
    if (addProfInc) {
       addInstr(env, AMD64Instr_ProfInc());
    }
 
    /* Ok, finally we can iterate over the statements. */
-   for (i = 0; i < bb->stmts_used; i++)
+   for (; i < bb->stmts_used; i++)
       if (bb->stmts[i])
          iselStmt(env, bb->stmts[i]);
 
-   iselNext(env, bb->next, bb->jumpkind, bb->offsIP);
+   if (selfLoop) {
+      vassert(bb->jumpkind == Ijk_Boring);
+      vassert(bb->next->tag == Iex_Const);
+      vassert(bb->next->Iex.Const.con->tag == Ico_U64);
+      addInstr(env, AMD64Instr_LoopBack(
+                       bb->next->Iex.Const.con->Ico.U64,
+                       AMD64AMode_IR(bb->offsIP, hregAMD64_RBP()),
+                       amCounter, amFailAddr, n_used, loop_regs));
+   } else {
+      iselNext(env, bb->next, bb->jumpkind, bb->offsIP);
+   }
 
    /* record the number of vregs we used. */
    env->code->n_vregs = env->vreg_ctr;
@@ -837,6 +837,14 @@ static const HChar* showARM64FpBinOp ( ARM64FpBinOp op ) {
    }
 }
 
+static const HChar* showARM64FpTriOp ( ARM64FpTriOp op ) {
+   switch (op) {
+      case ARM64fpt_FMADD: return "madd ";
+      case ARM64fpt_FMSUB: return "nmsub";
+      default: vpanic("showARM64FpTriOp");
+   }
+}
+
 static const HChar* showARM64FpUnaryOp ( ARM64FpUnaryOp op ) {
    switch (op) {
       case ARM64fpu_NEG:  return "neg  ";
@@ -885,6 +893,7 @@ static void showARM64VecBinOp(/*OUT*/const HChar** nm,
       case ARM64vecb_CMEQ32x4: *nm = "cmeq"; *ar = "4s";  return;
       case ARM64vecb_CMEQ16x8: *nm = "cmeq"; *ar = "8h";  return;
       case ARM64vecb_CMEQ8x16: *nm = "cmeq"; *ar = "16b"; return;
+      case ARM64vecb_PMULL64:  *nm = "pmull"; *ar = "1d"; return;
       default: vpanic("showARM64VecBinOp");
    }
 }
@@ -898,10 +907,23 @@ static void showARM64VecUnaryOp(/*OUT*/const HChar** nm,
       case ARM64vecu_FABS64x2: *nm = "fabs "; *ar = "2d";  return;
       case ARM64vecu_FABS32x4: *nm = "fabs "; *ar = "4s";  return;
       case ARM64vecu_NOT:      *nm = "not  "; *ar = "all"; return;
+      case ARM64vecu_AESMC:    *nm = "aesmc"; *ar = "16b"; return;
+      case ARM64vecu_AESIMC:   *nm = "aesimc"; *ar = "16b"; return;
       default: vpanic("showARM64VecUnaryOp");
    }
 }
 
+static void showARM64VecModifyOp(/*OUT*/const HChar** nm,
+                                 /*OUT*/const HChar** ar,
+                                 ARM64VecModifyOp op )
+{
+   switch (op) {
+      case ARM64vecmo_AESE: *nm = "aese "; *ar = "16b"; return;
+      case ARM64vecmo_AESD: *nm = "aesd "; *ar = "16b"; return;
+      default: vpanic("showARM64VecModifyOp");
+   }
+}
+
 static void showARM64VecShiftOp(/*OUT*/const HChar** nm,
                                 /*OUT*/const HChar** ar,
                                 ARM64VecShiftOp op )
@@ -1447,6 +1469,16 @@ ARM64Instr* ARM64Instr_Mul ( HReg dst, HReg argL, HReg argR,
    i->ARM64in.Mul.op   = op;
    return i;
 }
+ARM64Instr* ARM64Instr_CRC32C ( HReg dst, HReg acc, HReg src, Int szB ) {
+   ARM64Instr* i = LibVEX_Alloc(sizeof(ARM64Instr));
+   i->tag                 = ARM64in_CRC32C;
+   i->ARM64in.CRC32C.dst  = dst;
+   i->ARM64in.CRC32C.acc  = acc;
+   i->ARM64in.CRC32C.src  = src;
+   i->ARM64in.CRC32C.szB  = toUChar(szB);
+   vassert(szB == 1 || szB == 2 || szB == 4 || szB == 8);
+   return i;
+}
 ARM64Instr* ARM64Instr_LdrEX ( Int szB ) {
    ARM64Instr* i = LibVEX_Alloc(sizeof(ARM64Instr));
    i->tag               = ARM64in_LdrEX;
@@ -1562,6 +1594,28 @@ ARM64Instr* ARM64Instr_VBinS ( ARM64FpBinOp op,
    i->ARM64in.VBinS.argR = argR;
    return i;
 }
+ARM64Instr* ARM64Instr_VTriD ( ARM64FpTriOp op, HReg dst,
+                               HReg argN, HReg argM, HReg argA ) {
+   ARM64Instr* i = LibVEX_Alloc(sizeof(ARM64Instr));
+   i->tag                = ARM64in_VTriD;
+   i->ARM64in.VTriD.op   = op;
+   i->ARM64in.VTriD.dst  = dst;
+   i->ARM64in.VTriD.argN = argN;
+   i->ARM64in.VTriD.argM = argM;
+   i->ARM64in.VTriD.argA = argA;
+   return i;
+}
+ARM64Instr* ARM64Instr_VTriS ( ARM64FpTriOp op, HReg dst,
+                               HReg argN, HReg argM, HReg argA ) {
+   ARM64Instr* i = LibVEX_Alloc(sizeof(ARM64Instr));
+   i->tag                = ARM64in_VTriS;
+   i->ARM64in.VTriS.op   = op;
+   i->ARM64in.VTriS.dst  = dst;
+   i->ARM64in.VTriS.argN = argN;
+   i->ARM64in.VTriS.argM = argM;
+   i->ARM64in.VTriS.argA = argA;
+   return i;
+}
 ARM64Instr* ARM64Instr_VCmpD ( HReg argL, HReg argR ) {
    ARM64Instr* i = LibVEX_Alloc(sizeof(ARM64Instr));
    i->tag                = ARM64in_VCmpD;
@@ -1601,6 +1655,14 @@ ARM64Instr* ARM64Instr_VUnaryV ( ARM64VecUnaryOp op, HReg dst, HReg arg ) {
    i->ARM64in.VUnaryV.arg = arg;
    return i;
 }
+ARM64Instr* ARM64Instr_VModifyV ( ARM64VecModifyOp op, HReg mod, HReg arg ) {
+   ARM64Instr* i = LibVEX_Alloc(sizeof(ARM64Instr));
+   i->tag                  = ARM64in_VModifyV;
+   i->ARM64in.VModifyV.op  = op;
+   i->ARM64in.VModifyV.mod = mod;
+   i->ARM64in.VModifyV.arg = arg;
+   return i;
+}
 ARM64Instr* ARM64Instr_VNarrowV ( UInt dszBlg2, HReg dst, HReg src ) {
    ARM64Instr* i = LibVEX_Alloc(sizeof(ARM64Instr));
    i->tag                      = ARM64in_VNarrowV;
@@ -2064,6 +2126,14 @@ void ppARM64Instr ( ARM64Instr* i ) {
          vex_printf(", ");
          ppHRegARM64(i->ARM64in.Mul.argR);
          return;
+      case ARM64in_CRC32C:
+         vex_printf("crc32c%c ", "?bh?w???x"[i->ARM64in.CRC32C.szB]);
+         ppHRegARM64(i->ARM64in.CRC32C.dst);
+         vex_printf(", ");
+         ppHRegARM64(i->ARM64in.CRC32C.acc);
+         vex_printf(", ");
+         ppHRegARM64(i->ARM64in.CRC32C.src);
+         return;
 
       case ARM64in_LdrEX: {
          const HChar* sz = " ";
@@ -2202,6 +2272,26 @@ void ppARM64Instr ( ARM64Instr* i ) {
          vex_printf(", ");
          ppHRegARM64asSreg(i->ARM64in.VBinS.argR);
          return;
+      case ARM64in_VTriD:
+         vex_printf("f%s ", showARM64FpTriOp(i->ARM64in.VTriD.op));
+         ppHRegARM64(i->ARM64in.VTriD.dst);
+         vex_printf(", ");
+         ppHRegARM64(i->ARM64in.VTriD.argN);
+         vex_printf(", ");
+         ppHRegARM64(i->ARM64in.VTriD.argM);
+         vex_printf(", ");
+         ppHRegARM64(i->ARM64in.VTriD.argA);
+         return;
+      case ARM64in_VTriS:
+         vex_printf("f%s ", showARM64FpTriOp(i->ARM64in.VTriS.op));
+         ppHRegARM64asSreg(i->ARM64in.VTriS.dst);
+         vex_printf(", ");
+         ppHRegARM64asSreg(i->ARM64in.VTriS.argN);
+         vex_printf(", ");
+         ppHRegARM64asSreg(i->ARM64in.VTriS.argM);
+         vex_printf(", ");
+         ppHRegARM64asSreg(i->ARM64in.VTriS.argA);
+         return;
       case ARM64in_VCmpD:
          vex_printf("fcmp   ");
          ppHRegARM64(i->ARM64in.VCmpD.argL);
@@ -2248,6 +2338,17 @@ void ppARM64Instr ( ARM64Instr* i ) {
          vex_printf(".%s", ar);
          return;
       }
+      case ARM64in_VModifyV: {
+         const HChar* nm = "??";
+         const HChar* ar = "??";
+         showARM64VecModifyOp(&nm, &ar, i->ARM64in.VModifyV.op);
+         vex_printf("%s  ", nm);
+         ppHRegARM64(i->ARM64in.VModifyV.mod);
+         vex_printf(".%s, ", ar);
+         ppHRegARM64(i->ARM64in.VModifyV.arg);
+         vex_printf(".%s", ar);
+         return;
+      }
       case ARM64in_VNarrowV: {
          UInt dszBlg2 = i->ARM64in.VNarrowV.dszBlg2;
          const HChar* darr[3] = { "8b", "4h", "2s" };
@@ -2647,6 +2748,11 @@ void getRegUsage_ARM64Instr ( HRegUsage* u, ARM64Instr* i, Bool mode64 )
          addHRegUse(u, HRmRead,  i->ARM64in.Mul.argL);
          addHRegUse(u, HRmRead,  i->ARM64in.Mul.argR);
          return;
+      case ARM64in_CRC32C:
+         addHRegUse(u, HRmWrite, i->ARM64in.CRC32C.dst);
+         addHRegUse(u, HRmRead,  i->ARM64in.CRC32C.acc);
+         addHRegUse(u, HRmRead,  i->ARM64in.CRC32C.src);
+         return;
       case ARM64in_LdrEX:
          addHRegUse(u, HRmRead, hregARM64_X4());
          addHRegUse(u, HRmWrite, hregARM64_X2());
@@ -2713,6 +2819,18 @@ void getRegUsage_ARM64Instr ( HRegUsage* u, ARM64Instr* i, Bool mode64 )
          addHRegUse(u, HRmRead, i->ARM64in.VBinS.argL);
          addHRegUse(u, HRmRead, i->ARM64in.VBinS.argR);
          return;
+      case ARM64in_VTriD:
+         addHRegUse(u, HRmWrite, i->ARM64in.VTriD.dst);
+         addHRegUse(u, HRmRead, i->ARM64in.VTriD.argN);
+         addHRegUse(u, HRmRead, i->ARM64in.VTriD.argM);
+         addHRegUse(u, HRmRead, i->ARM64in.VTriD.argA);
+         return;
+      case ARM64in_VTriS:
+         addHRegUse(u, HRmWrite, i->ARM64in.VTriS.dst);
+         addHRegUse(u, HRmRead, i->ARM64in.VTriS.argN);
+         addHRegUse(u, HRmRead, i->ARM64in.VTriS.argM);
+         addHRegUse(u, HRmRead, i->ARM64in.VTriS.argA);
+         return;
       case ARM64in_VCmpD:
          addHRegUse(u, HRmRead, i->ARM64in.VCmpD.argL);
          addHRegUse(u, HRmRead, i->ARM64in.VCmpD.argR);
@@ -2736,6 +2854,10 @@ void getRegUsage_ARM64Instr ( HRegUsage* u, ARM64Instr* i, Bool mode64 )
          addHRegUse(u, HRmWrite, i->ARM64in.VUnaryV.dst);
          addHRegUse(u, HRmRead, i->ARM64in.VUnaryV.arg);
          return;
+      case ARM64in_VModifyV:
+         addHRegUse(u, HRmModify, i->ARM64in.VModifyV.mod);
+         addHRegUse(u, HRmRead, i->ARM64in.VModifyV.arg);
+         return;
       case ARM64in_VNarrowV:
          addHRegUse(u, HRmWrite, i->ARM64in.VNarrowV.dst);
          addHRegUse(u, HRmRead, i->ARM64in.VNarrowV.src);
@@ -2956,6 +3078,11 @@ void mapRegs_ARM64Instr ( HRegRemap* m, ARM64Instr* i, Bool mode64 )
          i->ARM64in.Mul.argL = lookupHRegRemap(m, i->ARM64in.Mul.argL);
          i->ARM64in.Mul.argR = lookupHRegRemap(m, i->ARM64in.Mul.argR);
          break;
+      case ARM64in_CRC32C:
+         i->ARM64in.CRC32C.dst = lookupHRegRemap(m, i->ARM64in.CRC32C.dst);
+         i->ARM64in.CRC32C.acc = lookupHRegRemap(m, i->ARM64in.CRC32C.acc);
+         i->ARM64in.CRC32C.src = lookupHRegRemap(m, i->ARM64in.CRC32C.src);
+         return;
       case ARM64in_LdrEX:
          return;
       case ARM64in_StrEX:
@@ -3006,6 +3133,18 @@ void mapRegs_ARM64Instr ( HRegRemap* m, ARM64Instr* i, Bool mode64 )
          i->ARM64in.VBinS.argL = lookupHRegRemap(m, i->ARM64in.VBinS.argL);
          i->ARM64in.VBinS.argR = lookupHRegRemap(m, i->ARM64in.VBinS.argR);
          return;
+      case ARM64in_VTriD:
+         i->ARM64in.VTriD.dst  = lookupHRegRemap(m, i->ARM64in.VTriD.dst);
+         i->ARM64in.VTriD.argN = lookupHRegRemap(m, i->ARM64in.VTriD.argN);
+         i->ARM64in.VTriD.argM = lookupHRegRemap(m, i->ARM64in.VTriD.argM);
+         i->ARM64in.VTriD.argA = lookupHRegRemap(m, i->ARM64in.VTriD.argA);
+         return;
+      case ARM64in_VTriS:
+         i->ARM64in.VTriS.dst  = lookupHRegRemap(m, i->ARM64in.VTriS.dst);
+         i->ARM64in.VTriS.argN = lookupHRegRemap(m, i->ARM64in.VTriS.argN);
+         i->ARM64in.VTriS.argM = lookupHRegRemap(m, i->ARM64in.VTriS.argM);
+         i->ARM64in.VTriS.argA = lookupHRegRemap(m, i->ARM64in.VTriS.argA);
+         return;
       case ARM64in_VCmpD:
          i->ARM64in.VCmpD.argL = lookupHRegRemap(m, i->ARM64in.VCmpD.argL);
          i->ARM64in.VCmpD.argR = lookupHRegRemap(m, i->ARM64in.VCmpD.argR);
@@ -3026,6 +3165,12 @@ void mapRegs_ARM64Instr ( HRegRemap* m, ARM64Instr* i, Bool mode64 )
          i->ARM64in.VUnaryV.dst = lookupHRegRemap(m, i->ARM64in.VUnaryV.dst);
          i->ARM64in.VUnaryV.arg = lookupHRegRemap(m, i->ARM64in.VUnaryV.arg);
          return;
+      case ARM64in_VModifyV:
+         i->ARM64in.VModifyV.mod
+            = lookupHRegRemap(m, i->ARM64in.VModifyV.mod);
+         i->ARM64in.VModifyV.arg
+            = lookupHRegRemap(m, i->ARM64in.VModifyV.arg);
+         return;
       case ARM64in_VNarrowV:
          i->ARM64in.VNarrowV.dst = lookupHRegRemap(m, i->ARM64in.VNarrowV.dst);
          i->ARM64in.VNarrowV.src = lookupHRegRemap(m, i->ARM64in.VNarrowV.src);
@@ -3256,6 +3401,91 @@ void genReload_ARM64 ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
 }
 
 
+/* Peephole rules, for register-allocated code. */
+
+/* Is i a 64-bit integer or FP load or store (as genSpill_ARM64 and
+   genReload_ARM64 make) to or from an offset from x21?  Then it is
+   in the guest state or a spill slot, which only generated code
+   writes.  If so, return the register and the byte offset. */
+static Bool isX21LdSt64 ( ARM64Instr* i, Bool isLoad, HReg* r, Int* off )
+{
+   ARM64AMode* am;
+   switch (i->tag) {
+      case ARM64in_LdSt64:
+         if (i->ARM64in.LdSt64.isLoad != isLoad)
+            return False;
+         *r = i->ARM64in.LdSt64.rD;
+         am = i->ARM64in.LdSt64.amode;
+         switch (am->tag) {
+            case ARM64am_RI9:
+               *off = am->ARM64am.RI9.simm9;
+               return sameHReg(am->ARM64am.RI9.reg, hregARM64_X21());
+            case ARM64am_RI12:
+               *off = am->ARM64am.RI12.uimm12 * am->ARM64am.RI12.szB;
+               return sameHReg(am->ARM64am.RI12.reg, hregARM64_X21());
+            default:
+               return False;
+         }
+      case ARM64in_VLdStD:
+         if (i->ARM64in.VLdStD.isLoad != isLoad)
+            return False;
+         *r   = i->ARM64in.VLdStD.dD;
+         *off = i->ARM64in.VLdStD.uimm12;
+         return sameHReg(i->ARM64in.VLdStD.rN, hregARM64_X21());
+      default:
+         return False;
+   }
+}
+
+/* See doPeephole and VexPeepholeRule. */
+Int peephole_ARM64Instr ( HInstr* prevH, HInstr** curH, Bool mode64 )
+{
+   ARM64Instr* prev = (ARM64Instr*)prevH;
+   ARM64Instr* cur  = (ARM64Instr*)*curH;
+   HReg        src, dst, src2, dst2;
+   Int         off, off2;
+   vassert(mode64 == True);
+
+   if (isMove_ARM64Instr(cur, &src, &dst) && sameHReg(src, dst)) {
+      *curH = NULL;
+      return VexPeepSelfMove;
+   }
+   if (prev == NULL)
+      return VexPeep_N;
+
+   if (isMove_ARM64Instr(cur, &src, &dst)
+       && isMove_ARM64Instr(prev, &src2, &dst2)
+       && cur->tag == prev->tag
+       && (cur->tag != ARM64in_VMov
+           || cur->ARM64in.VMov.szB == prev->ARM64in.VMov.szB)
+       && sameHReg(src, dst2) && sameHReg(dst, src2)) {
+      *curH = NULL;
+      return VexPeepMoveBack;
+   }
+
+   if (isX21LdSt64(cur, True/*load*/, &dst, &off)
+       && isX21LdSt64(prev, False/*store*/, &src, &off2)
+       && off == off2 && cur->tag == prev->tag) {
+      if (sameHReg(src, dst))
+         *curH = NULL;
+      else if (cur->tag == ARM64in_LdSt64)
+         *curH = ARM64Instr_MovI(dst, src);
+      else
+         *curH = ARM64Instr_VMov(8, dst, src);
+      return VexPeepStoreReload;
+   }
+
+   if (isX21LdSt64(cur, False/*store*/, &src, &off)
+       && isX21LdSt64(prev, True/*load*/, &dst, &off2)
+       && off == off2 && cur->tag == prev->tag && sameHReg(src, dst)) {
+      *curH = NULL;
+      return VexPeepLoadStore;
+   }
+
+   return VexPeep_N;
+}
+
+
 //ZZ /* Emit an instruction into buf and return the number of bytes used.
 //ZZ    Note that buf is not the insn's final place, and therefore it is
 //ZZ    imperative to emit position-independent code. */
@@ -3334,8 +3564,11 @@ static inline UChar qregNo ( HReg r )
 #define X001111  BITS8(0,0, 0,0,1,1,1,1)
 #define X010000  BITS8(0,0, 0,1,0,0,0,0)
 #define X010001  BITS8(0,0, 0,1,0,0,0,1)
+#define X010010  BITS8(0,0, 0,1,0,0,1,0)
+#define X010100  BITS8(0,0, 0,1,0,1,0,0)
 #define X010101  BITS8(0,0, 0,1,0,1,0,1)
 #define X010110  BITS8(0,0, 0,1,0,1,1,0)
+#define X010111  BITS8(0,0, 0,1,0,1,1,1)
 #define X011001  BITS8(0,0, 0,1,1,0,0,1)
 #define X011010  BITS8(0,0, 0,1,1,0,1,0)
 #define X011011  BITS8(0,0, 0,1,1,0,1,1)
@@ -3938,10 +4171,11 @@ Int emit_ARM64Instr ( /*MB_MOD*/Bool* is_profInc,
                       void* disp_cp_chain_me_to_slowEP,
                       void* disp_cp_chain_me_to_fastEP,
                       void* disp_cp_xindir,
+                      void* disp_cp_xindir_miss,
                       void* disp_cp_xassisted )
 {
    UInt* p = (UInt*)buf;
-   vassert(nbuf >= 32);
+   vassert(nbuf >= 80);
    vassert(mode64 == True);
    vassert(0 == (((HWord)buf) & 3));
 
@@ -4378,10 +4612,40 @@ Int emit_ARM64Instr ( /*MB_MOD*/Bool* is_profInc,
                                 iregNo(i->ARM64in.XIndir.dstGA),
                                 i->ARM64in.XIndir.amPC);
 
-         /* imm64 x9, VG_(disp_cp_xindir) */
-         /* br    x9 */
-         p = imm64_to_iregNo(p, /*x*/9, Ptr_to_ULong(disp_cp_xindir));
-         *p++ = 0xD61F0120; /* br x9 */
+         if (disp_cp_xindir_miss != NULL) {
+            /* An inline cache.  NB: what goes on here has to be very
+               closely coordinated with chainXIndir_ARM64 and
+               unchainXIndir_ARM64 below. */
+            /* --- FIRST PATCHABLE BYTE follows --- */
+            /* disp_cp_xindir_miss backs up the return address by 64
+               to find the first patchable byte, so don't change the
+               number of instructions (16) below.  The site starts
+               out empty: the cached guest address is zero, and
+               matching it just goes to disp_cp_xindir anyway. */
+            /* imm64-exactly4 x9, 0 */
+            p = imm64_to_iregNo_EXACTLY4(p, /*x*/9, 0);
+            /* cmp r-dstGA, x9 */
+            *p++ = X_3_8_5_6_5_5(X111, X01011000, /*x*/9, X000000,
+                                 iregNo(i->ARM64in.XIndir.dstGA), 31);
+            /* b.ne miss */
+            *p++ = X_8_19_1_4(X01010100, 6, 0, ARM64cc_NE);
+            /* imm64-exactly4 x9, VG_(disp_cp_xindir) */
+            /* br x9 */
+            p = imm64_to_iregNo_EXACTLY4(p, /*x*/9,
+                                         Ptr_to_ULong(disp_cp_xindir));
+            *p++ = 0xD61F0120;
+            /* miss: imm64-exactly4 x9, VG_(disp_cp_xindir_miss) */
+            /* blr x9 */
+            p = imm64_to_iregNo_EXACTLY4(p, /*x*/9,
+                                         Ptr_to_ULong(disp_cp_xindir_miss));
+            *p++ = 0xD63F0120;
+            /* --- END of PATCHABLE BYTES --- */
+         } else {
+            /* imm64 x9, VG_(disp_cp_xindir) */
+            /* br    x9 */
+            p = imm64_to_iregNo(p, /*x*/9, Ptr_to_ULong(disp_cp_xindir));
+            *p++ = 0xD61F0120; /* br x9 */
+         }
 
          /* Fix up the conditional jump, if there was one. */
          if (i->ARM64in.XIndir.cond != ARM64cc_AL) {
@@ -4567,6 +4831,34 @@ Int emit_ARM64Instr ( /*MB_MOD*/Bool* is_profInc,
          }
          goto bad;
       }
+      case ARM64in_CRC32C: {
+         /* 000 11010110 m 010100 n d   CRC32CB Wd, Wn, Wm
+            000 11010110 m 010101 n d   CRC32CH Wd, Wn, Wm
+            000 11010110 m 010110 n d   CRC32CW Wd, Wn, Wm
+            100 11010110 m 010111 n d   CRC32CX Wd, Wn, Xm
+         */
+         UInt dd = iregNo(i->ARM64in.CRC32C.dst);
+         UInt nn = iregNo(i->ARM64in.CRC32C.acc);
+         UInt mm = iregNo(i->ARM64in.CRC32C.src);
+         vassert(dd < 31 && nn < 31 && mm < 31);
+         switch (i->ARM64in.CRC32C.szB) {
+            case 1:
+               *p++ = X_3_8_5_6_5_5(X000, X11010110, mm, X010100, nn, dd);
+               goto done;
+            case 2:
+               *p++ = X_3_8_5_6_5_5(X000, X11010110, mm, X010101, nn, dd);
+               goto done;
+            case 4:
+               *p++ = X_3_8_5_6_5_5(X000, X11010110, mm, X010110, nn, dd);
+               goto done;
+            case 8:
+               *p++ = X_3_8_5_6_5_5(X100, X11010110, mm, X010111, nn, dd);
+               goto done;
+            default:
+               vassert(0);
+         }
+         goto bad;
+      }
       case ARM64in_LdrEX: {
          /* 085F7C82   ldxrb w2, [x4]
             485F7C82   ldxrh w2, [x4]
@@ -4881,6 +5173,39 @@ Int emit_ARM64Instr ( /*MB_MOD*/Bool* is_profInc,
             = X_3_8_5_6_5_5(X000, X11110001, sM, (b1512 << 2) | X10, sN, sD);
          goto done;
       }
+      case ARM64in_VTriD:
+      case ARM64in_VTriS: {
+         /* 31       23 21 20 15 14 9 4
+            000 11111 ty 0 m  0  a  n d   FMADD  Fd,Fn,Fm,Fa
+            000 11111 ty 1 m  1  a  n d   FNMSUB Fd,Fn,Fm,Fa
+            where ty = 01 for D regs, 00 for S regs
+         */
+         Bool isD = i->tag == ARM64in_VTriD;
+         ARM64FpTriOp op;
+         UInt fD, fN, fM, fA, o1o0;
+         if (isD) {
+            op = i->ARM64in.VTriD.op;
+            fD = dregNo(i->ARM64in.VTriD.dst);
+            fN = dregNo(i->ARM64in.VTriD.argN);
+            fM = dregNo(i->ARM64in.VTriD.argM);
+            fA = dregNo(i->ARM64in.VTriD.argA);
+         } else {
+            op = i->ARM64in.VTriS.op;
+            fD = dregNo(i->ARM64in.VTriS.dst);
+            fN = dregNo(i->ARM64in.VTriS.argN);
+            fM = dregNo(i->ARM64in.VTriS.argM);
+            fA = dregNo(i->ARM64in.VTriS.argA);
+         }
+         switch (op) {
+            case ARM64fpt_FMADD: o1o0 = 0; break;
+            case ARM64fpt_FMSUB: o1o0 = 3; break;
+            default: goto bad;
+         }
+         *p++ = X_3_8_5_6_5_5(X000, (X11111 << 3) | (isD ? 2 : 0)
+                                    | (o1o0 >> 1),
+                              fM, ((o1o0 & 1) << 5) | fA, fN, fD);
+         goto done;
+      }
       case ARM64in_VCmpD: {
          /* 000 11110 01 1 m 00 1000 n 00 000  FCMP Dn, Dm */
          UInt dN = dregNo(i->ARM64in.VCmpD.argL);
@@ -5071,6 +5396,10 @@ Int emit_ARM64Instr ( /*MB_MOD*/Bool* is_profInc,
             case ARM64vecb_CMEQ8x16:
                *p++ = X_3_8_5_6_5_5(X011, X01110001, vM, X100011, vN, vD);
                break;
+            case ARM64vecb_PMULL64:
+               /* 000 01110 11 1 m 111000 n d  PMULL Vd.1q, Vn.1d, Vm.1d */
+               *p++ = X_3_8_5_6_5_5(X000, X01110111, vM, X111000, vN, vD);
+               break;
 
             default:
                goto bad;
@@ -5097,6 +5426,31 @@ Int emit_ARM64Instr ( /*MB_MOD*/Bool* is_profInc,
             case ARM64vecu_NOT:
                *p++ = X_3_8_5_6_5_5(X011, X01110001, X00000, X010110, vN, vD);
                break;
+            case ARM64vecu_AESMC:
+               *p++ = X_3_8_5_6_5_5(X010, X01110001, X01000, X011010, vN, vD);
+               break;
+            case ARM64vecu_AESIMC:
+               *p++ = X_3_8_5_6_5_5(X010, X01110001, X01000, X011110, vN, vD);
+               break;
+            default:
+               goto bad;
+         }
+         goto done;
+      }
+      case ARM64in_VModifyV: {
+         /* 31        23   20    15     9 4
+            010 01110 00 1 01000 010010 n d  AESE Vd.16b, Vn.16b
+            010 01110 00 1 01000 010110 n d  AESD Vd.16b, Vn.16b
+         */
+         UInt vD = qregNo(i->ARM64in.VModifyV.mod);
+         UInt vN = qregNo(i->ARM64in.VModifyV.arg);
+         switch (i->ARM64in.VModifyV.op) {
+            case ARM64vecmo_AESE:
+               *p++ = X_3_8_5_6_5_5(X010, X01110001, X01000, X010010, vN, vD);
+               break;
+            case ARM64vecmo_AESD:
+               *p++ = X_3_8_5_6_5_5(X010, X01110001, X01000, X010110, vN, vD);
+               break;
             default:
                goto bad;
          }
@@ -6288,7 +6642,7 @@ Int emit_ARM64Instr ( /*MB_MOD*/Bool* is_profInc,
    /*NOTREACHED*/
 
   done:
-   vassert(((UChar*)p) - &buf[0] <= 36);
+   vassert(((UChar*)p) - &buf[0] <= 80);
    return ((UChar*)p) - &buf[0];
 }
 
@@ -6302,6 +6656,58 @@ Int evCheckSzB_ARM64 ( void )
 }
 
 
+/* Hot/cold layout.  If i is a conditional exit, return an
+   unconditional copy of it, to be emitted out of line, else NULL. */
+ARM64Instr* coldExit_ARM64Instr ( ARM64Instr* i )
+{
+   ARM64Instr* stub;
+   switch (i->tag) {
+      case ARM64in_XDirect:
+         if (i->ARM64in.XDirect.cond == ARM64cc_AL) return NULL;
+         break;
+      case ARM64in_XIndir:
+         if (i->ARM64in.XIndir.cond == ARM64cc_AL) return NULL;
+         break;
+      case ARM64in_XAssisted:
+         if (i->ARM64in.XAssisted.cond == ARM64cc_AL) return NULL;
+         break;
+      default:
+         return NULL;
+   }
+   stub  = LibVEX_Alloc(sizeof(ARM64Instr));
+   *stub = *i;
+   switch (i->tag) {
+      case ARM64in_XDirect:   stub->ARM64in.XDirect.cond   = ARM64cc_AL; break;
+      case ARM64in_XIndir:    stub->ARM64in.XIndir.cond    = ARM64cc_AL; break;
+      case ARM64in_XAssisted: stub->ARM64in.XAssisted.cond = ARM64cc_AL; break;
+      default: vassert(0);
+   }
+   return stub;
+}
+
+/* Emit the branch to cold exit i's out of line copy, which is delta
+   bytes from the start of the branch.  This is always one insn,
+   whatever delta is. */
+Int emitColdBranch_ARM64 ( UChar* buf, Int nbuf, ARM64Instr* i, Int delta )
+{
+   ARM64CondCode cond = ARM64cc_AL;
+   UInt*         p    = (UInt*)&buf[0];
+   vassert(nbuf >= 4);
+   switch (i->tag) {
+      case ARM64in_XDirect:   cond = i->ARM64in.XDirect.cond;   break;
+      case ARM64in_XIndir:    cond = i->ARM64in.XIndir.cond;    break;
+      case ARM64in_XAssisted: cond = i->ARM64in.XAssisted.cond; break;
+      default: vpanic("emitColdBranch_ARM64");
+   }
+   vassert(cond <= 13); /* Neither AL nor NV */
+   vassert((delta & 3) == 0);
+   vassert(delta >= -(1<<20) && delta < (1<<20));
+   /* b.cond delta */
+   *p++ = X_8_19_1_4(X01010100, (delta >> 2) & ((1<<19)-1), 0, cond);
+   return (UChar*)p - &buf[0];
+}
+
+
 /* NB: what goes on here has to be very closely coordinated with the
    emitInstr case for XDirect, above. */
 VexInvalRange chainXDirect_ARM64 ( void* place_to_chain,
@@ -6386,6 +6792,88 @@ VexInvalRange unchainXDirect_ARM64 ( void* place_to_unchain,
 }
 
 
+/* NB: what goes on here has to be very closely coordinated with the
+   emitInstr case for XIndir, above. */
+VexInvalRange chainXIndir_ARM64 ( void*  place_to_chain,
+                                  void*  disp_cp_xindir_miss_EXPECTED,
+                                  Addr64 guest_addr,
+                                  void*  place_to_jump_to,
+                                  void*  disp_cp_xindir )
+{
+   /* What we're expecting to see is the empty inline cache:
+         0  imm64-exactly4 x9, 0
+        16  cmp  r-dstGA, x9
+        20  b.ne 44
+        24  imm64-exactly4 x9, disp_cp_xindir
+        40  br   x9
+        44  imm64-exactly4 x9, disp_cp_xindir_miss_EXPECTED
+        60  blr  x9
+   */
+   UInt* p = (UInt*)place_to_chain;
+   vassert(0 == (3 & (HWord)p));
+   vassert(is_imm64_to_iregNo_EXACTLY4(p, /*x*/9, 0));
+   vassert(p[5] == X_8_19_1_4(X01010100, 6, 0, ARM64cc_NE));
+   vassert(is_imm64_to_iregNo_EXACTLY4(
+              &p[6], /*x*/9, Ptr_to_ULong(disp_cp_xindir)));
+   vassert(p[10] == 0xD61F0120);
+   vassert(is_imm64_to_iregNo_EXACTLY4(
+              &p[11], /*x*/9, Ptr_to_ULong(disp_cp_xindir_miss_EXPECTED)));
+   vassert(p[15] == 0xD63F0120);
+
+   /* And what we want to change it to is:
+         0  imm64-exactly4 x9, guest_addr
+        16  cmp  r-dstGA, x9
+        20  b.ne 44
+        24  imm64-exactly4 x9, place_to_jump_to
+        40  br   x9
+        44  imm64-exactly4 x9, disp_cp_xindir
+        60  br   x9
+   */
+   (void)imm64_to_iregNo_EXACTLY4(p, /*x*/9, guest_addr);
+   (void)imm64_to_iregNo_EXACTLY4(
+            &p[6], /*x*/9, Ptr_to_ULong(place_to_jump_to));
+   (void)imm64_to_iregNo_EXACTLY4(
+            &p[11], /*x*/9, Ptr_to_ULong(disp_cp_xindir));
+   p[15] = 0xD61F0120;
+
+   VexInvalRange vir = {(HWord)p, 64};
+   return vir;
+}
+
+
+/* NB: what goes on here has to be very closely coordinated with the
+   emitInstr case for XIndir, above. */
+VexInvalRange unchainXIndir_ARM64 ( void* place_to_unchain,
+                                    void* place_to_jump_to_EXPECTED,
+                                    void* disp_cp_xindir,
+                                    void* disp_cp_xindir_miss )
+{
+   /* What we're expecting to see is an inline cache as left by
+      chainXIndir_ARM64, with its hit jump going to
+      place_to_jump_to_EXPECTED. */
+   UInt* p = (UInt*)place_to_unchain;
+   vassert(0 == (3 & (HWord)p));
+   vassert(p[5] == X_8_19_1_4(X01010100, 6, 0, ARM64cc_NE));
+   vassert(is_imm64_to_iregNo_EXACTLY4(
+              &p[6], /*x*/9, Ptr_to_ULong(place_to_jump_to_EXPECTED)));
+   vassert(p[10] == 0xD61F0120);
+   vassert(is_imm64_to_iregNo_EXACTLY4(
+              &p[11], /*x*/9, Ptr_to_ULong(disp_cp_xindir)));
+   vassert(p[15] == 0xD61F0120);
+
+   /* And put back the empty inline cache, as generated. */
+   (void)imm64_to_iregNo_EXACTLY4(p, /*x*/9, 0);
+   (void)imm64_to_iregNo_EXACTLY4(
+            &p[6], /*x*/9, Ptr_to_ULong(disp_cp_xindir));
+   (void)imm64_to_iregNo_EXACTLY4(
+            &p[11], /*x*/9, Ptr_to_ULong(disp_cp_xindir_miss));
+   p[15] = 0xD63F0120;
+
+   VexInvalRange vir = {(HWord)p, 64};
+   return vir;
+}
+
+
 //ZZ /* Patch the counter address into a profile inc point, as previously
 //ZZ    created by the ARMin_ProfInc case for emit_ARMInstr. */
 //ZZ VexInvalRange patchProfInc_ARM ( void*  place_to_patch,
@@ -295,6 +295,14 @@ typedef
    }
    ARM64FpBinOp;
 
+typedef
+   enum {
+      ARM64fpt_FMADD=105, /* dst = argN * argM + argA: fmadd */
+      ARM64fpt_FMSUB,     /* dst = argN * argM - argA: fnmsub */
+      ARM64fpt_INVALID
+   }
+   ARM64FpTriOp;
+
 typedef
    enum {
       ARM64fpu_NEG=110,
@@ -342,6 +350,7 @@ typedef
       ARM64vecb_CMEQ32x4,
       ARM64vecb_CMEQ16x8,
       ARM64vecb_CMEQ8x16,
+      ARM64vecb_PMULL64,  /* pmull Vd.1q, Vn.1d, Vm.1d */
       ARM64vecb_INVALID
    }
    ARM64VecBinOp;
@@ -353,10 +362,20 @@ typedef
       ARM64vecu_FABS64x2,
       ARM64vecu_FABS32x4,
       ARM64vecu_NOT,
+      ARM64vecu_AESMC,
+      ARM64vecu_AESIMC,
       ARM64vecu_INVALID
    }
    ARM64VecUnaryOp;
 
+typedef
+   enum {
+      ARM64vecmo_AESE=330, /* mod := ShiftRows(SubBytes(mod ^ arg)) */
+      ARM64vecmo_AESD,     /* ditto, inverted */
+      ARM64vecmo_INVALID
+   }
+   ARM64VecModifyOp;
+
 typedef
    enum {
       ARM64vecsh_USHR64x2=350,
@@ -530,6 +549,7 @@ typedef
       ARM64in_AddToSP,     /* move SP by small, signed constant */
       ARM64in_FromSP,      /* move SP to integer register */
       ARM64in_Mul,
+      ARM64in_CRC32C,
       ARM64in_LdrEX,
       ARM64in_StrEX,
       ARM64in_MFence,
@@ -545,12 +565,15 @@ typedef
       ARM64in_VUnaryS,
       ARM64in_VBinD,
       ARM64in_VBinS,
+      ARM64in_VTriD,
+      ARM64in_VTriS,
       ARM64in_VCmpD,
       ARM64in_VCmpS,
       ARM64in_FPCR,
       /* ARM64in_V*V: vector ops on vector registers */
       ARM64in_VBinV,
       ARM64in_VUnaryV,
+      ARM64in_VModifyV,
       ARM64in_VNarrowV,
       ARM64in_VShiftImmV,
 //ZZ       ARMin_VAluS,
@@ -717,6 +740,14 @@ typedef
             HReg       argR;
             ARM64MulOp op;
          } Mul;
+         /* crc32c{b,h,w,x} Wd, Wn, Rm: dst := the CRC32C of acc and
+            the low szB bytes of src */
+         struct {
+            HReg  dst;
+            HReg  acc;
+            HReg  src;
+            UChar szB; /* 1, 2, 4 or 8 */
+         } CRC32C;
          /* LDXR{,H,B} x2, [x4] */
          struct {
             Int  szB; /* 1, 2, 4 or 8 */
@@ -802,6 +833,22 @@ typedef
             HReg         argL;
             HReg         argR;
          } VBinS;
+         /* 64-bit FP fused multiply-add/sub, rounded once */
+         struct {
+            ARM64FpTriOp op;
+            HReg         dst;
+            HReg         argN;
+            HReg         argM;
+            HReg         argA;
+         } VTriD;
+         /* 32-bit FP fused multiply-add/sub, rounded once */
+         struct {
+            ARM64FpTriOp op;
+            HReg         dst;
+            HReg         argN;
+            HReg         argM;
+            HReg         argA;
+         } VTriS;
          /* 64-bit FP compare */
          struct {
             HReg argL;
@@ -830,6 +877,13 @@ typedef
             HReg            dst;
             HReg            arg;
          } VUnaryV;
+         /* vector operation on vector registers, that reads and
+            writes mod, eg AESE */
+         struct {
+            ARM64VecModifyOp op;
+            HReg             mod;
+            HReg             arg;
+         } VModifyV;
          /* vector narrowing, Q -> Q.  Result goes in the bottom half
             of dst and the top half is zeroed out.  Iow is XTN. */
         struct {
@@ -1012,6 +1066,8 @@ extern ARM64Instr* ARM64Instr_AddToSP ( Int simm );
 extern ARM64Instr* ARM64Instr_FromSP  ( HReg dst );
 extern ARM64Instr* ARM64Instr_Mul     ( HReg dst, HReg argL, HReg argR,
                                         ARM64MulOp op );
+extern ARM64Instr* ARM64Instr_CRC32C  ( HReg dst, HReg acc, HReg src,
+                                        Int szB );
 extern ARM64Instr* ARM64Instr_LdrEX   ( Int szB );
 extern ARM64Instr* ARM64Instr_StrEX   ( Int szB );
 extern ARM64Instr* ARM64Instr_MFence  ( void );
@@ -1029,11 +1085,17 @@ extern ARM64Instr* ARM64Instr_VUnaryD ( ARM64FpUnaryOp op, HReg dst, HReg src );
 extern ARM64Instr* ARM64Instr_VUnaryS ( ARM64FpUnaryOp op, HReg dst, HReg src );
 extern ARM64Instr* ARM64Instr_VBinD   ( ARM64FpBinOp op, HReg, HReg, HReg );
 extern ARM64Instr* ARM64Instr_VBinS   ( ARM64FpBinOp op, HReg, HReg, HReg );
+extern ARM64Instr* ARM64Instr_VTriD   ( ARM64FpTriOp op, HReg dst,
+                                        HReg argN, HReg argM, HReg argA );
+extern ARM64Instr* ARM64Instr_VTriS   ( ARM64FpTriOp op, HReg dst,
+                                        HReg argN, HReg argM, HReg argA );
 extern ARM64Instr* ARM64Instr_VCmpD   ( HReg argL, HReg argR );
 extern ARM64Instr* ARM64Instr_VCmpS   ( HReg argL, HReg argR );
 extern ARM64Instr* ARM64Instr_FPCR    ( Bool toFPCR, HReg iReg );
 extern ARM64Instr* ARM64Instr_VBinV   ( ARM64VecBinOp op, HReg, HReg, HReg );
 extern ARM64Instr* ARM64Instr_VUnaryV ( ARM64VecUnaryOp op, HReg, HReg );
+extern ARM64Instr* ARM64Instr_VModifyV ( ARM64VecModifyOp op, HReg mod,
+                                         HReg arg );
 extern ARM64Instr* ARM64Instr_VNarrowV ( UInt dszBlg2, HReg dst, HReg src );
 extern ARM64Instr* ARM64Instr_VShiftImmV ( ARM64VecShiftOp op,
                                            HReg dst, HReg src, UInt amt );
@@ -1078,12 +1140,14 @@ extern Int  emit_ARM64Instr        ( /*MB_MOD*/Bool* is_profInc,
                                      void* disp_cp_chain_me_to_slowEP,
                                      void* disp_cp_chain_me_to_fastEP,
                                      void* disp_cp_xindir,
+                                     void* disp_cp_xindir_miss,
                                      void* disp_cp_xassisted );
 
 extern void genSpill_ARM64  ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
                               HReg rreg, Int offset, Bool );
 extern void genReload_ARM64 ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
                               HReg rreg, Int offset, Bool );
+extern Int  peephole_ARM64Instr ( HInstr* prev, HInstr** cur, Bool );
 
 extern void getAllocableRegs_ARM64 ( Int*, HReg** );
 extern HInstrArray* iselSB_ARM64 ( IRSB*, 
@@ -1092,15 +1156,22 @@ extern HInstrArray* iselSB_ARM64 ( IRSB*,
                                    VexAbiInfo*,
                                    Int offs_Host_EvC_Counter,
                                    Int offs_Host_EvC_FailAddr,
+                                   Int offs_Host_RetStack,
                                    Bool chainingAllowed,
                                    Bool addProfInc,
-                                   Addr64 max_ga );
+                                   Addr64 max_ga,
+                                   Bool selfLoop );
 
 /* How big is an event check?  This is kind of a kludge because it
    depends on the offsets of host_EvC_FAILADDR and
    host_EvC_COUNTER. */
 extern Int evCheckSzB_ARM64 ( void );
 
+/* Move conditional exits out of line; see LibVEX_Translate. */
+extern ARM64Instr* coldExit_ARM64Instr  ( ARM64Instr* i );
+extern Int         emitColdBranch_ARM64 ( UChar* buf, Int nbuf,
+                                          ARM64Instr* i, Int delta );
+
 /* Perform a chaining and unchaining of an XDirect jump. */
 extern VexInvalRange chainXDirect_ARM64 ( void* place_to_chain,
                                           void* disp_cp_chain_me_EXPECTED,
@@ -1110,6 +1181,18 @@ extern VexInvalRange unchainXDirect_ARM64 ( void* place_to_unchain,
                                             void* place_to_jump_to_EXPECTED,
                                             void* disp_cp_chain_me );
 
+/* Populate and empty an XIndir inline cache. */
+extern VexInvalRange chainXIndir_ARM64 ( void*  place_to_chain,
+                                         void*  disp_cp_xindir_miss_EXPECTED,
+                                         Addr64 guest_addr,
+                                         void*  place_to_jump_to,
+                                         void*  disp_cp_xindir );
+
+extern VexInvalRange unchainXIndir_ARM64 ( void* place_to_unchain,
+                                           void* place_to_jump_to_EXPECTED,
+                                           void* disp_cp_xindir,
+                                           void* disp_cp_xindir_miss );
+
 //ZZ /* Patch the counter location into an existing ProfInc point. */
 //ZZ extern VexInvalRange patchProfInc_ARM ( void*  place_to_patch,
 //ZZ                                         ULong* location_of_counter );
@@ -1783,6 +1783,26 @@ static HReg iselIntExpr_R_wrk ( ISelEnv* env, IRExpr* e )
          return hi32;
       }
 
+      if ((e->Iex.Binop.op == Iop_CRC32C8
+           || e->Iex.Binop.op == Iop_CRC32C16
+           || e->Iex.Binop.op == Iop_CRC32C32
+           || e->Iex.Binop.op == Iop_CRC32C64)
+          && (env->hwcaps & VEX_HWCAPS_ARM64_CRC32)) {
+         HReg acc = iselIntExpr_R(env, e->Iex.Binop.arg1);
+         HReg src = iselIntExpr_R(env, e->Iex.Binop.arg2);
+         HReg dst = newVRegI(env);
+         Int  szB = 0;
+         switch (e->Iex.Binop.op) {
+            case Iop_CRC32C8:  szB = 1; break;
+            case Iop_CRC32C16: szB = 2; break;
+            case Iop_CRC32C32: szB = 4; break;
+            case Iop_CRC32C64: szB = 8; break;
+            default: vassert(0);
+         }
+         addInstr(env, ARM64Instr_CRC32C(dst, acc, src, szB));
+         return dst;
+      }
+
       if (e->Iex.Binop.op == Iop_CmpF64 || e->Iex.Binop.op == Iop_CmpF32) {
          Bool isD = e->Iex.Binop.op == Iop_CmpF64;
          HReg dL  = (isD ? iselDblExpr : iselFltExpr)(env, e->Iex.Binop.arg1);
@@ -4414,6 +4434,15 @@ static HReg iselV128Expr_wrk ( ISelEnv* env, IRExpr* e )
             addInstr(env, ARM64Instr_VUnaryV(op, res, arg));
             return res;
          }
+         case Iop_AESIMC128: {
+            HReg res, arg;
+            if (!(env->hwcaps & VEX_HWCAPS_ARM64_AES))
+               break;
+            res = newVRegV(env);
+            arg = iselV128Expr(env, e->Iex.Unop.arg);
+            addInstr(env, ARM64Instr_VUnaryV(ARM64vecu_AESIMC, res, arg));
+            return res;
+         }
          case Iop_CmpNEZ8x16:
          case Iop_CmpNEZ16x8:
          case Iop_CmpNEZ32x4:
@@ -4871,6 +4900,70 @@ static HReg iselV128Expr_wrk ( ISelEnv* env, IRExpr* e )
             addInstr(env, ARM64Instr_VQfromXX(res, argL, argR));
             return res;
          }
+         case Iop_AESEnc128:
+         case Iop_AESEncLast128:
+         case Iop_AESDec128:
+         case Iop_AESDecLast128: {
+            /* AESE/AESD xor the key in first and have no MixColumns
+               step, whereas the IR ops (like x86) xor it in last.  So
+               start from zero, use the state as AESE/AESD's key, do
+               the (Inv)MixColumns separately, and xor the real round
+               key in at the end. */
+            Bool isEnc, isLast;
+            HReg res, state, key;
+            if (!(env->hwcaps & VEX_HWCAPS_ARM64_AES))
+               break;
+            isEnc  = e->Iex.Binop.op == Iop_AESEnc128
+                     || e->Iex.Binop.op == Iop_AESEncLast128;
+            isLast = e->Iex.Binop.op == Iop_AESEncLast128
+                     || e->Iex.Binop.op == Iop_AESDecLast128;
+            res    = newVRegV(env);
+            state  = iselV128Expr(env, e->Iex.Binop.arg1);
+            key    = iselV128Expr(env, e->Iex.Binop.arg2);
+            addInstr(env, ARM64Instr_VImmQ(res, 0x0000));
+            addInstr(env, ARM64Instr_VModifyV(
+                             isEnc ? ARM64vecmo_AESE : ARM64vecmo_AESD,
+                             res, state));
+            if (!isLast)
+               addInstr(env, ARM64Instr_VUnaryV(
+                                isEnc ? ARM64vecu_AESMC : ARM64vecu_AESIMC,
+                                res, res));
+            addInstr(env, ARM64Instr_VBinV(ARM64vecb_XOR, res, res, key));
+            return res;
+         }
+         case Iop_PolynomialMull64: {
+            /* PMULL only reads the low lanes.  A high lane passed in
+               as InterleaveHI64x2(t,t) is moved down via an X reg,
+               since that interleave isn't otherwise available here. */
+            HReg    res, arg[2];
+            IRExpr* ea[2];
+            Int     k;
+            if (!(env->hwcaps & VEX_HWCAPS_ARM64_PMULL))
+               break;
+            ea[0] = e->Iex.Binop.arg1;
+            ea[1] = e->Iex.Binop.arg2;
+            for (k = 0; k < 2; k++) {
+               IRExpr* a = ea[k];
+               if (a->tag == Iex_Binop
+                   && a->Iex.Binop.op == Iop_InterleaveHI64x2
+                   && a->Iex.Binop.arg1->tag == Iex_RdTmp
+                   && a->Iex.Binop.arg2->tag == Iex_RdTmp
+                   && a->Iex.Binop.arg1->Iex.RdTmp.tmp
+                      == a->Iex.Binop.arg2->Iex.RdTmp.tmp) {
+                  HReg src = iselV128Expr(env, a->Iex.Binop.arg1);
+                  HReg hi  = newVRegI(env);
+                  arg[k]   = newVRegV(env);
+                  addInstr(env, ARM64Instr_VXfromQ(hi, src, 1));
+                  addInstr(env, ARM64Instr_VQfromXX(arg[k], hi, hi));
+               } else {
+                  arg[k] = iselV128Expr(env, a);
+               }
+            }
+            res = newVRegV(env);
+            addInstr(env, ARM64Instr_VBinV(ARM64vecb_PMULL64,
+                                           res, arg[0], arg[1]));
+            return res;
+         }
 //ZZ          case Iop_AndV128: {
 //ZZ             HReg res = newVRegV(env);
 //ZZ             HReg argL = iselNeonExpr(env, e->Iex.Binop.arg1);
@@ -6064,6 +6157,25 @@ static HReg iselDblExpr_wrk ( ISelEnv* env, IRExpr* e )
       }
    }
 
+   if (e->tag == Iex_Qop) {
+      IRQop*       qop   = e->Iex.Qop.details;
+      ARM64FpTriOp fmaop = ARM64fpt_INVALID;
+      switch (qop->op) {
+         case Iop_MAddF64: fmaop = ARM64fpt_FMADD; break;
+         case Iop_MSubF64: fmaop = ARM64fpt_FMSUB; break;
+         default: break;
+      }
+      if (fmaop != ARM64fpt_INVALID) {
+         HReg argN = iselDblExpr(env, qop->arg2);
+         HReg argM = iselDblExpr(env, qop->arg3);
+         HReg argA = iselDblExpr(env, qop->arg4);
+         HReg dst  = newVRegD(env);
+         set_FPCR_rounding_mode(env, qop->arg1);
+         addInstr(env, ARM64Instr_VTriD(fmaop, dst, argN, argM, argA));
+         return dst;
+      }
+   }
+
 //ZZ    if (e->tag == Iex_ITE) { // VFD
 //ZZ       if (ty == Ity_F64
 //ZZ           && typeOfIRExpr(env->type_env,e->Iex.ITE.cond) == Ity_I1) {
@@ -6239,6 +6351,25 @@ static HReg iselFltExpr_wrk ( ISelEnv* env, IRExpr* e )
       }
    }
 
+   if (e->tag == Iex_Qop) {
+      IRQop*       qop   = e->Iex.Qop.details;
+      ARM64FpTriOp fmaop = ARM64fpt_INVALID;
+      switch (qop->op) {
+         case Iop_MAddF32: fmaop = ARM64fpt_FMADD; break;
+         case Iop_MSubF32: fmaop = ARM64fpt_FMSUB; break;
+         default: break;
+      }
+      if (fmaop != ARM64fpt_INVALID) {
+         HReg argN = iselFltExpr(env, qop->arg2);
+         HReg argM = iselFltExpr(env, qop->arg3);
+         HReg argA = iselFltExpr(env, qop->arg4);
+         HReg dst  = newVRegD(env);
+         set_FPCR_rounding_mode(env, qop->arg1);
+         addInstr(env, ARM64Instr_VTriS(fmaop, dst, argN, argM, argA));
+         return dst;
+      }
+   }
+
 //ZZ 
 //ZZ    if (e->tag == Iex_ITE) { // VFD
 //ZZ       if (ty == Ity_F32
@@ -6921,9 +7052,11 @@ HInstrArray* iselSB_ARM64 ( IRSB* bb,
                             VexAbiInfo*  vbi/*UNUSED*/,
                             Int offs_Host_EvC_Counter,
                             Int offs_Host_EvC_FailAddr,
+                            Int offs_Host_RetStack,
                             Bool chainingAllowed,
                             Bool addProfInc,
-                            Addr64 max_ga )
+                            Addr64 max_ga,
+                            Bool selfLoop )
 {
    Int        i, j;
    HReg       hreg, hregHI;
@@ -6933,6 +7066,7 @@ HInstrArray* iselSB_ARM64 ( IRSB* bb,
 
    /* sanity ... */
    vassert(arch_host == VexArchARM64);
+   vassert(!selfLoop);
 
    /* guard against unexpected space regressions */
    vassert(sizeof(ARM64Instr) <= 32);
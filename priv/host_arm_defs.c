@@ -41,7 +41,7 @@
 #include "host_generic_regs.h"
 #include "host_arm_defs.h"
 
-UInt arm_hwcaps = 0;
+VEX_TLS UInt arm_hwcaps = 0;
 
 
 /* --------- Registers. --------- */
@@ -2975,6 +2975,7 @@ Int emit_ARMInstr ( /*MB_MOD*/Bool* is_profInc,
                     void* disp_cp_chain_me_to_slowEP,
                     void* disp_cp_chain_me_to_fastEP,
                     void* disp_cp_xindir,
+                    void* disp_cp_xindir_miss,
                     void* disp_cp_xassisted )
 {
    UInt* p = (UInt*)buf;
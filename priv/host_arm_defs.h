@@ -34,7 +34,7 @@
 #include "libvex.h"                      // VexArch
 #include "host_generic_regs.h"           // HReg
 
-extern UInt arm_hwcaps;
+extern VEX_TLS UInt arm_hwcaps;
 
 
 /* --------- Registers. --------- */
@@ -1030,6 +1030,7 @@ extern Int  emit_ARMInstr        ( /*MB_MOD*/Bool* is_profInc,
                                    void* disp_cp_chain_me_to_slowEP,
                                    void* disp_cp_chain_me_to_fastEP,
                                    void* disp_cp_xindir,
+                                   void* disp_cp_xindir_miss,
                                    void* disp_cp_xassisted );
 
 extern void genSpill_ARM  ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
@@ -1044,9 +1045,11 @@ extern HInstrArray* iselSB_ARM   ( IRSB*,
                                    VexAbiInfo*,
                                    Int offs_Host_EvC_Counter,
                                    Int offs_Host_EvC_FailAddr,
+                                   Int offs_Host_RetStack,
                                    Bool chainingAllowed,
                                    Bool addProfInc,
-                                   Addr64 max_ga );
+                                   Addr64 max_ga,
+                                   Bool selfLoop );
 
 /* How big is an event check?  This is kind of a kludge because it
    depends on the offsets of host_EvC_FAILADDR and
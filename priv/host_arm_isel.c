@@ -6318,9 +6318,11 @@ HInstrArray* iselSB_ARM ( IRSB* bb,
                           VexAbiInfo*  vbi/*UNUSED*/,
                           Int offs_Host_EvC_Counter,
                           Int offs_Host_EvC_FailAddr,
+                          Int offs_Host_RetStack,
                           Bool chainingAllowed,
                           Bool addProfInc,
-                          Addr64 max_ga )
+                          Addr64 max_ga,
+                          Bool selfLoop )
 {
    Int       i, j;
    HReg      hreg, hregHI;
@@ -6330,6 +6332,7 @@ HInstrArray* iselSB_ARM ( IRSB* bb,
 
    /* sanity ... */
    vassert(arch_host == VexArchARM);
+   vassert(!selfLoop);
 
    /* guard against unexpected space regressions */
    vassert(sizeof(ARMInstr) <= 28);
@@ -39,38 +39,14 @@
    See a paper by Boldo and Melquiond:
    http://www.lri.fr/~melquion/doc/08-tc.pdf  */
 
-#define FORCE_EVAL(X) __asm __volatile__ ("" : : "m" (X))
-
-#if defined(__x86_64__) && defined(__SSE2_MATH__)
-# define ENV_TYPE unsigned int
-/* Save current rounding mode into ENV, hold exceptions, set rounding
-   mode to rounding toward zero.  */
-# define ROUNDTOZERO(env) \
-   do {							\
-      unsigned int mxcsr;				\
-      __asm __volatile__ ("stmxcsr %0" : "=m" (mxcsr));	\
-      (env) = mxcsr;					\
-      mxcsr = (mxcsr | 0x7f80) & ~0x3f;			\
-      __asm __volatile__ ("ldmxcsr %0" : : "m" (mxcsr));\
-   } while (0)
-/* Restore exceptions from ENV, return if inexact exception has been raised
-   since ROUNDTOZERO.  */
-# define RESET_TESTINEXACT(env) \
-   ({							\
-      unsigned int mxcsr, ret;				\
-      __asm __volatile__ ("stmxcsr %0" : "=m" (mxcsr));	\
-      ret = (mxcsr >> 5) & 1;				\
-      mxcsr = (mxcsr & 0x3d) | (env);			\
-      __asm __volatile__ ("ldmxcsr %0" : : "m" (mxcsr));\
-      ret;						\
-   })
-/* Return if inexact exception has been raised since ROUNDTOZERO.  */
-# define TESTINEXACT() \
-   ({							\
-      unsigned int mxcsr;				\
-      __asm __volatile__ ("stmxcsr %0" : "=m" (mxcsr));	\
-      (mxcsr >> 5) & 1;					\
-   })
+/* Rounding to odd is done below by adding in round-to-nearest and
+   then fixing up the last bit using the exact rounding error, which
+   Knuth's two-sum gives.  That avoids changing the host's rounding
+   mode and reading its inexact flag, which the glibc original did
+   around every call.  It needs Double arithmetic to be done in
+   Double, without the excess precision of the x87. */
+#if defined(__FLT_EVAL_METHOD__) && __FLT_EVAL_METHOD__ == 0
+# define MADDF_EXACT 1
 #endif
 
 #define DBL_MANT_DIG 53
@@ -78,6 +54,7 @@
 
 union vg_ieee754_double {
    Double d;
+   ULong  w;
 
    /* This is the IEEE 754 double-precision format.  */
    struct {
@@ -95,28 +72,105 @@ union vg_ieee754_double {
    } ieee;
 };
 
+#ifdef MADDF_EXACT
+/* The two-sum and Dekker steps are only exact when rounding to
+   nearest, but the last rounding has to be done in the caller's
+   rounding mode.  Generated code always calls these helpers with the
+   host rounding to nearest, so normally nothing needs doing.  On x86
+   and amd64 hosts, where Double arithmetic is done in SSE, MXCSR is
+   switched to nearest for the exact steps if it is set otherwise.
+   Other hosts are assumed to be rounding to nearest.
+
+   PIN(d) keeps d from being computed on the other side of a switch,
+   and stops the compiler reusing a sum or product of it from there.
+   It is applied to inputs just after a switch and to results just
+   before one. */
+#if defined(__x86_64__) || defined(__i386__)
+#define MXCSR_RC 0x6000
+
+static inline UInt round_nearest ( void )
+{
+   UInt csr, csr_rn;
+   __asm__ __volatile__ ("stmxcsr %0" : "=m"(csr));
+   if (UNLIKELY (csr & MXCSR_RC)) {
+      csr_rn = csr & ~MXCSR_RC;
+      __asm__ __volatile__ ("ldmxcsr %0" : : "m"(csr_rn));
+   }
+   return csr;
+}
+
+static inline void round_restore ( UInt csr )
+{
+   if (UNLIKELY (csr & MXCSR_RC))
+      __asm__ __volatile__ ("ldmxcsr %0" : : "m"(csr));
+}
+
+#define PIN(d) __asm__ __volatile__ ("" : "+x"(d))
+#else
+static inline UInt round_nearest ( void )
+{
+   return 0;
+}
+
+static inline void round_restore ( UInt csr )
+{
+}
+
+#define PIN(d) do { } while (0)
+#endif
+
+/* Return a + b rounded toward zero, and set *inexact to whether that
+   lost anything.  a + b must not overflow. */
+static inline Double add_toward_zero ( Double a, Double b,
+                                       /*OUT*/Int* inexact )
+{
+   union vg_ieee754_double u;
+   Double bb, err;
+   u.d = a + b;
+   if (u.ieee.exponent == 0x7ff) {
+      *inexact = 0;
+      return u.d;
+   }
+   bb  = u.d - a;
+   err = (a - (u.d - bb)) + (b - bb);
+   PIN(err);
+   *inexact = err != 0;
+   /* A nonzero error means u.d is nonzero too.  Step u.d back
+      towards zero if the rounding went away from it. */
+   if (err != 0 && (err < 0) != (u.d < 0))
+      u.w--;
+   return u.d;
+}
+#endif
+
 void VEX_REGPARM(3)
      h_generic_calc_MAddF32 ( /*OUT*/Float* res,
                                Float* argX, Float* argY, Float* argZ )
 {
-#ifndef ENV_TYPE
+#ifndef MADDF_EXACT
    /* Lame fallback implementation.  */
    *res = *argX * *argY + *argZ;
 #else
-   ENV_TYPE env;
    /* Multiplication is always exact.  */
    Double temp = (Double) *argX * (Double) *argY;
+   Double z = (Double) *argZ;
    union vg_ieee754_double u;
-
-   ROUNDTOZERO (env);
+   Int j;
+   UInt rm = round_nearest ();
+   PIN(temp);
+   PIN(z);
 
    /* Perform addition with round to odd.  */
-   u.d = temp + (Double) *argZ;
-   /* Ensure the addition is not scheduled after fetestexcept call.  */
-   FORCE_EVAL (u.d);
+   u.d = add_toward_zero (temp, z, &j);
+   round_restore (rm);
 
-   /* Reset rounding mode and test for inexact simultaneously.  */
-   int j = RESET_TESTINEXACT (env);
+   /* An exact zero takes its sign from the caller's rounding mode. */
+   if (u.d == 0 && j == 0) {
+      PIN(temp);
+      PIN(z);
+      *res = (Float) (temp + z);
+      return;
+   }
 
    if ((u.ieee.mantissa1 & 1) == 0 && u.ieee.exponent != 0x7ff)
       u.ieee.mantissa1 |= j;
@@ -131,13 +185,14 @@ void VEX_REGPARM(3)
      h_generic_calc_MAddF64 ( /*OUT*/Double* res,
                                Double* argX, Double* argY, Double* argZ )
 {
-#ifndef ENV_TYPE
+#ifndef MADDF_EXACT
    /* Lame fallback implementation.  */
    *res = *argX * *argY + *argZ;
 #else
    Double x = *argX, y = *argY, z = *argZ;
    union vg_ieee754_double u, v, w;
    int adjust = 0;
+   UInt rm;
    u.d = x;
    v.d = y;
    w.d = z;
@@ -156,18 +211,46 @@ void VEX_REGPARM(3)
          *res = (z + x) + y;
          return;
       }
-      /* If x or y or z is Inf/NaN, or if fma will certainly overflow,
-         or if x * y is less than half of DBL_DENORM_MIN,
-         compute as x * y + z.  */
+      /* If z is zero and x and y are nonzero, compute the result
+         as x * y to avoid the wrong sign of a zero result if x * y
+         underflows to 0.  */
+      if (z == 0 && x != 0 && y != 0) {
+         *res = x * y;
+         return;
+      }
+      /* If x or y or z is Inf/NaN, or if x * y is zero, compute as
+         x * y + z.  */
       if (u.ieee.exponent == 0x7ff
           || v.ieee.exponent == 0x7ff
           || w.ieee.exponent == 0x7ff
-          || u.ieee.exponent + v.ieee.exponent > 0x7ff + IEEE754_DOUBLE_BIAS
-          || u.ieee.exponent + v.ieee.exponent
-             < IEEE754_DOUBLE_BIAS - DBL_MANT_DIG - 2) {
+          || x == 0
+          || y == 0) {
          *res = x * y + z;
          return;
       }
+      /* If fma will certainly overflow, compute as x * y, which
+         overflows in the same direction.  */
+      if (u.ieee.exponent + v.ieee.exponent > 0x7ff + IEEE754_DOUBLE_BIAS) {
+         *res = x * y;
+         return;
+      }
+      /* If x * y is less than 1/4 of DBL_TRUE_MIN, the result only
+         depends on its sign.  */
+      if (u.ieee.exponent + v.ieee.exponent
+          < IEEE754_DOUBLE_BIAS - DBL_MANT_DIG - 2) {
+         Double tiny = (u.ieee.negative ^ v.ieee.negative)
+                       ? -0x1p-1074 : 0x1p-1074;
+         if (w.ieee.exponent >= 3) {
+            *res = tiny + z;
+            return;
+         }
+         /* Scaling up, adding tiny and scaling down gives the right
+            result: to nearest, adding tiny does nothing, and in the
+            other modes the double rounding is harmless.  */
+         v.d = z * 0x1p54 + tiny;
+         *res = v.d * 0x1p-54;
+         return;
+      }
       if (u.ieee.exponent + v.ieee.exponent
           >= 0x7ff + IEEE754_DOUBLE_BIAS - DBL_MANT_DIG) {
          /* Compute 1p-53 times smaller result and multiply
@@ -184,8 +267,16 @@ void VEX_REGPARM(3)
       } else if (w.ieee.exponent >= 0x7ff - DBL_MANT_DIG) {
          /* Similarly.
             If z exponent is very large and x and y exponents are
-            very small, it doesn't matter if we don't adjust it.  */
-         if (u.ieee.exponent > v.ieee.exponent) {
+            very small, adjust them up rather than down, so that
+            x * y does not underflow: when not rounding to nearest,
+            its sign still matters.  */
+         if (u.ieee.exponent + v.ieee.exponent
+             <= IEEE754_DOUBLE_BIAS + 2 * DBL_MANT_DIG) {
+            if (u.ieee.exponent > v.ieee.exponent)
+               u.ieee.exponent += 2 * DBL_MANT_DIG + 2;
+            else
+               v.ieee.exponent += 2 * DBL_MANT_DIG + 2;
+         } else if (u.ieee.exponent > v.ieee.exponent) {
             if (u.ieee.exponent > DBL_MANT_DIG)
                u.ieee.exponent -= DBL_MANT_DIG;
          } else if (v.ieee.exponent > DBL_MANT_DIG)
@@ -207,14 +298,14 @@ void VEX_REGPARM(3)
       } else /* if (u.ieee.exponent + v.ieee.exponent
                     <= IEEE754_DOUBLE_BIAS + DBL_MANT_DIG) */ {
          if (u.ieee.exponent > v.ieee.exponent)
-            u.ieee.exponent += 2 * DBL_MANT_DIG;
+            u.ieee.exponent += 2 * DBL_MANT_DIG + 2;
          else
-            v.ieee.exponent += 2 * DBL_MANT_DIG;
-         if (w.ieee.exponent <= 4 * DBL_MANT_DIG + 4) {
+            v.ieee.exponent += 2 * DBL_MANT_DIG + 2;
+         if (w.ieee.exponent <= 4 * DBL_MANT_DIG + 6) {
             if (w.ieee.exponent)
-               w.ieee.exponent += 2 * DBL_MANT_DIG;
+               w.ieee.exponent += 2 * DBL_MANT_DIG + 2;
             else
-               w.d *= 0x1p106;
+               w.d *= 0x1p108;
             adjust = -1;
          }
          /* Otherwise x * y should just affect inexact
@@ -224,6 +315,11 @@ void VEX_REGPARM(3)
       y = v.d;
       z = w.d;
    }
+   rm = round_nearest ();
+   PIN(x);
+   PIN(y);
+   PIN(z);
+
    /* Multiplication m1 + m2 = x * y using Dekker's algorithm.  */
 #  define C ((1 << (DBL_MANT_DIG + 1) / 2) + 1)
    Double x1 = x * C;
@@ -244,22 +340,30 @@ void VEX_REGPARM(3)
    t2 = z - t2;
    Double a2 = t1 + t2;
 
-   ENV_TYPE env;
-   ROUNDTOZERO (env);
+   /* If the result is an exact zero, its sign depends on the caller's
+      rounding mode.  */
+   if (UNLIKELY (a1 == 0 && m2 == 0)) {
+      round_restore (rm);
+      PIN(z);
+      PIN(m1);
+      *res = z + m1;
+      return;
+   }
 
    /* Perform m2 + a2 addition with round to odd.  */
-   u.d = a2 + m2;
+   Int j;
+   u.d = add_toward_zero (a2, m2, &j);
 
    if (UNLIKELY (adjust < 0)) {
+      Int j2;
       if ((u.ieee.mantissa1 & 1) == 0)
-         u.ieee.mantissa1 |= TESTINEXACT ();
-      v.d = a1 + u.d;
-      /* Ensure the addition is not scheduled after fetestexcept call.  */
-      FORCE_EVAL (v.d);
+         u.ieee.mantissa1 |= j;
+      v.d = add_toward_zero (a1, u.d, &j2);
+      j |= j2;
    }
-
-   /* Reset rounding mode and test for inexact simultaneously.  */
-   int j = RESET_TESTINEXACT (env) != 0;
+   round_restore (rm);
+   PIN(a1);
+   PIN(u.d);
 
    if (LIKELY (adjust == 0)) {
       if ((u.ieee.mantissa1 & 1) == 0 && u.ieee.exponent != 0x7ff)
@@ -275,41 +379,38 @@ void VEX_REGPARM(3)
       /* If a1 + u.d is exact, the only rounding happens during
          scaling down.  */
       if (j == 0) {
-         *res = v.d * 0x1p-106;
+         *res = v.d * 0x1p-108;
          return;
       }
       /* If result rounded to zero is not subnormal, no double
          rounding will occur.  */
-      if (v.ieee.exponent > 106) {
-         *res = (a1 + u.d) * 0x1p-106;
+      if (v.ieee.exponent > 108) {
+         *res = (a1 + u.d) * 0x1p-108;
          return;
       }
-      /* If v.d * 0x1p-106 with round to zero is a subnormal above
-         or equal to DBL_MIN / 2, then v.d * 0x1p-106 shifts mantissa
+      /* If v.d * 0x1p-108 with round to zero is a subnormal above
+         or equal to DBL_MIN / 2, then v.d * 0x1p-108 shifts mantissa
          down just by 1 bit, which means v.ieee.mantissa1 |= j would
          change the round bit, not sticky or guard bit.
-         v.d * 0x1p-106 never normalizes by shifting up,
+         v.d * 0x1p-108 never normalizes by shifting up,
          so round bit plus sticky bit should be already enough
          for proper rounding.  */
-      if (v.ieee.exponent == 106) {
+      if (v.ieee.exponent == 108) {
          /* v.ieee.mantissa1 & 2 is LSB bit of the result before rounding,
             v.ieee.mantissa1 & 1 is the round bit and j is our sticky
-            bit.  In round-to-nearest 001 rounds down like 00,
-            011 rounds up, even though 01 rounds down (thus we need
-            to adjust), 101 rounds down like 10 and 111 rounds up
-            like 11.  */
-         if ((v.ieee.mantissa1 & 3) == 1) {
-            v.d *= 0x1p-106;
-            if (v.ieee.negative)
-               *res = v.d - 0x1p-1074;
-            else
-               *res = v.d + 0x1p-1074;
-         } else
-            *res = v.d * 0x1p-106;
+            bit.  Put the three of them in w, below v's last bit, so
+            that adding it rounds correctly in any mode.  */
+         w.d = 0.0;
+         w.ieee.mantissa1 = ((v.ieee.mantissa1 & 3) << 1) | j;
+         w.ieee.negative = v.ieee.negative;
+         v.ieee.mantissa1 &= ~3U;
+         v.d *= 0x1p-108;
+         w.d *= 0x1p-2;
+         *res = v.d + w.d;
          return;
       }
       v.ieee.mantissa1 |= j;
-      *res = v.d * 0x1p-106;
+      *res = v.d * 0x1p-108;
       return;
     }
 #endif
@@ -208,7 +208,7 @@ Int findMostDistantlyMentionedVReg (
 static inline void sanity_check_spill_offset ( VRegLR* vreg )
 {
    switch (vreg->reg_class) {
-      case HRcVec128: case HRcFlt64:
+      case HRcVec256: case HRcVec128: case HRcFlt64:
          vassert(0 == ((UShort)vreg->spill_offset % 16)); break;
       default:
          vassert(0 == ((UShort)vreg->spill_offset % 8)); break;
@@ -855,6 +855,26 @@ HInstrArray* doRegisterAllocation (
             ss_busy_until_before[k+1] = vreg_lrs[j].dead_before;
             break;
 
+         case HRcVec256:
+            /* Same deal, but with four adjacent slots, starting at a
+               multiple of 4.  The host spills these with unaligned
+               moves, so 16-alignment of the whole area suffices. */
+            for (k = 0; k < N_SPILL64S-3; k += 4)
+               if (ss_busy_until_before[k+0] <= vreg_lrs[j].live_after
+                   && ss_busy_until_before[k+1] <= vreg_lrs[j].live_after
+                   && ss_busy_until_before[k+2] <= vreg_lrs[j].live_after
+                   && ss_busy_until_before[k+3] <= vreg_lrs[j].live_after)
+                  break;
+            if (k >= N_SPILL64S-3) {
+               vpanic("LibVEX_N_SPILL_BYTES is too low.  " 
+                      "Increase and recompile.");
+            }
+            ss_busy_until_before[k+0] = vreg_lrs[j].dead_before;
+            ss_busy_until_before[k+1] = vreg_lrs[j].dead_before;
+            ss_busy_until_before[k+2] = vreg_lrs[j].dead_before;
+            ss_busy_until_before[k+3] = vreg_lrs[j].dead_before;
+            break;
+
          default:
             /* The ordinary case -- just find a single spill slot. */
             /* Find the lowest-numbered spill slot which is available
@@ -1162,6 +1182,7 @@ HInstrArray* doRegisterAllocation (
                   (*genSpill)( &spill1, &spill2, rreg_state[k].rreg,
                                vreg_lrs[m].spill_offset, mode64 );
                   vassert(spill1 || spill2); /* can't both be NULL */
+                  vex_tstats->n_spills++;
                   if (spill1)
                      EMIT_INSTR(spill1);
                   if (spill2)
@@ -1251,6 +1272,7 @@ HInstrArray* doRegisterAllocation (
                ppInstr(instrs_in->arr[ii], mode64); 
             }
             if (reloaded) {
+               vex_tstats->n_direct_reloads++;
                /* Update info about the insn, so it looks as if it had
                   been in this form all along. */
                instrs_in->arr[ii] = reloaded;
@@ -1343,6 +1365,7 @@ HInstrArray* doRegisterAllocation (
                (*genReload)( &reload1, &reload2, rreg_state[k].rreg,
                              vreg_lrs[m].spill_offset, mode64 );
                vassert(reload1 || reload2); /* can't both be NULL */
+               vex_tstats->n_reloads++;
                if (reload1)
                   EMIT_INSTR(reload1);
                if (reload2)
@@ -1426,6 +1449,7 @@ HInstrArray* doRegisterAllocation (
             (*genSpill)( &spill1, &spill2, rreg_state[spillee].rreg,
                          vreg_lrs[m].spill_offset, mode64 );
             vassert(spill1 || spill2); /* can't both be NULL */
+            vex_tstats->n_spills++;
             if (spill1)
                EMIT_INSTR(spill1);
             if (spill2)
@@ -1452,6 +1476,7 @@ HInstrArray* doRegisterAllocation (
             (*genReload)( &reload1, &reload2, rreg_state[spillee].rreg,
                           vreg_lrs[m].spill_offset, mode64 );
             vassert(reload1 || reload2); /* can't both be NULL */
+            vex_tstats->n_reloads++;
             if (reload1)
                EMIT_INSTR(reload1);
             if (reload2)
@@ -49,6 +49,7 @@ void ppHRegClass ( HRegClass hrc )
       case HRcFlt64:   vex_printf("HRcFlt64"); break;
       case HRcVec64:   vex_printf("HRcVec64"); break;
       case HRcVec128:  vex_printf("HRcVec128"); break;
+      case HRcVec256:  vex_printf("HRcVec256"); break;
       default: vpanic("ppHRegClass");
    }
 }
@@ -65,6 +66,7 @@ void ppHReg ( HReg r )
       case HRcFlt64:   vex_printf("%%%sD%d", maybe_v, regNo); return;
       case HRcVec64:   vex_printf("%%%sv%d", maybe_v, regNo); return;
       case HRcVec128:  vex_printf("%%%sV%d", maybe_v, regNo); return;
+      case HRcVec256:  vex_printf("%%%sY%d", maybe_v, regNo); return;
       default: vpanic("ppHReg");
    }
 }
@@ -218,6 +220,38 @@ void addHInstr ( HInstrArray* ha, HInstr* instr )
 }
 
 
+/*---------------------------------------------------------*/
+/*--- Peephole optimisation                             ---*/
+/*---------------------------------------------------------*/
+
+void doPeephole ( HInstrArray* code,
+                  Int (*peep) ( HInstr*, HInstr**, Bool ),
+                  Bool mode64 )
+{
+   Int     i, n, rule;
+   HInstr* cur;
+   HInstr* prev;
+   n = 0;
+   for (i = 0; i < code->arr_used; i++) {
+      cur = code->arr[i];
+      /* A rewritten instruction may let another rule fire, so keep
+         going until none does.  Each firing either deletes cur or
+         makes it simpler, so this terminates. */
+      while (cur != NULL) {
+         prev = n > 0 ? code->arr[n-1] : NULL;
+         rule = peep(prev, &cur, mode64);
+         if (rule == VexPeep_N)
+            break;
+         vassert(rule >= 0 && rule < VexPeep_N);
+         vex_tstats->n_peephole[rule]++;
+      }
+      if (cur != NULL)
+         code->arr[n++] = cur;
+   }
+   code->arr_used = n;
+}
+
+
 /*---------------------------------------------------------*/
 /*--- C-Call return-location actions                    ---*/
 /*---------------------------------------------------------*/
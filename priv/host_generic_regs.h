@@ -37,6 +37,7 @@
 #define __VEX_HOST_GENERIC_REGS_H
 
 #include "libvex_basictypes.h"
+#include "libvex.h"
 
 
 /*---------------------------------------------------------*/
@@ -91,6 +92,7 @@ typedef
                              so won't fit in a 64-bit slot)
       HRcVec64     64 bits
       HRcVec128    128 bits
+      HRcVec256    256 bits
 
    If you add another regclass, you must remember to update
    host_generic_reg_alloc2.c accordingly.
@@ -103,7 +105,8 @@ typedef
       HRcFlt32=5,     /* 32-bit float */
       HRcFlt64=6,     /* 64-bit float */
       HRcVec64=7,     /* 64-bit SIMD */
-      HRcVec128=8     /* 128-bit SIMD */
+      HRcVec128=8,    /* 128-bit SIMD */
+      HRcVec256=9     /* 256-bit SIMD */
    }
    HRegClass;
 
@@ -128,7 +131,7 @@ static inline HReg mkHReg ( UInt regno, HRegClass rc, Bool virtual ) {
 static inline HRegClass hregClass ( HReg r ) {
    UInt rc = r.reg;
    rc = (rc >> 28) & 0x0F;
-   vassert(rc >= HRcInt32 && rc <= HRcVec128);
+   vassert(rc >= HRcInt32 && rc <= HRcVec256);
    return (HRegClass)rc;
 }
 
@@ -244,6 +247,16 @@ typedef
 extern HInstrArray* newHInstrArray ( void );
 extern void         addHInstr ( HInstrArray*, HInstr* );
 
+/* Run a host's peephole rules over register-allocated code, in
+   place.  peep is given each instruction in turn, along with the
+   last one kept before it (NULL at the start).  It returns the
+   VexPeepholeRule that fired, having replaced the instruction (with
+   NULL, to delete it), or VexPeep_N if none did. */
+extern void doPeephole ( HInstrArray* code,
+                         Int (*peep) ( HInstr* prev, HInstr** cur,
+                                       Bool mode64 ),
+                         Bool mode64 );
+
 
 /*---------------------------------------------------------*/
 /*--- C-Call return-location descriptions               ---*/
@@ -309,6 +322,47 @@ static inline Bool is_RetLoc_INVALID ( RetLoc rl ) {
 }
 
 
+/*---------------------------------------------------------*/
+/*--- Relocations                                       ---*/
+/*---------------------------------------------------------*/
+
+/* A host address in generated code which depends on where things are
+   loaded: a helper function the code calls, or one of the dispatcher
+   entry points it was given.  The translation cache takes these out
+   of the code it stores and puts the current ones back when it hands
+   the code out again, in another process. */
+
+typedef
+   enum {
+      HReloc_Helper=0x70,   /* a helper function */
+      HReloc_ChainMeSlow,   /* disp_cp_chain_me_to_slowEP, at a chain site */
+      HReloc_ChainMeFast,   /* disp_cp_chain_me_to_fastEP, at a chain site */
+      HReloc_XIndir,        /* disp_cp_xindir */
+      HReloc_XIndirMiss,    /* disp_cp_xindir_miss */
+      HReloc_XAssisted      /* disp_cp_xassisted */
+   }
+   HRelocKind;
+
+typedef
+   struct {
+      Int   offs;  /* of the address, from the start of the code */
+      UChar kind;  /* an HRelocKind */
+      UChar szB;   /* 8, or 4 for an address sign-extended from 32 bits */
+      UChar back;  /* ChainMe kinds: the chain site starts this many
+                      bytes before offs */
+   }
+   HReloc;
+
+/* As LibVEX_Translate, and also write the relocations in the code made
+   to relocs[0 .. *n_relocs-1].  *n_relocs is set to -1 if there are
+   more than relocs_size, or if the host can't say where they are
+   (only amd64 hosts can). */
+extern VexTranslateResult vexTranslateRelocs ( VexTranslateArgs* vta,
+                                               HReloc* relocs,
+                                               Int relocs_size,
+                                               /*OUT*/Int* n_relocs );
+
+
 /*---------------------------------------------------------*/
 /*--- Reg alloc: TODO: move somewhere else              ---*/
 /*---------------------------------------------------------*/
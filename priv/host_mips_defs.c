@@ -2845,6 +2845,7 @@ Int emit_MIPSInstr ( /*MB_MOD*/Bool* is_profInc,
                      void* disp_cp_chain_me_to_slowEP,
                      void* disp_cp_chain_me_to_fastEP,
                      void* disp_cp_xindir,
+                     void* disp_cp_xindir_miss,
                      void* disp_cp_xassisted )
 {
    UChar *p = &buf[0];
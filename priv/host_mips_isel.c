@@ -50,10 +50,10 @@
    SP          StackFramePointer
    RA          LinkRegister */
 
-static Bool mode64 = False;
+static VEX_TLS Bool mode64 = False;
 
 /* Host CPU has FPU and 32 dbl. prec. FP registers. */
-static Bool fp_mode64 = False;
+static VEX_TLS Bool fp_mode64 = False;
 
 /* GPR register class for mips32/64 */
 #define HRcGPR(__mode64) (__mode64 ? HRcInt64 : HRcInt32)
@@ -4134,9 +4134,11 @@ HInstrArray *iselSB_MIPS ( IRSB* bb,
                            VexAbiInfo* vbi,
                            Int offs_Host_EvC_Counter,
                            Int offs_Host_EvC_FailAddr,
+                           Int offs_Host_RetStack,
                            Bool chainingAllowed,
                            Bool addProfInc,
-                           Addr64 max_ga )
+                           Addr64 max_ga,
+                           Bool selfLoop )
 {
    Int      i, j;
    HReg     hreg, hregHI;
@@ -4146,6 +4148,7 @@ HInstrArray *iselSB_MIPS ( IRSB* bb,
 
    /* sanity ... */
    vassert(arch_host == VexArchMIPS32 || arch_host == VexArchMIPS64);
+   vassert(!selfLoop);
    vassert(VEX_PRID_COMP_MIPS == hwcaps_host
            || VEX_PRID_COMP_BROADCOM == hwcaps_host
            || VEX_PRID_COMP_NETLOGIC);
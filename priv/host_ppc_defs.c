@@ -3724,6 +3724,7 @@ Int emit_PPCInstr ( /*MB_MOD*/Bool* is_profInc,
                     void* disp_cp_chain_me_to_slowEP,
                     void* disp_cp_chain_me_to_fastEP,
                     void* disp_cp_xindir,
+                    void* disp_cp_xindir_miss,
                     void* disp_cp_xassisted )
 {
    UChar* p = &buf[0];
@@ -1141,6 +1141,7 @@ extern Int          emit_PPCInstr        ( /*MB_MOD*/Bool* is_profInc,
                                            void* disp_cp_chain_me_to_slowEP,
                                            void* disp_cp_chain_me_to_fastEP,
                                            void* disp_cp_xindir,
+                                           void* disp_cp_xindir_miss,
                                            void* disp_cp_xassisted );
 
 extern void genSpill_PPC  ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
@@ -1155,9 +1156,11 @@ extern HInstrArray* iselSB_PPC           ( IRSB*,
                                            VexAbiInfo*,
                                            Int offs_Host_EvC_Counter,
                                            Int offs_Host_EvC_FailAddr,
+                                           Int offs_Host_RetStack,
                                            Bool chainingAllowed,
                                            Bool addProfInc,
-                                           Addr64 max_ga );
+                                           Addr64 max_ga,
+                                           Bool selfLoop );
 
 /* How big is an event check?  This is kind of a kludge because it
    depends on the offsets of host_EvC_FAILADDR and
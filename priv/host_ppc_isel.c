@@ -5877,9 +5877,11 @@ HInstrArray* iselSB_PPC ( IRSB* bb,
                           VexAbiInfo*  vbi,
                           Int offs_Host_EvC_Counter,
                           Int offs_Host_EvC_FailAddr,
+                          Int offs_Host_RetStack,
                           Bool chainingAllowed,
                           Bool addProfInc,
-                          Addr64 max_ga )
+                          Addr64 max_ga,
+                          Bool selfLoop )
 {
    Int       i, j;
    HReg      hregLo, hregMedLo, hregMedHi, hregHi;
@@ -5891,6 +5893,7 @@ HInstrArray* iselSB_PPC ( IRSB* bb,
 
 
    vassert(arch_host == VexArchPPC32 || arch_host == VexArchPPC64);
+   vassert(!selfLoop);
    mode64 = arch_host == VexArchPPC64;
    if (!mode64) vassert(max_ga <= 0xFFFFFFFFULL);
 
@@ -50,7 +50,7 @@
    Until then, we use a global variable. This variable is set as a side
    effect of iselSB_S390. This is safe because instructions are selected
    before they are emitted. */
-UInt s390_host_hwcaps;
+VEX_TLS UInt s390_host_hwcaps;
 
 
 /*------------------------------------------------------------*/
@@ -71,7 +71,7 @@ static UInt s390_tchain_load64_len(void);
 const HChar *
 s390_hreg_as_string(HReg reg)
 {
-   static HChar buf[10];
+   static VEX_TLS HChar buf[10];
 
    static const HChar ireg_names[16][5] = {
       "%r0",  "%r1",  "%r2",  "%r3",  "%r4",  "%r5",  "%r6",  "%r7",
@@ -295,7 +295,7 @@ s390_amode_for_guest_state(Int offset)
 const HChar *
 s390_amode_as_string(const s390_amode *am)
 {
-   static HChar buf[30];
+   static VEX_TLS HChar buf[30];
    HChar *p;
 
    buf[0] = '\0';
@@ -6593,7 +6593,7 @@ s390_sprintf(HChar *buf, const HChar *fmt, ...)
 const HChar *
 s390_insn_as_string(const s390_insn *insn)
 {
-   static HChar buf[300];
+   static VEX_TLS HChar buf[300];
    const HChar *op;
    HChar *p;
 
@@ -9898,7 +9898,7 @@ Int
 emit_S390Instr(Bool *is_profinc, UChar *buf, Int nbuf, s390_insn *insn,
                Bool mode64, void *disp_cp_chain_me_to_slowEP,
                void *disp_cp_chain_me_to_fastEP, void *disp_cp_xindir,
-               void *disp_cp_xassisted)
+               void *disp_cp_xindir_miss, void *disp_cp_xassisted)
 {
    UChar *end;
 
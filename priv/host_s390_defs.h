@@ -736,13 +736,13 @@ void  getRegUsage_S390Instr( HRegUsage *, s390_insn *, Bool );
 void  mapRegs_S390Instr    ( HRegRemap *, s390_insn *, Bool );
 Bool  isMove_S390Instr     ( s390_insn *, HReg *, HReg * );
 Int   emit_S390Instr       ( Bool *, UChar *, Int, s390_insn *, Bool,
-                             void *, void *, void *, void *);
+                             void *, void *, void *, void *, void *);
 void  getAllocableRegs_S390( Int *, HReg **, Bool );
 void  genSpill_S390        ( HInstr **, HInstr **, HReg , Int , Bool );
 void  genReload_S390       ( HInstr **, HInstr **, HReg , Int , Bool );
 s390_insn *directReload_S390 ( s390_insn *, HReg, Short );
 HInstrArray *iselSB_S390   ( IRSB *, VexArch, VexArchInfo *, VexAbiInfo *,
-                             Int, Int, Bool, Bool, Addr64);
+                             Int, Int, Int, Bool, Bool, Addr64, Bool);
 
 /* Return the number of bytes of code needed for an event check */
 Int evCheckSzB_S390(void);
@@ -761,7 +761,7 @@ VexInvalRange patchProfInc_S390(void  *code_to_patch,
                                 ULong *location_of_counter);
 
 /* KLUDGE: See detailled comment in host_s390_defs.c. */
-extern UInt s390_host_hwcaps;
+extern VEX_TLS UInt s390_host_hwcaps;
 
 /* Convenience macros to test installed facilities */
 #define s390_host_has_ldisp \
@@ -1536,8 +1536,8 @@ s390_isel_int_expr_wrk(ISelEnv *env, IRExpr *expr)
 
       /* --------- UNARY OP --------- */
    case Iex_Unop: {
-      static s390_opnd_RMI mask  = { S390_OPND_IMMEDIATE };
-      static s390_opnd_RMI shift = { S390_OPND_IMMEDIATE };
+      static VEX_TLS s390_opnd_RMI mask  = { S390_OPND_IMMEDIATE };
+      static VEX_TLS s390_opnd_RMI shift = { S390_OPND_IMMEDIATE };
       s390_opnd_RMI opnd;
       s390_insn    *insn;
       IRExpr *arg;
@@ -4080,8 +4080,9 @@ iselNext(ISelEnv *env, IRExpr *next, IRJumpKind jk, Int offsIP)
 HInstrArray *
 iselSB_S390(IRSB *bb, VexArch arch_host, VexArchInfo *archinfo_host,
             VexAbiInfo *vbi, Int offset_host_evcheck_counter,
-            Int offset_host_evcheck_fail_addr, Bool chaining_allowed,
-            Bool add_profinc, Addr64 max_ga)
+            Int offset_host_evcheck_fail_addr, Int offset_host_ret_stack,
+            Bool chaining_allowed, Bool add_profinc, Addr64 max_ga,
+            Bool self_loop)
 {
    UInt     i, j;
    HReg     hreg, hregHI;
@@ -4093,6 +4094,7 @@ iselSB_S390(IRSB *bb, VexArch arch_host, VexArchInfo *archinfo_host,
 
    /* Do some sanity checks */
    vassert((VEX_HWCAPS_S390X(hwcaps_host) & ~(VEX_HWCAPS_S390X_ALL)) == 0);
+   vassert(!self_loop);
 
    /* Make up an initial environment to use. */
    env = LibVEX_Alloc(sizeof(ISelEnv));
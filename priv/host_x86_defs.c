@@ -861,7 +861,16 @@ X86Instr* X86Instr_Sse32FLo ( X86SseOp op, HReg src, HReg dst ) {
    X86Instr* i         = LibVEX_Alloc(sizeof(X86Instr));
    i->tag              = Xin_Sse32FLo;
    i->Xin.Sse32FLo.op  = op;
-   i->Xin.Sse32FLo.src = src;
+   i->Xin.Sse32FLo.src = X86RM_Reg(src);
+   i->Xin.Sse32FLo.dst = dst;
+   vassert(op != Xsse_MOV);
+   return i;
+}
+X86Instr* X86Instr_Sse32FLoM ( X86SseOp op, X86AMode* src, HReg dst ) {
+   X86Instr* i         = LibVEX_Alloc(sizeof(X86Instr));
+   i->tag              = Xin_Sse32FLo;
+   i->Xin.Sse32FLo.op  = op;
+   i->Xin.Sse32FLo.src = X86RM_Mem(src);
    i->Xin.Sse32FLo.dst = dst;
    vassert(op != Xsse_MOV);
    return i;
@@ -879,7 +888,16 @@ X86Instr* X86Instr_Sse64FLo ( X86SseOp op, HReg src, HReg dst ) {
    X86Instr* i         = LibVEX_Alloc(sizeof(X86Instr));
    i->tag              = Xin_Sse64FLo;
    i->Xin.Sse64FLo.op  = op;
-   i->Xin.Sse64FLo.src = src;
+   i->Xin.Sse64FLo.src = X86RM_Reg(src);
+   i->Xin.Sse64FLo.dst = dst;
+   vassert(op != Xsse_MOV);
+   return i;
+}
+X86Instr* X86Instr_Sse64FLoM ( X86SseOp op, X86AMode* src, HReg dst ) {
+   X86Instr* i         = LibVEX_Alloc(sizeof(X86Instr));
+   i->tag              = Xin_Sse64FLo;
+   i->Xin.Sse64FLo.op  = op;
+   i->Xin.Sse64FLo.src = X86RM_Mem(src);
    i->Xin.Sse64FLo.dst = dst;
    vassert(op != Xsse_MOV);
    return i;
@@ -1168,7 +1186,7 @@ void ppX86Instr ( X86Instr* i, Bool mode64 ) {
          return;
       case Xin_Sse32FLo:
          vex_printf("%sss ", showX86SseOp(i->Xin.Sse32FLo.op));
-         ppHRegX86(i->Xin.Sse32FLo.src);
+         ppX86RM(i->Xin.Sse32FLo.src);
          vex_printf(",");
          ppHRegX86(i->Xin.Sse32FLo.dst);
          return;
@@ -1180,7 +1198,7 @@ void ppX86Instr ( X86Instr* i, Bool mode64 ) {
          return;
       case Xin_Sse64FLo:
          vex_printf("%ssd ", showX86SseOp(i->Xin.Sse64FLo.op));
-         ppHRegX86(i->Xin.Sse64FLo.src);
+         ppX86RM(i->Xin.Sse64FLo.src);
          vex_printf(",");
          ppHRegX86(i->Xin.Sse64FLo.dst);
          return;
@@ -1432,7 +1450,7 @@ void getRegUsage_X86Instr (HRegUsage* u, X86Instr* i, Bool mode64)
          unary = toBool( i->Xin.Sse32FLo.op == Xsse_RCPF
                          || i->Xin.Sse32FLo.op == Xsse_RSQRTF
                          || i->Xin.Sse32FLo.op == Xsse_SQRTF );
-         addHRegUse(u, HRmRead, i->Xin.Sse32FLo.src);
+         addRegUsage_X86RM(u, i->Xin.Sse32FLo.src, HRmRead);
          addHRegUse(u, unary ? HRmWrite : HRmModify, 
                        i->Xin.Sse32FLo.dst);
          return;
@@ -1450,7 +1468,7 @@ void getRegUsage_X86Instr (HRegUsage* u, X86Instr* i, Bool mode64)
          unary = toBool( i->Xin.Sse64FLo.op == Xsse_RCPF
                          || i->Xin.Sse64FLo.op == Xsse_RSQRTF
                          || i->Xin.Sse64FLo.op == Xsse_SQRTF );
-         addHRegUse(u, HRmRead, i->Xin.Sse64FLo.src);
+         addRegUsage_X86RM(u, i->Xin.Sse64FLo.src, HRmRead);
          addHRegUse(u, unary ? HRmWrite : HRmModify, 
                        i->Xin.Sse64FLo.dst);
          return;
@@ -1625,7 +1643,7 @@ void mapRegs_X86Instr ( HRegRemap* m, X86Instr* i, Bool mode64 )
          mapReg(m, &i->Xin.Sse32Fx4.dst);
          return;
       case Xin_Sse32FLo:
-         mapReg(m, &i->Xin.Sse32FLo.src);
+         mapRegs_X86RM(m, i->Xin.Sse32FLo.src);
          mapReg(m, &i->Xin.Sse32FLo.dst);
          return;
       case Xin_Sse64Fx2:
@@ -1633,7 +1651,7 @@ void mapRegs_X86Instr ( HRegRemap* m, X86Instr* i, Bool mode64 )
          mapReg(m, &i->Xin.Sse64Fx2.dst);
          return;
       case Xin_Sse64FLo:
-         mapReg(m, &i->Xin.Sse64FLo.src);
+         mapRegs_X86RM(m, i->Xin.Sse64FLo.src);
          mapReg(m, &i->Xin.Sse64FLo.dst);
          return;
       case Xin_SseReRg:
@@ -2092,6 +2110,7 @@ Int emit_X86Instr ( /*MB_MOD*/Bool* is_profInc,
                     void* disp_cp_chain_me_to_slowEP,
                     void* disp_cp_chain_me_to_fastEP,
                     void* disp_cp_xindir,
+                    void* disp_cp_xindir_miss,
                     void* disp_cp_xassisted )
 {
    UInt irno, opc, opc_rr, subopc_imm, opc_imma, opc_cl, opc_imm, subopc;
@@ -3124,8 +3143,12 @@ Int emit_X86Instr ( /*MB_MOD*/Bool* is_profInc,
          case Xsse_CMPUNF: *p++ = 0xC2; xtra = 0x103; break;
          default: goto bad;
       }
-      p = doAMode_R(p, fake(vregNo(i->Xin.Sse32FLo.dst)),
-                       fake(vregNo(i->Xin.Sse32FLo.src)) );
+      if (i->Xin.Sse32FLo.src->tag == Xrm_Reg)
+         p = doAMode_R(p, fake(vregNo(i->Xin.Sse32FLo.dst)),
+                          fake(vregNo(i->Xin.Sse32FLo.src->Xrm.Reg.reg)) );
+      else
+         p = doAMode_M(p, fake(vregNo(i->Xin.Sse32FLo.dst)),
+                          i->Xin.Sse32FLo.src->Xrm.Mem.am );
       if (xtra & 0x100)
          *p++ = toUChar(xtra & 0xFF);
       goto done;
@@ -3150,8 +3173,12 @@ Int emit_X86Instr ( /*MB_MOD*/Bool* is_profInc,
          case Xsse_CMPUNF: *p++ = 0xC2; xtra = 0x103; break;
          default: goto bad;
       }
-      p = doAMode_R(p, fake(vregNo(i->Xin.Sse64FLo.dst)),
-                       fake(vregNo(i->Xin.Sse64FLo.src)) );
+      if (i->Xin.Sse64FLo.src->tag == Xrm_Reg)
+         p = doAMode_R(p, fake(vregNo(i->Xin.Sse64FLo.dst)),
+                          fake(vregNo(i->Xin.Sse64FLo.src->Xrm.Reg.reg)) );
+      else
+         p = doAMode_M(p, fake(vregNo(i->Xin.Sse64FLo.dst)),
+                          i->Xin.Sse64FLo.src->Xrm.Mem.am );
       if (xtra & 0x100)
          *p++ = toUChar(xtra & 0xFF);
       goto done;
@@ -3328,6 +3355,66 @@ Int evCheckSzB_X86 ( void )
 }
 
 
+/* Hot/cold layout.  If i is a conditional exit, return an
+   unconditional copy of it, to be emitted out of line, else NULL. */
+X86Instr* coldExit_X86Instr ( X86Instr* i )
+{
+   X86Instr* stub;
+   switch (i->tag) {
+      case Xin_XDirect:
+         if (i->Xin.XDirect.cond == Xcc_ALWAYS) return NULL;
+         break;
+      case Xin_XIndir:
+         if (i->Xin.XIndir.cond == Xcc_ALWAYS) return NULL;
+         break;
+      case Xin_XAssisted:
+         if (i->Xin.XAssisted.cond == Xcc_ALWAYS) return NULL;
+         break;
+      default:
+         return NULL;
+   }
+   stub  = LibVEX_Alloc(sizeof(X86Instr));
+   *stub = *i;
+   switch (i->tag) {
+      case Xin_XDirect:   stub->Xin.XDirect.cond   = Xcc_ALWAYS; break;
+      case Xin_XIndir:    stub->Xin.XIndir.cond    = Xcc_ALWAYS; break;
+      case Xin_XAssisted: stub->Xin.XAssisted.cond = Xcc_ALWAYS; break;
+      default: vassert(0);
+   }
+   return stub;
+}
+
+/* Emit the branch to cold exit i's out of line copy, which is delta
+   bytes from the start of the branch.  This is the 2 byte rel8 form
+   if delta is in reach of it and the 6 byte rel32 form otherwise, so
+   the length depends only on delta, and never shrinks as delta
+   grows. */
+Int emitColdBranch_X86 ( UChar* buf, Int nbuf, X86Instr* i, Int delta )
+{
+   X86CondCode cond = Xcc_ALWAYS;
+   UChar*      p    = &buf[0];
+   vassert(nbuf >= 6);
+   switch (i->tag) {
+      case Xin_XDirect:   cond = i->Xin.XDirect.cond;   break;
+      case Xin_XIndir:    cond = i->Xin.XIndir.cond;    break;
+      case Xin_XAssisted: cond = i->Xin.XAssisted.cond; break;
+      default: vpanic("emitColdBranch_X86");
+   }
+   vassert(cond != Xcc_ALWAYS);
+   if (fits8bits(delta - 2)) {
+      /* jcc rel8 */
+      *p++ = toUChar(0x70 + (0xF & cond));
+      *p++ = toUChar(delta - 2);
+   } else {
+      /* jcc rel32 */
+      *p++ = 0x0F;
+      *p++ = toUChar(0x80 + (0xF & cond));
+      p = emit32(p, (UInt)(delta - 6));
+   }
+   return p - &buf[0];
+}
+
+
 /* NB: what goes on here has to be very closely coordinated with the
    emitInstr case for XDirect, above. */
 VexInvalRange chainXDirect_X86 ( void* place_to_chain,
@@ -610,7 +610,7 @@ typedef
          } Sse32Fx4;
          struct {
             X86SseOp op;
-            HReg     src;
+            X86RM*   src;
             HReg     dst;
          } Sse32FLo;
          struct {
@@ -620,7 +620,7 @@ typedef
          } Sse64Fx2;
          struct {
             X86SseOp op;
-            HReg     src;
+            X86RM*   src;
             HReg     dst;
          } Sse64FLo;
          struct {
@@ -697,8 +697,10 @@ extern X86Instr* X86Instr_SseLdSt   ( Bool isLoad, HReg, X86AMode* );
 extern X86Instr* X86Instr_SseLdzLO  ( Int sz, HReg, X86AMode* );
 extern X86Instr* X86Instr_Sse32Fx4  ( X86SseOp, HReg, HReg );
 extern X86Instr* X86Instr_Sse32FLo  ( X86SseOp, HReg, HReg );
+extern X86Instr* X86Instr_Sse32FLoM ( X86SseOp, X86AMode*, HReg );
 extern X86Instr* X86Instr_Sse64Fx2  ( X86SseOp, HReg, HReg );
 extern X86Instr* X86Instr_Sse64FLo  ( X86SseOp, HReg, HReg );
+extern X86Instr* X86Instr_Sse64FLoM ( X86SseOp, X86AMode*, HReg );
 extern X86Instr* X86Instr_SseReRg   ( X86SseOp, HReg, HReg );
 extern X86Instr* X86Instr_SseCMov   ( X86CondCode, HReg src, HReg dst );
 extern X86Instr* X86Instr_SseShuf   ( Int order, HReg src, HReg dst );
@@ -720,6 +722,7 @@ extern Int          emit_X86Instr        ( /*MB_MOD*/Bool* is_profInc,
                                            void* disp_cp_chain_me_to_slowEP,
                                            void* disp_cp_chain_me_to_fastEP,
                                            void* disp_cp_xindir,
+                                           void* disp_cp_xindir_miss,
                                            void* disp_cp_xassisted );
 
 extern void genSpill_X86  ( /*OUT*/HInstr** i1, /*OUT*/HInstr** i2,
@@ -736,9 +739,11 @@ extern HInstrArray* iselSB_X86           ( IRSB*,
                                            VexAbiInfo*,
                                            Int offs_Host_EvC_Counter,
                                            Int offs_Host_EvC_FailAddr,
+                                           Int offs_Host_RetStack,
                                            Bool chainingAllowed,
                                            Bool addProfInc,
-                                           Addr64 max_ga );
+                                           Addr64 max_ga,
+                                           Bool selfLoop );
 
 /* How big is an event check?  This is kind of a kludge because it
    depends on the offsets of host_EvC_FAILADDR and host_EvC_COUNTER,
@@ -747,6 +752,11 @@ extern HInstrArray* iselSB_X86           ( IRSB*,
    worst case we will merely assert at startup. */
 extern Int evCheckSzB_X86 ( void );
 
+/* Move conditional exits out of line; see LibVEX_Translate. */
+extern X86Instr* coldExit_X86Instr  ( X86Instr* i );
+extern Int       emitColdBranch_X86 ( UChar* buf, Int nbuf,
+                                      X86Instr* i, Int delta );
+
 /* Perform a chaining and unchaining of an XDirect jump. */
 extern VexInvalRange chainXDirect_X86 ( void* place_to_chain,
                                         void* disp_cp_chain_me_EXPECTED,
@@ -735,6 +735,49 @@ X86AMode* genGuestArrayOffset ( ISelEnv* env, IRRegArray* descr,
 }
 
 
+/* Memory operands.  A little-endian load or a GET can be read by
+   many instructions straight from memory rather than first being
+   loaded into a register.  Loads only appear inside trees if they
+   are used once, so this never duplicates a memory access. */
+
+static Bool isMemOperand ( IRExpr* e, IRType ty )
+{
+   switch (e->tag) {
+      case Iex_Load:
+         return toBool(e->Iex.Load.end == Iend_LE && e->Iex.Load.ty == ty);
+      case Iex_Get:
+         return toBool(e->Iex.Get.ty == ty);
+      default:
+         return False;
+   }
+}
+
+static X86AMode* iselMemOperand ( ISelEnv* env, IRExpr* e )
+{
+   if (e->tag == Iex_Load)
+      return iselIntExpr_AMode(env, e->Iex.Load.addr);
+   vassert(e->tag == Iex_Get);
+   return X86AMode_IR(e->Iex.Get.offset, hregX86_EBP());
+}
+
+/* If e, the second operand of a scalar SSE op on the lowest szB
+   bytes, can be read straight from memory, return the part of it to
+   read, else NULL.  See the amd64 version for the details. */
+static IRExpr* sseLoMemOperand ( IRExpr* e, Int szB )
+{
+   IRType tyF = szB == 8 ? Ity_F64 : Ity_F32;
+   IRType tyI = szB == 8 ? Ity_I64 : Ity_I32;
+   vassert(szB == 4 || szB == 8);
+   if (e->tag == Iex_Unop
+       && e->Iex.Unop.op == (szB == 8 ? Iop_64UtoV128 : Iop_32UtoV128))
+      e = e->Iex.Unop.arg;
+   if (isMemOperand(e, tyF) || isMemOperand(e, tyI)
+       || (e->tag == Iex_Get && isMemOperand(e, Ity_V128)))
+      return e;
+   return NULL;
+}
+
+
 /* Mess with the FPU's rounding mode: set to the default rounding mode
    (DEFAULT_FPUCW). */
 static 
@@ -950,9 +993,22 @@ static HReg iselIntExpr_R_wrk ( ISelEnv* env, IRExpr* e )
       /* For commutative ops we assume any literal
          values are on the second operand. */
       if (aluOp != Xalu_INVALID) {
-         HReg dst    = newVRegI(env);
-         HReg reg    = iselIntExpr_R(env, e->Iex.Binop.arg1);
-         X86RMI* rmi = iselIntExpr_RMI(env, e->Iex.Binop.arg2);
+         HReg    dst  = newVRegI(env);
+         IRExpr* argL = e->Iex.Binop.arg1;
+         IRExpr* argR = e->Iex.Binop.arg2;
+         HReg    reg;
+         X86RMI* rmi;
+         /* Put a memory operand second if we can, so it can be
+            folded into the op. */
+         if (ty == Ity_I32 && aluOp != Xalu_SUB
+             && isMemOperand(argL, Ity_I32)
+             && !isMemOperand(argR, Ity_I32)
+             && argR->tag != Iex_Const) {
+            argL = e->Iex.Binop.arg2;
+            argR = e->Iex.Binop.arg1;
+         }
+         reg = iselIntExpr_R(env, argL);
+         rmi = iselIntExpr_RMI(env, argR);
          addInstr(env, mk_iMOVsd_RR(reg,dst));
          addInstr(env, X86Instr_Alu32R(aluOp, rmi, dst));
          return dst;
@@ -3594,11 +3650,17 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
       case Iop_Mul32F0x4:   op = Xsse_MULF;   goto do_32F0x4;
       case Iop_Sub32F0x4:   op = Xsse_SUBF;   goto do_32F0x4;
       do_32F0x4: {
-         HReg argL = iselVecExpr(env, e->Iex.Binop.arg1);
-         HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
-         HReg dst = newVRegV(env);
+         HReg    argL = iselVecExpr(env, e->Iex.Binop.arg1);
+         IRExpr* argM = sseLoMemOperand(e->Iex.Binop.arg2, 4);
+         HReg    dst  = newVRegV(env);
          addInstr(env, mk_vMOVsd_RR(argL, dst));
-         addInstr(env, X86Instr_Sse32FLo(op, argR, dst));
+         if (argM) {
+            X86AMode* am = iselMemOperand(env, argM);
+            addInstr(env, X86Instr_Sse32FLoM(op, am, dst));
+         } else {
+            HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
+            addInstr(env, X86Instr_Sse32FLo(op, argR, dst));
+         }
          return dst;
       }
 
@@ -3613,12 +3675,18 @@ static HReg iselVecExpr_wrk ( ISelEnv* env, IRExpr* e )
       case Iop_Mul64F0x2:   op = Xsse_MULF;   goto do_64F0x2;
       case Iop_Sub64F0x2:   op = Xsse_SUBF;   goto do_64F0x2;
       do_64F0x2: {
-         HReg argL = iselVecExpr(env, e->Iex.Binop.arg1);
-         HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
-         HReg dst = newVRegV(env);
+         HReg    argL = iselVecExpr(env, e->Iex.Binop.arg1);
+         IRExpr* argM = sseLoMemOperand(e->Iex.Binop.arg2, 8);
+         HReg    dst  = newVRegV(env);
          REQUIRE_SSE2;
          addInstr(env, mk_vMOVsd_RR(argL, dst));
-         addInstr(env, X86Instr_Sse64FLo(op, argR, dst));
+         if (argM) {
+            X86AMode* am = iselMemOperand(env, argM);
+            addInstr(env, X86Instr_Sse64FLoM(op, am, dst));
+         } else {
+            HReg argR = iselVecExpr(env, e->Iex.Binop.arg2);
+            addInstr(env, X86Instr_Sse64FLo(op, argR, dst));
+         }
          return dst;
       }
 
@@ -4414,9 +4482,11 @@ HInstrArray* iselSB_X86 ( IRSB* bb,
                           VexAbiInfo*  vbi/*UNUSED*/,
                           Int offs_Host_EvC_Counter,
                           Int offs_Host_EvC_FailAddr,
+                          Int offs_Host_RetStack,
                           Bool chainingAllowed,
                           Bool addProfInc,
-                          Addr64 max_ga )
+                          Addr64 max_ga,
+                          Bool selfLoop )
 {
    Int      i, j;
    HReg     hreg, hregHI;
@@ -4426,6 +4496,7 @@ HInstrArray* iselSB_X86 ( IRSB* bb,
 
    /* sanity ... */
    vassert(arch_host == VexArchX86);
+   vassert(!selfLoop);
    vassert(0 == (hwcaps_host
                  & ~(VEX_HWCAPS_X86_MMXEXT
                      | VEX_HWCAPS_X86_SSE1
@@ -193,6 +193,11 @@ void ppIROp ( IROp op )
       case Iop_Ctz64:    vex_printf("Ctz64"); return;
       case Iop_Ctz32:    vex_printf("Ctz32"); return;
 
+      case Iop_CRC32C8:  vex_printf("CRC32C8"); return;
+      case Iop_CRC32C16: vex_printf("CRC32C16"); return;
+      case Iop_CRC32C32: vex_printf("CRC32C32"); return;
+      case Iop_CRC32C64: vex_printf("CRC32C64"); return;
+
       case Iop_CmpLT32S: vex_printf("CmpLT32S"); return;
       case Iop_CmpLE32S: vex_printf("CmpLE32S"); return;
       case Iop_CmpLT32U: vex_printf("CmpLT32U"); return;
@@ -773,6 +778,7 @@ void ppIROp ( IROp op )
       case Iop_Mull32Sx2:    vex_printf("Mull32Sx2"); return;
       case Iop_PolynomialMul8x16: vex_printf("PolynomialMul8x16"); return;
       case Iop_PolynomialMull8x8: vex_printf("PolynomialMull8x8"); return;
+      case Iop_PolynomialMull64: vex_printf("PolynomialMull64"); return;
       case Iop_MulHi16Ux8: vex_printf("MulHi16Ux8"); return;
       case Iop_MulHi32Ux4: vex_printf("MulHi32Ux4"); return;
       case Iop_MulHi16Sx8: vex_printf("MulHi16Sx8"); return;
@@ -1150,6 +1156,12 @@ void ppIROp ( IROp op )
       case Iop_NCipherLV128: vex_printf("NCipherLV128"); return;
       case Iop_CipherSV128:  vex_printf("CipherSV128"); return;
 
+      case Iop_AESEnc128:     vex_printf("AESEnc128"); return;
+      case Iop_AESEncLast128: vex_printf("AESEncLast128"); return;
+      case Iop_AESDec128:     vex_printf("AESDec128"); return;
+      case Iop_AESDecLast128: vex_printf("AESDecLast128"); return;
+      case Iop_AESIMC128:     vex_printf("AESIMC128"); return;
+
       case Iop_SHA256:  vex_printf("SHA256"); return;
       case Iop_SHA512:  vex_printf("SHA512"); return;
       case Iop_BCDAdd:  vex_printf("BCDAdd"); return;
@@ -2578,6 +2590,15 @@ void typeOfPrimop ( IROp op,
       case Iop_Clz64: case Iop_Ctz64:
          UNARY(Ity_I64, Ity_I64);
 
+      case Iop_CRC32C8:
+         BINARY(Ity_I32,Ity_I8, Ity_I32);
+      case Iop_CRC32C16:
+         BINARY(Ity_I32,Ity_I16, Ity_I32);
+      case Iop_CRC32C32:
+         BINARY(Ity_I32,Ity_I32, Ity_I32);
+      case Iop_CRC32C64:
+         BINARY(Ity_I32,Ity_I64, Ity_I32);
+
       case Iop_DivU32: case Iop_DivS32: case Iop_DivU32E: case Iop_DivS32E:
          BINARY(Ity_I32,Ity_I32, Ity_I32);
 
@@ -2882,6 +2903,9 @@ void typeOfPrimop ( IROp op,
       case Iop_CipherLV128:
       case Iop_NCipherV128:
       case Iop_NCipherLV128:
+      case Iop_PolynomialMull64:
+      case Iop_AESEnc128: case Iop_AESEncLast128:
+      case Iop_AESDec128: case Iop_AESDecLast128:
          BINARY(Ity_V128,Ity_V128, Ity_V128);
 
       case Iop_PolynomialMull8x8:
@@ -2911,6 +2935,7 @@ void typeOfPrimop ( IROp op,
       case Iop_Neg64Fx2: case Iop_Neg32Fx4:
       case Iop_Abs8x16: case Iop_Abs16x8: case Iop_Abs32x4:
       case Iop_CipherSV128:
+      case Iop_AESIMC128:
       case Iop_PwBitMtxXpose64x2:
       case Iop_ZeroHI64ofV128:  case Iop_ZeroHI96ofV128:
       case Iop_ZeroHI112ofV128: case Iop_ZeroHI120ofV128:
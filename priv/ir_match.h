@@ -44,19 +44,27 @@
 
 /* Patterns are simply IRExpr* trees, with IRExpr_Binder nodes at the
    leaves, indicating binding points.  Use these magic macros to
-   declare and define patterns. */
+   declare and define patterns.
+
+   Patterns live in the PERM area and are shared by all threads.  The
+   pointer is published with a release store and read with an acquire
+   load, so a thread which sees it also sees the finished tree.  Two
+   threads may race to build the same pattern; that merely wastes a
+   few bytes of the PERM area. */
 
 #define DECLARE_PATTERN(_patt) \
    static IRExpr* _patt = NULL
 
 #define DEFINE_PATTERN(_patt,_expr)                            \
    do {                                                        \
-      if (!(_patt)) {                                          \
+      if (!__atomic_load_n(&(_patt), __ATOMIC_ACQUIRE)) {      \
+         IRExpr* _built;                                       \
          vassert(vexGetAllocMode() == VexAllocModeTEMP);       \
          vexSetAllocMode(VexAllocModePERM);                    \
-         _patt = (_expr);                                      \
+         _built = (_expr);                                     \
          vexSetAllocMode(VexAllocModeTEMP);                    \
          vassert(vexGetAllocMode() == VexAllocModeTEMP);       \
+         __atomic_store_n(&(_patt), _built, __ATOMIC_RELEASE); \
       }                                                        \
    } while (0)
 
@@ -172,9 +172,29 @@
 /*--- Finite mappery, of a sort                               ---*/
 /*---------------------------------------------------------------*/
 
-/* General map from HWord-sized thing HWord-sized thing.  Could be by
-   hashing, but it's not clear whether or not this would really be any
-   faster. */
+/* General map from HWord-sized thing HWord-sized thing.
+
+   The bindings live in the dense arrays inuse/key/val[0 .. used-1],
+   in the order they were added; some callers walk these directly, and
+   may remove a binding by clearing its inuse flag.  Small maps, which
+   most are, are searched linearly.  Once a map outgrows
+   HHW_SMALL_SIZE, lookups go through 'index', an open-addressed
+   (linear probing) hash table of entry numbers, which is kept twice
+   the size of the dense arrays so that it never fills.  An index
+   slot whose entry is no longer inuse is a tombstone: lookups probe
+   past it and additions may reuse it.  Index slots are only valid if
+   their stamp equals 'epoch', so that the whole map can be emptied in
+   constant time, which matters since some passes empty it at every
+   side exit.
+
+   Keys are compared with ==, unless hashFn/eqFn are given, in which
+   case keys are pointers to structures compared by value.  For maps
+   whose keys are guest state ranges made by mk_key_GetPut and
+   mk_key_GetIPutI, 'ranges' is a bitmap of the 32-byte granules of
+   guest state which any key added since the last emptying or
+   compaction covers, with everything beyond 2K lumped into the top
+   bit.  It lets invalidateOverlaps skip the scan in the common case
+   where nothing can overlap. */
 
 typedef
    struct {
@@ -183,35 +203,165 @@ typedef
       HWord* val;
       Int    size;
       Int    used;
+      /* The hash index, of index_mask+1 slots, or NULL */
+      Int*   index;
+      UInt*  stamp;
+      UInt   index_mask;
+      UInt   epoch;
+      /* Structural keys, or NULL */
+      UInt (*hashFn) ( HWord );
+      Bool (*eqFn) ( HWord, HWord );
+      /* Guest state ranges, or not */
+      Bool   range_keys;
+      ULong  ranges;
    }
    HashHW;
 
-static HashHW* newHHW ( void )
+static inline UInt hash_HWord ( HWord w )
+{
+   ULong h = (ULong)w * 0x9E3779B97F4A7C15ULL;
+   return (UInt)(h >> 32);
+}
+
+static inline UInt hashHHW ( HashHW* h, HWord key )
+{
+   return h->hashFn ? h->hashFn(key) : hash_HWord(key);
+}
+
+static inline Bool eqHHW ( HashHW* h, HWord k1, HWord k2 )
+{
+   return k1 == k2 || (h->eqFn && h->eqFn(k1, k2));
+}
+
+/* The granules of guest state covered by a range key. */
+static inline ULong rangesOfKey ( UInt key )
+{
+   UInt lo = (key >> 21) & 0x7FF;
+   UInt hi = (key >>  5) & 0x7FF;
+   if (lo > 63) lo = 63;
+   if (hi > 63) hi = 63;
+   return (0xFFFFFFFFFFFFFFFFULL >> (63 - hi)) & ~((1ULL << lo) - 1);
+}
+
+#define HHW_SMALL_SIZE 8
+
+static void allocHHW ( HashHW* h, Int size )
+{
+   Int n_index = 2 * size;
+   Int i;
+   vassert(0 == (size & (size - 1)));
+   h->size       = size;
+   h->used       = 0;
+   h->inuse      = LibVEX_Alloc(size * sizeof(Bool));
+   h->key        = LibVEX_Alloc(size * sizeof(HWord));
+   h->val        = LibVEX_Alloc(size * sizeof(HWord));
+   h->index      = NULL;
+   h->stamp      = NULL;
+   h->index_mask = 0;
+   h->epoch      = 1;
+   h->ranges     = 0;
+   if (size <= HHW_SMALL_SIZE)
+      return;
+   h->index      = LibVEX_Alloc(n_index * sizeof(Int));
+   h->stamp      = LibVEX_Alloc(n_index * sizeof(UInt));
+   h->index_mask = n_index - 1;
+   for (i = 0; i < n_index; i++)
+      h->stamp[i] = 0;
+}
+
+static HashHW* newHHW_with ( UInt (*hashFn) ( HWord ),
+                             Bool (*eqFn) ( HWord, HWord ) )
 {
    HashHW* h = LibVEX_Alloc(sizeof(HashHW));
-   h->size   = 8;
-   h->used   = 0;
-   h->inuse  = LibVEX_Alloc(h->size * sizeof(Bool));
-   h->key    = LibVEX_Alloc(h->size * sizeof(HWord));
-   h->val    = LibVEX_Alloc(h->size * sizeof(HWord));
+   allocHHW(h, HHW_SMALL_SIZE);
+   h->hashFn     = hashFn;
+   h->eqFn       = eqFn;
+   h->range_keys = False;
+   return h;
+}
+
+static HashHW* newHHW ( void )
+{
+   return newHHW_with(NULL, NULL);
+}
+
+/* A map keyed by mk_key_GetPut / mk_key_GetIPutI ranges. */
+static HashHW* newHHW_ranges ( void )
+{
+   HashHW* h = newHHW();
+   h->range_keys = True;
    return h;
 }
 
 
+/* Remove all bindings. */
+
+static void clearHHW ( HashHW* h )
+{
+   h->used   = 0;
+   h->ranges = 0;
+   if (!h->index)
+      return;
+   h->epoch++;
+   if (UNLIKELY(h->epoch == 0)) {
+      UInt i;
+      for (i = 0; i <= h->index_mask; i++)
+         h->stamp[i] = 0;
+      h->epoch = 1;
+   }
+}
+
+
+/* Find where key is: for a small map, its entry number, or -1;
+   otherwise the index slot holding its binding if there is one, and
+   if not an empty slot or tombstone it can go in. */
+
+static Int findSlotHHW ( HashHW* h, HWord key, /*OUT*/Bool* found )
+{
+   UInt i;
+   Int  free = -1;
+   if (!h->index) {
+      Int e;
+      for (e = 0; e < h->used; e++) {
+         if (h->inuse[e] && eqHHW(h, h->key[e], key)) {
+            *found = True;
+            return e;
+         }
+      }
+      *found = False;
+      return -1;
+   }
+   i = hashHHW(h, key) & h->index_mask;
+   while (True) {
+      Int e;
+      if (h->stamp[i] != h->epoch) {
+         *found = False;
+         return free >= 0 ? free : (Int)i;
+      }
+      e = h->index[i];
+      if (!h->inuse[e]) {
+         if (free < 0)
+            free = i;
+      }
+      else if (eqHHW(h, h->key[e], key)) {
+         *found = True;
+         return i;
+      }
+      i = (i + 1) & h->index_mask;
+   }
+}
+
+
 /* Look up key in the map. */
 
 static Bool lookupHHW ( HashHW* h, /*OUT*/HWord* val, HWord key )
 {
-   Int i;
+   Bool found;
+   Int  i = findSlotHHW(h, key, &found);
    /* vex_printf("lookupHHW(%llx)\n", key ); */
-   for (i = 0; i < h->used; i++) {
-      if (h->inuse[i] && h->key[i] == key) {
-         if (val)
-            *val = h->val[i];
-         return True;
-      }
-   }
-   return False;
+   if (found && val)
+      *val = h->val[h->index ? h->index[i] : i];
+   return found;
 }
 
 
@@ -219,43 +369,53 @@ static Bool lookupHHW ( HashHW* h, /*OUT*/HWord* val, HWord key )
 
 static void addToHHW ( HashHW* h, HWord key, HWord val )
 {
-   Int i, j;
+   Bool found;
+   Int  i, j, e;
    /* vex_printf("addToHHW(%llx, %llx)\n", key, val); */
 
    /* Find and replace existing binding, if any. */
-   for (i = 0; i < h->used; i++) {
-      if (h->inuse[i] && h->key[i] == key) {
-         h->val[i] = val;
-         return;
-      }
+   i = findSlotHHW(h, key, &found);
+   if (found) {
+      h->val[h->index ? h->index[i] : i] = val;
+      return;
    }
 
-   /* Ensure a space is available. */
+   /* Ensure a space is available.  Dead entries accumulate at the
+      end of the dense arrays, so squeeze them out first, and only
+      make the arrays bigger if they are still more than half full. */
    if (h->used == h->size) {
-      /* Copy into arrays twice the size. */
-      Bool*  inuse2 = LibVEX_Alloc(2 * h->size * sizeof(Bool));
-      HWord* key2   = LibVEX_Alloc(2 * h->size * sizeof(HWord));
-      HWord* val2   = LibVEX_Alloc(2 * h->size * sizeof(HWord));
-      for (i = j = 0; i < h->size; i++) {
-         if (!h->inuse[i]) continue;
-         inuse2[j] = True;
-         key2[j] = h->key[i];
-         val2[j] = h->val[i];
-         j++;
+      Bool*  inuse = h->inuse;
+      HWord* keys  = h->key;
+      HWord* vals  = h->val;
+      Int    used  = h->used;
+      Int    live  = 0;
+      for (j = 0; j < used; j++)
+         if (inuse[j]) live++;
+      if (2 * live >= h->size) {
+         allocHHW(h, 2 * h->size);
+      } else {
+         clearHHW(h);
+      }
+      for (j = 0; j < used; j++) {
+         if (!inuse[j]) continue;
+         addToHHW(h, keys[j], vals[j]);
       }
-      h->used = j;
-      h->size *= 2;
-      h->inuse = inuse2;
-      h->key = key2;
-      h->val = val2;
+      i = findSlotHHW(h, key, &found);
+      vassert(!found);
    }
 
    /* Finally, add it. */
    vassert(h->used < h->size);
-   h->inuse[h->used] = True;
-   h->key[h->used] = key;
-   h->val[h->used] = val;
-   h->used++;
+   e = h->used++;
+   h->inuse[e] = True;
+   h->key[e]   = key;
+   h->val[e]   = val;
+   if (h->index) {
+      h->index[i] = e;
+      h->stamp[i] = h->epoch;
+   }
+   if (h->range_keys)
+      h->ranges |= rangesOfKey((UInt)key);
 }
 
 
@@ -592,10 +752,14 @@ static void invalidateOverlaps ( HashHW* h, UInt k_lo, UInt k_hi )
    Int  j;
    UInt e_lo, e_hi;
    vassert(k_lo <= k_hi);
+   vassert(h->range_keys);
    /* invalidate any env entries which in any way overlap (k_lo
       .. k_hi) */
    /* vex_printf("invalidate %d .. %d\n", k_lo, k_hi ); */
 
+   if ((h->ranges & rangesOfKey((k_lo << 16) | k_hi)) == 0)
+      return; /* no overlap possible */
+
    for (j = 0; j < h->used; j++) {
       if (!h->inuse[j]) 
          continue;
@@ -613,7 +777,7 @@ static void invalidateOverlaps ( HashHW* h, UInt k_lo, UInt k_hi )
 
 static void redundant_get_removal_BB ( IRSB* bb )
 {
-   HashHW* env = newHHW();
+   HashHW* env = newHHW_ranges();
    UInt    key = 0; /* keep gcc -O happy */
    Int     i, j;
    HWord   val;
@@ -688,8 +852,7 @@ static void redundant_get_removal_BB ( IRSB* bb )
          }
          if (writes) {
             /* dump the entire env (not clever, but correct ...) */
-            for (j = 0; j < env->used; j++)
-               env->inuse[j] = False;
+            clearHHW(env);
             if (0) vex_printf("rGET: trash env due to dirty helper\n");
          }
       }
@@ -773,8 +936,7 @@ static void handle_gets_Stmt (
       case Ist_Dirty:
       case Ist_CAS:
       case Ist_LLSC:
-         for (j = 0; j < env->used; j++)
-            env->inuse[j] = False;
+         clearHHW(env);
          break;
 
       /* all other cases are boring. */
@@ -828,8 +990,7 @@ static void handle_gets_Stmt (
          case VexRegUpdAllregsAtMemAccess:
             /* Precise exceptions required at mem access.
                Flush all guest state. */
-            for (j = 0; j < env->used; j++)
-               env->inuse[j] = False;
+            clearHHW(env);
             break;
          case VexRegUpdSpAtMemAccess:
             /* We need to dump the stack pointer
@@ -880,14 +1041,14 @@ static void redundant_put_removal_BB (
                Bool (*preciseMemExnsFn)(Int,Int)
             )
 {
-   Int     i, j;
+   Int     i;
    Bool    isPut;
    IRStmt* st;
    UInt    key = 0; /* keep gcc -O happy */
 
    vassert(vex_control.iropt_register_updates < VexRegUpdAllregsAtEachInsn);
 
-   HashHW* env = newHHW();
+   HashHW* env = newHHW_ranges();
 
    /* Initialise the running env with the fact that the final exit
       writes the IP (or, whatever it claims to write.  We don't
@@ -925,8 +1086,7 @@ static void redundant_put_removal_BB (
          //                    typeOfIRConst(st->Ist.Exit.dst));
          //re_add = lookupHHW(env, NULL, key);
          /* (2) */
-         for (j = 0; j < env->used; j++)
-            env->inuse[j] = False;
+         clearHHW(env);
          /* (3) */
          //if (0 && re_add) 
          //   addToHHW(env, (HWord)key, 0);
@@ -988,26 +1148,26 @@ static void redundant_put_removal_BB (
 
 #if STATS_IROPT
 /* How often sameIRExprs was invoked */
-static UInt invocation_count;
+static VEX_TLS UInt invocation_count;
 /* How often sameIRExprs recursed through IRTemp assignments */
-static UInt recursion_count;
+static VEX_TLS UInt recursion_count;
 /* How often sameIRExprs found identical IRExprs */
-static UInt success_count;
+static VEX_TLS UInt success_count;
 /* How often recursing through assignments to IRTemps helped
    establishing equality. */
-static UInt recursion_success_count;
+static VEX_TLS UInt recursion_success_count;
 /* Whether or not recursing through an IRTemp assignment helped 
    establishing IRExpr equality for a given sameIRExprs invocation. */
-static Bool recursion_helped;
+static VEX_TLS Bool recursion_helped;
 /* Whether or not a given sameIRExprs invocation recursed through an
    IRTemp assignment */
-static Bool recursed;
+static VEX_TLS Bool recursed;
 /* Maximum number of nodes ever visited when comparing two IRExprs. */
-static UInt max_nodes_visited;
+static VEX_TLS UInt max_nodes_visited;
 #endif /* STATS_IROPT */
 
 /* Count the number of nodes visited for a given sameIRExprs invocation. */
-static UInt num_nodes_visited;
+static VEX_TLS UInt num_nodes_visited;
 
 /* Do not visit more than NODE_LIMIT nodes when comparing two IRExprs.
    This is to guard against performance degradation by visiting large
@@ -3463,6 +3623,109 @@ static Bool eq_AvailExpr ( AvailExpr* a1, AvailExpr* a2 )
    }
 }
 
+/* Hashing of AvailExprs, consistent with eq_AvailExpr: anything
+   which eq_AvailExpr compares with something other than == (float
+   constants, for which +0 == -0) only contributes its tag. */
+
+static inline UInt mix_AvailExpr ( UInt h, UInt x )
+{
+   h ^= x;
+   h *= 0x01000193; /* FNV prime */
+   return h;
+}
+
+static UInt hash_IRConst ( UInt h, IRConst* c )
+{
+   h = mix_AvailExpr(h, c->tag);
+   switch (c->tag) {
+      case Ico_U1:   return mix_AvailExpr(h, 1 & c->Ico.U1);
+      case Ico_U8:   return mix_AvailExpr(h, c->Ico.U8);
+      case Ico_U16:  return mix_AvailExpr(h, c->Ico.U16);
+      case Ico_U32:  return mix_AvailExpr(h, c->Ico.U32);
+      case Ico_U64:  h = mix_AvailExpr(h, (UInt)c->Ico.U64);
+                     return mix_AvailExpr(h, (UInt)(c->Ico.U64 >> 32));
+      case Ico_F32i: return mix_AvailExpr(h, c->Ico.F32i);
+      case Ico_F64i: h = mix_AvailExpr(h, (UInt)c->Ico.F64i);
+                     return mix_AvailExpr(h, (UInt)(c->Ico.F64i >> 32));
+      case Ico_V128: return mix_AvailExpr(h, c->Ico.V128);
+      case Ico_V256: return mix_AvailExpr(h, c->Ico.V256);
+      case Ico_F32: case Ico_F64: return h;
+      default: vpanic("hash_IRConst");
+   }
+}
+
+static UInt hash_AvailExpr ( AvailExpr* ae )
+{
+   UInt h = mix_AvailExpr(0x811C9DC5, ae->tag);
+   switch (ae->tag) {
+      case Ut:
+         h = mix_AvailExpr(h, ae->u.Ut.op);
+         return mix_AvailExpr(h, ae->u.Ut.arg);
+      case Btt:
+         h = mix_AvailExpr(h, ae->u.Btt.op);
+         h = mix_AvailExpr(h, ae->u.Btt.arg1);
+         return mix_AvailExpr(h, ae->u.Btt.arg2);
+      case Btc:
+         h = mix_AvailExpr(h, ae->u.Btc.op);
+         h = mix_AvailExpr(h, ae->u.Btc.arg1);
+         return hash_IRConst(h, &ae->u.Btc.con2);
+      case Bct:
+         h = mix_AvailExpr(h, ae->u.Bct.op);
+         h = mix_AvailExpr(h, ae->u.Bct.arg2);
+         return hash_IRConst(h, &ae->u.Bct.con1);
+      case Cf64i:
+         h = mix_AvailExpr(h, (UInt)ae->u.Cf64i.f64i);
+         return mix_AvailExpr(h, (UInt)(ae->u.Cf64i.f64i >> 32));
+      case Ittt:
+         h = mix_AvailExpr(h, ae->u.Ittt.co);
+         h = mix_AvailExpr(h, ae->u.Ittt.e1);
+         return mix_AvailExpr(h, ae->u.Ittt.e0);
+      case Ittc:
+         h = mix_AvailExpr(h, ae->u.Ittc.co);
+         h = mix_AvailExpr(h, ae->u.Ittc.e1);
+         return hash_IRConst(h, &ae->u.Ittc.con0);
+      case Itct:
+         h = mix_AvailExpr(h, ae->u.Itct.co);
+         h = hash_IRConst(h, &ae->u.Itct.con1);
+         return mix_AvailExpr(h, ae->u.Itct.e0);
+      case Itcc:
+         h = mix_AvailExpr(h, ae->u.Itcc.co);
+         h = hash_IRConst(h, &ae->u.Itcc.con1);
+         return hash_IRConst(h, &ae->u.Itcc.con0);
+      case GetIt:
+         h = mix_AvailExpr(h, ae->u.GetIt.descr->base);
+         h = mix_AvailExpr(h, ae->u.GetIt.descr->elemTy);
+         h = mix_AvailExpr(h, ae->u.GetIt.descr->nElems);
+         h = mix_AvailExpr(h, ae->u.GetIt.ix);
+         return mix_AvailExpr(h, ae->u.GetIt.bias);
+      case CCall: {
+         Int i;
+         h = hash_HWord((HWord)ae->u.CCall.cee->addr) ^ h;
+         h = mix_AvailExpr(h, ae->u.CCall.nArgs);
+         for (i = 0; i < ae->u.CCall.nArgs; i++) {
+            TmpOrConst* tc = &ae->u.CCall.args[i];
+            if (tc->tag == TCt)
+               h = mix_AvailExpr(h, tc->u.tmp);
+            else
+               h = hash_IRConst(h, tc->u.con);
+         }
+         return h;
+      }
+      default: vpanic("hash_AvailExpr");
+   }
+}
+
+/* For HashHW maps keyed by AvailExpr*. */
+static UInt hashHW_AvailExpr ( HWord ae )
+{
+   return hash_AvailExpr((AvailExpr*)ae);
+}
+
+static Bool eqHW_AvailExpr ( HWord ae1, HWord ae2 )
+{
+   return eq_AvailExpr((AvailExpr*)ae1, (AvailExpr*)ae2);
+}
+
 static IRExpr* availExpr_to_IRExpr ( AvailExpr* ae ) 
 {
    IRConst *con, *con0, *con1;
@@ -3743,9 +4006,12 @@ static Bool do_cse_BB ( IRSB* bb )
    AvailExpr* ae;
    Bool       invalidate;
    Bool       anyDone = False;
+   HWord      val;
+   Int        n_getIts = 0; /* GetIt bindings in aenv */
 
    HashHW* tenv = newHHW(); /* :: IRTemp -> IRTemp */
-   HashHW* aenv = newHHW(); /* :: AvailExpr* -> IRTemp */
+   HashHW* aenv = newHHW_with( hashHW_AvailExpr, eqHW_AvailExpr );
+                            /* :: AvailExpr* -> IRTemp */
 
    vassert(sizeof(IRTemp) <= sizeof(HWord));
 
@@ -3793,7 +4059,7 @@ static Bool do_cse_BB ( IRSB* bb )
             vpanic("do_cse_BB(1)");
       }
 
-      if (paranoia > 0) {
+      if (paranoia > 0 && n_getIts > 0) {
          for (j = 0; j < aenv->used; j++) {
             if (!aenv->inuse[j])
                continue;
@@ -3833,7 +4099,7 @@ static Bool do_cse_BB ( IRSB* bb )
 
             if (invalidate) {
                aenv->inuse[j] = False;
-               aenv->key[j]   = (HWord)NULL;  /* be sure */
+               n_getIts--;
             }
          } /* for j */
       } /* paranoia > 0 */
@@ -3855,16 +4121,12 @@ static Bool do_cse_BB ( IRSB* bb )
       /* apply tenv */
       subst_AvailExpr( tenv, eprime );
 
-      /* search aenv for eprime, unfortunately the hard way */
-      for (j = 0; j < aenv->used; j++)
-         if (aenv->inuse[j] && eq_AvailExpr(eprime, (AvailExpr*)aenv->key[j]))
-            break;
-
-      if (j < aenv->used) {
+      /* search aenv for eprime */
+      if (lookupHHW( aenv, &val, (HWord)eprime )) {
          /* A binding E' -> q was found.  Replace stmt by "t = q" and
             note the t->q binding in tenv. */
          /* (this is the core of the CSE action) */
-         q = (IRTemp)aenv->val[j];
+         q = (IRTemp)val;
          bb->stmts[i] = IRStmt_WrTmp( t, IRExpr_RdTmp(q) );
          addToHHW( tenv, (HWord)t, (HWord)q );
          anyDone = True;
@@ -3874,6 +4136,8 @@ static Bool do_cse_BB ( IRSB* bb )
             with "t = E'", and move on. */
          bb->stmts[i] = IRStmt_WrTmp( t, availExpr_to_IRExpr(eprime) );
          addToHHW( aenv, (HWord)eprime, (HWord)t );
+         if (eprime->tag == GetIt)
+            n_getIts++;
       }
    }
 
@@ -4769,6 +5033,384 @@ static IRSB* maybe_loop_unroll_BB ( IRSB* bb0, Addr64 my_addr )
 }
 
 
+/*---------------------------------------------------------------*/
+/*--- Induction variables and memory values in unrolled loops ---*/
+/*---------------------------------------------------------------*/
+
+/* Once maybe_loop_unroll_BB has done its work, a self-looping
+   superblock is a straight run of copies of the loop body, each
+   ending in the loop's exit test, and jumps back to itself.  So
+   within one run of the translation the copies are the iterations.
+   Redundant-GET removal already carries guest registers from one
+   copy to the next in temps, and CSE shares invariant GETs, address
+   computations and helper calls between copies; do_loop_hoist_BB
+   later moves those out of the loop altogether.  What none of them
+   does is:
+
+   - strength reduction.  An induction variable stepped by a constant
+     turns into a chain t2 = t1+c, t3 = t2+c, ... which serialises the
+     copies, and each copy recomputes addresses such as
+     Add64(b,Shl64(i,3)) from scratch.  Here every such value is
+     rewritten as base + constant, where base is a value the first
+     copy already computed.  The chains go away and the later copies'
+     addresses become base + displacement, which the instruction
+     selectors fold into the addressing mode.
+
+   - memory values.  CSE does not touch loads.  Loads from the same
+     address in later copies reuse the first one, and loads of a
+     location the loop itself stored to are forwarded the stored
+     value, as long as nothing in between might have written it.
+     That keeps loop variables the guest spills to its stack in
+     temps from one iteration to the next.
+
+   Both rely on the affine form of a temp: t == base + off, where
+   base is a temp defined no later than t (t itself if nothing better
+   is known).  Addresses with the same base and different offsets
+   are known not to alias; anything else might. */
+
+/* For the 32- and 64-bit integer ops that the forms understand, the
+   op kind and the result type. */
+typedef
+   enum { LAdd, LSub, LShl, LMul, LOther }
+   LoopOpKind;
+
+static LoopOpKind loopOpKind ( IROp op, /*OUT*/IRType* ty )
+{
+   switch (op) {
+      case Iop_Add32: *ty = Ity_I32; return LAdd;
+      case Iop_Add64: *ty = Ity_I64; return LAdd;
+      case Iop_Sub32: *ty = Ity_I32; return LSub;
+      case Iop_Sub64: *ty = Ity_I64; return LSub;
+      case Iop_Shl32: *ty = Ity_I32; return LShl;
+      case Iop_Shl64: *ty = Ity_I64; return LShl;
+      case Iop_Mul32: *ty = Ity_I32; return LMul;
+      case Iop_Mul64: *ty = Ity_I64; return LMul;
+      default:        *ty = Ity_INVALID; return LOther;
+   }
+}
+
+static inline ULong loopTrunc ( IRType ty, ULong v )
+{
+   return ty == Ity_I32 ? (ULong)(UInt)v : v;
+}
+
+static IRExpr* loopMkConst ( IRType ty, ULong v )
+{
+   return ty == Ity_I32 ? IRExpr_Const(IRConst_U32((UInt)v))
+                        : IRExpr_Const(IRConst_U64(v));
+}
+
+/* base + off, as a flat expression. */
+static IRExpr* loopMkAffine ( IRType ty, IRTemp base, ULong off )
+{
+   off = loopTrunc(ty, off);
+   if (off == 0)
+      return IRExpr_RdTmp(base);
+   return IRExpr_Binop(ty == Ity_I32 ? Iop_Add32 : Iop_Add64,
+                       IRExpr_RdTmp(base), loopMkConst(ty, off));
+}
+
+/* A known value of a combination of bases: op(a,b) == res + off,
+   where b is a temp for LAdd/LSub and a shift or multiply amount
+   otherwise. */
+typedef
+   struct {
+      LoopOpKind kind;
+      IRType     ty;
+      IRTemp     a;
+      ULong      b;
+      IRTemp     res;
+      ULong      off;
+   }
+   LoopCombo;
+
+/* A memory location whose contents are known, because it was loaded
+   or stored: ty-sized, at base+off (or absolute address off if base
+   is IRTemp_INVALID), holding the atom val. */
+typedef
+   struct {
+      IRTemp     base;
+      ULong      off;
+      IRType     ty;
+      IREndness  end;
+      IRExpr*    val;
+   }
+   LoopMemVal;
+
+#define N_LOOP_MEMVALS 32
+
+/* May a szA-byte access at offA and a szB-byte one at offB, both
+   from the same base, overlap?  Say yes unless they are clearly
+   apart. */
+static Bool loopOffsetsOverlap ( IRType aty, ULong offA, Int szA,
+                                 ULong offB, Int szB )
+{
+   Long d = aty == Ity_I32 ? (Long)(Int)(UInt)(offB - offA)
+                           : (Long)(offB - offA);
+   if (d >= szA || d <= -(Long)szB)
+      return False;
+   return True;
+}
+
+/* The affine form of an address atom.  Returns False for things it
+   can't describe. */
+static Bool loopAddrForm ( IRTemp* fbase, ULong* foff, IRType aty,
+                           IRExpr* addr,
+                           /*OUT*/IRTemp* base, /*OUT*/ULong* off )
+{
+   if (addr->tag == Iex_RdTmp) {
+      IRTemp t = addr->Iex.RdTmp.tmp;
+      *base = fbase[t];
+      *off  = foff[t];
+      return True;
+   }
+   if (addr->tag == Iex_Const) {
+      IRConst* c = addr->Iex.Const.con;
+      *base = IRTemp_INVALID;
+      if (c->tag == Ico_U32) { *off = c->Ico.U32; return aty == Ity_I32; }
+      if (c->tag == Ico_U64) { *off = c->Ico.U64; return aty == Ity_I64; }
+   }
+   return False;
+}
+
+/* Rewrite bb, which must be flat, in place.  Returns True if
+   anything changed. */
+static Bool do_loop_ivs_and_memvals_BB ( IRSB* bb )
+{
+   Int        i, j, n_combos = 0, n_memvals = 0;
+   Int        n_tmps = bb->tyenv->types_used;
+   IRTemp*    fbase  = LibVEX_Alloc(n_tmps * sizeof(IRTemp));
+   ULong*     foff   = LibVEX_Alloc(n_tmps * sizeof(ULong));
+   LoopCombo* combos = LibVEX_Alloc(bb->stmts_used * sizeof(LoopCombo));
+   LoopMemVal memvals[N_LOOP_MEMVALS];
+   Bool       changed = False;
+
+   for (i = 0; i < n_tmps; i++) {
+      fbase[i] = (IRTemp)i;
+      foff[i]  = 0;
+   }
+
+   for (i = 0; i < bb->stmts_used; i++) {
+      IRStmt* st = bb->stmts[i];
+      switch (st->tag) {
+
+         case Ist_WrTmp: {
+            IRTemp     t = st->Ist.WrTmp.tmp;
+            IRExpr*    e = st->Ist.WrTmp.data;
+            IRType     ty;
+            LoopOpKind k;
+
+            if (e->tag == Iex_RdTmp) {
+               fbase[t] = fbase[e->Iex.RdTmp.tmp];
+               foff[t]  = foff[e->Iex.RdTmp.tmp];
+               break;
+            }
+
+            if (e->tag == Iex_Load) {
+               IRType    aty = typeOfIRExpr(bb->tyenv, e->Iex.Load.addr);
+               IRTemp    base;
+               ULong     off;
+               if (!loopAddrForm(fbase, foff, aty, e->Iex.Load.addr,
+                                 &base, &off))
+                  break;
+               off = loopTrunc(aty, off);
+               for (j = n_memvals-1; j >= 0; j--) {
+                  if (memvals[j].base == base && memvals[j].off == off
+                      && memvals[j].ty == e->Iex.Load.ty
+                      && memvals[j].end == e->Iex.Load.end)
+                     break;
+               }
+               if (j >= 0) {
+                  bb->stmts[i] = IRStmt_WrTmp(t, memvals[j].val);
+                  if (memvals[j].val->tag == Iex_RdTmp) {
+                     fbase[t] = fbase[memvals[j].val->Iex.RdTmp.tmp];
+                     foff[t]  = foff[memvals[j].val->Iex.RdTmp.tmp];
+                  }
+                  changed = True;
+                  break;
+               }
+               if (n_memvals == N_LOOP_MEMVALS) {
+                  for (j = 1; j < n_memvals; j++)
+                     memvals[j-1] = memvals[j];
+                  n_memvals--;
+               }
+               memvals[n_memvals].base = base;
+               memvals[n_memvals].off  = off;
+               memvals[n_memvals].ty   = e->Iex.Load.ty;
+               memvals[n_memvals].end  = e->Iex.Load.end;
+               memvals[n_memvals].val  = IRExpr_RdTmp(t);
+               n_memvals++;
+               break;
+            }
+
+            if (e->tag != Iex_Binop)
+               break;
+            k = loopOpKind(e->Iex.Binop.op, &ty);
+            if (k == LOther)
+               break;
+
+            IRExpr* a1 = e->Iex.Binop.arg1;
+            IRExpr* a2 = e->Iex.Binop.arg2;
+
+            /* t = x +/- const, or const + x */
+            if ((k == LAdd || k == LSub)
+                && a1->tag == Iex_RdTmp && a2->tag == Iex_Const) {
+               IRTemp x = a1->Iex.RdTmp.tmp;
+               ULong  c = ty == Ity_I32 ? (ULong)a2->Iex.Const.con->Ico.U32
+                                        : a2->Iex.Const.con->Ico.U64;
+               fbase[t] = fbase[x];
+               foff[t]  = loopTrunc(ty, k == LAdd ? foff[x] + c
+                                                  : foff[x] - c);
+               if (fbase[x] != x) {
+                  bb->stmts[i]
+                     = IRStmt_WrTmp(t, loopMkAffine(ty, fbase[t], foff[t]));
+                  changed = True;
+               }
+               break;
+            }
+            if (k == LAdd && a1->tag == Iex_Const && a2->tag == Iex_RdTmp) {
+               IRTemp x = a2->Iex.RdTmp.tmp;
+               ULong  c = ty == Ity_I32 ? (ULong)a1->Iex.Const.con->Ico.U32
+                                        : a1->Iex.Const.con->Ico.U64;
+               fbase[t] = fbase[x];
+               foff[t]  = loopTrunc(ty, foff[x] + c);
+               if (fbase[x] != x) {
+                  bb->stmts[i]
+                     = IRStmt_WrTmp(t, loopMkAffine(ty, fbase[t], foff[t]));
+                  changed = True;
+               }
+               break;
+            }
+
+            /* t = x +/- y, x << const, x * const: look for an earlier
+               value of the same combination of bases. */
+            IRTemp ca;
+            ULong  cb, off;
+            if ((k == LAdd || k == LSub)
+                && a1->tag == Iex_RdTmp && a2->tag == Iex_RdTmp) {
+               IRTemp x = a1->Iex.RdTmp.tmp, y = a2->Iex.RdTmp.tmp;
+               ca  = fbase[x];
+               cb  = (ULong)fbase[y];
+               off = k == LAdd ? foff[x] + foff[y] : foff[x] - foff[y];
+               /* Addition commutes, so order the bases. */
+               if (k == LAdd && (ULong)ca > cb) {
+                  IRTemp tmp = ca; ca = (IRTemp)cb; cb = (ULong)tmp;
+               }
+            }
+            else
+            if ((k == LShl || k == LMul)
+                && a1->tag == Iex_RdTmp && a2->tag == Iex_Const) {
+               IRTemp x = a1->Iex.RdTmp.tmp;
+               IRConst* c = a2->Iex.Const.con;
+               ca = fbase[x];
+               if (k == LShl) {
+                  vassert(c->tag == Ico_U8);
+                  cb  = c->Ico.U8;
+                  if (cb >= (ty == Ity_I32 ? 32 : 64))
+                     break;
+                  off = foff[x] << cb;
+               } else {
+                  cb  = ty == Ity_I32 ? (ULong)c->Ico.U32 : c->Ico.U64;
+                  off = foff[x] * cb;
+               }
+            }
+            else
+               break;
+            off = loopTrunc(ty, off);
+
+            for (j = 0; j < n_combos; j++) {
+               if (combos[j].kind == k && combos[j].ty == ty
+                   && combos[j].a == ca && combos[j].b == cb)
+                  break;
+            }
+            if (j < n_combos) {
+               /* op(bases) == res + roff, so t == res + roff + off */
+               fbase[t] = combos[j].res;
+               foff[t]  = loopTrunc(ty, combos[j].off + off);
+               bb->stmts[i]
+                  = IRStmt_WrTmp(t, loopMkAffine(ty, fbase[t], foff[t]));
+               changed = True;
+            } else {
+               /* First sighting: t == op(bases) + off, so op(bases)
+                  == t - off.  Leave the stmt alone; t becomes the
+                  base for later ones. */
+               vassert(n_combos < bb->stmts_used);
+               combos[n_combos].kind = k;
+               combos[n_combos].ty   = ty;
+               combos[n_combos].a    = ca;
+               combos[n_combos].b    = cb;
+               combos[n_combos].res  = t;
+               combos[n_combos].off  = loopTrunc(ty, 0 - off);
+               n_combos++;
+            }
+            break;
+         }
+
+         case Ist_Store: {
+            IRExpr* addr = st->Ist.Store.addr;
+            IRExpr* data = st->Ist.Store.data;
+            IRType  aty  = typeOfIRExpr(bb->tyenv, addr);
+            IRType  dty  = typeOfIRExpr(bb->tyenv, data);
+            IRTemp  base;
+            ULong   off;
+            Int     w;
+            if (!loopAddrForm(fbase, foff, aty, addr, &base, &off)) {
+               n_memvals = 0;
+               break;
+            }
+            off = loopTrunc(aty, off);
+            /* Forget everything the store might overwrite: anything
+               off a different base, and anything overlapping it off
+               the same one. */
+            for (j = 0, w = 0; j < n_memvals; j++) {
+               if (memvals[j].base == base
+                   && !loopOffsetsOverlap(aty, memvals[j].off,
+                                          sizeofIRType(memvals[j].ty),
+                                          off, sizeofIRType(dty)))
+                  memvals[w++] = memvals[j];
+            }
+            n_memvals = w;
+            if (n_memvals == N_LOOP_MEMVALS) {
+               for (j = 1; j < n_memvals; j++)
+                  memvals[j-1] = memvals[j];
+               n_memvals--;
+            }
+            vassert(n_memvals < N_LOOP_MEMVALS);
+            memvals[n_memvals].base = base;
+            memvals[n_memvals].off  = off;
+            memvals[n_memvals].ty   = dty;
+            memvals[n_memvals].end  = st->Ist.Store.end;
+            memvals[n_memvals].val  = data;
+            n_memvals++;
+            break;
+         }
+
+         case Ist_StoreG:
+         case Ist_CAS:
+         case Ist_LLSC:
+         case Ist_Dirty:
+         case Ist_MBE:
+            /* Might write memory, or order it with respect to other
+               threads. */
+            n_memvals = 0;
+            break;
+
+         case Ist_LoadG: {
+            IRTemp dst = st->Ist.LoadG.details->dst;
+            fbase[dst] = dst;
+            foff[dst]  = 0;
+            break;
+         }
+
+         default:
+            break;
+      }
+   }
+
+   return changed;
+}
+
+
 /*---------------------------------------------------------------*/
 /*--- The tree builder                                        ---*/
 /*---------------------------------------------------------------*/
@@ -5785,6 +6427,783 @@ static Interval stmt_modifies_guest_state ( IRSB *bb, const IRStmt *st,
 }
 
 
+/*---------------------------------------------------------------*/
+/*--- Loop-invariant code motion                              ---*/
+/*---------------------------------------------------------------*/
+
+/* For a block which jumps back to its own start, and a host which
+   can loop within a translation, move values which are the same on
+   every iteration into a preheader, computed once per entry to the
+   translation, rather than once per iteration.  This works on the
+   trees, just before instruction selection, so that nothing later
+   moves them back.
+
+   The preheader is the stmts before the first IMark.  Each binds an
+   integer temp (I8 to I64), or puts the guest IP, and the host keeps
+   the temps in registers round the loop; hence the limit of n_regs
+   of them.  Any loop body tree or maximal subtree which reads guest
+   state or memory or calls a helper, and does so invariantly, goes
+   there.  That is:
+
+   - a GET, if the body doesn't write any of it.  PUTs, PUTIs and
+     dirty helpers' guest state effects count as writes.
+
+   - a load from an invariant address, if the body doesn't write
+     memory which might overlap it.  Each store must be to a pure
+     invariant base plus a constant; the load must be off the same
+     base, clear of all of them.  Any other kind of write to memory,
+     a memory barrier or a dirty helper call stops all loads being
+     hoisted.
+
+   - a clean helper call, op or ITE of invariant args, and a temp
+     the preheader binds.  So is a temp the body binds to something
+     invariant which can't fault, such as an address off an
+     invariant base; its binding is copied into the preheader where
+     needed, as it is too cheap to be worth a register of its own.
+
+   A load, or an integer division, may fault.  It is only hoisted if
+   everything in the body before it has been hoisted too, or can't
+   fault, leave the block or change guest state that must be precise
+   at memory exceptions; so that the first iteration gets to it in
+   the same guest state.  The preheader puts the insn's address in
+   the guest IP before it, and puts the block's own address back
+   at the end.
+
+   A block which ends "if (c) goto <itself>; goto X" has its test
+   turned round, so that it ends with the jump to itself. */
+
+/* A store's address, split as base + off. */
+typedef
+   struct {
+      IRExpr* base;
+      ULong   off;
+      Int     szB;
+   }
+   LoopStore;
+
+typedef
+   struct {
+      IRTypeEnv* tyenv;
+      IRType     aty;
+      Int        offsIP;
+      Int        szIP;
+      /* Guest state [wr_lo[k] .. wr_hi[k]] is written in the body. */
+      Int*       wr_lo;
+      Int*       wr_hi;
+      Int        n_wr;
+      /* The body's stores, unless mem_unknown, in which case loads
+         aren't hoisted at all. */
+      LoopStore* st;
+      Int        n_st;
+      Bool       mem_unknown;
+      /* What the body binds each temp to, whether that is a pure
+         invariant value, and the temps the preheader binds. */
+      IRExpr**   def;
+      Bool*      pure;
+      Bool*      hoisted;
+      /* May the stmt being looked at have things hoisted from it
+         which might fault? */
+      Bool       faults_ok;
+      /* The preheader so far, the number of temps it may yet bind,
+         the guest IP as it leaves it, and the address of the insn
+         being looked at. */
+      IRStmt**   pre;
+      Int        n_pre;
+      Int        n_left;
+      Addr64     pre_ip;
+      Addr64     cur_ip;
+   }
+   LoopHoistEnv;
+
+static Bool loopHoistTy ( IRType ty )
+{
+   return ty == Ity_I8 || ty == Ity_I16 || ty == Ity_I32 || ty == Ity_I64;
+}
+
+/* Might op fault, given some args? */
+static Bool loopOpMayFault ( IROp op )
+{
+   switch (op) {
+      case Iop_DivU32:  case Iop_DivS32:  case Iop_DivU64:  case Iop_DivS64:
+      case Iop_DivU32E: case Iop_DivS32E: case Iop_DivU64E: case Iop_DivS64E:
+      case Iop_DivModU64to32:  case Iop_DivModS64to32:
+      case Iop_DivModU128to64: case Iop_DivModS128to64:
+      case Iop_DivModS64to64:
+         return True;
+      default:
+         return False;
+   }
+}
+
+static Bool loopExprMayFault ( IRExpr* e )
+{
+   Int i;
+   switch (e->tag) {
+      case Iex_Load:
+         return True;
+      case Iex_Unop:
+         return loopExprMayFault(e->Iex.Unop.arg);
+      case Iex_Binop:
+         return loopOpMayFault(e->Iex.Binop.op)
+                || loopExprMayFault(e->Iex.Binop.arg1)
+                || loopExprMayFault(e->Iex.Binop.arg2);
+      case Iex_Triop:
+         return loopExprMayFault(e->Iex.Triop.details->arg1)
+                || loopExprMayFault(e->Iex.Triop.details->arg2)
+                || loopExprMayFault(e->Iex.Triop.details->arg3);
+      case Iex_Qop:
+         return loopExprMayFault(e->Iex.Qop.details->arg1)
+                || loopExprMayFault(e->Iex.Qop.details->arg2)
+                || loopExprMayFault(e->Iex.Qop.details->arg3)
+                || loopExprMayFault(e->Iex.Qop.details->arg4);
+      case Iex_ITE:
+         return loopExprMayFault(e->Iex.ITE.cond)
+                || loopExprMayFault(e->Iex.ITE.iftrue)
+                || loopExprMayFault(e->Iex.ITE.iffalse);
+      case Iex_CCall:
+         for (i = 0; e->Iex.CCall.args[i]; i++)
+            if (loopExprMayFault(e->Iex.CCall.args[i]))
+               return True;
+         return False;
+      case Iex_GetI:
+         return loopExprMayFault(e->Iex.GetI.ix);
+      default:
+         return False;
+   }
+}
+
+/* Do a and b compute the same value, given that both are
+   invariant? */
+static Bool loopSameExpr ( IRExpr* a, IRExpr* b )
+{
+   Int i;
+   if (a->tag != b->tag)
+      return False;
+   switch (a->tag) {
+      case Iex_Const:
+         return eqIRConst(a->Iex.Const.con, b->Iex.Const.con);
+      case Iex_RdTmp:
+         return a->Iex.RdTmp.tmp == b->Iex.RdTmp.tmp;
+      case Iex_Get:
+         return a->Iex.Get.offset == b->Iex.Get.offset
+                && a->Iex.Get.ty == b->Iex.Get.ty;
+      case Iex_Load:
+         return a->Iex.Load.end == b->Iex.Load.end
+                && a->Iex.Load.ty == b->Iex.Load.ty
+                && loopSameExpr(a->Iex.Load.addr, b->Iex.Load.addr);
+      case Iex_Unop:
+         return a->Iex.Unop.op == b->Iex.Unop.op
+                && loopSameExpr(a->Iex.Unop.arg, b->Iex.Unop.arg);
+      case Iex_Binop:
+         return a->Iex.Binop.op == b->Iex.Binop.op
+                && loopSameExpr(a->Iex.Binop.arg1, b->Iex.Binop.arg1)
+                && loopSameExpr(a->Iex.Binop.arg2, b->Iex.Binop.arg2);
+      case Iex_Triop:
+         return a->Iex.Triop.details->op == b->Iex.Triop.details->op
+                && loopSameExpr(a->Iex.Triop.details->arg1,
+                                b->Iex.Triop.details->arg1)
+                && loopSameExpr(a->Iex.Triop.details->arg2,
+                                b->Iex.Triop.details->arg2)
+                && loopSameExpr(a->Iex.Triop.details->arg3,
+                                b->Iex.Triop.details->arg3);
+      case Iex_Qop:
+         return a->Iex.Qop.details->op == b->Iex.Qop.details->op
+                && loopSameExpr(a->Iex.Qop.details->arg1,
+                                b->Iex.Qop.details->arg1)
+                && loopSameExpr(a->Iex.Qop.details->arg2,
+                                b->Iex.Qop.details->arg2)
+                && loopSameExpr(a->Iex.Qop.details->arg3,
+                                b->Iex.Qop.details->arg3)
+                && loopSameExpr(a->Iex.Qop.details->arg4,
+                                b->Iex.Qop.details->arg4);
+      case Iex_ITE:
+         return loopSameExpr(a->Iex.ITE.cond, b->Iex.ITE.cond)
+                && loopSameExpr(a->Iex.ITE.iftrue, b->Iex.ITE.iftrue)
+                && loopSameExpr(a->Iex.ITE.iffalse, b->Iex.ITE.iffalse);
+      case Iex_CCall:
+         if (a->Iex.CCall.cee->addr != b->Iex.CCall.cee->addr
+             || a->Iex.CCall.retty != b->Iex.CCall.retty)
+            return False;
+         for (i = 0; a->Iex.CCall.args[i] && b->Iex.CCall.args[i]; i++)
+            if (!loopSameExpr(a->Iex.CCall.args[i], b->Iex.CCall.args[i]))
+               return False;
+         return a->Iex.CCall.args[i] == NULL && b->Iex.CCall.args[i] == NULL;
+      default:
+         return False;
+   }
+}
+
+/* Split an address as base + off, with off constant, looking
+   through temps bound to pure values. */
+static void loopSplitAddr ( LoopHoistEnv* L, IRExpr* addr,
+                            /*OUT*/IRExpr** base, /*OUT*/ULong* off )
+{
+   IRConst* c;
+   ULong    v;
+   *off = 0;
+   while (True) {
+      if (addr->tag == Iex_RdTmp && L->pure[addr->Iex.RdTmp.tmp]
+          && L->def[addr->Iex.RdTmp.tmp]) {
+         addr = L->def[addr->Iex.RdTmp.tmp];
+         continue;
+      }
+      if (addr->tag != Iex_Binop)
+         break;
+      if (addr->Iex.Binop.op != Iop_Add32 && addr->Iex.Binop.op != Iop_Add64
+          && addr->Iex.Binop.op != Iop_Sub32
+          && addr->Iex.Binop.op != Iop_Sub64)
+         break;
+      if (addr->Iex.Binop.arg2->tag == Iex_Const) {
+         c = addr->Iex.Binop.arg2->Iex.Const.con;
+         v = c->tag == Ico_U32 ? (ULong)c->Ico.U32 : c->Ico.U64;
+         if (addr->Iex.Binop.op == Iop_Sub32
+             || addr->Iex.Binop.op == Iop_Sub64)
+            v = 0 - v;
+         *off += v;
+         addr = addr->Iex.Binop.arg1;
+      } else if (addr->Iex.Binop.arg1->tag == Iex_Const
+                 && (addr->Iex.Binop.op == Iop_Add32
+                     || addr->Iex.Binop.op == Iop_Add64)) {
+         c = addr->Iex.Binop.arg1->Iex.Const.con;
+         *off += c->tag == Ico_U32 ? (ULong)c->Ico.U32 : c->Ico.U64;
+         addr = addr->Iex.Binop.arg2;
+      } else {
+         break;
+      }
+   }
+   *base = addr;
+}
+
+/* Does the body write any of guest state [off, off+szB)? */
+static Bool loopGuestWritten ( LoopHoistEnv* L, Int off, Int szB )
+{
+   Int k;
+   for (k = 0; k < L->n_wr; k++)
+      if (off <= L->wr_hi[k] && off + szB - 1 >= L->wr_lo[k])
+         return True;
+   return False;
+}
+
+static void loopAddGuestWrite ( LoopHoistEnv* L, Int lo, Int hi )
+{
+   L->wr_lo[L->n_wr] = lo;
+   L->wr_hi[L->n_wr] = hi;
+   L->n_wr++;
+}
+
+/* Is e's value the same every time the body computes it?  Unlike
+   loopInvariant this allows temps the body binds, but not loads;
+   it is for store addresses. */
+static Bool loopPure ( LoopHoistEnv* L, IRExpr* e )
+{
+   Int i;
+   switch (e->tag) {
+      case Iex_Const:
+         return True;
+      case Iex_RdTmp:
+         return L->pure[e->Iex.RdTmp.tmp];
+      case Iex_Get:
+         return !loopGuestWritten(L, e->Iex.Get.offset,
+                                  sizeofIRType(e->Iex.Get.ty));
+      case Iex_Unop:
+         return loopPure(L, e->Iex.Unop.arg);
+      case Iex_Binop:
+         return loopPure(L, e->Iex.Binop.arg1)
+                && loopPure(L, e->Iex.Binop.arg2);
+      case Iex_Triop:
+         return loopPure(L, e->Iex.Triop.details->arg1)
+                && loopPure(L, e->Iex.Triop.details->arg2)
+                && loopPure(L, e->Iex.Triop.details->arg3);
+      case Iex_Qop:
+         return loopPure(L, e->Iex.Qop.details->arg1)
+                && loopPure(L, e->Iex.Qop.details->arg2)
+                && loopPure(L, e->Iex.Qop.details->arg3)
+                && loopPure(L, e->Iex.Qop.details->arg4);
+      case Iex_ITE:
+         return loopPure(L, e->Iex.ITE.cond)
+                && loopPure(L, e->Iex.ITE.iftrue)
+                && loopPure(L, e->Iex.ITE.iffalse);
+      case Iex_CCall:
+         for (i = 0; e->Iex.CCall.args[i]; i++)
+            if (!loopPure(L, e->Iex.CCall.args[i]))
+               return False;
+         return True;
+      default:
+         return False;
+   }
+}
+
+/* Can e be computed in the preheader, instead of where it is?  If
+   so, *worth says whether it reads guest state or memory or calls a
+   helper, and *faults whether it might fault. */
+static Bool loopInvariant ( LoopHoistEnv* L, IRExpr* e,
+                            /*MOD*/Bool* worth, /*MOD*/Bool* faults )
+{
+   IRExpr* base;
+   ULong   off;
+   Int     i, szB;
+   switch (e->tag) {
+      case Iex_Const:
+         return True;
+      case Iex_RdTmp:
+         if (L->hoisted[e->Iex.RdTmp.tmp])
+            return True;
+         return L->def[e->Iex.RdTmp.tmp] != NULL
+                && !loopExprMayFault(L->def[e->Iex.RdTmp.tmp])
+                && loopInvariant(L, L->def[e->Iex.RdTmp.tmp], worth, faults);
+      case Iex_Get:
+         /* The preheader itself puts the guest IP. */
+         szB = sizeofIRType(e->Iex.Get.ty);
+         if (e->Iex.Get.offset < L->offsIP + L->szIP
+             && e->Iex.Get.offset + szB > L->offsIP)
+            return False;
+         if (loopGuestWritten(L, e->Iex.Get.offset, szB))
+            return False;
+         *worth = True;
+         return True;
+      case Iex_Load:
+         if (L->mem_unknown || !L->faults_ok)
+            return False;
+         if (!loopInvariant(L, e->Iex.Load.addr, worth, faults))
+            return False;
+         loopSplitAddr(L, e->Iex.Load.addr, &base, &off);
+         szB = sizeofIRType(e->Iex.Load.ty);
+         for (i = 0; i < L->n_st; i++)
+            if (!loopSameExpr(base, L->st[i].base)
+                || loopOffsetsOverlap(L->aty, off, szB,
+                                      L->st[i].off, L->st[i].szB))
+               return False;
+         *worth  = True;
+         *faults = True;
+         return True;
+      case Iex_Unop:
+         return loopInvariant(L, e->Iex.Unop.arg, worth, faults);
+      case Iex_Binop:
+         if (loopOpMayFault(e->Iex.Binop.op)) {
+            if (!L->faults_ok)
+               return False;
+            *faults = True;
+         }
+         return loopInvariant(L, e->Iex.Binop.arg1, worth, faults)
+                && loopInvariant(L, e->Iex.Binop.arg2, worth, faults);
+      case Iex_Triop:
+         return loopInvariant(L, e->Iex.Triop.details->arg1, worth, faults)
+                && loopInvariant(L, e->Iex.Triop.details->arg2, worth, faults)
+                && loopInvariant(L, e->Iex.Triop.details->arg3, worth, faults);
+      case Iex_Qop:
+         return loopInvariant(L, e->Iex.Qop.details->arg1, worth, faults)
+                && loopInvariant(L, e->Iex.Qop.details->arg2, worth, faults)
+                && loopInvariant(L, e->Iex.Qop.details->arg3, worth, faults)
+                && loopInvariant(L, e->Iex.Qop.details->arg4, worth, faults);
+      case Iex_ITE:
+         return loopInvariant(L, e->Iex.ITE.cond, worth, faults)
+                && loopInvariant(L, e->Iex.ITE.iftrue, worth, faults)
+                && loopInvariant(L, e->Iex.ITE.iffalse, worth, faults);
+      case Iex_CCall:
+         for (i = 0; e->Iex.CCall.args[i]; i++)
+            if (!loopInvariant(L, e->Iex.CCall.args[i], worth, faults))
+               return False;
+         *worth = True;
+         return True;
+      default:
+         return False;
+   }
+}
+
+/* Invariant e, with the bindings of any temps the preheader doesn't
+   bind copied in. */
+static IRExpr* loopInline ( LoopHoistEnv* L, IRExpr* e )
+{
+   IRExpr** args;
+   Int      i;
+   switch (e->tag) {
+      case Iex_RdTmp:
+         if (L->hoisted[e->Iex.RdTmp.tmp])
+            return e;
+         vassert(L->def[e->Iex.RdTmp.tmp]);
+         return loopInline(L, L->def[e->Iex.RdTmp.tmp]);
+      case Iex_Load:
+         return IRExpr_Load(e->Iex.Load.end, e->Iex.Load.ty,
+                            loopInline(L, e->Iex.Load.addr));
+      case Iex_Unop:
+         return IRExpr_Unop(e->Iex.Unop.op, loopInline(L, e->Iex.Unop.arg));
+      case Iex_Binop:
+         return IRExpr_Binop(e->Iex.Binop.op,
+                             loopInline(L, e->Iex.Binop.arg1),
+                             loopInline(L, e->Iex.Binop.arg2));
+      case Iex_Triop:
+         return IRExpr_Triop(e->Iex.Triop.details->op,
+                             loopInline(L, e->Iex.Triop.details->arg1),
+                             loopInline(L, e->Iex.Triop.details->arg2),
+                             loopInline(L, e->Iex.Triop.details->arg3));
+      case Iex_Qop:
+         return IRExpr_Qop(e->Iex.Qop.details->op,
+                           loopInline(L, e->Iex.Qop.details->arg1),
+                           loopInline(L, e->Iex.Qop.details->arg2),
+                           loopInline(L, e->Iex.Qop.details->arg3),
+                           loopInline(L, e->Iex.Qop.details->arg4));
+      case Iex_ITE:
+         return IRExpr_ITE(loopInline(L, e->Iex.ITE.cond),
+                           loopInline(L, e->Iex.ITE.iftrue),
+                           loopInline(L, e->Iex.ITE.iffalse));
+      case Iex_CCall:
+         args = shallowCopyIRExprVec(e->Iex.CCall.args);
+         for (i = 0; args[i]; i++)
+            args[i] = loopInline(L, args[i]);
+         return IRExpr_CCall(e->Iex.CCall.cee, e->Iex.CCall.retty, args);
+      default:
+         return e;
+   }
+}
+
+/* Add WrTmp(t, e) to the preheader. */
+static void loopAddToPreheader ( LoopHoistEnv* L, IRTemp t, IRExpr* e,
+                                 Bool faults )
+{
+   vassert(L->n_left > 0);
+   if (faults && L->pre_ip != L->cur_ip) {
+      L->pre[L->n_pre++] = IRStmt_Put(L->offsIP,
+                                      loopMkConst(L->aty, L->cur_ip));
+      L->pre_ip = L->cur_ip;
+   }
+   L->pre[L->n_pre++] = IRStmt_WrTmp(t, loopInline(L, e));
+   L->hoisted[t]      = True;
+   L->n_left--;
+}
+
+/* e, with each maximal subtree worth moving to the preheader moved
+   there, as far as there are registers for them. */
+static IRExpr* loopHoistIn ( LoopHoistEnv* L, IRExpr* e )
+{
+   Bool      worth = False, faults = False, faults_ok, inv;
+   IRType    ty;
+   IRTemp    t;
+   IRExpr    *a1, *a2, *a3, *a4;
+   IRExpr**  args;
+   Int       i;
+
+   if (L->n_pre == 0 && L->n_left == 0)
+      return e;
+
+   /* The preheader's existing temps can be used even where nothing
+      more may be hoisted, because the registers have run out or
+      because of faults. */
+   ty        = typeOfIRExpr(L->tyenv, e);
+   faults_ok = L->faults_ok;
+   L->faults_ok = True;
+   inv = loopHoistTy(ty) && loopInvariant(L, e, &worth, &faults) && worth;
+   L->faults_ok = faults_ok;
+   if (inv) {
+      a1 = loopInline(L, e);
+      for (i = 0; i < L->n_pre; i++)
+         if (L->pre[i]->tag == Ist_WrTmp
+             && loopSameExpr(L->pre[i]->Ist.WrTmp.data, a1))
+            return IRExpr_RdTmp(L->pre[i]->Ist.WrTmp.tmp);
+      if (L->n_left > 0 && (faults_ok || !faults)) {
+         t = newIRTemp(L->tyenv, ty);
+         loopAddToPreheader(L, t, e, faults);
+         return IRExpr_RdTmp(t);
+      }
+   }
+
+   switch (e->tag) {
+      case Iex_Load:
+         a1 = loopHoistIn(L, e->Iex.Load.addr);
+         if (a1 == e->Iex.Load.addr)
+            return e;
+         return IRExpr_Load(e->Iex.Load.end, e->Iex.Load.ty, a1);
+      case Iex_Unop:
+         a1 = loopHoistIn(L, e->Iex.Unop.arg);
+         if (a1 == e->Iex.Unop.arg)
+            return e;
+         return IRExpr_Unop(e->Iex.Unop.op, a1);
+      case Iex_Binop:
+         a1 = loopHoistIn(L, e->Iex.Binop.arg1);
+         a2 = loopHoistIn(L, e->Iex.Binop.arg2);
+         if (a1 == e->Iex.Binop.arg1 && a2 == e->Iex.Binop.arg2)
+            return e;
+         return IRExpr_Binop(e->Iex.Binop.op, a1, a2);
+      case Iex_Triop:
+         a1 = loopHoistIn(L, e->Iex.Triop.details->arg1);
+         a2 = loopHoistIn(L, e->Iex.Triop.details->arg2);
+         a3 = loopHoistIn(L, e->Iex.Triop.details->arg3);
+         if (a1 == e->Iex.Triop.details->arg1
+             && a2 == e->Iex.Triop.details->arg2
+             && a3 == e->Iex.Triop.details->arg3)
+            return e;
+         return IRExpr_Triop(e->Iex.Triop.details->op, a1, a2, a3);
+      case Iex_Qop:
+         a1 = loopHoistIn(L, e->Iex.Qop.details->arg1);
+         a2 = loopHoistIn(L, e->Iex.Qop.details->arg2);
+         a3 = loopHoistIn(L, e->Iex.Qop.details->arg3);
+         a4 = loopHoistIn(L, e->Iex.Qop.details->arg4);
+         if (a1 == e->Iex.Qop.details->arg1
+             && a2 == e->Iex.Qop.details->arg2
+             && a3 == e->Iex.Qop.details->arg3
+             && a4 == e->Iex.Qop.details->arg4)
+            return e;
+         return IRExpr_Qop(e->Iex.Qop.details->op, a1, a2, a3, a4);
+      case Iex_ITE:
+         a1 = loopHoistIn(L, e->Iex.ITE.cond);
+         a2 = loopHoistIn(L, e->Iex.ITE.iftrue);
+         a3 = loopHoistIn(L, e->Iex.ITE.iffalse);
+         if (a1 == e->Iex.ITE.cond
+             && a2 == e->Iex.ITE.iftrue
+             && a3 == e->Iex.ITE.iffalse)
+            return e;
+         return IRExpr_ITE(a1, a2, a3);
+      case Iex_CCall:
+         args = shallowCopyIRExprVec(e->Iex.CCall.args);
+         a1   = NULL;
+         for (i = 0; args[i]; i++) {
+            args[i] = loopHoistIn(L, args[i]);
+            if (args[i] != e->Iex.CCall.args[i])
+               a1 = args[i];
+         }
+         if (a1 == NULL)
+            return e;
+         return IRExpr_CCall(e->Iex.CCall.cee, e->Iex.CCall.retty, args);
+      default:
+         return e;
+   }
+}
+
+/* Once st is in the body, can things after it that might fault
+   still be hoisted? */
+static Bool loopStmtStopsFaults ( LoopHoistEnv* L, IRStmt* st,
+                                  Bool (*preciseMemExnsFn)(Int,Int) )
+{
+   Int szB;
+   switch (st->tag) {
+      case Ist_NoOp: case Ist_IMark: case Ist_AbiHint:
+         return False;
+      case Ist_WrTmp:
+         return loopExprMayFault(st->Ist.WrTmp.data);
+      case Ist_Put:
+         if (st->Ist.Put.offset == L->offsIP)
+            return loopExprMayFault(st->Ist.Put.data);
+         szB = sizeofIRType(typeOfIRExpr(L->tyenv, st->Ist.Put.data));
+         return loopExprMayFault(st->Ist.Put.data)
+                || preciseMemExnsFn(st->Ist.Put.offset,
+                                    st->Ist.Put.offset + szB - 1);
+      default:
+         return True;
+   }
+}
+
+/* Give bb a preheader, if it jumps back to my_addr and there's
+   anything worth putting there; see above.  bb must be a tree, and
+   is modified in place.  Returns True if it now has a preheader. */
+Bool do_loop_hoist_BB ( IRSB* bb, Addr64 my_addr, Int n_regs,
+                        Bool (*preciseMemExnsFn)(Int,Int) )
+{
+   LoopHoistEnv L;
+   IRStmt*      st;
+   IRStmt**     body;
+   IRStmt*      last = NULL;
+   IRDirty*     d;
+   IRConst*     dst;
+   IRExpr       *e1, *e2;
+   Int          i, k, n_body, n_types, szB, lo;
+   Bool         flip = False, worth, faults;
+
+   if (n_regs <= 0 || bb->jumpkind != Ijk_Boring
+       || bb->next->tag != Iex_Const)
+      return False;
+   dst = bb->next->Iex.Const.con;
+   if (dst->tag != Ico_U32 && dst->tag != Ico_U64)
+      return False;
+   L.aty = dst->tag == Ico_U32 ? Ity_I32 : Ity_I64;
+
+   /* It must start with an IMark, and either end with a jump to
+      itself or with a conditional one just before a jump elsewhere. */
+   for (i = 0; i < bb->stmts_used; i++)
+      if (bb->stmts[i] && bb->stmts[i]->tag != Ist_NoOp)
+         break;
+   if (i == bb->stmts_used || bb->stmts[i]->tag != Ist_IMark)
+      return False;
+   for (i = bb->stmts_used-1; i >= 0; i--)
+      if (bb->stmts[i] && bb->stmts[i]->tag != Ist_NoOp)
+         break;
+   last = bb->stmts[i];
+   if ((dst->tag == Ico_U32 ? (Addr64)dst->Ico.U32 : dst->Ico.U64)
+       != my_addr) {
+      if (last->tag != Ist_Exit || last->Ist.Exit.jk != Ijk_Boring
+          || last->Ist.Exit.offsIP != bb->offsIP
+          || last->Ist.Exit.dst->tag != dst->tag)
+         return False;
+      if ((dst->tag == Ico_U32 ? (Addr64)last->Ist.Exit.dst->Ico.U32
+                               : last->Ist.Exit.dst->Ico.U64) != my_addr)
+         return False;
+      flip = True;
+   }
+
+   L.tyenv       = bb->tyenv;
+   L.offsIP      = bb->offsIP;
+   L.szIP        = sizeofIRType(L.aty);
+   L.n_wr        = 0;
+   L.n_st        = 0;
+   L.mem_unknown = False;
+   L.faults_ok   = True;
+   L.n_pre       = 0;
+   L.n_left      = n_regs;
+   L.pre_ip      = my_addr;
+   L.cur_ip      = my_addr;
+   n_types       = bb->tyenv->types_used + n_regs;
+   L.def         = LibVEX_Alloc(n_types * sizeof(IRExpr*));
+   L.pure        = LibVEX_Alloc(n_types * sizeof(Bool));
+   L.hoisted     = LibVEX_Alloc(n_types * sizeof(Bool));
+   for (i = 0; i < n_types; i++) {
+      L.def[i]  = NULL;
+      L.pure[i] = L.hoisted[i] = False;
+   }
+
+   /* What guest state and memory does the body write? */
+   k = 0;
+   for (i = 0; i < bb->stmts_used; i++) {
+      st = bb->stmts[i];
+      if (st && st->tag == Ist_Dirty)
+         k += st->Ist.Dirty.details->nFxState;
+      else
+         k++;
+   }
+   L.wr_lo = LibVEX_Alloc(k * sizeof(Int));
+   L.wr_hi = LibVEX_Alloc(k * sizeof(Int));
+   L.st    = LibVEX_Alloc(bb->stmts_used * sizeof(LoopStore));
+   for (i = 0; i < bb->stmts_used; i++) {
+      st = bb->stmts[i];
+      if (!st)
+         continue;
+      switch (st->tag) {
+         case Ist_Put:
+            szB = sizeofIRType(typeOfIRExpr(bb->tyenv, st->Ist.Put.data));
+            loopAddGuestWrite(&L, st->Ist.Put.offset,
+                              st->Ist.Put.offset + szB - 1);
+            break;
+         case Ist_PutI:
+            lo  = st->Ist.PutI.details->descr->base;
+            szB = st->Ist.PutI.details->descr->nElems
+                  * sizeofIRType(st->Ist.PutI.details->descr->elemTy);
+            loopAddGuestWrite(&L, lo, lo + szB - 1);
+            break;
+         case Ist_Dirty:
+            d = st->Ist.Dirty.details;
+            for (k = 0; k < d->nFxState; k++) {
+               if (d->fxState[k].fx == Ifx_Read)
+                  continue;
+               lo = d->fxState[k].offset;
+               loopAddGuestWrite(&L, lo, lo + d->fxState[k].size - 1
+                                 + d->fxState[k].nRepeats
+                                   * d->fxState[k].repeatLen);
+            }
+            /* Whatever it declares: some helpers, such as the REP
+               string op ones, touch memory without saying so. */
+            L.mem_unknown = True;
+            break;
+         case Ist_CAS: case Ist_LLSC: case Ist_MBE:
+         case Ist_StoreG:
+            L.mem_unknown = True;
+            break;
+         default:
+            break;
+      }
+   }
+   for (i = 0; i < bb->stmts_used; i++) {
+      st = bb->stmts[i];
+      if (!st)
+         continue;
+      if (st->tag == Ist_WrTmp) {
+         L.def[st->Ist.WrTmp.tmp]  = st->Ist.WrTmp.data;
+         L.pure[st->Ist.WrTmp.tmp] = loopPure(&L, st->Ist.WrTmp.data);
+      } else if (st->tag == Ist_Store) {
+         loopSplitAddr(&L, st->Ist.Store.addr, &L.st[L.n_st].base,
+                       &L.st[L.n_st].off);
+         L.st[L.n_st].szB
+            = sizeofIRType(typeOfIRExpr(bb->tyenv, st->Ist.Store.data));
+         if (!loopPure(&L, L.st[L.n_st].base))
+            L.mem_unknown = True;
+         L.n_st++;
+      }
+   }
+
+   /* Move things out of the body, in order. */
+   L.pre  = LibVEX_Alloc((2 * n_regs + 1) * sizeof(IRStmt*));
+   body   = LibVEX_Alloc(bb->stmts_used * sizeof(IRStmt*));
+   n_body = 0;
+   for (i = 0; i < bb->stmts_used; i++) {
+      st = bb->stmts[i];
+      if (!st)
+         continue;
+      switch (st->tag) {
+         case Ist_IMark:
+            L.cur_ip = st->Ist.IMark.addr + st->Ist.IMark.delta;
+            break;
+         case Ist_WrTmp:
+            worth = faults = False;
+            if (L.n_left > 0
+                && loopHoistTy(typeOfIRTemp(bb->tyenv, st->Ist.WrTmp.tmp))
+                && loopInvariant(&L, st->Ist.WrTmp.data, &worth, &faults)
+                && worth) {
+               loopAddToPreheader(&L, st->Ist.WrTmp.tmp,
+                                  st->Ist.WrTmp.data, faults);
+               continue;
+            }
+            e1 = loopHoistIn(&L, st->Ist.WrTmp.data);
+            if (e1 != st->Ist.WrTmp.data)
+               st = IRStmt_WrTmp(st->Ist.WrTmp.tmp, e1);
+            break;
+         case Ist_Put:
+            e1 = loopHoistIn(&L, st->Ist.Put.data);
+            if (e1 != st->Ist.Put.data)
+               st = IRStmt_Put(st->Ist.Put.offset, e1);
+            break;
+         case Ist_Store:
+            e1 = loopHoistIn(&L, st->Ist.Store.addr);
+            e2 = loopHoistIn(&L, st->Ist.Store.data);
+            if (e1 != st->Ist.Store.addr || e2 != st->Ist.Store.data)
+               st = IRStmt_Store(st->Ist.Store.end, e1, e2);
+            break;
+         case Ist_Exit:
+            e1 = loopHoistIn(&L, st->Ist.Exit.guard);
+            if (e1 != st->Ist.Exit.guard)
+               st = IRStmt_Exit(e1, st->Ist.Exit.jk, st->Ist.Exit.dst,
+                                st->Ist.Exit.offsIP);
+            break;
+         default:
+            break;
+      }
+      if (L.faults_ok && loopStmtStopsFaults(&L, st, preciseMemExnsFn))
+         L.faults_ok = False;
+      body[n_body++] = st;
+   }
+
+   if (L.n_pre == 0)
+      return False;
+
+   if (L.pre_ip != my_addr)
+      L.pre[L.n_pre++] = IRStmt_Put(L.offsIP, loopMkConst(L.aty, my_addr));
+
+   if (flip) {
+      st = body[n_body-1];
+      vassert(st->tag == Ist_Exit);
+      body[n_body-1] = IRStmt_Exit(IRExpr_Unop(Iop_Not1, st->Ist.Exit.guard),
+                                   Ijk_Boring, dst, st->Ist.Exit.offsIP);
+      bb->next = IRExpr_Const(st->Ist.Exit.dst);
+   }
+
+   bb->stmts_size = bb->stmts_used = L.n_pre + n_body;
+   bb->stmts      = LibVEX_Alloc(bb->stmts_size * sizeof(IRStmt*));
+   for (i = 0; i < L.n_pre; i++)
+      bb->stmts[i] = L.pre[i];
+   for (i = 0; i < n_body; i++)
+      bb->stmts[L.n_pre + i] = body[i];
+
+   /* The body may no longer need some of what it bound. */
+   do_deadcode_BB(bb);
+   return True;
+}
+
+
 /*---------------------------------------------------------------*/
 /*--- iropt main                                              ---*/
 /*---------------------------------------------------------------*/
@@ -5985,18 +7404,21 @@ IRSB* do_iropt_BB(
          VexArch guest_arch
       )
 {
-   static Int n_total     = 0;
-   static Int n_expensive = 0;
+   static VEX_TLS Int n_total     = 0;
+   static VEX_TLS Int n_expensive = 0;
 
    Bool hasGetIorPutI, hasVorFtemps;
    IRSB *bb, *bb2;
+   ULong t_phase;
 
    n_total++;
 
    /* First flatten the block out, since all other
       phases assume flat code. */
 
+   t_phase = vexReadCycles();
    bb = flatten_BB ( bb0 );
+   vexPhaseDone(VexPhaseFlatten, &t_phase);
 
    if (iropt_verbose) {
       vex_printf("\n========= FLAT\n\n" );
@@ -6047,7 +7469,9 @@ IRSB* do_iropt_BB(
          n_expensive++;
          if (DEBUG_IROPT)
             vex_printf("***** EXPENSIVE %d %d\n", n_total, n_expensive);
+         vexPhaseDone(VexPhaseIroptCheap, &t_phase);
          bb = expensive_transformations( bb );
+         vexPhaseDone(VexPhaseIroptExpensive, &t_phase);
          bb = cheap_transformations( bb, specHelper, preciseMemExnsFn );
          /* Potentially common up GetIs */
          cses = do_cse_BB( bb );
@@ -6061,8 +7485,14 @@ IRSB* do_iropt_BB(
       bb2 = maybe_loop_unroll_BB( bb, guest_addr );
       if (bb2) {
          bb = cheap_transformations( bb2, specHelper, preciseMemExnsFn );
+         /* The copies are now the loop's iterations.  Let them share
+            induction variable arithmetic and memory values. */
+         if (do_loop_ivs_and_memvals_BB( bb ))
+            bb = cheap_transformations( bb, specHelper, preciseMemExnsFn );
          if (hasGetIorPutI) {
+            vexPhaseDone(VexPhaseIroptCheap, &t_phase);
             bb = expensive_transformations( bb );
+            vexPhaseDone(VexPhaseIroptExpensive, &t_phase);
             bb = cheap_transformations( bb, specHelper, preciseMemExnsFn );
          } else {
             /* at least do CSE and dead code removal */
@@ -6074,6 +7504,7 @@ IRSB* do_iropt_BB(
 
    }
 
+   vexPhaseDone(VexPhaseIroptCheap, &t_phase);
    return bb;
 }
 
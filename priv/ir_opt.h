@@ -66,6 +66,15 @@ void do_deadcode_BB ( IRSB* bb );
 extern
 Addr64 ado_treebuild_BB ( IRSB* bb, Bool (*preciseMemExnsFn)(Int,Int) );
 
+/* Move loop-invariant values out of a block which jumps back to
+   my_addr, its own start, into a preheader: the stmts before the
+   first IMark, binding at most n_regs temps.  bb must be a tree, and
+   is destructively modified.  Returns True if it has a preheader,
+   and so must be selected as a loop. */
+extern
+Bool do_loop_hoist_BB ( IRSB* bb, Addr64 my_addr, Int n_regs,
+                        Bool (*preciseMemExnsFn)(Int,Int) );
+
 #endif /* ndef __VEX_IR_OPT_H */
 
 /*---------------------------------------------------------------*/
@@ -0,0 +1,227 @@
+
+/*---------------------------------------------------------------*/
+/*--- begin                                      main_batch.c ---*/
+/*---------------------------------------------------------------*/
+
+/*
+   This file is part of Valgrind, a dynamic binary instrumentation
+   framework.
+
+   Copyright (C) 2004-2013 OpenWorks LLP
+      info@open-works.net
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+
+   Neither the names of the U.S. Department of Energy nor the
+   University of California nor the names of its contributors may be
+   used to endorse or promote products derived from this software
+   without prior written permission.
+*/
+
+#include "libvex_basictypes.h"
+#include "libvex.h"
+
+#include "main_util.h"
+
+
+/*---------------------------------------------------------*/
+/*--- Work-stealing deques                              ---*/
+/*---------------------------------------------------------*/
+
+/* Each worker owns a slice [lo, hi) of the argument array, packed
+   into one 64-bit word together with a 16-bit tag that changes on
+   every update, so that a compare-and-swap against a stale copy
+   always fails.  The owner takes entries from the bottom; a thief
+   takes the top half of what is left, runs its first entry and
+   publishes the rest as its own slice.  Slices only ever shrink or
+   move between workers, so once every slice is empty the batch is
+   done: anything still in flight belongs to a thief, which will run
+   it. */
+
+#define BATCH_MAX_WORKERS  64
+#define BATCH_MAX_ARGS     ((1 << 24) - 1)
+
+static inline ULong mkSlice ( UInt lo, UInt hi, UInt tag )
+{
+   return ((ULong)(tag & 0xFFFF) << 48) | ((ULong)hi << 24) | (ULong)lo;
+}
+static inline UInt sliceLo  ( ULong s ) { return (UInt)(s & 0xFFFFFF); }
+static inline UInt sliceHi  ( ULong s ) { return (UInt)((s >> 24) & 0xFFFFFF); }
+static inline UInt sliceTag ( ULong s ) { return (UInt)(s >> 48); }
+
+typedef
+   struct {
+      ULong slice;
+      /* Keep each worker's slice on a cache line of its own. */
+      UChar pad[56];
+   }
+   BatchDeque;
+
+typedef
+   struct {
+      BatchDeque*          deques;
+      Int                  n_workers;
+      VexTranslateContext* ctxs;
+      VexTranslateArgs*    vtas;
+      VexTranslateResult*  results;
+   }
+   BatchJob;
+
+typedef
+   struct {
+      BatchJob* job;
+      Int       w;
+   }
+   BatchWorker;
+
+static inline ULong loadSlice ( BatchDeque* d )
+{
+   return __atomic_load_n(&d->slice, __ATOMIC_ACQUIRE);
+}
+
+static inline Bool casSlice ( BatchDeque* d, ULong old, ULong new )
+{
+   return __atomic_compare_exchange_n(&d->slice, &old, new,
+                                      False/*strong*/,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/* Take the bottom entry of d, or return -1 if it is empty. */
+static Int popBottom ( BatchDeque* d )
+{
+   while (True) {
+      ULong s  = loadSlice(d);
+      UInt  lo = sliceLo(s);
+      UInt  hi = sliceHi(s);
+      if (lo >= hi)
+         return -1;
+      if (casSlice(d, s, mkSlice(lo+1, hi, sliceTag(s)+1)))
+         return (Int)lo;
+   }
+}
+
+/* Steal the top half of victim's slice into mine, and return the
+   first stolen entry, or -1 if the victim has nothing to give. */
+static Int stealHalf ( BatchDeque* mine, BatchDeque* victim )
+{
+   while (True) {
+      ULong s  = loadSlice(victim);
+      UInt  lo = sliceLo(s);
+      UInt  hi = sliceHi(s);
+      if (lo >= hi)
+         return -1;
+      UInt mid = hi - (hi - lo + 1) / 2;
+      if (casSlice(victim, s, mkSlice(lo, mid, sliceTag(s)+1))) {
+         /* My slice is empty, and nobody else modifies an empty
+            slice, so a plain store suffices.  The tag still has to
+            move on, to fail anyone's CAS against the old value. */
+         ULong m = loadSlice(mine);
+         vassert(sliceLo(m) >= sliceHi(m));
+         __atomic_store_n(&mine->slice, mkSlice(mid+1, hi, sliceTag(m)+1),
+                          __ATOMIC_RELEASE);
+         return (Int)mid;
+      }
+   }
+}
+
+static void batchWorker ( void* argV )
+{
+   BatchWorker* me  = (BatchWorker*)argV;
+   BatchJob*    job = me->job;
+   Int          w   = me->w;
+   Int          i, k;
+
+   while (True) {
+      i = popBottom(&job->deques[w]);
+      if (i < 0) {
+         /* Go round the others, starting with my neighbour, so that
+            thieves spread out. */
+         for (k = 1; k < job->n_workers; k++) {
+            i = stealHalf(&job->deques[w],
+                          &job->deques[(w + k) % job->n_workers]);
+            if (i >= 0)
+               break;
+         }
+      }
+      if (i < 0)
+         return;
+      job->results[i] = LibVEX_TranslateCtx(&job->ctxs[w], &job->vtas[i]);
+   }
+}
+
+
+/*---------------------------------------------------------*/
+/*--- The batch translator                              ---*/
+/*---------------------------------------------------------*/
+
+/* Exported to library client. */
+
+void LibVEX_TranslateBatch ( VexTranslateContext* ctxs, Int n_workers,
+                             VexTranslateArgs* vtas,
+                             /*OUT*/VexTranslateResult* results, Int n,
+                             void (*run_workers) ( void (*fn)( void* ),
+                                                   void** args,
+                                                   Int n_workers ) )
+{
+   BatchDeque  deques[BATCH_MAX_WORKERS];
+   BatchWorker workers[BATCH_MAX_WORKERS];
+   void*       args[BATCH_MAX_WORKERS];
+   BatchJob    job;
+   Int         w, i;
+
+   vassert(ctxs != NULL);
+   vassert(n_workers >= 1 && n_workers <= BATCH_MAX_WORKERS);
+   vassert(n >= 0 && n <= BATCH_MAX_ARGS);
+
+#  if !defined(VEX_THREADSAFE)
+   /* The translation state is shared, so there can only be one
+      translation at a time. */
+   run_workers = NULL;
+#  endif
+
+   if (run_workers == NULL || n_workers == 1 || n <= 1) {
+      for (i = 0; i < n; i++)
+         results[i] = LibVEX_TranslateCtx(&ctxs[0], &vtas[i]);
+      return;
+   }
+
+   /* Start each worker with as near an equal share as possible. */
+   for (w = 0; w < n_workers; w++) {
+      Int lo = (Int)(((Long)n * w) / n_workers);
+      Int hi = (Int)(((Long)n * (w+1)) / n_workers);
+      deques[w].slice = mkSlice(lo, hi, 0);
+      workers[w].job  = &job;
+      workers[w].w    = w;
+      args[w]         = &workers[w];
+   }
+   job.deques    = deques;
+   job.n_workers = n_workers;
+   job.ctxs      = ctxs;
+   job.vtas      = vtas;
+   job.results   = results;
+
+   run_workers(batchWorker, args, n_workers);
+
+   for (w = 0; w < n_workers; w++)
+      vassert(sliceLo(deques[w].slice) >= sliceHi(deques[w].slice));
+}
+
+
+/*---------------------------------------------------------------*/
+/*--- end                                        main_batch.c ---*/
+/*---------------------------------------------------------------*/
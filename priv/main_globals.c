@@ -56,13 +56,13 @@ void (*vex_log_bytes) ( HChar*, Int nbytes ) = NULL;
 Int vex_debuglevel = 0;
 
 /* trace flags */
-Int vex_traceflags = 0;
+VEX_TLS Int vex_traceflags = 0;
 
 /* Are we supporting valgrind checking? */
 Bool vex_valgrind_support = False;
 
 /* Max # guest insns per bb */
-VexControl vex_control = { 0,0,False,0,0,0 };
+VEX_TLS VexControl vex_control = { 0,0,False,0,0,0 };
 
 
 
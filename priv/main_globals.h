@@ -56,14 +56,15 @@ extern void (*vex_log_bytes) ( HChar*, Int nbytes );
 /* debug paranoia level */
 extern Int vex_debuglevel;
 
-/* trace flags */
-extern Int vex_traceflags;
+/* trace flags, for the translation in progress on this thread */
+extern VEX_TLS Int vex_traceflags;
 
 /* Are we supporting valgrind checking? */
 extern Bool vex_valgrind_support;
 
-/* Optimiser/front-end control */
-extern VexControl vex_control;
+/* Optimiser/front-end control.  This is a copy of the settings of
+   the translation context in use on this thread. */
+extern VEX_TLS VexControl vex_control;
 
 
 /* vex_traceflags values */
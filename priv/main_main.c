@@ -76,6 +76,7 @@
 
 static Bool   are_valid_hwcaps ( VexArch arch, UInt hwcaps );
 static const HChar* show_hwcaps ( VexArch arch, UInt hwcaps );
+static void   check_VexControl ( const VexControl* vcon );
 
 
 /* --------- helpers --------- */
@@ -99,6 +100,11 @@ void LibVEX_default_VexControl ( /*OUT*/ VexControl* vcon )
    vcon->guest_max_insns            = 60;
    vcon->guest_chase_thresh         = 10;
    vcon->guest_chase_cond           = False;
+   vcon->shadow_ret_stack           = False;
+   vcon->host_peephole              = True;
+   vcon->host_cold_exits            = False;
+   vcon->guest_rep_bulk             = False;
+   vcon->iropt_loop_hoist           = False;
 }
 
 
@@ -129,17 +135,7 @@ void LibVEX_Init (
    vassert(log_bytes);
    vassert(debuglevel >= 0);
 
-   vassert(vcon->iropt_verbosity >= 0);
-   vassert(vcon->iropt_level >= 0);
-   vassert(vcon->iropt_level <= 2);
-   vassert(vcon->iropt_unroll_thresh >= 0);
-   vassert(vcon->iropt_unroll_thresh <= 400);
-   vassert(vcon->guest_max_insns >= 1);
-   vassert(vcon->guest_max_insns <= 100);
-   vassert(vcon->guest_chase_thresh >= 0);
-   vassert(vcon->guest_chase_thresh < vcon->guest_max_insns);
-   vassert(vcon->guest_chase_cond == True 
-           || vcon->guest_chase_cond == False);
+   check_VexControl(vcon);
 
    /* Check that Vex has been built with sizes of basic types as
       stated in priv/libvex_basictypes.h.  Failure of any of these is
@@ -181,6 +177,8 @@ void LibVEX_Init (
       vassert(sizeof(IRExpr) == 32);
       vassert(sizeof(IRStmt) == 32);
    }
+   /* Clients store one of these per translation. */
+   vassert(sizeof(VexGuestExtents) == 32);
 
    /* Check that signed integer division on the host rounds towards
       zero.  If not, h_calc_sdiv32_w_arm_semantics() won't work
@@ -198,14 +196,135 @@ void LibVEX_Init (
    vex_control            = *vcon;
    vex_initdone           = True;
    vexSetAllocMode ( VexAllocModeTEMP );
+   vexDefaultTranslateContext()->control = *vcon;
+}
+
+
+static void check_VexControl ( const VexControl* vcon )
+{
+   vassert(vcon->iropt_verbosity >= 0);
+   vassert(vcon->iropt_level >= 0);
+   vassert(vcon->iropt_level <= 2);
+   vassert(vcon->iropt_unroll_thresh >= 0);
+   vassert(vcon->iropt_unroll_thresh <= 400);
+   vassert(vcon->guest_max_insns >= 1);
+   vassert(vcon->guest_max_insns <= 100);
+   vassert(vcon->guest_chase_thresh >= 0);
+   vassert(vcon->guest_chase_thresh < vcon->guest_max_insns);
+   vassert(vcon->guest_chase_cond == True 
+           || vcon->guest_chase_cond == False);
+}
+
+
+/* --------- Set up a translation context. --------- */
+
+/* Exported to library client. */
+
+void LibVEX_InitTranslateContext ( /*OUT*/VexTranslateContext* ctx,
+                                   /*READONLY*/VexControl* vcon,
+                                   HChar* temp_area, Int temp_area_szB )
+{
+   vassert(vex_initdone);
+   vassert(temp_area != NULL);
+   check_VexControl(vcon);
+   vex_bzero(ctx, sizeof(*ctx));
+   ctx->control    = *vcon;
+   ctx->traceflags = 0;
+   vexInitTranslateContextStorage(ctx, temp_area, temp_area_szB);
 }
 
 
 /* --------- Make a translation. --------- */
 
+static VexTranslateResult LibVEX_Translate_wrk ( VexTranslateArgs* vta,
+                                                 HReloc* relocs,
+                                                 Int relocs_size,
+                                                 Int* n_relocs );
+
+static VexTranslateResult translate_in_ctx ( VexTranslateContext* ctx,
+                                             VexTranslateArgs* vta,
+                                             HReloc* relocs,
+                                             Int relocs_size,
+                                             Int* n_relocs );
+
 /* Exported to library client. */
 
 VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
+{
+   return LibVEX_TranslateCtx( vexDefaultTranslateContext(), vta );
+}
+
+/* Exported to library client. */
+
+VexTranslateResult LibVEX_TranslateCtx ( VexTranslateContext* ctx,
+                                         VexTranslateArgs* vta )
+{
+   return translate_in_ctx( ctx, vta, NULL, 0, NULL );
+}
+
+/* For the translation cache: see HReloc. */
+
+VexTranslateResult vexTranslateRelocs ( VexTranslateArgs* vta,
+                                        HReloc* relocs, Int relocs_size,
+                                        /*OUT*/Int* n_relocs )
+{
+   return translate_in_ctx( vexDefaultTranslateContext(), vta,
+                            relocs, relocs_size, n_relocs );
+}
+
+static VexTranslateResult translate_in_ctx ( VexTranslateContext* ctx,
+                                             VexTranslateArgs* vta,
+                                             HReloc* relocs,
+                                             Int relocs_size,
+                                             Int* n_relocs )
+{
+   VexTranslateContext* prev_ctx;
+   VexTranslateResult   res;
+
+   vassert(vex_initdone);
+
+   /* Everything the translation modifies is either in ctx or is
+      thread-local, so that translations in different contexts can
+      proceed concurrently. */
+   prev_ctx        = vexBindTranslateContext(ctx);
+   ctx->traceflags = vta->traceflags;
+   vex_traceflags  = ctx->traceflags;
+   vex_control     = ctx->control;
+
+   res = LibVEX_Translate_wrk(vta, relocs, relocs_size, n_relocs);
+
+   vex_traceflags  = 0;
+   ctx->traceflags = 0;
+   vexBindTranslateContext(prev_ctx);
+   return res;
+}
+
+/* Exported to library client. */
+
+void LibVEX_GetTranslateStats ( /*READONLY*/VexTranslateContext* ctx,
+                                /*OUT*/VexTranslateStats* stats )
+{
+   if (ctx == NULL)
+      ctx = vexDefaultTranslateContext();
+   *stats = ctx->stats;
+}
+
+/* Copy the first 3 of the extents in *src to *dst. */
+static void head_extents ( /*OUT*/VexGuestExtents* dst,
+                           const VexGuestTraceExtents* src )
+{
+   Int i;
+   dst->n_used = toUShort(src->n_used < 3 ? src->n_used : 3);
+   for (i = 0; i < 3; i++) {
+      dst->base[i] = i < dst->n_used ? src->base[i] : 0;
+      dst->len[i]  = i < dst->n_used ? src->len[i]  : 0;
+   }
+}
+
+static VexTranslateResult LibVEX_Translate_wrk ( VexTranslateArgs* vta,
+                                                 HReloc* relocs,
+                                                 Int relocs_size,
+                                                 Int* n_relocs )
 {
    /* This the bundle of functions we need to do the back-end stuff
       (insn selection, reg-alloc, assembly) whilst being insulated
@@ -218,19 +337,31 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
    void         (*genSpill)     ( HInstr**, HInstr**, HReg, Int, Bool );
    void         (*genReload)    ( HInstr**, HInstr**, HReg, Int, Bool );
    HInstr*      (*directReload) ( HInstr*, HReg, Short );
+   Int          (*peephole)     ( HInstr*, HInstr**, Bool );
+   HInstr*      (*coldExit)     ( HInstr* );
+   Int          (*emitColdBranch) ( UChar*, Int, HInstr*, Int );
+   void         (*getLoopRegs)  ( Int*, HReg**, VexAbiInfo* );
+   Bool         (*isLoopHead)   ( HInstr* );
+   Int          (*emitLoopBack) ( UChar*, Int, HInstr*, Int );
+   Int          (*getRelocs)    ( HReloc*, HInstr*, UChar*, Int,
+                                  void*, void* );
    void         (*ppInstr)      ( HInstr*, Bool );
    void         (*ppReg)        ( HReg );
    HInstrArray* (*iselSB)       ( IRSB*, VexArch, VexArchInfo*, VexAbiInfo*,
-                                  Int, Int, Bool, Bool, Addr64 );
+                                  Int, Int, Int, Bool, Bool, Addr64,
+                                  Bool );
    Int          (*emit)         ( /*MB_MOD*/Bool*,
                                   UChar*, Int, HInstr*, Bool,
-                                  void*, void*, void*, void* );
+                                  void*, void*, void*, void*, void* );
    IRExpr*      (*specHelper)   ( const HChar*, IRExpr**, IRStmt**, Int );
    Bool         (*preciseMemExnsFn) ( Int, Int );
 
    DisOneInstrFn disInstrFn;
 
    VexGuestLayout* guest_layout;
+   VexGuestTraceExtents vge;
+   VexGuestExtents vge_head;
+   VexGuestExtents* inst_vge;
    Bool            host_is_bigendian = False;
    IRSB*           irsb;
    HInstrArray*    vcode;
@@ -238,7 +369,19 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
    Int             i, j, k, out_used, guest_sizeB;
    Int             offB_TISTART, offB_TILEN, offB_GUEST_IP, szB_GUEST_IP;
    Int             offB_HOST_EvC_COUNTER, offB_HOST_EvC_FAILADDR;
+   Int             offB_HOST_RetStack;
+   HInstr**        cold;
+   Int             *cold_at, *cold_from, *cold_szB;
+   Int             n_cold, cold_total, delta, shift;
+   Int             n_loop_regs, loop_at, loop_from;
+   HReloc*         rl;
+   Int             n_rl;
+   HReg*           loop_regs;
+   Bool            selfLoop;
+   Bool            changed;
    UChar           insn_bytes[128];
+   UChar*          buf;
+   ULong           t_phase;
    IRType          guest_word_type;
    IRType          host_word_type;
    Bool            mode64, chainingAllowed;
@@ -253,6 +396,13 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
    genSpill               = NULL;
    genReload              = NULL;
    directReload           = NULL;
+   peephole               = NULL;
+   coldExit               = NULL;
+   emitColdBranch         = NULL;
+   getLoopRegs            = NULL;
+   isLoopHead             = NULL;
+   emitLoopBack           = NULL;
+   getRelocs              = NULL;
    ppInstr                = NULL;
    ppReg                  = NULL;
    iselSB                 = NULL;
@@ -268,11 +418,10 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
    szB_GUEST_IP           = 0;
    offB_HOST_EvC_COUNTER  = 0;
    offB_HOST_EvC_FAILADDR = 0;
+   offB_HOST_RetStack     = -1;
    mode64                 = False;
    chainingAllowed        = False;
 
-   vex_traceflags = vta->traceflags;
-
    vassert(vex_initdone);
    vassert(vta->needs_self_check  != NULL);
    vassert(vta->disp_cp_xassisted != NULL);
@@ -285,6 +434,13 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
       vassert(vta->disp_cp_chain_me_to_fastEP == NULL);
       vassert(vta->disp_cp_xindir             == NULL);
    }
+   /* XIndir inline caches need chaining, and are only implemented
+      for some hosts. */
+   if (vta->disp_cp_xindir_miss != NULL) {
+      vassert(chainingAllowed);
+      vassert(vta->arch_host == VexArchAMD64
+              || vta->arch_host == VexArchARM64);
+   }
 
    vexSetAllocModeTEMP_and_clear();
    vexAllocSanityCheck();
@@ -311,8 +467,11 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          ppReg        = (void(*)(HReg)) ppHRegX86;
          iselSB       = iselSB_X86;
          emit         = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                         emit_X86Instr;
+         coldExit     = (HInstr*(*)(HInstr*)) coldExit_X86Instr;
+         emitColdBranch = (Int(*)(UChar*,Int,HInstr*,Int))
+                          emitColdBranch_X86;
          host_is_bigendian = False;
          host_word_type    = Ity_I32;
          vassert(are_valid_hwcaps(VexArchX86, vta->archinfo_host.hwcaps));
@@ -321,7 +480,9 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
       case VexArchAMD64:
          mode64      = True;
          getAllocableRegs_AMD64 ( &n_available_real_regs,
-                                  &available_real_regs );
+                                  &available_real_regs,
+                                  vta->archinfo_host.hwcaps,
+                                  &vta->abiinfo_both );
          isMove      = (Bool(*)(HInstr*,HReg*,HReg*)) isMove_AMD64Instr;
          getRegUsage = (void(*)(HRegUsage*,HInstr*, Bool))
                        getRegUsage_AMD64Instr;
@@ -330,12 +491,22 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
                        genSpill_AMD64;
          genReload   = (void(*)(HInstr**,HInstr**,HReg,Int,Bool))
                        genReload_AMD64;
+         peephole    = (Int(*)(HInstr*,HInstr**,Bool)) peephole_AMD64Instr;
          ppInstr     = (void(*)(HInstr*, Bool)) ppAMD64Instr;
          ppReg       = (void(*)(HReg)) ppHRegAMD64;
          iselSB      = iselSB_AMD64;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                        emit_AMD64Instr;
+         coldExit    = (HInstr*(*)(HInstr*)) coldExit_AMD64Instr;
+         emitColdBranch = (Int(*)(UChar*,Int,HInstr*,Int))
+                          emitColdBranch_AMD64;
+         getLoopRegs = getLoopRegs_AMD64;
+         isLoopHead  = (Bool(*)(HInstr*)) isLoopHead_AMD64Instr;
+         emitLoopBack = (Int(*)(UChar*,Int,HInstr*,Int))
+                        emitLoopBack_AMD64;
+         getRelocs   = (Int(*)(HReloc*,HInstr*,UChar*,Int,void*,void*))
+                       getRelocs_AMD64Instr;
          host_is_bigendian = False;
          host_word_type    = Ity_I64;
          vassert(are_valid_hwcaps(VexArchAMD64, vta->archinfo_host.hwcaps));
@@ -354,7 +525,7 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          ppReg       = (void(*)(HReg)) ppHRegPPC;
          iselSB      = iselSB_PPC;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                        emit_PPCInstr;
          host_is_bigendian = True;
          host_word_type    = Ity_I32;
@@ -374,7 +545,7 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          ppReg       = (void(*)(HReg)) ppHRegPPC;
          iselSB      = iselSB_PPC;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                        emit_PPCInstr;
          host_is_bigendian = True;
          host_word_type    = Ity_I64;
@@ -394,7 +565,7 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          ppReg       = (void(*)(HReg)) ppHRegS390;
          iselSB      = iselSB_S390;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*)) emit_S390Instr;
+                               void*,void*,void*,void*,void*)) emit_S390Instr;
          host_is_bigendian = True;
          host_word_type    = Ity_I64;
          vassert(are_valid_hwcaps(VexArchS390X, vta->archinfo_host.hwcaps));
@@ -413,7 +584,7 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          ppReg       = (void(*)(HReg)) ppHRegARM;
          iselSB      = iselSB_ARM;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                        emit_ARMInstr;
          host_is_bigendian = False;
          host_word_type    = Ity_I32;
@@ -433,12 +604,16 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
                        genSpill_ARM64;
          genReload   = (void(*)(HInstr**,HInstr**,HReg,Int,Bool))
                        genReload_ARM64;
+         peephole    = (Int(*)(HInstr*,HInstr**,Bool)) peephole_ARM64Instr;
          ppInstr     = (void(*)(HInstr*, Bool)) ppARM64Instr;
          ppReg       = (void(*)(HReg)) ppHRegARM64;
          iselSB      = iselSB_ARM64;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                        emit_ARM64Instr;
+         coldExit    = (HInstr*(*)(HInstr*)) coldExit_ARM64Instr;
+         emitColdBranch = (Int(*)(UChar*,Int,HInstr*,Int))
+                          emitColdBranch_ARM64;
          host_is_bigendian = False;
          host_word_type    = Ity_I64;
          vassert(are_valid_hwcaps(VexArchARM64, vta->archinfo_host.hwcaps));
@@ -457,7 +632,7 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          ppReg       = (void(*)(HReg)) ppHRegMIPS;
          iselSB      = iselSB_MIPS;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                        emit_MIPSInstr;
 #        if defined(VKI_LITTLE_ENDIAN)
          host_is_bigendian = False;
@@ -481,7 +656,7 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          ppReg       = (void(*)(HReg)) ppHRegMIPS;
          iselSB      = iselSB_MIPS;
          emit        = (Int(*)(Bool*,UChar*,Int,HInstr*,Bool,
-                               void*,void*,void*,void*))
+                               void*,void*,void*,void*,void*))
                        emit_MIPSInstr;
 #        if defined(VKI_LITTLE_ENDIAN)
          host_is_bigendian = False;
@@ -532,8 +707,18 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          szB_GUEST_IP           = sizeof( ((VexGuestAMD64State*)0)->guest_RIP );
          offB_HOST_EvC_COUNTER  = offsetof(VexGuestAMD64State,host_EvC_COUNTER);
          offB_HOST_EvC_FAILADDR = offsetof(VexGuestAMD64State,host_EvC_FAILADDR);
+         if (vex_control.shadow_ret_stack
+             && vta->arch_host == VexArchAMD64 && chainingAllowed)
+            offB_HOST_RetStack  = offsetof(VexGuestAMD64State,host_RS_TOP);
          vassert(are_valid_hwcaps(VexArchAMD64, vta->archinfo_guest.hwcaps));
          vassert(0 == sizeof(VexGuestAMD64State) % 16);
+         vassert(offsetof(VexGuestAMD64State,host_RS_GA)
+                 == offsetof(VexGuestAMD64State,host_RS_TOP) + 32);
+         vassert(offsetof(VexGuestAMD64State,host_RS_HA)
+                 == offsetof(VexGuestAMD64State,host_RS_GA)
+                    + 8 * VEX_RET_STACK_SIZE);
+         vassert(sizeof( ((VexGuestAMD64State*)0)->host_RS_GA )
+                 == 8 * VEX_RET_STACK_SIZE);
          vassert(sizeof( ((VexGuestAMD64State*)0)->guest_TISTART ) == 8);
          vassert(sizeof( ((VexGuestAMD64State*)0)->guest_TILEN   ) == 8);
          vassert(sizeof( ((VexGuestAMD64State*)0)->guest_NRADDR  ) == 8);
@@ -691,6 +876,27 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
    res.offs_profInc   = -1;
    res.n_guest_instrs = 0;
 
+   /* Guest registers cached in host registers must be whole 64-bit
+      slots which only GET and PUT touch. */
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++) {
+      Int off = vta->abiinfo_both.host_amd64_cached_guest_offsets[i];
+      if (off == 0)
+         continue;
+      vassert(vta->arch_host == VexArchAMD64);
+      vassert(off > 0 && (off & 7) == 0 && off + 8 <= guest_sizeB);
+      vassert(off + 8 <= offB_GUEST_IP || off >= offB_GUEST_IP + szB_GUEST_IP);
+      vassert(off + 8 <= offB_HOST_EvC_COUNTER
+              || off >= offB_HOST_EvC_COUNTER + 4);
+      vassert(off + 8 <= offB_HOST_EvC_FAILADDR
+              || off >= offB_HOST_EvC_FAILADDR + 8);
+      if (vta->arch_guest == VexArchAMD64)
+         vassert(off < offsetof(VexGuestAMD64State,host_RS_TOP)
+                 || off >= offsetof(VexGuestAMD64State,pad1));
+      for (j = 0; j < i; j++)
+         vassert(vta->abiinfo_both.host_amd64_cached_guest_offsets[j]
+                 != off);
+   }
+
    /* yet more sanity checks ... */
    if (vta->arch_guest == vta->arch_host) {
       /* doesn't necessarily have to be true, but if it isn't it means
@@ -701,12 +907,14 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
 
    vexAllocSanityCheck();
 
+   t_phase = vexReadCycles();
+
    if (vex_traceflags & VEX_TRACE_FE)
       vex_printf("\n------------------------" 
                    " Front end "
                    "------------------------\n\n");
 
-   irsb = bb_to_IR ( vta->guest_extents,
+   irsb = bb_to_IR ( &vge,
                      &res.n_sc_extents,
                      &res.n_guest_instrs,
                      vta->callback_opaque,
@@ -714,6 +922,8 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
                      vta->guest_bytes, 
                      vta->guest_bytes_addr,
                      vta->chase_into_ok,
+                     vta->trace,
+                     vta->trace_len,
                      host_is_bigendian,
                      vta->sigill_diag,
                      vta->arch_guest,
@@ -727,30 +937,43 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
                      offB_GUEST_IP,
                      szB_GUEST_IP );
 
+   vexPhaseDone(VexPhaseFrontEnd, &t_phase);
    vexAllocSanityCheck();
 
+   /* Give the caller the extents in the type it expects.  The
+      instrumenters are only given the first 3 of a trace's. */
+   head_extents(&vge_head, &vge);
+   if (vta->trace_len > 0) {
+      *(vta->trace_extents) = vge;
+      inst_vge = &vge_head;
+   } else {
+      vassert(vge.n_used <= 3);
+      *(vta->guest_extents) = vge_head;
+      inst_vge = vta->guest_extents;
+   }
+
    if (irsb == NULL) {
       /* Access failure. */
       vexSetAllocModeTEMP_and_clear();
-      vex_traceflags = 0;
       res.status = VexTransAccessFail; return res;
    }
 
-   vassert(vta->guest_extents->n_used >= 1 && vta->guest_extents->n_used <= 3);
-   vassert(vta->guest_extents->base[0] == vta->guest_bytes_addr);
-   for (i = 0; i < vta->guest_extents->n_used; i++) {
-      vassert(vta->guest_extents->len[i] < 10000); /* sanity */
+   vassert(vge.n_used >= 1 && vge.n_used <= VEX_MAX_TRACE_EXTENTS);
+   vex_tstats->n_ir_stmts_in += irsb->stmts_used;
+   vassert(vge.base[0] == vta->guest_bytes_addr);
+   for (i = 0; i < vge.n_used; i++) {
+      vassert(vge.len[i] < 10000); /* sanity */
    }
 
    /* If debugging, show the raw guest bytes for this bb. */
    if (0 || (vex_traceflags & VEX_TRACE_FE)) {
-      if (vta->guest_extents->n_used > 1) {
+      if (vge.n_used > 1) {
          vex_printf("can't show code due to extents > 1\n");
       } else {
          /* HACK */
          UChar* p = (UChar*)vta->guest_bytes;
          UInt   sum = 0;
-         UInt   guest_bytes_read = (UInt)vta->guest_extents->len[0];
+         UInt   guest_bytes_read = (UInt)vge.len[0];
          vex_printf("GuestBytes %llx %u ", vta->guest_bytes_addr, 
                                            guest_bytes_read );
          for (i = 0; i < guest_bytes_read; i++) {
@@ -768,7 +991,8 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
 
    vexAllocSanityCheck();
 
-   /* Clean it up, hopefully a lot. */
+   /* Clean it up, hopefully a lot.  do_iropt_BB accounts for its own
+      phases. */
    irsb = do_iropt_BB ( irsb, specHelper, preciseMemExnsFn, 
                               vta->guest_bytes_addr,
                               vta->arch_guest );
@@ -786,10 +1010,11 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
    vexAllocSanityCheck();
 
    /* Get the thing instrumented. */
+   t_phase = vexReadCycles();
    if (vta->instrument1)
       irsb = vta->instrument1(vta->callback_opaque,
                               irsb, guest_layout, 
-                              vta->guest_extents,
+                              inst_vge,
                               &vta->archinfo_host,
                               guest_word_type, host_word_type);
    vexAllocSanityCheck();
@@ -797,7 +1022,7 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
    if (vta->instrument2)
       irsb = vta->instrument2(vta->callback_opaque,
                               irsb, guest_layout,
-                              vta->guest_extents,
+                              inst_vge,
                               &vta->archinfo_host,
                               guest_word_type, host_word_type);
       
@@ -822,6 +1047,9 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
                        True/*must be flat*/, guest_word_type );
    }
 
+   if (vta->instrument1 || vta->instrument2)
+      vexPhaseDone(VexPhaseInstrument, &t_phase);
+
    vexAllocSanityCheck();
 
    if (vex_traceflags & VEX_TRACE_OPT2) {
@@ -834,12 +1062,31 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
 
    /* Turn it into virtual-registerised code.  Build trees -- this
       also throws away any dead bindings. */
+   t_phase = vexReadCycles();
    max_ga = ado_treebuild_BB( irsb, preciseMemExnsFn );
 
    if (vta->finaltidy) {
       irsb = vta->finaltidy(irsb);
    }
 
+   /* A block which jumps back to its own start can loop within the
+      translation, where the host allows it, with what doesn't change
+      between iterations done once beforehand.  Not if the block is
+      instrumented, checks itself or follows a trace, so that the
+      loop is exactly the block's own code. */
+   selfLoop = False;
+   if (getLoopRegs && vex_control.iropt_loop_hoist
+       && vex_control.iropt_level > 1 && chainingAllowed
+       && !vta->instrument1 && !vta->instrument2
+       && res.n_sc_extents == 0 && vta->trace_len == 0) {
+      getLoopRegs(&n_loop_regs, &loop_regs, &vta->abiinfo_both);
+      selfLoop = do_loop_hoist_BB( irsb, vta->guest_bytes_addr,
+                                   n_loop_regs, preciseMemExnsFn );
+      if (selfLoop)
+         vex_tstats->n_self_loops++;
+   }
+   vexPhaseDone(VexPhaseTreeBuild, &t_phase);
+
    vexAllocSanityCheck();
 
    if (vex_traceflags & VEX_TRACE_TREES) {
@@ -867,15 +1114,23 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
       irsb->offsIP properly. */
    vassert(irsb->offsIP >= 16);
 
+   vex_tstats->n_ir_stmts_out += irsb->stmts_used;
+   vex_tstats->n_ir_temps     += irsb->tyenv->types_used;
+   t_phase = vexReadCycles();
+
    vcode = iselSB ( irsb, vta->arch_host,
                     &vta->archinfo_host, 
                     &vta->abiinfo_both,
                     offB_HOST_EvC_COUNTER,
                     offB_HOST_EvC_FAILADDR,
+                    offB_HOST_RetStack,
                     chainingAllowed,
                     vta->addProfInc,
-                    max_ga );
+                    max_ga,
+                    selfLoop );
 
+   vexPhaseDone(VexPhaseIsel, &t_phase);
+   vex_tstats->n_vregs += vcode->n_vregs;
    vexAllocSanityCheck();
 
    if (vex_traceflags & VEX_TRACE_VCODE)
@@ -898,8 +1153,16 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
                                   guest_sizeB,
                                   ppInstr, ppReg, mode64 );
 
+   vexPhaseDone(VexPhaseRegAlloc, &t_phase);
    vexAllocSanityCheck();
 
+   /* Tidy up what the register allocator left behind. */
+   if (peephole && vex_control.host_peephole) {
+      doPeephole( rcode, peephole, mode64 );
+      vexPhaseDone(VexPhasePeephole, &t_phase);
+   }
+   vex_tstats->n_host_instrs += rcode->arr_used;
+
    if (vex_traceflags & VEX_TRACE_RCODE) {
       vex_printf("\n------------------------" 
                    " Register-allocated code "
@@ -926,31 +1189,106 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
                    "------------------------\n\n");
    }
 
+   /* Conditional exits are mostly not taken, so where the host allows
+      it they are moved out of line: each is replaced by a
+      conditional branch to an unconditional copy of it, and the
+      copies are put after the block's final jump.  That keeps the
+      fall-through path dense.  The copies are just as they would be
+      inline, so chaining works on them as usual.  cold[] holds the
+      exits moved, cold_at[] where their branches go and cold_from[]
+      where their copies are, both as offsets into the code before
+      the branches are put in.
+
+      A block which loops within itself (selfLoop) ends with a back
+      edge to its loop head, which is emitted by emitLoopBack once
+      loop_at, the head's offset, is known.  The head comes before
+      any conditional exit, so the back edge's own offset (loop_from)
+      is the only one of the two which moves when the branches to
+      cold exits are put in, and it is then emitted again.  Its
+      length doesn't depend on how far it goes.
+
+      Instructions are emitted straight into host_bytes.  Only when
+      the space left might be too small for the longest instruction
+      do they go via insn_bytes, so the overflow check can be done
+      before anything is written past the end. */
+   cold      = NULL;
+   cold_at   = NULL;
+   cold_from = NULL;
+   cold_szB  = NULL;
+   n_cold    = 0;
+   loop_at   = -1;
+   loop_from = -1;
+   if (coldExit && vex_control.host_cold_exits) {
+      cold      = LibVEX_Alloc(rcode->arr_used * sizeof(HInstr*));
+      cold_at   = LibVEX_Alloc(rcode->arr_used * sizeof(Int));
+      cold_from = LibVEX_Alloc(rcode->arr_used * sizeof(Int));
+      cold_szB  = LibVEX_Alloc(rcode->arr_used * sizeof(Int));
+   }
+
+   /* Each insn, cold copies included, has at most 2 relocations. */
+   rl   = NULL;
+   n_rl = 0;
+   if (getRelocs)
+      rl = LibVEX_Alloc(4 * (rcode->arr_used + 1) * sizeof(HReloc));
+
    out_used = 0; /* tracks along the host_bytes array */
-   for (i = 0; i < rcode->arr_used; i++) {
-      HInstr* hi           = rcode->arr[i];
+   for (i = 0; i < rcode->arr_used + n_cold; i++) {
+      HInstr* hi           = NULL;
       Bool    hi_isProfInc = False;
+      if (i < rcode->arr_used) {
+         hi = rcode->arr[i];
+         if (cold && coldExit(hi)) {
+            /* The branch is put in once we know how far it goes. */
+            cold[n_cold]    = hi;
+            cold_at[n_cold] = out_used;
+            n_cold++;
+            if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
+               vex_printf("(branch to cold) ");
+               ppInstr(hi, mode64);
+               vex_printf("\n\n");
+            }
+            continue;
+         }
+         if (selfLoop && loop_at == -1 && isLoopHead(hi))
+            loop_at = out_used;
+      } else {
+         k            = i - rcode->arr_used;
+         cold_from[k] = out_used;
+         hi           = coldExit(cold[k]);
+      }
       if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
+         if (i >= rcode->arr_used)
+            vex_printf("(cold) ");
          ppInstr(hi, mode64);
          vex_printf("\n");
       }
-      j = emit( &hi_isProfInc,
-                insn_bytes, sizeof insn_bytes, hi, mode64,
-                vta->disp_cp_chain_me_to_slowEP,
-                vta->disp_cp_chain_me_to_fastEP,
-                vta->disp_cp_xindir,
-                vta->disp_cp_xassisted );
+      if (LIKELY(vta->host_bytes_size - out_used >= sizeof insn_bytes))
+         buf = &vta->host_bytes[out_used];
+      else
+         buf = insn_bytes;
+      if (selfLoop && i == rcode->arr_used - 1) {
+         vassert(loop_at >= 0);
+         loop_from = out_used;
+         j = emitLoopBack( buf, sizeof insn_bytes, hi, loop_at - out_used );
+      } else {
+         j = emit( &hi_isProfInc,
+                   buf, sizeof insn_bytes, hi, mode64,
+                   vta->disp_cp_chain_me_to_slowEP,
+                   vta->disp_cp_chain_me_to_fastEP,
+                   vta->disp_cp_xindir,
+                   vta->disp_cp_xindir_miss,
+                   vta->disp_cp_xassisted );
+      }
       if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
          for (k = 0; k < j; k++)
-            if (insn_bytes[k] < 16)
-               vex_printf("0%x ",  (UInt)insn_bytes[k]);
+            if (buf[k] < 16)
+               vex_printf("0%x ",  (UInt)buf[k]);
             else
-               vex_printf("%x ", (UInt)insn_bytes[k]);
+               vex_printf("%x ", (UInt)buf[k]);
          vex_printf("\n\n");
       }
       if (UNLIKELY(out_used + j > vta->host_bytes_size)) {
          vexSetAllocModeTEMP_and_clear();
-         vex_traceflags = 0;
          res.status = VexTransOutputFull;
          return res;
       }
@@ -960,31 +1298,146 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* vta )
          vassert(out_used >= 0);
          res.offs_profInc = out_used;
       }
-      { UChar* dst = &vta->host_bytes[out_used];
-        for (k = 0; k < j; k++) {
-           dst[k] = insn_bytes[k];
-        }
-        out_used += j;
+      if (rl && !(selfLoop && i == rcode->arr_used - 1)) {
+         k = getRelocs( &rl[n_rl], hi, buf, j,
+                        vta->disp_cp_xindir, vta->disp_cp_xindir_miss );
+         for (; k > 0; k--, n_rl++)
+            rl[n_rl].offs += out_used;
+      }
+      if (UNLIKELY(buf == insn_bytes)) {
+         UChar* dst = &vta->host_bytes[out_used];
+         for (k = 0; k < j; k++) {
+            dst[k] = insn_bytes[k];
+         }
+      }
+      out_used += j;
+      vassert(out_used <= vta->host_bytes_size);
+   }
+
+   if (n_cold > 0) {
+      /* Work out how long each branch has to be.  Branch k ends up
+         cold_from[k] - cold_at[k] bytes short of its copy, plus the
+         lengths of itself and the branches after it.  Each starts
+         out at zero length and is lengthened until it reaches.
+         Lengthening a branch only moves copies further away, and the
+         host's branches never get shorter as the distance grows, so
+         this settles, and on the shortest lengths which work. */
+      for (k = 0; k < n_cold; k++)
+         cold_szB[k] = 0;
+      do {
+         changed    = False;
+         cold_total = 0;
+         for (k = n_cold-1; k >= 0; k--) {
+            delta = cold_from[k] - cold_at[k] + cold_total + cold_szB[k];
+            j = emitColdBranch( insn_bytes, sizeof insn_bytes,
+                                cold[k], delta );
+            if (j != cold_szB[k]) {
+               vassert(j > cold_szB[k]);
+               cold_szB[k] = j;
+               changed     = True;
+            }
+            cold_total += cold_szB[k];
+         }
+      } while (changed);
+
+      if (UNLIKELY(out_used + cold_total > vta->host_bytes_size)) {
+         vexSetAllocModeTEMP_and_clear();
+         res.status = VexTransOutputFull;
+         return res;
+      }
+
+      if (res.offs_profInc != -1) {
+         j = res.offs_profInc;
+         for (k = 0; k < n_cold && cold_at[k] <= j; k++)
+            res.offs_profInc += cold_szB[k];
+      }
+      for (i = 0; i < n_rl; i++) {
+         j = rl[i].offs;
+         for (k = 0; k < n_cold && cold_at[k] <= j; k++)
+            rl[i].offs += cold_szB[k];
       }
+
+      /* Open up the gaps, working down from the end, and fill them
+         in.  Everything after branch k moves up by the lengths of
+         branches 0 .. k. */
+      shift = cold_total;
+      j     = out_used;
+      for (k = n_cold-1; k >= 0; k--) {
+         for (i = j-1; i >= cold_at[k]; i--)
+            vta->host_bytes[i + shift] = vta->host_bytes[i];
+         j      = cold_at[k];
+         shift -= cold_szB[k];
+         buf    = &vta->host_bytes[cold_at[k] + shift];
+         delta  = cold_from[k] + cold_total - (cold_at[k] + shift);
+         i = emitColdBranch( buf, vta->host_bytes_size - (cold_at[k] + shift),
+                             cold[k], delta );
+         vassert(i == cold_szB[k]);
+         if (UNLIKELY(vex_traceflags & VEX_TRACE_ASM)) {
+            vex_printf("(branch to cold at %d) ", cold_at[k] + shift);
+            for (i = 0; i < cold_szB[k]; i++)
+               if (buf[i] < 16)
+                  vex_printf("0%x ",  (UInt)buf[i]);
+               else
+                  vex_printf("%x ", (UInt)buf[i]);
+            vex_printf("\n");
+         }
+      }
+      vassert(shift == 0);
+
+      if (loop_from >= 0) {
+         vassert(cold_at[0] >= loop_at);
+         j = emitLoopBack( insn_bytes, sizeof insn_bytes,
+                           rcode->arr[rcode->arr_used - 1],
+                           loop_at - (loop_from + cold_total) );
+         /* The cold copies follow it. */
+         vassert(j == cold_from[0] - loop_from);
+         for (k = 0; k < j; k++)
+            vta->host_bytes[loop_from + cold_total + k] = insn_bytes[k];
+      }
+      vex_tstats->n_cold_bytes += out_used - cold_from[0];
+      out_used += cold_total;
       vassert(out_used <= vta->host_bytes_size);
    }
    *(vta->host_bytes_used) = out_used;
 
+   /* Hand out the chain sites, and the relocations if wanted, before
+      they are freed. */
+   if (vta->n_chain_sites) {
+      *(vta->n_chain_sites) = rl ? 0 : -1;
+      for (i = 0; i < n_rl; i++) {
+         if (rl[i].kind != HReloc_ChainMeSlow
+             && rl[i].kind != HReloc_ChainMeFast)
+            continue;
+         if (*(vta->n_chain_sites) < vta->chain_sites_size)
+            vta->chain_sites[*(vta->n_chain_sites)] = rl[i].offs - rl[i].back;
+         (*(vta->n_chain_sites))++;
+      }
+   }
+   if (n_relocs) {
+      *n_relocs = rl && n_rl <= relocs_size ? n_rl : -1;
+      for (i = 0; i < *n_relocs; i++)
+         relocs[i] = rl[i];
+   }
+
+   vexPhaseDone(VexPhaseAssemble, &t_phase);
+   j = 0; /* total guest bytes */
+   for (i = 0; i < vge.n_used; i++) {
+      j += vge.len[i];
+   }
+   vex_tstats->n_translations++;
+   vex_tstats->n_guest_instrs += res.n_guest_instrs;
+   vex_tstats->n_guest_bytes  += j;
+   vex_tstats->n_host_bytes   += out_used;
    vexAllocSanityCheck();
 
    vexSetAllocModeTEMP_and_clear();
 
    if (vex_traceflags) {
       /* Print the expansion ratio for this SB. */
-      j = 0; /* total guest bytes */
-      for (i = 0; i < vta->guest_extents->n_used; i++) {
-         j += vta->guest_extents->len[i];
-      }
       if (1) vex_printf("VexExpansionRatio %d %d   %d :10\n\n",
                         j, out_used, (10 * out_used) / (j == 0 ? 1 : j));
    }
 
-   vex_traceflags = 0;
    res.status = VexTransOK;
    return res;
 }
@@ -1078,6 +1531,52 @@ VexInvalRange LibVEX_UnChain ( VexArch arch_host,
    return vir;
 }
 
+
+/* --------- Populate/empty XIndir inline caches. --------- */
+
+VexInvalRange LibVEX_ChainXIndir ( VexArch arch_host,
+                                   void*   place_to_chain,
+                                   void*   disp_cp_xindir_miss_EXPECTED,
+                                   Addr64  guest_addr,
+                                   void*   place_to_jump_to,
+                                   void*   disp_cp_xindir )
+{
+   switch (arch_host) {
+      case VexArchAMD64:
+         return chainXIndir_AMD64(place_to_chain,
+                                  disp_cp_xindir_miss_EXPECTED,
+                                  guest_addr, place_to_jump_to,
+                                  disp_cp_xindir);
+      case VexArchARM64:
+         return chainXIndir_ARM64(place_to_chain,
+                                  disp_cp_xindir_miss_EXPECTED,
+                                  guest_addr, place_to_jump_to,
+                                  disp_cp_xindir);
+      default:
+         vassert(0);
+   }
+}
+
+VexInvalRange LibVEX_UnChainXIndir ( VexArch arch_host,
+                                     void*   place_to_unchain,
+                                     void*   place_to_jump_to_EXPECTED,
+                                     void*   disp_cp_xindir,
+                                     void*   disp_cp_xindir_miss )
+{
+   switch (arch_host) {
+      case VexArchAMD64:
+         return unchainXIndir_AMD64(place_to_unchain,
+                                    place_to_jump_to_EXPECTED,
+                                    disp_cp_xindir, disp_cp_xindir_miss);
+      case VexArchARM64:
+         return unchainXIndir_ARM64(place_to_unchain,
+                                    place_to_jump_to_EXPECTED,
+                                    disp_cp_xindir, disp_cp_xindir_miss);
+      default:
+         vassert(0);
+   }
+}
+
 Int LibVEX_evCheckSzB ( VexArch arch_host )
 {
    static Int cached = 0; /* DO NOT MAKE NON-STATIC */
@@ -1239,6 +1738,7 @@ void LibVEX_default_VexArchInfo ( /*OUT*/VexArchInfo* vai )
 /* Write default settings info *vbi. */
 void LibVEX_default_VexAbiInfo ( /*OUT*/VexAbiInfo* vbi )
 {
+   Int i;
    vbi->guest_stack_redzone_size       = 0;
    vbi->guest_amd64_assume_fs_is_zero  = False;
    vbi->guest_amd64_assume_gs_is_0x60  = False;
@@ -1247,6 +1747,8 @@ void LibVEX_default_VexAbiInfo ( /*OUT*/VexAbiInfo* vbi )
    vbi->guest_ppc_sc_continues_at_LR   = False;
    vbi->host_ppc_calls_use_fndescrs    = False;
    vbi->host_ppc32_regalign_int64_args = False;
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++)
+      vbi->host_amd64_cached_guest_offsets[i] = 0;
 }
 
 
@@ -1292,15 +1794,18 @@ static const HChar* show_hwcaps_amd64 ( UInt hwcaps )
    Bool have_avx  = (hwcaps & VEX_HWCAPS_AMD64_AVX)  != 0;
    Bool have_bmi  = (hwcaps & VEX_HWCAPS_AMD64_BMI)  != 0;
    Bool have_avx2 = (hwcaps & VEX_HWCAPS_AMD64_AVX2) != 0;
+   Bool have_fma3 = (hwcaps & VEX_HWCAPS_AMD64_FMA3) != 0;
    /* AVX without SSE3 */
    if (have_avx && !have_sse3)
       return NULL;
    /* AVX2 or BMI without AVX */
    if ((have_avx2 || have_bmi) && !have_avx)
       return NULL;
+   /* FMA3 without AVX: the insns are VEX-encoded */
+   if (have_fma3 && !have_avx)
+      return NULL;
 
-   /* This isn't threadsafe.  We might need to fix it at some point. */
-   static HChar buf[100] = { 0 };
+   static VEX_TLS HChar buf[100] = { 0 };
    if (buf[0] != 0) return buf; /* already constructed */
 
    vex_bzero(buf, sizeof(buf));
@@ -1334,6 +1839,18 @@ static const HChar* show_hwcaps_amd64 ( UInt hwcaps )
    if (hwcaps & VEX_HWCAPS_AMD64_BMI) {
       p = p + vex_sprintf(p, "%s", "-bmi");
    }
+   if (hwcaps & VEX_HWCAPS_AMD64_SSE42) {
+      p = p + vex_sprintf(p, "%s", "-sse42");
+   }
+   if (hwcaps & VEX_HWCAPS_AMD64_AES) {
+      p = p + vex_sprintf(p, "%s", "-aes");
+   }
+   if (hwcaps & VEX_HWCAPS_AMD64_PCLMUL) {
+      p = p + vex_sprintf(p, "%s", "-pclmul");
+   }
+   if (hwcaps & VEX_HWCAPS_AMD64_FMA3) {
+      p = p + vex_sprintf(p, "%s", "-fma3");
+   }
 
   out:
    vassert(buf[sizeof(buf)-1] == 0);
@@ -1437,11 +1954,27 @@ static const HChar* show_hwcaps_arm ( UInt hwcaps )
 
 static const HChar* show_hwcaps_arm64 ( UInt hwcaps )
 {
-   /* Since there are no variants, just insist that hwcaps is zero,
-      and declare it invalid otherwise. */
-  if (hwcaps == 0)
-     return "baseline";
-  return NULL;
+   /* The only variants are the optional crypto and CRC32
+      extensions, which are independent of each other. */
+   if (hwcaps & ~(VEX_HWCAPS_ARM64_AES | VEX_HWCAPS_ARM64_PMULL
+                  | VEX_HWCAPS_ARM64_CRC32))
+      return NULL;
+   if (hwcaps == 0)
+      return "baseline";
+
+   static VEX_TLS HChar buf[30];
+   vex_bzero(buf, sizeof(buf));
+
+   HChar* p = &buf[0];
+   p = p + vex_sprintf(p, "%s", "v8");
+   if (hwcaps & VEX_HWCAPS_ARM64_AES)
+      p = p + vex_sprintf(p, "%s", "-aes");
+   if (hwcaps & VEX_HWCAPS_ARM64_PMULL)
+      p = p + vex_sprintf(p, "%s", "-pmull");
+   if (hwcaps & VEX_HWCAPS_ARM64_CRC32)
+      p = p + vex_sprintf(p, "%s", "-crc32");
+   vassert(buf[sizeof(buf)-1] == 0);
+   return buf;
 }
 
 static const HChar* show_hwcaps_s390x ( UInt hwcaps )
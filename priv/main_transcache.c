@@ -0,0 +1,564 @@
+
+/*---------------------------------------------------------------*/
+/*--- begin                                 main_transcache.c ---*/
+/*---------------------------------------------------------------*/
+
+/*
+   This file is part of Valgrind, a dynamic binary instrumentation
+   framework.
+
+   Copyright (C) 2004-2013 OpenWorks LLP
+      info@open-works.net
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+   02110-1301, USA.
+
+   The GNU General Public License is contained in the file COPYING.
+
+   Neither the names of the U.S. Department of Energy nor the
+   University of California nor the names of its contributors may be
+   used to endorse or promote products derived from this software
+   without prior written permission.
+*/
+
+#include "libvex_basictypes.h"
+#include "libvex_ir.h"
+#include "libvex.h"
+
+#include "main_util.h"
+#include "host_generic_regs.h"
+#include "guest_generic_bb_to_IR.h"
+
+
+/*---------------------------------------------------------*/
+/*--- Layout of the cache area                          ---*/
+/*---------------------------------------------------------*/
+
+/* The area is a header, a table of hash chain heads and then a log of
+   entries, allocated upwards and never freed.  All links are offsets
+   from the start of the area, so it does not matter where the client
+   maps it.  An offset of zero means "none".
+
+   An entry is keyed on the guest address the translation started at
+   and a hash of everything else that went into it (see config_hash).
+   It is only used if the guest bytes it was made from are unchanged,
+   which is checked by hashing them again on lookup.  A later entry
+   with the same key goes at the front of the chain, so it shadows the
+   stale one.  The extents of every entry, trace or not, are kept in
+   a VexGuestTraceExtents.
+
+   Nothing in an entry depends on where anything is loaded either.
+   The code is stored with its relocations (see HReloc) listed in the
+   entry and the addresses at them taken out: a helper's address is
+   stored relative to LibVEX's own (that of LibVEX_Translate), and a
+   dispatcher address as zero.  The addresses for this process go
+   back in when the entry is used.  The chain sites are the
+   relocations of the two ChainMe kinds.  Only translations for hosts
+   which can list their relocations, so far amd64, are cached.
+
+   Bump TC_MAGIC whenever the layout, or the meaning of any of the
+   translation settings, changes. */
+
+#define TC_MAGIC      0x3430304354584556ULL   /* "VEXTC004" */
+#define TC_N_BUCKETS  4096
+#define TC_MAX_RELOCS 1024
+
+typedef
+   struct {
+      ULong magic;
+      UInt  area_szB;
+      UInt  n_buckets;
+      UInt  used;       /* offset of first free byte */
+      UInt  n_entries;
+      UInt  buckets[TC_N_BUCKETS];
+   }
+   TCHeader;
+
+typedef
+   struct {
+      UInt            next;
+      UInt            host_szB;
+      ULong           guest_addr;
+      ULong           config_hash;
+      ULong           guest_hash;
+      VexGuestTraceExtents vge;
+      Int             offs_profInc;
+      UInt            n_sc_extents;
+      UInt            n_guest_instrs;
+      UInt            sc_mask;
+      UInt            n_relocs;
+      /* followed by n_relocs HRelocs, and then host_szB bytes of
+         code, padded to 8 */
+   }
+   TCEntry;
+
+#define TC_ROUNDUP8(_n) (((_n) + 7) & ~7)
+
+
+/*---------------------------------------------------------*/
+/*--- Hashing                                           ---*/
+/*---------------------------------------------------------*/
+
+/* 64-bit FNV-1a.  Not cryptographic: the cache trusts its own area. */
+
+#define TC_HASH_INIT 0xCBF29CE484222325ULL
+
+static ULong hash_bytes ( ULong h, const UChar* p, UInt n )
+{
+   UInt i;
+   for (i = 0; i < n; i++) {
+      h ^= (ULong)p[i];
+      h *= 0x100000001B3ULL;
+   }
+   return h;
+}
+
+static ULong hash_word ( ULong h, ULong w )
+{
+   UInt i;
+   for (i = 0; i < 8; i++) {
+      h ^= w & 0xFF;
+      h *= 0x100000001B3ULL;
+      w >>= 8;
+   }
+   return h;
+}
+
+static ULong hash_archinfo ( ULong h, const VexArchInfo* vai )
+{
+   h = hash_word(h, vai->hwcaps);
+   h = hash_word(h, vai->hwcache_info.icaches_maintain_coherence);
+   h = hash_word(h, (ULong)(Long)vai->ppc_icache_line_szB);
+   h = hash_word(h, vai->ppc_dcbz_szB);
+   h = hash_word(h, vai->ppc_dcbzl_szB);
+   return h;
+}
+
+/* Code addresses are relative to this, the one address in LibVEX
+   which is sure to be in the same place relative to its helpers. */
+static inline HWord tc_anchor ( void )
+{
+   return (HWord)&LibVEX_Translate;
+}
+
+/* A client callback, as an offset from tc_anchor.  That only stays
+   the same from one process to the next if the client and LibVEX are
+   loaded together, which is also what relocating the client's
+   helpers relative to tc_anchor relies on; if they are not, the
+   cache misses. */
+static ULong hash_code_ptr ( ULong h, HWord fn )
+{
+   h = hash_word(h, fn != 0);
+   if (fn != 0)
+      h = hash_word(h, (ULong)(fn - tc_anchor()));
+   return h;
+}
+
+/* Everything other than the guest bytes which affects the code
+   produced.  None of it may depend on where things are loaded: the
+   client_id, which identifies the build, stands in for the code of
+   LibVEX and of the client's callbacks, and the dispatcher addresses
+   are put in when a translation is used, so only whether they are
+   given matters. */
+static ULong config_hash ( const VexTransCache* tc,
+                           const VexTranslateArgs* vta )
+{
+   const VexControl* vcon = &vexDefaultTranslateContext()->control;
+   const VexAbiInfo* vbi  = &vta->abiinfo_both;
+   ULong h = TC_HASH_INIT;
+   UInt  i;
+
+   h = hash_word(h, tc->client_id);
+
+   h = hash_word(h, vta->arch_guest);
+   h = hash_archinfo(h, &vta->archinfo_guest);
+   h = hash_word(h, vta->arch_host);
+   h = hash_archinfo(h, &vta->archinfo_host);
+
+   h = hash_word(h, (ULong)(Long)vbi->guest_stack_redzone_size);
+   h = hash_word(h, vbi->guest_amd64_assume_fs_is_zero);
+   h = hash_word(h, vbi->guest_amd64_assume_gs_is_0x60);
+   h = hash_word(h, vbi->guest_ppc_zap_RZ_at_blr);
+   h = hash_code_ptr(h, (HWord)vbi->guest_ppc_zap_RZ_at_bl);
+   h = hash_word(h, vbi->guest_ppc_sc_continues_at_LR);
+   h = hash_word(h, vbi->host_ppc_calls_use_fndescrs);
+   h = hash_word(h, vbi->host_ppc32_regalign_int64_args);
+   for (i = 0; i < VEX_N_CACHED_GUEST_REGS; i++)
+      h = hash_word(h, (ULong)(Long)vbi->host_amd64_cached_guest_offsets[i]);
+
+   h = hash_word(h, (ULong)(Long)vcon->iropt_level);
+   h = hash_word(h, vcon->iropt_register_updates);
+   h = hash_word(h, (ULong)(Long)vcon->iropt_unroll_thresh);
+   h = hash_word(h, (ULong)(Long)vcon->guest_max_insns);
+   h = hash_word(h, (ULong)(Long)vcon->guest_chase_thresh);
+   h = hash_word(h, vcon->guest_chase_cond);
+   h = hash_word(h, vcon->shadow_ret_stack);
+   h = hash_word(h, vcon->host_peephole);
+   h = hash_word(h, vcon->host_cold_exits);
+   h = hash_word(h, vcon->guest_rep_bulk);
+   h = hash_word(h, vcon->iropt_loop_hoist);
+
+   /* A trace translation of a block is a different translation
+      from the plain one, and from one along another path. */
+   h = hash_word(h, vta->trace_len);
+   for (i = 0; i < vta->trace_len; i++)
+      h = hash_word(h, vta->trace[i]);
+
+   h = hash_code_ptr(h, (HWord)vta->instrument1);
+   h = hash_code_ptr(h, (HWord)vta->instrument2);
+   h = hash_code_ptr(h, (HWord)vta->finaltidy);
+   h = hash_code_ptr(h, (HWord)vta->preamble_function);
+   h = hash_word(h, vta->sigill_diag);
+   h = hash_word(h, vta->addProfInc);
+   h = hash_word(h, vta->disp_cp_chain_me_to_slowEP != NULL);
+   h = hash_word(h, vta->disp_cp_chain_me_to_fastEP != NULL);
+   h = hash_word(h, vta->disp_cp_xindir != NULL);
+   h = hash_word(h, vta->disp_cp_xindir_miss != NULL);
+   h = hash_word(h, vta->disp_cp_xassisted != NULL);
+   return h;
+}
+
+/* Hash the guest bytes covered by *vge.  As in the front ends, guest
+   address A is assumed to be at host address
+   guest_bytes + (A - guest_bytes_addr). */
+static ULong guest_hash ( const VexTranslateArgs* vta,
+                          const VexGuestTraceExtents* vge )
+{
+   ULong h = TC_HASH_INIT;
+   UInt  i;
+   for (i = 0; i < vge->n_used; i++) {
+      const UChar* p = vta->guest_bytes
+                       + (HWord)(vge->base[i] - vta->guest_bytes_addr);
+      h = hash_word(h, vge->base[i]);
+      h = hash_bytes(h, p, vge->len[i]);
+   }
+   return h;
+}
+
+
+/*---------------------------------------------------------*/
+/*--- Lookup and insertion                              ---*/
+/*---------------------------------------------------------*/
+
+static inline TCHeader* tc_header ( const VexTransCache* tc )
+{
+   return (TCHeader*)tc->area;
+}
+
+static inline TCEntry* tc_entry ( const VexTransCache* tc, UInt offs )
+{
+   return (TCEntry*)(tc->area + offs);
+}
+
+static inline UInt tc_bucket ( ULong guest_addr, ULong cfg )
+{
+   ULong h = hash_word(cfg, guest_addr);
+   return (UInt)(h ^ (h >> 32)) & (TC_N_BUCKETS-1);
+}
+
+static Bool tc_header_ok ( const VexTransCache* tc )
+{
+   const TCHeader* hdr = tc_header(tc);
+   return toBool(hdr->magic == TC_MAGIC
+                 && hdr->area_szB == tc->area_szB
+                 && hdr->n_buckets == TC_N_BUCKETS
+                 && hdr->used >= TC_ROUNDUP8(sizeof(TCHeader))
+                 && hdr->used <= tc->area_szB);
+}
+
+static void tc_format ( VexTransCache* tc )
+{
+   TCHeader* hdr = tc_header(tc);
+   vex_bzero(hdr, sizeof(TCHeader));
+   hdr->area_szB  = tc->area_szB;
+   hdr->n_buckets = TC_N_BUCKETS;
+   hdr->used      = TC_ROUNDUP8(sizeof(TCHeader));
+   hdr->n_entries = 0;
+   /* Set the magic last, so a half-formatted area is never valid. */
+   hdr->magic     = TC_MAGIC;
+}
+
+/* Find a usable entry for vta, or return NULL. */
+static TCEntry* tc_lookup ( VexTransCache* tc, VexTranslateArgs* vta,
+                            ULong cfg )
+{
+   TCHeader* hdr  = tc_header(tc);
+   UInt      offs = hdr->buckets[tc_bucket(vta->guest_bytes_addr, cfg)];
+
+   while (offs != 0) {
+      TCEntry* e;
+      if (offs > hdr->used - sizeof(TCEntry))
+         break; /* corrupt; give up */
+      e = tc_entry(tc, offs);
+      if (e->guest_addr == vta->guest_bytes_addr
+          && e->config_hash == cfg) {
+         /* This is the most recent translation of the block.  It is
+            only any good if the code hasn't changed since and the
+            client still wants the same self-checks. */
+         if (e->vge.n_used < 1
+             || e->vge.n_used > (vta->trace_len > 0
+                                 ? VEX_MAX_TRACE_EXTENTS : 3)
+             || guest_hash(vta, &e->vge) != e->guest_hash) {
+            tc->n_stale++;
+            return NULL;
+         }
+         if (bb_sc_extents(vta->needs_self_check, vta->callback_opaque,
+                           &e->vge) != e->sc_mask) {
+            tc->n_stale++;
+            return NULL;
+         }
+         return e;
+      }
+      offs = e->next;
+   }
+   return NULL;
+}
+
+/* The address at relocation r in code.  Only little-endian hosts
+   list relocations. */
+static ULong reloc_get ( const UChar* code, const HReloc* r )
+{
+   ULong v = 0;
+   Int   i;
+   for (i = r->szB - 1; i >= 0; i--)
+      v = (v << 8) | code[r->offs + i];
+   if (r->szB == 4)
+      v = (ULong)(Long)(Int)(UInt)v;
+   return v;
+}
+
+/* Put v at relocation r in code, unless it doesn't fit. */
+static Bool reloc_put ( UChar* code, const HReloc* r, ULong v )
+{
+   Int i;
+   if (r->szB == 4 && v != (ULong)(Long)(Int)(UInt)v)
+      return False;
+   for (i = 0; i < r->szB; i++) {
+      code[r->offs + i] = (UChar)(v & 0xFF);
+      v >>= 8;
+   }
+   return True;
+}
+
+/* What goes at relocation r for vta, given what the entry has
+   there. */
+static ULong reloc_value ( const VexTranslateArgs* vta, const HReloc* r,
+                           ULong stored )
+{
+   switch (r->kind) {
+      case HReloc_Helper:
+         return (ULong)tc_anchor() + stored;
+      case HReloc_ChainMeSlow:
+         return (ULong)(HWord)vta->disp_cp_chain_me_to_slowEP;
+      case HReloc_ChainMeFast:
+         return (ULong)(HWord)vta->disp_cp_chain_me_to_fastEP;
+      case HReloc_XIndir:
+         return (ULong)(HWord)vta->disp_cp_xindir;
+      case HReloc_XIndirMiss:
+         return (ULong)(HWord)vta->disp_cp_xindir_miss;
+      case HReloc_XAssisted:
+         return (ULong)(HWord)vta->disp_cp_xassisted;
+      default:
+         vpanic("reloc_value(main_transcache)");
+   }
+}
+
+static void tc_insert ( VexTransCache* tc, VexTranslateArgs* vta,
+                        ULong cfg, VexTranslateResult* res,
+                        const HReloc* relocs, Int n_relocs )
+{
+   TCHeader* hdr      = tc_header(tc);
+   UInt      host_szB = (UInt)*(vta->host_bytes_used);
+   UInt      szB      = sizeof(TCEntry) + n_relocs * sizeof(HReloc)
+                        + TC_ROUNDUP8(host_szB);
+   UInt      bucket, offs, i;
+   TCEntry*  e;
+   HReloc*   rs;
+   UChar*    code;
+   ULong     stored;
+
+   if (tc->area_szB - hdr->used < szB) {
+      tc->n_full++;
+      return;
+   }
+
+   offs = hdr->used;
+   e    = tc_entry(tc, offs);
+   e->host_szB       = host_szB;
+   e->guest_addr     = vta->guest_bytes_addr;
+   e->config_hash    = cfg;
+   if (vta->trace_len > 0) {
+      e->vge = *(vta->trace_extents);
+   } else {
+      e->vge.n_used = vta->guest_extents->n_used;
+      for (i = 0; i < e->vge.n_used; i++) {
+         e->vge.base[i] = vta->guest_extents->base[i];
+         e->vge.len[i]  = vta->guest_extents->len[i];
+      }
+   }
+   e->guest_hash     = guest_hash(vta, &e->vge);
+   e->offs_profInc   = res->offs_profInc;
+   e->n_sc_extents   = res->n_sc_extents;
+   e->n_guest_instrs = res->n_guest_instrs;
+   e->sc_mask        = bb_sc_extents(vta->needs_self_check,
+                                     vta->callback_opaque, &e->vge);
+   e->n_relocs       = (UInt)n_relocs;
+   rs   = (HReloc*)(e+1);
+   code = (UChar*)(rs + n_relocs);
+   for (i = 0; i < host_szB; i++)
+      code[i] = vta->host_bytes[i];
+   for (i = 0; i < (UInt)n_relocs; i++) {
+      rs[i]  = relocs[i];
+      stored = relocs[i].kind == HReloc_Helper
+                  ? reloc_get(code, &rs[i]) - (ULong)tc_anchor()
+                  : 0;
+      if (!reloc_put(code, &rs[i], stored)) {
+         tc->n_full++;
+         return;
+      }
+   }
+
+   /* Publish the entry only once it is complete. */
+   bucket = tc_bucket(e->guest_addr, cfg);
+   e->next = hdr->buckets[bucket];
+   hdr->used += szB;
+   hdr->n_entries++;
+   hdr->buckets[bucket] = offs;
+   tc->n_inserts++;
+}
+
+/* Hand out entry e's translation for vta, with this process's
+   addresses put in.  Returns False, with host_bytes and the extents
+   possibly overwritten, if an address doesn't fit where it has to
+   go. */
+static Bool tc_use ( VexTranslateArgs* vta, const TCEntry* e,
+                     /*OUT*/VexTranslateResult* res )
+{
+   const HReloc* rs   = (const HReloc*)(e+1);
+   const UChar*  code = (const UChar*)(rs + e->n_relocs);
+   UInt          i;
+
+   res->n_sc_extents   = e->n_sc_extents;
+   res->offs_profInc   = e->offs_profInc;
+   res->n_guest_instrs = e->n_guest_instrs;
+   if (vta->trace_len > 0) {
+      *(vta->trace_extents) = e->vge;
+   } else {
+      vex_bzero(vta->guest_extents, sizeof(VexGuestExtents));
+      vta->guest_extents->n_used = e->vge.n_used;
+      for (i = 0; i < e->vge.n_used; i++) {
+         vta->guest_extents->base[i] = e->vge.base[i];
+         vta->guest_extents->len[i]  = e->vge.len[i];
+      }
+   }
+   if (e->host_szB > (UInt)vta->host_bytes_size) {
+      res->status = VexTransOutputFull;
+      return True;
+   }
+   for (i = 0; i < e->host_szB; i++)
+      vta->host_bytes[i] = code[i];
+   for (i = 0; i < e->n_relocs; i++) {
+      ULong v = reloc_value(vta, &rs[i], reloc_get(code, &rs[i]));
+      if (!reloc_put(vta->host_bytes, &rs[i], v))
+         return False;
+   }
+   *(vta->host_bytes_used) = (Int)e->host_szB;
+
+   if (vta->n_chain_sites) {
+      *(vta->n_chain_sites) = 0;
+      for (i = 0; i < e->n_relocs; i++) {
+         if (rs[i].kind != HReloc_ChainMeSlow
+             && rs[i].kind != HReloc_ChainMeFast)
+            continue;
+         if (*(vta->n_chain_sites) < vta->chain_sites_size)
+            vta->chain_sites[*(vta->n_chain_sites)]
+               = rs[i].offs - rs[i].back;
+         (*(vta->n_chain_sites))++;
+      }
+   }
+   res->status = VexTransOK;
+   return True;
+}
+
+
+/*---------------------------------------------------------*/
+/*--- Exported to library client                        ---*/
+/*---------------------------------------------------------*/
+
+void LibVEX_InitTransCache ( /*OUT*/VexTransCache* tc,
+                             void* area, UInt area_szB, ULong client_id )
+{
+   vassert(area != NULL);
+   vassert(0 == (((HWord)area) & 7));
+   vex_bzero(tc, sizeof(VexTransCache));
+   tc->area      = area;
+   tc->area_szB  = area_szB & ~7;
+   tc->client_id = client_id;
+   vassert(tc->area_szB >= TC_ROUNDUP8(sizeof(TCHeader)) + 4096);
+   if (!tc_header_ok(tc))
+      tc_format(tc);
+}
+
+VexTranslateResult LibVEX_TranslateCached ( VexTransCache* tc,
+                                            VexTranslateArgs* vta )
+{
+   VexTranslateResult res;
+   TCEntry* e;
+   ULong    cfg;
+   HReloc   relocs[TC_MAX_RELOCS];
+   Int      n_relocs;
+
+   /* Tracing wants to see the pipeline run, so bypass the cache. */
+   if (vta->traceflags != 0)
+      return LibVEX_Translate(vta);
+
+   cfg = config_hash(tc, vta);
+   tc->n_lookups++;
+   e = tc_lookup(tc, vta, cfg);
+
+   if (e != NULL) {
+      if (tc_use(vta, e, &res)) {
+         if (res.status == VexTransOK)
+            tc->n_hits++;
+         return res;
+      }
+      tc->n_stale++;
+   }
+
+   res = vexTranslateRelocs(vta, relocs, TC_MAX_RELOCS, &n_relocs);
+   if (res.status == VexTransOK) {
+      if (n_relocs >= 0)
+         tc_insert(tc, vta, cfg, &res, relocs, n_relocs);
+      else
+         tc->n_full++;
+   }
+   return res;
+}
+
+void LibVEX_ShowTransCacheStats ( const VexTransCache* tc )
+{
+   const TCHeader* hdr = tc_header(tc);
+   vex_printf("vex transcache: %u lookups, %u hits, %u stale, "
+              "%u inserts, %u not cached\n",
+              tc->n_lookups, tc->n_hits, tc->n_stale,
+              tc->n_inserts, tc->n_full);
+   vex_printf("vex transcache: %u entries, %u of %u bytes used\n",
+              hdr->n_entries, hdr->used, tc->area_szB);
+}
+
+
+/*---------------------------------------------------------------*/
+/*--- end                                   main_transcache.c ---*/
+/*---------------------------------------------------------------*/
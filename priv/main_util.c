@@ -50,16 +50,54 @@
    second to LibVEX_Alloc(16) -- that is, allocate memory at over 400
    MByte/sec.  Once the size increases enough to fall out of the cache
    into memory, the rate falls by about a factor of 3. 
+
+   This is the fixed size of the built-in context's temporary area.
+   If the client has supplied a page source (LibVEX_SetTempPageSource)
+   only the first chunk's worth of it is used, and a translation which
+   needs more grows the arena in chunks taken from the page source.
 */
 #define N_TEMPORARY_BYTES 5000000
 
+/* The temporary area of the built-in translation context, which is
+   the one LibVEX_Translate uses.  Contexts set up by the client with
+   LibVEX_InitTranslateContext bring their own. */
 static HChar  temporary[N_TEMPORARY_BYTES] __attribute__((aligned(8)));
-static HChar* temporary_first = &temporary[0];
-static HChar* temporary_curr  = &temporary[0];
-static HChar* temporary_last  = &temporary[N_TEMPORARY_BYTES-1];
 
-static ULong  temporary_bytes_allocd_TOT = 0;
+static VexTranslateContext default_ctx
+   = { .temp_first      = &temporary[0],
+       .temp_curr       = &temporary[0],
+       .temp_last       = &temporary[N_TEMPORARY_BYTES-1],
+       .temp_base_first = &temporary[0],
+       .temp_base_last  = &temporary[N_TEMPORARY_BYTES-1] };
+
+/* The context whose temporary area this thread allocates from. */
+static VEX_TLS VexTranslateContext* curr_ctx = &default_ctx;
+
+/* Where this thread's translations are accounted. */
+VEX_TLS VexTranslateStats* vex_tstats = &default_ctx.stats;
+
+/* Where temporary areas get extra chunks from, if anywhere.  Chunks
+   are handed back when the translation which needed them is done, so
+   each context returns to its baseline area between translations.
+   Each chunk starts with a TempChunk header, and chunk sizes are
+   multiples of TEMP_CHUNK_ALIGN. */
+static void* (*temp_get_pages) ( HWord szB )          = NULL;
+static void  (*temp_put_pages) ( void* p, HWord szB ) = NULL;
+static HWord temp_chunk_szB = 0;
+
+typedef
+   struct _TempChunk {
+      struct _TempChunk* next;
+      HWord              szB;
+   }
+   TempChunk;
+
+#define TEMP_CHUNK_HDR_SZB 16
+#define TEMP_CHUNK_ALIGN   4096
 
+/* The permanent area is shared by all contexts.  It is only used to
+   build immutable data on first use (see DEFINE_PATTERN), so it is
+   small, and a thread holds permanent_lock whilst in PERM mode. */
 #define N_PERMANENT_BYTES 10000
 
 static HChar  permanent[N_PERMANENT_BYTES] __attribute__((aligned(8)));
@@ -67,23 +105,46 @@ static HChar* permanent_first = &permanent[0];
 static HChar* permanent_curr  = &permanent[0];
 static HChar* permanent_last  = &permanent[N_PERMANENT_BYTES-1];
 
-static VexAllocMode mode = VexAllocModeTEMP;
+static volatile Int permanent_lock = 0;
+
+static VEX_TLS VexAllocMode mode = VexAllocModeTEMP;
+
+static void lock_permanent ( void )
+{
+#  if defined(VEX_THREADSAFE)
+   while (__sync_lock_test_and_set(&permanent_lock, 1)) {
+      while (permanent_lock)
+         ;
+   }
+#  endif
+}
+
+static void unlock_permanent ( void )
+{
+#  if defined(VEX_THREADSAFE)
+   __sync_lock_release(&permanent_lock);
+#  endif
+}
 
 void vexAllocSanityCheck ( void )
 {
-   vassert(temporary_first == &temporary[0]);
-   vassert(temporary_last  == &temporary[N_TEMPORARY_BYTES-1]);
+   VexTranslateContext* ctx = curr_ctx;
+   vassert(ctx->temp_first != NULL);
+   vassert(ctx->temp_base_first != NULL);
    vassert(permanent_first == &permanent[0]);
    vassert(permanent_last  == &permanent[N_PERMANENT_BYTES-1]);
-   vassert(temporary_first <= temporary_curr);
-   vassert(temporary_curr  <= temporary_last);
+   vassert(ctx->temp_first <= ctx->temp_curr);
+   vassert(ctx->temp_curr  <= ctx->temp_last);
+   vassert(ctx->temp_base_first <= ctx->temp_base_last);
+   vassert((ctx->temp_chunks == NULL) 
+           == (ctx->temp_first == ctx->temp_base_first));
    vassert(permanent_first <= permanent_curr);
    vassert(permanent_curr  <= permanent_last);
    vassert(private_LibVEX_alloc_first <= private_LibVEX_alloc_curr);
    vassert(private_LibVEX_alloc_curr  <= private_LibVEX_alloc_last);
    if (mode == VexAllocModeTEMP){
-      vassert(private_LibVEX_alloc_first == temporary_first);
-      vassert(private_LibVEX_alloc_last  == temporary_last);
+      vassert(private_LibVEX_alloc_first == ctx->temp_first);
+      vassert(private_LibVEX_alloc_last  == ctx->temp_last);
    } 
    else
    if (mode == VexAllocModePERM) {
@@ -95,9 +156,11 @@ void vexAllocSanityCheck ( void )
 
 #  define IS_WORD_ALIGNED(p)   (0 == (((HWord)p) & (sizeof(HWord)-1)))
    vassert(sizeof(HWord) == 4 || sizeof(HWord) == 8);
-   vassert(IS_WORD_ALIGNED(temporary_first));
-   vassert(IS_WORD_ALIGNED(temporary_curr));
-   vassert(IS_WORD_ALIGNED(temporary_last+1));
+   vassert(IS_WORD_ALIGNED(ctx->temp_first));
+   vassert(IS_WORD_ALIGNED(ctx->temp_curr));
+   vassert(IS_WORD_ALIGNED(ctx->temp_last+1));
+   vassert(IS_WORD_ALIGNED(ctx->temp_base_first));
+   vassert(IS_WORD_ALIGNED(ctx->temp_base_last+1));
    vassert(IS_WORD_ALIGNED(permanent_first));
    vassert(IS_WORD_ALIGNED(permanent_curr));
    vassert(IS_WORD_ALIGNED(permanent_last+1));
@@ -115,7 +178,7 @@ void vexSetAllocMode ( VexAllocMode m )
 
    /* Save away the current allocation point .. */
    if (mode == VexAllocModeTEMP){
-      temporary_curr = private_LibVEX_alloc_curr;
+      curr_ctx->temp_curr = private_LibVEX_alloc_curr;
    } 
    else
    if (mode == VexAllocModePERM) {
@@ -127,10 +190,15 @@ void vexSetAllocMode ( VexAllocMode m )
    /* Did that screw anything up? */
    vexAllocSanityCheck();
 
+   if (mode == VexAllocModePERM && m != VexAllocModePERM)
+      unlock_permanent();
+   if (mode != VexAllocModePERM && m == VexAllocModePERM)
+      lock_permanent();
+
    if (m == VexAllocModeTEMP){
-      private_LibVEX_alloc_first = temporary_first;
-      private_LibVEX_alloc_curr  = temporary_curr;
-      private_LibVEX_alloc_last  = temporary_last;
+      private_LibVEX_alloc_first = curr_ctx->temp_first;
+      private_LibVEX_alloc_curr  = curr_ctx->temp_curr;
+      private_LibVEX_alloc_last  = curr_ctx->temp_last;
    } 
    else
    if (m == VexAllocModePERM) {
@@ -151,15 +219,14 @@ VexAllocMode vexGetAllocMode ( void )
 
 /* Visible to library client, unfortunately. */
 
-HChar* private_LibVEX_alloc_first = &temporary[0];
-HChar* private_LibVEX_alloc_curr  = &temporary[0];
-HChar* private_LibVEX_alloc_last  = &temporary[N_TEMPORARY_BYTES-1];
+VEX_TLS HChar* private_LibVEX_alloc_first = &temporary[0];
+VEX_TLS HChar* private_LibVEX_alloc_curr  = &temporary[0];
+VEX_TLS HChar* private_LibVEX_alloc_last  = &temporary[N_TEMPORARY_BYTES-1];
 
 __attribute__((noreturn))
-void private_LibVEX_alloc_OOM(void)
+static void alloc_OOM ( void )
 {
-   const HChar* pool = "???";
-   if (private_LibVEX_alloc_first == &temporary[0]) pool = "TEMP";
+   const HChar* pool = "TEMP";
    if (private_LibVEX_alloc_first == &permanent[0]) pool = "PERM";
    vex_printf("VEX temporary storage exhausted.\n");
    vex_printf("Pool = %s,  start %p curr %p end %p (size %lld)\n",
@@ -169,38 +236,197 @@ void private_LibVEX_alloc_OOM(void)
               private_LibVEX_alloc_last,
               (Long)(private_LibVEX_alloc_last + 1 - private_LibVEX_alloc_first));
    vpanic("VEX temporary storage exhausted.\n"
-          "Increase N_{TEMPORARY,PERMANENT}_BYTES and recompile.");
+          "Increase N_{TEMPORARY,PERMANENT}_BYTES and recompile,\n"
+          "or give LibVEX_SetTempPageSource a page source.");
+}
+
+/* Called by LibVEX_Alloc when the current chunk can't supply nbytes
+   (already rounded up to the alignment unit).  In TEMP mode with a
+   page source, move on to a new chunk; otherwise we're out of luck. */
+void* private_LibVEX_alloc_slow ( Int nbytes )
+{
+   VexTranslateContext* ctx = curr_ctx;
+   TempChunk* chunk;
+   HChar*     first;
+   HWord      szB;
+
+   if (mode != VexAllocModeTEMP || temp_get_pages == NULL || nbytes < 0)
+      alloc_OOM();
+
+   /* LibVEX_Alloc insists that the new allocation point stays strictly
+      below the last byte, hence the 8 spare bytes. */
+   szB = temp_chunk_szB;
+   if (szB < TEMP_CHUNK_HDR_SZB + (HWord)nbytes + 8)
+      szB = (TEMP_CHUNK_HDR_SZB + (HWord)nbytes + 8 + TEMP_CHUNK_ALIGN-1)
+            & ~(HWord)(TEMP_CHUNK_ALIGN-1);
+
+   chunk = temp_get_pages(szB);
+   if (chunk == NULL)
+      alloc_OOM();
+   vassert(0 == (((HWord)chunk) & 7));
+
+   ctx->temp_bytes_prev 
+      += (ULong)(private_LibVEX_alloc_curr - private_LibVEX_alloc_first);
+   chunk->next      = ctx->temp_chunks;
+   chunk->szB       = szB;
+   ctx->temp_chunks = chunk;
+   ctx->temp_n_chunks++;
+   ctx->temp_n_chunks_TOT++;
+   if (ctx->temp_n_chunks > ctx->temp_n_chunks_max)
+      ctx->temp_n_chunks_max = ctx->temp_n_chunks;
+
+   first = ((HChar*)chunk) + TEMP_CHUNK_HDR_SZB;
+   ctx->temp_first = first;
+   ctx->temp_curr  = first + nbytes;
+   ctx->temp_last  = ((HChar*)chunk) + szB - 1;
+   private_LibVEX_alloc_first = ctx->temp_first;
+   private_LibVEX_alloc_curr  = ctx->temp_curr;
+   private_LibVEX_alloc_last  = ctx->temp_last;
+   return first;
 }
 
 void vexSetAllocModeTEMP_and_clear ( void )
 {
+   VexTranslateContext* ctx = curr_ctx;
+   ULong used;
+
    /* vassert(vex_initdone); */ /* causes infinite assert loops */
-   temporary_bytes_allocd_TOT 
-      += (ULong)(private_LibVEX_alloc_curr - private_LibVEX_alloc_first);
+   used = ctx->temp_bytes_prev
+          + (ULong)(private_LibVEX_alloc_curr - private_LibVEX_alloc_first);
+   ctx->temp_bytes_allocd_TOT += used;
+   if (used > ctx->temp_bytes_hwm)
+      ctx->temp_bytes_hwm = used;
+
+   /* Hand back any chunks taken on since the last clear. */
+   while (ctx->temp_chunks != NULL) {
+      TempChunk* chunk = ctx->temp_chunks;
+      ctx->temp_chunks = chunk->next;
+      vassert(temp_put_pages != NULL);
+      temp_put_pages(chunk, chunk->szB);
+   }
+   ctx->temp_n_chunks   = 0;
+   ctx->temp_bytes_prev = 0;
 
    mode = VexAllocModeTEMP;
-   temporary_curr            = &temporary[0];
-   private_LibVEX_alloc_curr = &temporary[0];
+   ctx->temp_first            = ctx->temp_base_first;
+   ctx->temp_curr             = ctx->temp_base_first;
+   ctx->temp_last             = ctx->temp_base_last;
+   private_LibVEX_alloc_first = ctx->temp_first;
+   private_LibVEX_alloc_curr  = ctx->temp_first;
+   private_LibVEX_alloc_last  = ctx->temp_last;
 
    /* Set to (1) and change the fill byte to 0x00 or 0xFF to test for
       any potential bugs due to using uninitialised memory in the main
       VEX storage area. */
    if (0) {
-      Int i;
-      for (i = 0; i < N_TEMPORARY_BYTES; i++)
-         temporary[i] = 0x00;
+      HChar* p;
+      for (p = ctx->temp_first; p <= ctx->temp_last; p++)
+         *p = 0x00;
    }
 
    vexAllocSanityCheck();
 }
 
 
+/* Translation contexts. */
+
+VexTranslateContext* vexDefaultTranslateContext ( void )
+{
+   return &default_ctx;
+}
+
+void vexInitTranslateContextStorage ( VexTranslateContext* ctx,
+                                      HChar* area, Int szB )
+{
+   vassert(0 == (((HWord)area) & 7));
+   szB &= ~7;
+   vassert(szB > 0);
+   ctx->temp_first            = area;
+   ctx->temp_curr             = area;
+   ctx->temp_last             = area + szB - 1;
+   ctx->temp_base_first       = area;
+   ctx->temp_base_last        = area + szB - 1;
+   ctx->temp_chunks           = NULL;
+   ctx->temp_n_chunks         = 0;
+   ctx->temp_bytes_prev       = 0;
+   ctx->temp_bytes_allocd_TOT = 0;
+   ctx->temp_bytes_hwm        = 0;
+   ctx->temp_n_chunks_TOT     = 0;
+   ctx->temp_n_chunks_max     = 0;
+}
+
+VexTranslateContext* vexBindTranslateContext ( VexTranslateContext* ctx )
+{
+   VexTranslateContext* prev = curr_ctx;
+   vassert(mode == VexAllocModeTEMP);
+   vassert(ctx->temp_first != NULL);
+   /* Nothing in a context's temporary area survives a translation, so
+      there is no need to save this thread's allocation point into the
+      context being left. */
+   curr_ctx   = ctx;
+   vex_tstats = &ctx->stats;
+   private_LibVEX_alloc_first = ctx->temp_first;
+   private_LibVEX_alloc_curr  = ctx->temp_curr;
+   private_LibVEX_alloc_last  = ctx->temp_last;
+   vexAllocSanityCheck();
+   return prev;
+}
+
+
 /* Exported to library client. */
 
+void LibVEX_SetTempPageSource ( void* (*get_pages) ( HWord szB ),
+                                void  (*put_pages) ( void* p, HWord szB ),
+                                Int chunk_szB )
+{
+   VexTranslateContext* ctx = &default_ctx;
+   HWord base_szB;
+
+   vassert(sizeof(TempChunk) <= TEMP_CHUNK_HDR_SZB);
+   vassert((get_pages == NULL) == (put_pages == NULL));
+   vassert(mode == VexAllocModeTEMP);
+   vassert(ctx->temp_chunks == NULL);
+   vassert(ctx->temp_curr == ctx->temp_base_first);
+
+   if (get_pages == NULL) {
+      temp_get_pages = NULL;
+      temp_put_pages = NULL;
+      temp_chunk_szB = 0;
+      base_szB       = N_TEMPORARY_BYTES;
+   } else {
+      vassert(chunk_szB >= TEMP_CHUNK_ALIGN);
+      temp_get_pages = get_pages;
+      temp_put_pages = put_pages;
+      temp_chunk_szB = ((HWord)chunk_szB) & ~(HWord)(TEMP_CHUNK_ALIGN-1);
+      base_szB       = temp_chunk_szB < N_TEMPORARY_BYTES
+                          ? temp_chunk_szB : N_TEMPORARY_BYTES;
+   }
+
+   /* The built-in context keeps only the first chunk's worth of its
+      static area as a baseline, so the rest of it is never touched. */
+   ctx->temp_first     = &temporary[0];
+   ctx->temp_curr      = &temporary[0];
+   ctx->temp_last      = &temporary[base_szB-1];
+   ctx->temp_base_last = ctx->temp_last;
+   if (curr_ctx == ctx) {
+      private_LibVEX_alloc_first = ctx->temp_first;
+      private_LibVEX_alloc_curr  = ctx->temp_curr;
+      private_LibVEX_alloc_last  = ctx->temp_last;
+   }
+}
+
 void LibVEX_ShowAllocStats ( void )
 {
+   VexTranslateContext* ctx = &default_ctx;
    vex_printf("vex storage: T total %lld bytes allocated\n",
-              (Long)temporary_bytes_allocd_TOT );
+              (Long)ctx->temp_bytes_allocd_TOT );
+   vex_printf("vex storage: T high water %lld bytes in one translation "
+              "(baseline %lld bytes)\n",
+              (Long)ctx->temp_bytes_hwm,
+              (Long)(ctx->temp_base_last + 1 - ctx->temp_base_first) );
+   vex_printf("vex storage: T %u extra chunks obtained, "
+              "at most %u at once\n",
+              ctx->temp_n_chunks_TOT, ctx->temp_n_chunks_max );
    vex_printf("vex storage: P total %lld bytes allocated\n",
               (Long)(permanent_curr - permanent_first) );
 }
@@ -484,8 +710,8 @@ UInt vprintf_wrk ( void(*sink)(HChar),
    debugging info should be sent via here.  The official route is to
    to use vg_message().  This interface is deprecated.
 */
-static HChar myprintf_buf[1000];
-static Int   n_myprintf_buf;
+static VEX_TLS HChar myprintf_buf[1000];
+static VEX_TLS Int   n_myprintf_buf;
 
 static void add_to_myprintf_buf ( HChar c )
 {
@@ -521,7 +747,7 @@ UInt vex_printf ( const HChar* format, ... )
 
 /* A general replacement for sprintf(). */
 
-static HChar *vg_sprintf_ptr;
+static VEX_TLS HChar *vg_sprintf_ptr;
 
 static void add_to_vg_sprintf_buf ( HChar c )
 {
@@ -37,6 +37,7 @@
 #define __VEX_MAIN_UTIL_H
 
 #include "libvex_basictypes.h"
+#include "libvex.h"
 
 
 /* Misc. */
@@ -98,6 +99,54 @@ extern void         vexAllocSanityCheck ( void );
 
 extern void vexSetAllocModeTEMP_and_clear ( void );
 
+/* Translation contexts.  Each thread allocates in TEMP mode from the
+   temporary area of the context most recently bound to it.  The PERM
+   area is shared by all threads, and a thread in PERM mode holds a
+   lock on it, so only stay there for as long as necessary. */
+
+extern VexTranslateContext* vexDefaultTranslateContext ( void );
+extern void vexInitTranslateContextStorage ( VexTranslateContext*,
+                                             HChar* area, Int szB );
+/* Returns the context previously bound to this thread. */
+extern VexTranslateContext* vexBindTranslateContext ( VexTranslateContext* );
+
+/* Statistics of the context bound to this thread. */
+extern VEX_TLS VexTranslateStats* vex_tstats;
+
+/* Read the host's timestamp counter, for vex_tstats.  See
+   VexTranslateStats for what the units are. */
+static inline ULong vexReadCycles ( void )
+{
+#  if defined(__x86_64__) || defined(__i386__)
+   UInt lo, hi;
+   __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+   return (((ULong)hi) << 32) | (ULong)lo;
+#  elif defined(__aarch64__)
+   ULong t;
+   __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r"(t));
+   return t;
+#  elif defined(__powerpc64__)
+   ULong t;
+   __asm__ __volatile__ ("mftb %0" : "=r"(t));
+   return t;
+#  elif defined(__s390x__)
+   ULong t;
+   __asm__ __volatile__ ("stck %0" : "=Q"(t) : : "cc");
+   return t;
+#  else
+   return 0;
+#  endif
+}
+
+/* Charge the time since *since to phase ph, and restart the clock. */
+static inline void vexPhaseDone ( VexTranslatePhase ph, ULong* since )
+{
+   ULong now = vexReadCycles();
+   vex_tstats->cycles[ph] += now - *since;
+   vex_tstats->calls[ph]++;
+   *since = now;
+}
+
 #endif /* ndef __VEX_MAIN_UTIL_H */
 
 /*---------------------------------------------------------------*/
@@ -88,6 +88,10 @@ typedef
 #define VEX_HWCAPS_AMD64_RDTSCP (1<<9)  /* RDTSCP instruction */
 #define VEX_HWCAPS_AMD64_BMI    (1<<10) /* BMI1 instructions */
 #define VEX_HWCAPS_AMD64_AVX2   (1<<11) /* AVX2 instructions */
+#define VEX_HWCAPS_AMD64_SSE42  (1<<12) /* SSE4.2, for CRC32 */
+#define VEX_HWCAPS_AMD64_AES    (1<<13) /* AES-NI instructions */
+#define VEX_HWCAPS_AMD64_PCLMUL (1<<14) /* PCLMULQDQ instruction */
+#define VEX_HWCAPS_AMD64_FMA3   (1<<15) /* FMA3 (vfmadd/vfmsub) insns */
 
 /* ppc32: baseline capability is integer only */
 #define VEX_HWCAPS_PPC32_F     (1<<8)  /* basic (non-optional) FP */
@@ -174,7 +178,9 @@ typedef
 #define VEX_ARM_ARCHLEVEL(x) ((x) & 0x3f)
 
 /* ARM64: baseline capability is AArch64 v8. */
-/* (no definitions since no variants so far) */
+#define VEX_HWCAPS_ARM64_AES   (1<<0)  /* AESE/AESD/AESMC/AESIMC */
+#define VEX_HWCAPS_ARM64_PMULL (1<<1)  /* PMULL{2} with 64-bit lanes */
+#define VEX_HWCAPS_ARM64_CRC32 (1<<2)  /* CRC32{C}{B,H,W,X} */
 
 /* MIPS baseline capability */
 /* Assigned Company values for bits 23:16 of the PRId Register
@@ -341,8 +347,18 @@ void LibVEX_default_VexArchInfo ( /*OUT*/VexArchInfo* vai );
       host is ppc32-linux                 ==> True
       host is ppc32-aix5                  ==> False
       host is other                       ==> inapplicable
+
+   host_amd64_cached_guest_offsets:
+      host is amd64                       ==> client's choice; see
+                                              "Cached guest registers"
+                                              below
+      host is other                       ==> all zero
 */
 
+/* Maximum number of guest registers which can be kept in host
+   registers across translations. */
+#define VEX_N_CACHED_GUEST_REGS 4
+
 typedef
    struct {
       /* PPC and AMD64 GUESTS only: how many bytes below the 
@@ -383,6 +399,12 @@ typedef
          (actual parameter) in a pair of regs, should we skip an arg
          reg if it is even-numbered?  True => yes, False => no. */
       Bool host_ppc32_regalign_int64_args;
+
+      /* AMD64 HOSTS only: guest state offsets of 64-bit guest
+         registers to be kept in host registers, rather than in the
+         guest state, across translations.  Slot i is kept in %r15-i
+         (%r15, %r14, %r13, %r12); zero means the slot is unused. */
+      Int host_amd64_cached_guest_offsets[VEX_N_CACHED_GUEST_REGS];
    }
    VexAbiInfo;
 
@@ -445,9 +467,62 @@ typedef
       /* EXPERIMENTAL: chase across conditional branches?  Not all
          front ends honour this.  Default: NO. */
       Bool guest_chase_cond;
+      /* Predict guest returns with a shadow return stack?  Default:
+         NO.  Currently this only has an effect for amd64 guests on
+         amd64 hosts, and only when chaining is enabled.  Each exit
+         with Ijk_Call pushes the guest return address, and the host
+         address of a chain-me stub which continues there, onto a
+         small ring in the guest state (the host_RS_ fields).  Each
+         exit with Ijk_Ret whose target matches the top entry pops
+         it and jumps to the stub instead of to disp_cp_xindir.
+         host_RS_HITS and host_RS_MISSES count the outcomes.  Direct
+         calls are not chased while this is set, so that they end the
+         block and do the push.
+
+         The stubs live in the calling translations, so the client
+         must empty the ring (see, for example,
+         LibVEX_GuestAMD64_clear_ret_stack) whenever it discards any
+         translations.  The stubs are chained and unchained like
+         any other XDirect. */
+      Bool shadow_ret_stack;
+      /* Run the host's peephole rules over register-allocated code
+         before assembling it?  Default: YES.  Currently only amd64
+         and arm64 hosts have any rules; see VexPeepholeRule. */
+      Bool host_peephole;
+      /* Move conditional exits out of the fall-through path?
+         Default: NO, as it makes the code bigger for no measured
+         gain so far.  Each becomes a branch to an unconditional
+         copy placed after the block's final jump.  Only amd64, x86
+         and arm64 hosts do this.  The copies are chained and
+         unchained as usual.  On amd64 and x86 the branches are
+         2 bytes long where the copy is in rel8 reach. */
+      Bool host_cold_exits;
+      /* Translate REP MOVS, STOS, CMPS and SCAS on x86 and amd64
+         guests into a dirty helper call that does many iterations
+         at once, rather than IR for a single iteration?  Default:
+         NO.  The helper's memory accesses do not appear in the IR,
+         so only a client that does not instrument loads and stores
+         should set this to YES. */
+      Bool guest_rep_bulk;
+      /* Let a translation of a block that jumps back to its own
+         start loop inside the host code, with values that do not
+         change between iterations computed once before the loop
+         and kept in host registers?  Default: NO.  Guest state
+         GETs of registers the block does not write, loads from
+         memory it does not store to, and pure helper calls of
+         those qualify; no load does if the block calls a dirty
+         helper.  Each iteration still does the event check,
+         and the profile increment if any.  Only amd64 hosts do
+         this, only when chaining is enabled, and not for
+         instrumented or multi-extent translations. */
+      Bool iropt_loop_hoist;
    }
    VexControl;
 
+/* Number of entries in the shadow return stack, when it is
+   enabled. */
+#define VEX_RET_STACK_SIZE 16
+
 
 /* Write the default settings into *vcon. */
 
@@ -465,10 +540,10 @@ void LibVEX_default_VexControl ( /*OUT*/ VexControl* vcon );
    LibVEX_Translate.  The storage allocated will only stay alive until
    translation of the current basic block is complete.
  */
-extern HChar* private_LibVEX_alloc_first;
-extern HChar* private_LibVEX_alloc_curr;
-extern HChar* private_LibVEX_alloc_last;
-extern void   private_LibVEX_alloc_OOM(void) __attribute__((noreturn));
+extern VEX_TLS HChar* private_LibVEX_alloc_first;
+extern VEX_TLS HChar* private_LibVEX_alloc_curr;
+extern VEX_TLS HChar* private_LibVEX_alloc_last;
+extern void*  private_LibVEX_alloc_slow(Int nbytes);
 
 static inline void* LibVEX_Alloc ( Int nbytes )
 {
@@ -502,13 +577,34 @@ static inline void* LibVEX_Alloc ( Int nbytes )
    curr   = private_LibVEX_alloc_curr;
    next   = curr + nbytes;
    if (next >= private_LibVEX_alloc_last)
-      private_LibVEX_alloc_OOM();
+      return private_LibVEX_alloc_slow(nbytes);
    private_LibVEX_alloc_curr = next;
    return curr;
 #endif
 }
 
-/* Show Vex allocation statistics. */
+/* By default the temporary area has a fixed size, and a translation
+   which needs more than that is fatal.  Supplying a page source lets
+   it grow instead: once the baseline area is full, get_pages is asked
+   for chunks of chunk_szB bytes (more if a single allocation needs
+   it; always a multiple of 4096), and they are given back to
+   put_pages when the translation finishes.  get_pages must return
+   8-aligned memory, or NULL on failure, which is fatal.  With a page
+   source, the built-in context's baseline shrinks to chunk_szB bytes
+   (if that is smaller), and LibVEX_InitTranslateContext's temp_area
+   becomes a baseline for the context too.  Under VEX_THREADSAFE both
+   functions may be called from several threads at once.
+
+   Call this before making any translations, or between them.  Pass
+   NULL for both functions to go back to the fixed area. */
+extern void LibVEX_SetTempPageSource ( void* (*get_pages) ( HWord szB ),
+                                       void  (*put_pages) ( void* p,
+                                                            HWord szB ),
+                                       Int chunk_szB );
+
+/* Show Vex allocation statistics, including the most temporary
+   storage any one translation has needed, which is what the baseline
+   should be sized for. */
 extern void LibVEX_ShowAllocStats ( void );
 
 
@@ -636,6 +732,20 @@ typedef
    }
    VexGuestExtents;
 
+/* The same for a trace translation (see VexTranslateArgs.trace),
+   which has an extent for each block on its path, and so may need
+   more than 3.  Only clients which make trace translations need to
+   store these. */
+#define VEX_MAX_TRACE_EXTENTS 16
+
+typedef
+   struct {
+      Addr64 base[VEX_MAX_TRACE_EXTENTS];
+      UShort len[VEX_MAX_TRACE_EXTENTS];
+      UShort n_used;
+   }
+   VexGuestTraceExtents;
+
 
 /* A structure to carry arguments for LibVEX_Translate.  There are so
    many of them, it seems better to have a structure. */
@@ -667,17 +777,51 @@ typedef
 	 NULL. */
       Bool    (*chase_into_ok) ( /*callback_opaque*/void*, Addr64 );
 
-      /* OUT: which bits of guest code actually got translated */
-      VexGuestExtents* guest_extents;
+      /* IN: optionally, a hot path to translate as a single trace.
+         If trace_len is zero, trace is ignored and the block is
+         translated as usual.  Otherwise trace[0] must equal
+         guest_bytes_addr, and trace[1 .. trace_len-1] are the guest
+         addresses at which the path enters each following block, in
+         order, including the targets of unconditional jumps.  The
+         front end then follows exactly that path, regardless of the
+         chasing limits in VexControl, taking whichever direction of
+         a conditional branch leads to the next address and turning
+         the other into a side exit.  The result is one superblock
+         with an extent per followed branch, so iropt sees the whole
+         path at once.  The path is cut short where the next address
+         is not reached by a direct transfer, where chase_into_ok
+         refuses it, or where it is guest_bytes_addr again.
+         trace_len may be at most VEX_MAX_TRACE_EXTENTS. */
+      const Addr64* trace;
+      UInt          trace_len;
+
+      /* OUT: which bits of guest code actually got translated.  For
+         a trace translation they go in *trace_extents instead, and
+         guest_extents is not written to.  trace_extents is only used
+         for trace translations, and may be NULL otherwise. */
+      VexGuestExtents*      guest_extents;
+      VexGuestTraceExtents* trace_extents;
 
       /* IN: a place to put the resulting code, and its size */
       UChar*  host_bytes;
       Int     host_bytes_size;
       /* OUT: how much of the output area is used. */
       Int*    host_bytes_used;
+      /* OUT: optionally, where the chain-me sites of a successful
+         translation are, as offsets in host_bytes of the
+         place_to_chain that LibVEX_Chain wants.  If n_chain_sites is
+         not NULL, *n_chain_sites is set to how many there are, and
+         the first chain_sites_size of them are written to
+         chain_sites.  Only amd64 hosts can say; elsewhere
+         *n_chain_sites is set to -1. */
+      Int*    chain_sites;
+      Int     chain_sites_size;
+      Int*    n_chain_sites;
 
       /* IN: optionally, two instrumentation functions.  May be
-	 NULL. */
+	 NULL.  For a trace translation, the VexGuestExtents they are
+	 given holds just the first 3 extents; all of them are in
+	 *trace_extents by then. */
       IRSB*   (*instrument1) ( /*callback_opaque*/void*, 
                                IRSB*, 
                                VexGuestLayout*, 
@@ -696,8 +840,10 @@ typedef
       /* IN: a callback used to ask the caller which of the extents,
          if any, a self check is required for.  Must not be NULL.
          The returned value is a bitmask with a 1 in position i indicating
-         that the i'th extent needs a check.  Since there can be at most
-         3 extents, the returned values must be between 0 and 7. */
+         that the i'th extent needs a check.  Bits at or above
+         guest_extents->n_used must be zero.  For a trace translation
+         it is called for each run of 3 extents in turn (the last run
+         may be shorter), each in a VexGuestExtents of its own. */
       UInt (*needs_self_check)( /*callback_opaque*/void*,
                                 VexGuestExtents* );
 
@@ -756,10 +902,22 @@ typedef
          addresses.
 
          FIXME: update this comment
-      */
+
+         'disp_cp_xindir_miss' is optional, and may only be non-NULL
+         if chaining is enabled and the host is amd64 or arm64.  If
+         it is non-NULL, each XIndir (indirect exit) is generated as
+         an inline cache: it compares the next guest address with a
+         cached one and jumps straight to the cached host address if
+         they match.  Initially the cache is empty, and all exits
+         through the site are misses.  A miss calls (not jumps to)
+         'disp_cp_xindir_miss', which is expected to back up the
+         return address to find the site, as for the chain-me
+         entries, and populate it with LibVEX_ChainXIndir.  A miss
+         at a populated site jumps to 'disp_cp_xindir' as usual. */
       void* disp_cp_chain_me_to_slowEP;
       void* disp_cp_chain_me_to_fastEP;
       void* disp_cp_xindir;
+      void* disp_cp_xindir_miss;
       void* disp_cp_xassisted;
    }
    VexTranslateArgs;
@@ -783,6 +941,244 @@ VexTranslateResult LibVEX_Translate ( VexTranslateArgs* );
    FIXME: is this still up to date? */
 
 
+/*-------------------------------------------------------*/
+/*--- Translation contexts                            ---*/
+/*-------------------------------------------------------*/
+
+/* Where translation time goes.  The phases are those of
+   LibVEX_Translate, in order.  Cheap and expensive iropt are the two
+   grades of transformation do_iropt_BB applies; the expensive one is
+   only used for blocks containing GetI/PutI.  The instrumentation
+   phase includes the cleanup pass run after instrumentation, and the
+   tree-building phase includes the client's finaltidy. */
+typedef
+   enum {
+      VexPhaseFrontEnd=0,
+      VexPhaseFlatten,
+      VexPhaseIroptCheap,
+      VexPhaseIroptExpensive,
+      VexPhaseInstrument,
+      VexPhaseTreeBuild,
+      VexPhaseIsel,
+      VexPhaseRegAlloc,
+      VexPhasePeephole,
+      VexPhaseAssemble,
+      VexPhase_N
+   }
+   VexTranslatePhase;
+
+/* The peephole rules run over register-allocated code (see
+   VexControl.host_peephole), as counted in VexTranslateStats.  Each
+   looks at an instruction and the one emitted just before it, and
+   only fires where neither moves nor stores are visible to anything
+   but those two instructions: for stores, that means the guest state
+   and the spill slots.
+
+   SelfMove:    a reg-reg move from a register to itself is deleted.
+   MoveBack:    "mov a,b" followed by "mov b,a": the second is deleted.
+   StoreReload: a store of a register followed by a load of the same
+                size from the same place: the load is deleted if it
+                is to the same register, else made a reg-reg move.
+   LoadStore:   a load followed by a store of the same register back
+                to the same place: the store is deleted. */
+typedef
+   enum {
+      VexPeepSelfMove=0,
+      VexPeepMoveBack,
+      VexPeepStoreReload,
+      VexPeepLoadStore,
+      VexPeep_N
+   }
+   VexPeepholeRule;
+
+/* Running totals for all translations made in a context.  Cycle
+   counts are in units of the host's cheapest timestamp counter: the
+   TSC on x86 and amd64, the virtual counter on arm64, the timebase on
+   ppc64 and the TOD clock on s390x.  They are zero on other hosts.
+   calls[] counts the times each phase was run; iropt phases can run
+   more than once per translation. */
+typedef
+   struct {
+      ULong n_translations;
+      ULong cycles[VexPhase_N];
+      ULong calls[VexPhase_N];
+      ULong n_guest_instrs;
+      ULong n_guest_bytes;
+      ULong n_ir_stmts_in;   /* IR stmts made by the front end */
+      ULong n_ir_stmts_out;  /* IR stmts given to isel */
+      ULong n_ir_temps;      /* IR temps given to isel */
+      ULong n_vregs;         /* virtual registers made by isel */
+      ULong n_host_instrs;   /* after register allocation and
+                                peephole rules */
+      ULong n_spills;        /* spill instrs added by reg-alloc */
+      ULong n_reloads;       /* reload instrs added by reg-alloc */
+      ULong n_direct_reloads;/* reloads folded into an instr */
+      ULong n_host_bytes;
+      ULong n_cold_bytes;    /* of those, out of line exits */
+      ULong n_peephole[VexPeep_N]; /* times each rule fired */
+      ULong n_self_loops;    /* translations looping within
+                                themselves (iropt_loop_hoist) */
+   }
+   VexTranslateStats;
+
+/* A translation context holds everything LibVEX_Translate modifies
+   while it works: a temporary allocation area, a copy of the
+   VexControl settings and the trace flags of the translation in
+   progress.  LibVEX_Translate uses a single built-in context whose
+   settings are those given to LibVEX_Init.
+
+   If the library and the client are both built with VEX_THREADSAFE
+   defined, several threads may call LibVEX_TranslateCtx at the same
+   time, provided each uses a context of its own.  No locking is done
+   on the translation path.  The permanent allocation area, which only
+   holds immutable data created on first use, is shared by all
+   contexts.
+
+   The fields are private to LibVEX.  Use LibVEX_InitTranslateContext
+   to set a context up. */
+typedef
+   struct {
+      VexControl control;
+      Int        traceflags;
+      /* The chunk currently allocated from */
+      HChar*     temp_first;
+      HChar*     temp_curr;
+      HChar*     temp_last;
+      /* The baseline area, and chunks got from the page source since
+         the last translation finished */
+      HChar*     temp_base_first;
+      HChar*     temp_base_last;
+      void*      temp_chunks;
+      UInt       temp_n_chunks;
+      ULong      temp_bytes_prev;
+      /* Statistics */
+      ULong      temp_bytes_allocd_TOT;
+      ULong      temp_bytes_hwm;
+      UInt       temp_n_chunks_TOT;
+      UInt       temp_n_chunks_max;
+      VexTranslateStats stats;
+   }
+   VexTranslateContext;
+
+/* Set up *ctx to translate with the settings in *vcon, allocating
+   from the temporary area [temp_area, +temp_area_szB).  The area must
+   be 8-aligned and stays in use until the context is no longer
+   needed.  5000000 bytes is what LibVEX_Translate's own context
+   gets, unless a page source has been supplied, in which case the
+   area is just a baseline (see LibVEX_SetTempPageSource).
+   LibVEX_Init must have been called first. */
+extern
+void LibVEX_InitTranslateContext ( /*OUT*/VexTranslateContext* ctx,
+                                   /*READONLY*/VexControl* vcon,
+                                   HChar* temp_area, Int temp_area_szB );
+
+/* As LibVEX_Translate, but working in the given context. */
+extern
+VexTranslateResult LibVEX_TranslateCtx ( VexTranslateContext* ctx,
+                                         VexTranslateArgs* vta );
+
+/* Copy out the statistics of ctx, or of LibVEX_Translate's built-in
+   context if ctx is NULL.  This is just a copy, so it is cheap enough
+   to sample regularly; take differences between samples to see
+   recent behaviour.  Only call it from the thread using the context,
+   or whilst the context is idle. */
+extern
+void LibVEX_GetTranslateStats ( /*READONLY*/VexTranslateContext* ctx,
+                                /*OUT*/VexTranslateStats* stats );
+
+
+/*-------------------------------------------------------*/
+/*--- Batch translation                               ---*/
+/*-------------------------------------------------------*/
+
+/* Make the n translations described by vtas[0 .. n-1], putting the
+   result for vtas[i] in results[i].  The work is shared between
+   n_workers (at most 64) workers.  Worker w translates in ctxs[w],
+   so each worker needs a context of its own, and each vtas[i] needs
+   its own host_bytes, host_bytes_used and guest_extents.  Each worker
+   starts with an equal slice of the array; one which runs out steals
+   half of what is left of another's.
+
+   LibVEX creates no threads itself.  run_workers is given a function
+   and n_workers arguments for it.  It must call fn(args[w]) for every
+   w, each in a thread of its own, and return once all the calls have
+   returned.  The client's callbacks in vtas (chase_into_ok,
+   instrument1 and so on) are called on those threads.
+
+   The calls only run concurrently if both the library and the client
+   are built with VEX_THREADSAFE.  Without it, or if run_workers is
+   NULL, the translations are made one after another on the calling
+   thread, in ctxs[0]. */
+extern
+void LibVEX_TranslateBatch ( VexTranslateContext* ctxs, Int n_workers,
+                             VexTranslateArgs* vtas,
+                             /*OUT*/VexTranslateResult* results, Int n,
+                             void (*run_workers) ( void (*fn)( void* ),
+                                                   void** args,
+                                                   Int n_workers ) );
+
+
+/*-------------------------------------------------------*/
+/*--- Persistent translation cache                    ---*/
+/*-------------------------------------------------------*/
+
+/* A translation cache lets translations outlive the process which
+   made them.  It lives in a block of memory supplied by the client,
+   typically a file mapped MAP_SHARED, so that a restarted process
+   finds the translations its predecessor made; LibVEX itself does no
+   I/O.  Nothing in the area depends on where it is mapped.
+
+   A cached translation is reused when a translation is asked for at
+   the same guest address with the same settings -- archs, hwcaps,
+   ABI info, VexControl, which dispatcher addresses are given, which
+   callbacks are and the client_id given here -- and the guest bytes
+   it covers are the same as when it was made.  client_id identifies
+   the build, for instance by the build ID of the executable, and
+   should also change whenever the behaviour of the client's
+   callbacks (instrumenters, chase_into_ok and so on) does.
+
+   The key holds no addresses, so a process loaded elsewhere, say
+   because of address space randomisation, still gets hits: the
+   addresses of helpers and of the dispatcher are put into the code
+   as it is handed out.  Helpers are placed relative to LibVEX, so
+   any that the client's instrumenters call must be loaded along with
+   it, as in a static link; the client's callbacks are keyed on where
+   they are relative to LibVEX, so that a client loaded separately
+   just misses.  Only translations for amd64 hosts are cached.
+
+   The area only ever fills up.  To start again, zero it, or pass a
+   different size.  The cache is not safe for concurrent use. */
+typedef
+   struct {
+      UChar* area;
+      UInt   area_szB;
+      ULong  client_id;
+      /* Statistics, for this process only */
+      UInt   n_lookups;
+      UInt   n_hits;
+      UInt   n_stale;
+      UInt   n_inserts;
+      UInt   n_full;     /* translations which could not be cached */
+   }
+   VexTransCache;
+
+/* Set up *tc to use [area, +area_szB), which must be 8-aligned.  If
+   the area does not already hold a cache of that size, it is
+   formatted as an empty one. */
+extern
+void LibVEX_InitTransCache ( /*OUT*/VexTransCache* tc,
+                             void* area, UInt area_szB, ULong client_id );
+
+/* As LibVEX_Translate, but use a cached translation if there is one,
+   and cache the translation if not.  Translations with traceflags
+   set are never cached. */
+extern
+VexTranslateResult LibVEX_TranslateCached ( VexTransCache* tc,
+                                            VexTranslateArgs* vta );
+
+extern void LibVEX_ShowTransCacheStats ( const VexTransCache* tc );
+
+
 /*-------------------------------------------------------*/
 /*--- Patch existing translations                     ---*/
 /*-------------------------------------------------------*/
@@ -816,6 +1212,32 @@ VexInvalRange LibVEX_UnChain ( VexArch arch_host,
                                void*   place_to_jump_to_EXPECTED,
                                void*   disp_cp_chain_me );
 
+/* Populate the XIndir inline cache located at place_to_chain, so
+   that exits through it to guest_addr jump straight to
+   place_to_jump_to, and other exits go to disp_cp_xindir without
+   calling disp_cp_xindir_miss again.  It is expected (and checked)
+   that the site is currently empty, with its misses calling
+   disp_cp_xindir_miss_EXPECTED. */
+extern
+VexInvalRange LibVEX_ChainXIndir ( VexArch arch_host,
+                                   void*   place_to_chain,
+                                   void*   disp_cp_xindir_miss_EXPECTED,
+                                   Addr64  guest_addr,
+                                   void*   place_to_jump_to,
+                                   void*   disp_cp_xindir );
+
+/* Empty the XIndir inline cache located at place_to_unchain, so
+   that all exits through it go to disp_cp_xindir again, and the
+   next one calls disp_cp_xindir_miss.  It is expected (and
+   checked) that the site is currently populated with a jump to
+   place_to_jump_to_EXPECTED. */
+extern
+VexInvalRange LibVEX_UnChainXIndir ( VexArch arch_host,
+                                     void*   place_to_unchain,
+                                     void*   place_to_jump_to_EXPECTED,
+                                     void*   disp_cp_xindir,
+                                     void*   disp_cp_xindir_miss );
+
 /* Returns a constant -- the size of the event check that is put at
    the start of every translation.  This makes it possible to
    calculate the fast entry point address if the slow entry point
@@ -905,6 +1327,36 @@ extern void LibVEX_InitIRI ( const IRICB * );
    ~~~~~
    Analogous to x86.
 
+   Cached guest registers (amd64 hosts only).  Normally every
+   translation reads guest registers from the guest state with GETs
+   and writes them back with PUTs, so all of the guest state is in
+   memory whenever control is outside generated code.  For each
+   non-zero offset in VexAbiInfo.host_amd64_cached_guest_offsets,
+   the 64-bit guest register at that offset instead lives in the
+   corresponding host register (%r15, %r14, %r13, %r12) throughout
+   generated code, including across chained jumps, and its guest
+   state slot is stale.  Those host registers are not otherwise
+   allocated.  The offsets must be 8-aligned and must not overlap the
+   guest IP or any host_ field.  Generated code writes the slots back
+   before any helper that is given the guest state pointer, and
+   reloads them afterwards, and likewise around any partial or
+   indexed access overlapping a slot.
+
+   The dispatcher's side of the contract is:
+
+   - on entry to generated code from outside, load each cached host
+     register from its guest state slot;
+
+   - when generated code jumps to any disp_cp_ entry point, or to
+     the event check failure address, the cached registers hold the
+     live values.  The dispatcher may pass straight on to another
+     translation if it preserves them; otherwise it must store them
+     back into the guest state (using the saved guest state pointer,
+     since %rbp may hold a TRC) before anything else looks at it.
+
+   Signal handlers which need the guest state must likewise take the
+   cached values from the host registers.
+
    ppc32
    ~~~~~
    On entry, guest state pointer is r31.  .dispatch must be NULL.
@@ -217,6 +217,21 @@ typedef  unsigned long HWord;
 #endif
 
 
+/* VEX_TLS marks library state which each translating thread must
+   have its own copy of.  Thread-local storage needs run-time support
+   which not every client has (Valgrind's core runs without a libc, for
+   example), so it is only used when both the library and its client
+   are built with VEX_THREADSAFE defined.  See LibVEX_TranslateCtx. */
+
+#undef VEX_TLS
+
+#if defined(VEX_THREADSAFE)
+#   define VEX_TLS __thread
+#else
+#   define VEX_TLS /* */
+#endif
+
+
 #if VEX_HOST_WORDSIZE == 8
    static inline ULong Ptr_to_ULong ( void* p ) {
       return (ULong)p;
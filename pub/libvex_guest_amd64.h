@@ -164,6 +164,20 @@ typedef
          been interrupted by a signal. */
       ULong guest_IP_AT_SYSCALL;
 
+      /* Shadow return stack, used only by generated code, and only
+         if VexControl.shadow_ret_stack is set.  host_RS_TOP indexes
+         the top entry, modulo VEX_RET_STACK_SIZE (16), of the pairs
+         (host_RS_GA[i], host_RS_HA[i]): a guest return address and
+         the host address to continue at.  An entry whose guest
+         address is all ones is empty.  Don't change the order of
+         these fields; code generation depends on it. */
+      ULong host_RS_TOP;
+      ULong host_RS_HITS;
+      ULong host_RS_MISSES;
+      ULong host_RS_pad;
+      ULong host_RS_GA[16];
+      ULong host_RS_HA[16];
+
       /* Padding to make it have an 16-aligned size */
       ULong pad1;
    }
@@ -183,6 +197,13 @@ extern
 void LibVEX_GuestAMD64_initialise ( /*OUT*/VexGuestAMD64State* vex_state );
 
 
+/* Empty the shadow return stack, as is required whenever any
+   translations are discarded, if it is in use.  The
+   hit and miss counters are not changed. */
+extern
+void LibVEX_GuestAMD64_clear_ret_stack ( /*MOD*/VexGuestAMD64State* vex_state );
+
+
 /* Extract from the supplied VexGuestAMD64State structure the
    corresponding native %rflags value. */
 extern 
@@ -458,6 +458,11 @@ typedef
          zero.  You must ensure they are never given a zero argument.
       */
 
+      /* CRC32C (Castagnoli polynomial, bit-reflected), as computed by
+         the x86 SSE4.2 CRC32 insn: fold the second arg into the CRC
+         given by the first.  (I32, I8/I16/I32/I64) -> I32 */
+      Iop_CRC32C8, Iop_CRC32C16, Iop_CRC32C32, Iop_CRC32C64,
+
       /* Standard integer comparisons */
       Iop_CmpLT32S, Iop_CmpLT64S,
       Iop_CmpLE32S, Iop_CmpLE64S,
@@ -1428,6 +1433,10 @@ typedef
          coefficients of polynomials over {0, 1}. */
       Iop_PolynomialMul8x16, /* (V128, V128) -> V128 */
       Iop_PolynomialMull8x8, /*   (I64, I64) -> V128 */
+      /* The 128-bit carry-less product of the lower 64-bit lanes
+         of the args; the upper lanes are ignored.  This is x86
+         PCLMULQDQ with imm8 == 0. */
+      Iop_PolynomialMull64,  /* (V128, V128) -> V128 */
 
       /* Vector Polynomial multiplication add.   (V128, V128) -> V128
 
@@ -1676,6 +1685,14 @@ typedef
        * vshasigmad and vshasigmaw insns.*/
       Iop_SHA512, Iop_SHA256,
 
+      /* AES rounds exactly as the x86 AES-NI insns of the same names
+         do them, with the state as the first arg and the round key
+         as the second, and state byte i in bits 8i+7 .. 8i.
+         (V128, V128) -> V128 */
+      Iop_AESEnc128, Iop_AESEncLast128, Iop_AESDec128, Iop_AESDecLast128,
+      /* InvMixColumns, as x86 AESIMC.  V128 -> V128 */
+      Iop_AESIMC128,
+
       /* ------------------ 256-bit SIMD FP. ------------------ */
 
       /* ternary :: IRRoundingMode(I32) x V256 x V256 -> V256 */
@@ -22,6 +22,33 @@ ARM64:
   (cd .. && make -f Makefile-gcc libvex-arm64-linux.a) \
      && $CC -Wall -O -g -o switchback switchback.c linker.c \
      ../libvex-arm64-linux.a test_emfloat.c
+
+AMD64:
+  (cd .. && make -f Makefile-gcc libvex.a) \
+     && gcc -Wall -O -g -fno-stack-protector -o switchback \
+        switchback.c linker.c ../libvex.a test_emfloat.c
+
+When run with #bbs == -1 (no switchback), direct exits are chained
+with LibVEX_Chain and indirect exits go through a small guest->host
+lookup cache in the dispatcher, so the generated code runs much as it
+would under a real JIT.  Chained blocks do not return to the
+dispatcher, so "bbs simulated" then counts dispatcher entries only.
+With a switchback point set, every block returns to the dispatcher,
+so that the switchback happens at exactly the requested block.
+
+Also with #bbs == -1, --opt translates every block at full
+optimisation (multi-insn superblocks, chasing, unrolling), and
+--tiered first translates each block cheaply (tier 0), with a
+ProfInc counter, and retranslates it at full optimisation (tier 1)
+once the counter reaches the threshold, default 1000.  Jumps into
+the tier 0 version are unchained, so they chain to tier 1 instead
+the next time they are taken.
+
+Indirect exits are generated as inline caches, unless --no-ic is
+given.  The first time each one is taken it calls
+disp_chain_indir_miss, and is then populated with that target using
+LibVEX_ChainXIndir; from then on it jumps straight there when the
+target is the same, and goes through disp_chain_indir otherwise.
 */
 
 #include <stdio.h>
@@ -30,6 +57,8 @@ ARM64:
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "../pub/libvex_basictypes.h"
@@ -38,6 +67,7 @@ ARM64:
 #include "../pub/libvex_guest_ppc32.h"
 #include "../pub/libvex_guest_ppc64.h"
 #include "../pub/libvex_guest_arm64.h"
+#include "../pub/libvex_guest_offsets.h"
 #include "../pub/libvex.h"
 #include "../pub/libvex_trc_values.h"
 #include "linker.h"
@@ -54,6 +84,14 @@ static Int   n_translations_made = 0;
 #  define GuestPC                   guest_EIP
 #  define CacheLineSize             0/*irrelevant*/
 
+#elif defined(__x86_64__)
+#  define VexGuestState             VexGuestAMD64State
+#  define LibVEX_Guest_initialise   LibVEX_GuestAMD64_initialise
+#  define VexArch                   VexArchAMD64
+#  define VexSubArch                VexSubArch_NONE
+#  define GuestPC                   guest_RIP
+#  define CacheLineSize             0/*irrelevant*/
+
 #elif defined(__aarch64__) && !defined(__arm__)
 #  define VexGuestState             VexGuestARM64State
 #  define LibVEX_Guest_initialise   LibVEX_GuestARM64_initialise
@@ -99,15 +137,185 @@ HWord sb_helper3 = 0;
 #define N_TRANS_CACHE 1000000
 #define N_TRANS_TABLE 10000
 
-ULong trans_cache[N_TRANS_CACHE];
+/* Mapped executable at startup; .bss is not executable. */
+ULong*          trans_cache;
 VexGuestExtents trans_table [N_TRANS_TABLE];
 ULong*          trans_tableP[N_TRANS_TABLE];
 
-Int trans_cache_used = 0;
-Int trans_table_used = 0;
+/* Both trans_cache and trans_table are split into N_SECTORS equal
+   sectors.  Translations are only ever added to the current sector.
+   When it fills up, the next sector (round robin, hence oldest
+   first) is emptied and becomes the current one.  Only that
+   sector's translations have to be made again, rather than all of
+   them. */
+#define N_SECTORS     8
+#define SECTOR_TT     (N_TRANS_TABLE / N_SECTORS)
+#define SECTOR_WORDS  (N_TRANS_CACHE / N_SECTORS)
+
+typedef
+   struct {
+      Int  tt_used;     /* from trans_table[s * SECTOR_TT] */
+      Int  words_used;  /* from trans_cache[s * SECTOR_WORDS] */
+      UInt gen;         /* bumped each time the sector is emptied */
+   }
+   Sector;
+
+Sector sectors[N_SECTORS];
+Int    cur_sector = 0;
+
+/* Chained jumps into each translation, so they can be unchained
+   when the translation is evicted.  An edge is only live if the
+   sector holding its 'place' still has generation 'from_gen';
+   otherwise the jump went with the code around it. */
+typedef
+   struct {
+      HWord place;      /* the XDirect or XIndir that was chained */
+      Int   from_sector;
+      UInt  from_gen;
+      Bool  toFastEP;
+      Bool  isXIndir;
+      Int   next;       /* next edge in the list, or -1 */
+   }
+   InEdge;
+
+#define N_IN_EDGES (4 * N_TRANS_TABLE)
+
+InEdge in_edges[N_IN_EDGES];
+Int    in_edges_free = -1;           /* free list */
+Int    tt_in_edges[N_TRANS_TABLE];   /* list heads, -1 if none */
+
+/* How translations are made.  JitSingle is the original
+   one-insn-per-block scheme, as needed for exact switchback; the
+   others are only available when running to completion. */
+typedef enum { JitSingle, JitOpt, JitTiered } JitMode;
+
+static JitMode jit_mode = JitSingle;
+
+/* Per-translation tiering state.  Tier 0 translations count their
+   executions in tt_count, via their ProfInc.  A tier 0 translation
+   which has been replaced by a tier 1 one is 'superseded': it stays
+   in its sector until that is evicted, but nothing reaches it any
+   more. */
+ULong tt_count[N_TRANS_TABLE];
+UChar tt_tier[N_TRANS_TABLE];
+Bool  tt_superseded[N_TRANS_TABLE];
+
+static ULong tier_threshold = 1000;
+
+/* Tier 0 is as cheap as VEX gets: simple iropt only, no chasing or
+   unrolling, and the linear-scan allocator.  Tier 1 is the full
+   treatment. */
+static VexControl          tier_vcon[2];
+static VexTranslateContext tier_ctx[2];
+static Int                 n_tier_translations[2] = { 0, 0 };
+static double              tier_translate_ms[2]   = { 0, 0 };
+static Int                 n_promotions           = 0;
+
+/* Hash index over trans_table, keyed on the guest start address.
+   Open addressing with linear probing; -1 marks an empty slot.  It
+   is kept at most half full, so probe sequences stay short. */
+#define N_TRANS_HASH_BITS 15
+#define N_TRANS_HASH      (1 << N_TRANS_HASH_BITS)
+
+Int trans_hash[N_TRANS_HASH];
+
+/* Direct-mapped guest->host cache consulted by disp_chain_indir
+   before it gives up and returns to run_simulator.  Each entry is a
+   (guest, host) pair; an entry whose guest field is 1 is empty,
+   since no translation starts at guest address 1.  The index
+   computation must agree with the one in disp_chain_indir. */
+#define N_FAST_CACHE_BITS 12
+#define N_FAST_CACHE      (1 << N_FAST_CACHE_BITS)
+#define FAST_CACHE_MASK   (N_FAST_CACHE - 1)
+#define FAST_CACHE_EMPTY  1
+
+#if defined(__aarch64__)
+#  define FAST_CACHE_INDEX(_ga) (((_ga) >> 2) & FAST_CACHE_MASK)
+#else
+#  define FAST_CACHE_INDEX(_ga) ((_ga) & FAST_CACHE_MASK)
+#endif
 
+HWord fast_cache[N_FAST_CACHE][2] __attribute__((aligned(16)));
+
+/* Dispatcher statistics, incremented by the assembly below. */
+ULong n_xindirs       = 0;
+ULong n_xindir_misses = 0;
+
+static Int  n_chained         = 0;
+static Int  n_ics_populated   = 0;
+static Int  n_unchained       = 0;
+static Int  n_chains_dropped  = 0; /* no free InEdge */
+static Int  n_sectors_evicted = 0;
+static Int  n_tt_evicted      = 0;
+static Int  n_retranslations  = 0;
+static Bool chaining          = False;
+/* The optional kinds of translation are all used, including those
+   VexControl has off by default, so that runs exercise them; the
+   --no- options turn them off one at a time. */
+static Bool use_ics           = True;
+static Bool use_ret_stack     = True;
+static Bool use_cold_exits    = True;
+static Bool use_rep_bulk      = True;
+static Bool use_loop_hoist    = True;
+/* Guest and host hwcaps; 0 is the baseline for each arch. */
+static UInt sb_hwcaps         = 0;
+
+/* On amd64, keep these guest registers in %r15, %r14, %r13 and %r12
+   (see "Cached guest registers" in libvex.h).  run_translation_asm
+   loads and stores them, so it tests the flag itself. */
+#define SB_CACHED_OFFSET_0 OFFSET_amd64_RSP
+#define SB_CACHED_OFFSET_1 OFFSET_amd64_RBX
+#define SB_CACHED_OFFSET_2 OFFSET_amd64_RBP
+#define SB_CACHED_OFFSET_3 OFFSET_amd64_R12
+
+Bool cache_guest_regs = True;
+
+/* Guest addresses whose translation has been evicted at some point,
+   so that translating them again can be counted.  Open addressing;
+   0 marks an empty slot.  Once full, it stops growing and
+   n_retranslations becomes a lower bound. */
+#define N_EVICTED_SET_BITS 17
+#define N_EVICTED_SET      (1 << N_EVICTED_SET_BITS)
+
+Addr64 evicted_set[N_EVICTED_SET];
+Int    evicted_set_used = 0;
+
+/* TRC values produced by the dispatcher itself, as opposed to by
+   translations.  These are below 61, so they don't collide with the
+   VEX_TRC_ values (see libvex_trc_values.h). */
+#define SB_TRC_COUNTERZERO          29
+#define SB_TRC_FASTMISS             37
+#define SB_TRC_CHAIN_ME_TO_SLOW_EP  41
+#define SB_TRC_CHAIN_ME_TO_FAST_EP  43
+#define SB_TRC_XINDIR_MISS          47
+
+/* Reload value for the event counter.  The evcheck failure only
+   returns to run_simulator, which reloads the counter and carries
+   on, so the value merely bounds how long chained code can run
+   without coming back.  Tiered mode also looks for hot blocks then,
+   so it wants to come back more often. */
+#define EVC_RELOAD        1000000
+#define EVC_RELOAD_TIERED 20000
+
+static UInt evc_reload = EVC_RELOAD;
+
+#define SB_STR2(_x) #_x
+#define SB_STR(_x)  SB_STR2(_x)
+
+static Int tt_words_in_use ( void )
+{
+   Int s, n = 0;
+   for (s = 0; s < N_SECTORS; s++)
+      n += sectors[s].words_used;
+   return n;
+}
+
+static HWord serviceFn ( HWord arg1, HWord arg2 );
+
+/* Only tier 1 sets guest_chase_thresh, so this is only asked then.
+   serviceFn is never translated, so never chase into it. */
 static Bool chase_into_ok ( void* opaque, Addr64 dst ) {
-   return False;
+   return dst != Ptr_to_ULong(&serviceFn);
 }
 
 static UInt needs_self_check ( void* opaque, VexGuestExtents* vge ) {
@@ -124,7 +332,49 @@ static HWord serviceFn ( HWord arg1, HWord arg2 )
          printf("serviceFn:EXIT\n");
 	 printf("%llu bbs simulated\n", n_bbs_done);
 	 printf("%d translations made, %d tt bytes\n", 
-                n_translations_made, 8*trans_cache_used);
+                n_translations_made, 8*tt_words_in_use());
+         printf("%d sectors evicted (%d translations), "
+                "%d retranslations\n",
+                n_sectors_evicted, n_tt_evicted, n_retranslations);
+         if (chaining)
+            printf("%d jumps chained, %d unchained, %d not chained, "
+                   "%d inline caches, %llu xindirs (%llu missed)\n",
+                   n_chained, n_unchained, n_chains_dropped,
+                   n_ics_populated, n_xindirs, n_xindir_misses);
+#        if defined(__x86_64__)
+         if (chaining && use_ret_stack)
+            printf("%llu returns predicted, %llu mispredicted\n",
+                   gst.host_RS_HITS, gst.host_RS_MISSES);
+#        endif
+         {
+            VexTranslateStats st;
+            ULong peep[VexPeep_N], host_bytes = 0, cold_bytes = 0;
+            ULong self_loops = 0;
+            int   c, r;
+            for (r = 0; r < VexPeep_N; r++)
+               peep[r] = 0;
+            for (c = -1; c < 2; c++) {
+               LibVEX_GetTranslateStats(c < 0 ? NULL : &tier_ctx[c], &st);
+               for (r = 0; r < VexPeep_N; r++)
+                  peep[r] += st.n_peephole[r];
+               host_bytes += st.n_host_bytes;
+               cold_bytes += st.n_cold_bytes;
+               self_loops += st.n_self_loops;
+            }
+            printf("peephole: %llu self-moves, %llu moves back, "
+                   "%llu store-reloads, %llu load-stores\n",
+                   peep[VexPeepSelfMove], peep[VexPeepMoveBack],
+                   peep[VexPeepStoreReload], peep[VexPeepLoadStore]);
+            printf("%llu host bytes made, %llu of them cold; "
+                   "%llu translations loop within themselves\n",
+                   host_bytes, cold_bytes, self_loops);
+         }
+         if (jit_mode != JitSingle)
+            printf("tier 0: %d translations, %.1f ms; "
+                   "tier 1: %d translations, %.1f ms; %d promoted\n",
+                   n_tier_translations[0], tier_translate_ms[0],
+                   n_tier_translations[1], tier_translate_ms[1],
+                   n_promotions);
          exit(0);
       case 1: /* PUTC */
          putchar(arg2);
@@ -140,6 +390,7 @@ static HWord serviceFn ( HWord arg1, HWord arg2 )
 }
 
 
+#if defined(__aarch64__)
 // needed for arm64 ?
 static void invalidate_icache(void *ptr, unsigned long nbytes)
 {
@@ -258,6 +509,7 @@ static void invalidate_icache(void *ptr, unsigned long nbytes)
    );
 
 }
+#endif
 
 
 /* -------------------- */
@@ -291,6 +543,48 @@ void switchback ( void )
    switchback_asm(); // never returns
 }
 
+#elif defined(__x86_64__)
+
+/* Resume on the guest's stack, below its red zone.  Registers are
+   reloaded from the guest state; the SSE/AVX state is not, the same
+   as on x86. */
+extern void switchback_asm(HWord rdi_gst, HWord rsi_rflags);
+asm(
+"switchback_asm:\n"
+"   movq  48(%rdi), %rsp\n"  // switch stacks
+"   leaq  -128(%rsp), %rsp\n" // step over the red zone
+"   pushq 184(%rdi)\n"       // push continuation addr
+"   pushq %rsi\n"            // rflags:CA
+"   pushq 72(%rdi)\n"        // RDI:rflags:CA
+"   movq  16(%rdi), %rax\n"
+"   movq  24(%rdi), %rcx\n"
+"   movq  32(%rdi), %rdx\n"
+"   movq  40(%rdi), %rbx\n"
+"   movq  56(%rdi), %rbp\n"
+"   movq  64(%rdi), %rsi\n"
+"   movq  80(%rdi), %r8\n"
+"   movq  88(%rdi), %r9\n"
+"   movq  96(%rdi), %r10\n"
+"   movq 104(%rdi), %r11\n"
+"   movq 112(%rdi), %r12\n"
+"   movq 120(%rdi), %r13\n"
+"   movq 128(%rdi), %r14\n"
+"   movq 136(%rdi), %r15\n"
+"   popq  %rdi\n"
+"   popfq\n"
+"   ret   $128\n"               // and give the red zone back
+);
+void switchback ( void )
+{
+   assert(offsetof(VexGuestAMD64State, guest_RAX) == 16);
+   assert(offsetof(VexGuestAMD64State, guest_RSP) == 48);
+   assert(offsetof(VexGuestAMD64State, guest_RDI) == 72);
+   assert(offsetof(VexGuestAMD64State, guest_R15) == 136);
+   assert(offsetof(VexGuestAMD64State, guest_RIP) == 184);
+   switchback_asm((HWord)&gst, LibVEX_GuestAMD64_get_rflags(&gst));
+   assert(0); /*NOTREACHED*/
+}
+
 #elif defined(__aarch64__)
 
 extern void switchback_asm(HWord x0_gst, HWord x1_pstate);
@@ -386,7 +680,7 @@ void switchback ( void )
 {
   assert(offsetof(VexGuestARM64State, guest_X0)  == 16 + 8*0);
   assert(offsetof(VexGuestARM64State, guest_X30) == 16 + 8*30);
-  assert(offsetof(VexGuestARM64State, guest_SP)  == 16 + 8*31);
+  assert(offsetof(VexGuestARM64State, guest_XSP) == 16 + 8*31);
   assert(offsetof(VexGuestARM64State, guest_TPIDR_EL0) == 16 + 8*37);
   assert(offsetof(VexGuestARM64State, guest_Q0)  == 16 + 8*38 + 16*0);
 
@@ -451,10 +745,24 @@ void switchback ( void )
 // f    holds is the host code address
 // gp   holds the guest state pointer to use
 // res  is to hold the result.  Or some such.
-static HWord block[2]; // f, gp;
+HWord block[2]; // f, gp;
 extern HWord run_translation_asm(void);
 
+/* Dispatcher entry points handed to LibVEX_Translate.  All of them
+   leave the translated code and return a TRC to run_translation.
+   disp_chain_indir first tries fast_cache and, on a hit, jumps
+   straight to the next translation instead.  For the two chain-me
+   cases, the address of the XDirect to patch is left in
+   chain_place, and for disp_chain_indir_miss, the address of the
+   XIndir inline cache to populate. */
 extern void disp_chain_assisted(void);
+extern void disp_chain_me_to_slowEP(void);
+extern void disp_chain_me_to_fastEP(void);
+extern void disp_chain_indir(void);
+extern void disp_chain_indir_miss(void);
+extern void disp_evcheck_fail(void);
+
+HWord chain_place = 0;
 
 #if defined(__aarch64__)
 asm(
@@ -470,10 +778,67 @@ asm(
 "   add  x0, x0, :lo12:block"     "\n"
 "   ldr  x21, [x0, #8]"           "\n"  // load GSP
 "   ldr  x1,  [x0, #0]"           "\n"  // Host address
-"   br   x1"                 "\n"  // go (we wind up at disp_chain_assisted)
+"   br   x1"                 "\n"  // go (we wind up at a disp_ entry)
 
 "disp_chain_assisted:"            "\n" // x21 holds the trc.  Return it.
 "   mov  x1, x21" "\n"
+"   b    postamble"              "\n"
+
+/* 4 = movw x9, disp_cp_chain_me_to_*EP[15:0]
+   4 = movk x9, disp_cp_chain_me_to_*EP[31:16], lsl 16
+   4 = movk x9, disp_cp_chain_me_to_*EP[47:32], lsl 32
+   4 = movk x9, disp_cp_chain_me_to_*EP[63:48], lsl 48
+   4 = blr  x9
+   so the XDirect starts 20 bytes before the return address. */
+"disp_chain_me_to_slowEP:"        "\n"
+"   mov  x1, #" SB_STR(SB_TRC_CHAIN_ME_TO_SLOW_EP)  "\n"
+"   sub  x2, x30, #20"           "\n"
+"   b    postamble"              "\n"
+
+"disp_chain_me_to_fastEP:"        "\n"
+"   mov  x1, #" SB_STR(SB_TRC_CHAIN_ME_TO_FAST_EP)  "\n"
+"   sub  x2, x30, #20"           "\n"
+"   b    postamble"              "\n"
+
+/* The XIndir inline cache is 16 insns, ending with blr x9, so it
+   starts 64 bytes before the return address. */
+"disp_chain_indir_miss:"          "\n"
+"   mov  x1, #" SB_STR(SB_TRC_XINDIR_MISS) "\n"
+"   sub  x2, x30, #64"           "\n"
+"   b    postamble"              "\n"
+
+"disp_chain_indir:"               "\n"
+"   adrp x2, n_xindirs"           "\n"
+"   add  x2, x2, :lo12:n_xindirs" "\n"
+"   ldr  x3, [x2]"               "\n"
+"   add  x3, x3, #1"             "\n"
+"   str  x3, [x2]"               "\n"
+"   ldr  x0, [x21, #" SB_STR(OFFSET_arm64_PC) "]" "\n"
+"   adrp x4, fast_cache"          "\n"
+"   add  x4, x4, :lo12:fast_cache" "\n"
+"   lsr  x2, x0, #2"             "\n"
+"   and  x2, x2, #" SB_STR(FAST_CACHE_MASK) "\n"
+"   add  x1, x4, x2, lsl #4"     "\n"  // x1 = &fast_cache[entry#]
+"   ldr  x4, [x1, #0]"           "\n"  // .guest
+"   ldr  x5, [x1, #8]"           "\n"  // .host
+"   cmp  x4, x0"                 "\n"
+"   b.ne 1f"                     "\n"
+"   br   x5"                     "\n"
+"1: adrp x2, n_xindir_misses"    "\n"
+"   add  x2, x2, :lo12:n_xindir_misses" "\n"
+"   ldr  x3, [x2]"               "\n"
+"   add  x3, x3, #1"             "\n"
+"   str  x3, [x2]"               "\n"
+"   mov  x1, #" SB_STR(SB_TRC_FASTMISS) "\n"
+"   b    postamble"              "\n"
+
+"disp_evcheck_fail:"              "\n"
+"   mov  x1, #" SB_STR(SB_TRC_COUNTERZERO) "\n"
+
+"postamble:"                      "\n" // x1 = trc, x2 = chain place
+"   adrp x0, chain_place"         "\n"
+"   add  x0, x0, :lo12:chain_place" "\n"
+"   str  x2, [x0]"               "\n"
     /* Restore int regs, but not x1. */
 "   ldp  x0,  xzr, [sp], #16"    "\n"
 "   ldp  x19, x20, [sp], #16"    "\n"
@@ -486,6 +851,92 @@ asm(
 "   ret"                         "\n"
 );
 
+#elif defined(__x86_64__)
+
+/* %rbp is the guest state pointer while in translated code.  The
+   seven pushes leave %rsp 16-aligned, as VEX-generated code
+   assumes at block entry.  Cached guest registers live in
+   %r15..%r12 throughout, and are written back at the postamble. */
+asm(
+"run_translation_asm:\n"
+"   pushq %rbx\n"
+"   pushq %rbp\n"
+"   pushq %r12\n"
+"   pushq %r13\n"
+"   pushq %r14\n"
+"   pushq %r15\n"
+"   pushq %rax\n"                     // alignment only
+"   movq  block+8(%rip), %rbp\n"      // load GSP
+"   cmpb  $0, cache_guest_regs(%rip)\n"
+"   je    1f\n"
+"   movq  " SB_STR(SB_CACHED_OFFSET_0) "(%rbp), %r15\n"
+"   movq  " SB_STR(SB_CACHED_OFFSET_1) "(%rbp), %r14\n"
+"   movq  " SB_STR(SB_CACHED_OFFSET_2) "(%rbp), %r13\n"
+"   movq  " SB_STR(SB_CACHED_OFFSET_3) "(%rbp), %r12\n"
+"1: jmpq  *block(%rip)\n"             // go (we wind up at a disp_ entry)
+
+"disp_chain_assisted:\n"              // %rbp holds the trc.  Return it.
+"   movq  %rbp, %rax\n"
+"   jmp   postamble\n"
+
+/* 10 = movabsq $disp_cp_chain_me_to_*EP, %r11
+   3  = call *%r11
+   so the XDirect starts 13 bytes before the return address. */
+"disp_chain_me_to_slowEP:\n"
+"   movq  $" SB_STR(SB_TRC_CHAIN_ME_TO_SLOW_EP) ", %rax\n"
+"   popq  %rdx\n"
+"   subq  $13, %rdx\n"
+"   jmp   postamble\n"
+
+"disp_chain_me_to_fastEP:\n"
+"   movq  $" SB_STR(SB_TRC_CHAIN_ME_TO_FAST_EP) ", %rax\n"
+"   popq  %rdx\n"
+"   subq  $13, %rdx\n"
+"   jmp   postamble\n"
+
+/* The XIndir inline cache is 41 bytes, ending with call *%r11. */
+"disp_chain_indir_miss:\n"
+"   movq  $" SB_STR(SB_TRC_XINDIR_MISS) ", %rax\n"
+"   popq  %rdx\n"
+"   subq  $41, %rdx\n"
+"   jmp   postamble\n"
+
+"disp_chain_indir:\n"
+"   addq  $1, n_xindirs(%rip)\n"
+"   movq  " SB_STR(OFFSET_amd64_RIP) "(%rbp), %rax\n"
+"   movq  %rax, %rbx\n"
+"   andq  $" SB_STR(FAST_CACHE_MASK) ", %rbx\n"
+"   shlq  $4, %rbx\n"
+"   leaq  fast_cache(%rip), %rcx\n"
+"   cmpq  0(%rcx,%rbx), %rax\n"      // .guest
+"   jnz   1f\n"
+"   jmpq  *8(%rcx,%rbx)\n"           // .host
+"1: addq  $1, n_xindir_misses(%rip)\n"
+"   movq  $" SB_STR(SB_TRC_FASTMISS) ", %rax\n"
+"   jmp   postamble\n"
+
+"disp_evcheck_fail:\n"
+"   movq  $" SB_STR(SB_TRC_COUNTERZERO) ", %rax\n"
+
+"postamble:\n"                        // %rax = trc, %rdx = chain place
+"   movq  %rdx, chain_place(%rip)\n"
+"   cmpb  $0, cache_guest_regs(%rip)\n"
+"   je    2f\n"
+"   movq  block+8(%rip), %rcx\n"      // %rbp may hold a TRC
+"   movq  %r15, " SB_STR(SB_CACHED_OFFSET_0) "(%rcx)\n"
+"   movq  %r14, " SB_STR(SB_CACHED_OFFSET_1) "(%rcx)\n"
+"   movq  %r13, " SB_STR(SB_CACHED_OFFSET_2) "(%rcx)\n"
+"   movq  %r12, " SB_STR(SB_CACHED_OFFSET_3) "(%rcx)\n"
+"2: popq  %rcx\n"
+"   popq  %r15\n"
+"   popq  %r14\n"
+"   popq  %r13\n"
+"   popq  %r12\n"
+"   popq  %rbp\n"
+"   popq  %rbx\n"
+"   ret\n"
+);
+
 #elif defined(__i386__)
 
 asm(
@@ -519,63 +970,285 @@ HWord run_translation ( HWord translation )
    return trc;
 }
 
+static UInt hash_guest_addr ( Addr64 guest_addr )
+{
+   return (UInt)((guest_addr * 0x9E3779B97F4A7C15ULL)
+                 >> (64 - N_TRANS_HASH_BITS));
+}
+
+static Int find_tte ( Addr64 guest_addr )
+{
+   UInt h = hash_guest_addr(guest_addr);
+   while (1) {
+      Int i = trans_hash[h];
+      if (i == -1 || trans_table[i].base[0] == guest_addr)
+         return i;
+      h = (h + 1) & (N_TRANS_HASH - 1);
+   }
+}
+
 HWord find_translation ( Addr64 guest_addr )
 {
-   Int i;
+   Int   i;
    HWord __res;
    if (0)
       printf("find translation %p ... ", ULong_to_Ptr(guest_addr));
-   for (i = 0; i < trans_table_used; i++)
-     if (trans_table[i].base[0] == guest_addr)
-        break;
-   if (i == trans_table_used) {
+   i = find_tte(guest_addr);
+   if (i == -1) {
       if (0) printf("none\n");
       return 0; /* not found */
    }
 
-   /* Move this translation one step towards the front, so finding it
-      next time round is just that little bit cheaper. */
-   if (i > 2) {
-      VexGuestExtents tmpE = trans_table[i-1];
-      ULong*          tmpP = trans_tableP[i-1];
-      trans_table[i-1]  = trans_table[i];
-      trans_tableP[i-1] = trans_tableP[i];
-      trans_table[i] = tmpE;
-      trans_tableP[i] = tmpP;
-      i--;
-   }
-
    __res = (HWord)trans_tableP[i];
    if (0) printf("%p\n", (void*)__res);
    return __res;
 }
 
+/* Make trans_table[i] findable by its guest start address,
+   replacing any older translation of the same address. */
+static void add_to_trans_hash ( Int i )
+{
+   Addr64 guest_addr = trans_table[i].base[0];
+   UInt   h          = hash_guest_addr(guest_addr);
+   while (trans_hash[h] != -1
+          && trans_table[trans_hash[h]].base[0] != guest_addr)
+      h = (h + 1) & (N_TRANS_HASH - 1);
+   trans_hash[h] = i;
+}
+
+/* Remove trans_table[i] from the hash index, if it is the
+   translation listed there for its guest address.  Entries after
+   the hole are moved back into it where their probe sequence allows,
+   so that lookups never stop early at it. */
+static void del_from_trans_hash ( Int i )
+{
+   UInt h = hash_guest_addr(trans_table[i].base[0]);
+   UInt j, k;
+   while (trans_hash[h] != i) {
+      if (trans_hash[h] == -1)
+         return;
+      h = (h + 1) & (N_TRANS_HASH - 1);
+   }
+   trans_hash[h] = -1;
+   j = h;
+   while (1) {
+      j = (j + 1) & (N_TRANS_HASH - 1);
+      if (trans_hash[j] == -1)
+         return;
+      k = hash_guest_addr(trans_table[trans_hash[j]].base[0]);
+      /* The entry at j may stay put if k lies cyclically in (h,j]. */
+      if (h <= j ? (h < k && k <= j) : (h < k || k <= j))
+         continue;
+      trans_hash[h] = trans_hash[j];
+      trans_hash[j] = -1;
+      h = j;
+   }
+}
+
+static UInt hash_evicted ( Addr64 guest_addr )
+{
+   return (UInt)((guest_addr * 0x9E3779B97F4A7C15ULL)
+                 >> (64 - N_EVICTED_SET_BITS));
+}
+
+/* Returns True if guest_addr was already present. */
+static Bool add_to_evicted_set ( Addr64 guest_addr )
+{
+   UInt h = hash_evicted(guest_addr);
+   while (evicted_set[h] != 0) {
+      if (evicted_set[h] == guest_addr)
+         return True;
+      h = (h + 1) & (N_EVICTED_SET - 1);
+   }
+   if (evicted_set_used < N_EVICTED_SET / 2) {
+      evicted_set[h] = guest_addr;
+      evicted_set_used++;
+   }
+   return False;
+}
+
+static Bool in_evicted_set ( Addr64 guest_addr )
+{
+   UInt h = hash_evicted(guest_addr);
+   while (evicted_set[h] != 0) {
+      if (evicted_set[h] == guest_addr)
+         return True;
+      h = (h + 1) & (N_EVICTED_SET - 1);
+   }
+   return False;
+}
+
+static void flush_fast_cache ( void )
+{
+   Int i;
+   for (i = 0; i < N_FAST_CACHE; i++) {
+      fast_cache[i][0] = FAST_CACHE_EMPTY;
+      fast_cache[i][1] = 0;
+   }
+}
+
+static Int sector_of_host_addr ( HWord a )
+{
+   HWord base = (HWord)trans_cache;
+   assert(a >= base && a < base + N_TRANS_CACHE * sizeof(ULong));
+   return (a - base) / (SECTOR_WORDS * sizeof(ULong));
+}
+
+/* Remember that the XDirect or XIndir inline cache at 'place' is
+   now chained to trans_table[to], so it can be undone if that is
+   evicted. */
+static Bool add_in_edge ( Int to, HWord place, Bool toFastEP,
+                          Bool isXIndir )
+{
+   Int e = in_edges_free;
+   if (e == -1)
+      return False;
+   in_edges_free = in_edges[e].next;
+   in_edges[e].place       = place;
+   in_edges[e].from_sector = sector_of_host_addr(place);
+   in_edges[e].from_gen    = sectors[in_edges[e].from_sector].gen;
+   in_edges[e].toFastEP    = toFastEP;
+   in_edges[e].isXIndir    = isXIndir;
+   in_edges[e].next        = tt_in_edges[to];
+   tt_in_edges[to] = e;
+   return True;
+}
+
+/* Point every live jump chained to trans_table[i] back at the
+   dispatcher, and free the edges.  Jumps from within the sector
+   being evicted are left alone, as they are about to go anyway. */
+static void unchain_in_edges ( Int i, Int evicting )
+{
+   HWord host = (HWord)trans_tableP[i];
+   Int   e    = tt_in_edges[i];
+   while (e != -1) {
+      InEdge* ie   = &in_edges[e];
+      Int     next = ie->next;
+      if (ie->from_sector != evicting
+          && sectors[ie->from_sector].gen == ie->from_gen) {
+         void* disp_cp_chain_me
+            = ie->toFastEP ? (void*)disp_chain_me_to_fastEP
+                           : (void*)disp_chain_me_to_slowEP;
+         HWord expected
+            = ie->toFastEP ? host + LibVEX_evCheckSzB(VexArch) : host;
+         VexInvalRange vir
+            = ie->isXIndir
+                 ? LibVEX_UnChainXIndir(VexArch, (void*)ie->place,
+                                        (void*)expected,
+                                        (void*)disp_chain_indir,
+                                        (void*)disp_chain_indir_miss)
+                 : LibVEX_UnChain(VexArch, (void*)ie->place,
+                                  (void*)expected, disp_cp_chain_me);
+#        if defined(__aarch64__)
+         invalidate_icache((void*)vir.start, vir.len);
+#        else
+         (void)vir;
+#        endif
+         n_unchained++;
+      }
+      ie->next = in_edges_free;
+      in_edges_free = e;
+      e = next;
+   }
+   tt_in_edges[i] = -1;
+}
+
+/* Empty sector s: unchain jumps into it from other sectors, and
+   forget its translations in trans_hash and fast_cache. */
+static void evict_sector ( Int s )
+{
+   Sector* sec = &sectors[s];
+   HWord   lo  = (HWord)&trans_cache[s * SECTOR_WORDS];
+   HWord   hi  = lo + SECTOR_WORDS * sizeof(ULong);
+   Int     i;
+
+   if (sec->tt_used == 0)
+      return;
+
+   for (i = s * SECTOR_TT; i < s * SECTOR_TT + sec->tt_used; i++) {
+      unchain_in_edges(i, s);
+      del_from_trans_hash(i);
+      if (!tt_superseded[i])
+         add_to_evicted_set(trans_table[i].base[0]);
+   }
+   for (i = 0; i < N_FAST_CACHE; i++) {
+      if (fast_cache[i][1] >= lo && fast_cache[i][1] < hi) {
+         fast_cache[i][0] = FAST_CACHE_EMPTY;
+         fast_cache[i][1] = 0;
+      }
+   }
+
+   /* The shadow return stack may point at code in this sector. */
+#  if defined(__x86_64__)
+   LibVEX_GuestAMD64_clear_ret_stack(&gst);
+#  endif
+
+   n_sectors_evicted++;
+   n_tt_evicted += sec->tt_used;
+   sec->tt_used    = 0;
+   sec->words_used = 0;
+   sec->gen++;
+}
+
+static void init_trans_cache ( void )
+{
+   Int i;
+   for (i = 0; i < N_SECTORS; i++) {
+      sectors[i].tt_used    = 0;
+      sectors[i].words_used = 0;
+      sectors[i].gen        = 0;
+   }
+   cur_sector = 0;
+   for (i = 0; i < N_TRANS_HASH; i++)
+      trans_hash[i] = -1;
+   for (i = 0; i < N_TRANS_TABLE; i++)
+      tt_in_edges[i] = -1;
+   for (i = 0; i < N_IN_EDGES; i++)
+      in_edges[i].next = i+1 < N_IN_EDGES ? i+1 : -1;
+   in_edges_free = 0;
+   flush_fast_cache();
+}
+
 #define N_TRANSBUF 5000
 static UChar transbuf[N_TRANSBUF];
-void make_translation ( Addr64 guest_addr, Bool verbose )
+static double now_ms ( void )
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* Translate guest_addr into the current sector and return its
+   trans_table index.  tier is ignored in JitSingle mode. */
+Int make_translation ( Addr64 guest_addr, Int tier, Bool verbose )
 {
    VexTranslateArgs   vta;
    VexTranslateResult tres;
    VexArchInfo vex_archinfo;
-   Int trans_used, i, ws_needed;
+   Int trans_used, i, ws_needed, tte;
+   Sector* sec;
 
    memset(&vta, 0, sizeof(vta));
    memset(&tres, 0, sizeof(tres));
    memset(&vex_archinfo, 0, sizeof(vex_archinfo));
 
-   if (trans_table_used >= N_TRANS_TABLE
-       || trans_cache_used >= N_TRANS_CACHE-1000) {
-      /* If things are looking to full, just dump
-         all the translations. */
-      trans_cache_used = 0;
-      trans_table_used = 0;
+   sec = &sectors[cur_sector];
+   if (sec->tt_used >= SECTOR_TT
+       || sec->words_used + (N_TRANSBUF+7) / 8 > SECTOR_WORDS) {
+      /* If the current sector is looking too full, move on to the
+         next one, evicting whatever is there. */
+      cur_sector = (cur_sector + 1) % N_SECTORS;
+      evict_sector(cur_sector);
+      sec = &sectors[cur_sector];
    }
 
-   assert(trans_table_used < N_TRANS_TABLE);
+   tte = cur_sector * SECTOR_TT + sec->tt_used;
+   assert(sec->tt_used < SECTOR_TT);
    if (0)
       printf("make translation %p\n", ULong_to_Ptr(guest_addr));
 
    LibVEX_default_VexArchInfo(&vex_archinfo);
+   vex_archinfo.hwcaps = sb_hwcaps;
    //vex_archinfo.subarch = VexSubArch;
    //vex_archinfo.ppc_icache_line_szB = CacheLineSize;
 
@@ -587,46 +1260,97 @@ void make_translation ( Addr64 guest_addr, Bool verbose )
    vta.guest_bytes      = (UChar*)ULong_to_Ptr(guest_addr);
    vta.guest_bytes_addr = (Addr64)guest_addr;
    vta.chase_into_ok    = chase_into_ok;
+   vta.trace            = NULL;
+   vta.trace_len        = 0;
+   vta.trace_extents    = NULL;
 //   vta.guest_extents    = &vge;
-   vta.guest_extents    = &trans_table[trans_table_used];
+   vta.guest_extents    = &trans_table[tte];
    vta.host_bytes       = transbuf;
    vta.host_bytes_size  = N_TRANSBUF;
    vta.host_bytes_used  = &trans_used;
+   vta.n_chain_sites    = NULL;
    vta.instrument1      = NULL;
    vta.instrument2      = NULL;
    vta.needs_self_check = needs_self_check;
    vta.traceflags       = verbose ? TEST_FLAGS : DEBUG_TRACE_FLAGS;
+   LibVEX_default_VexAbiInfo(&vta.abiinfo_both);
+#  if defined(__x86_64__)
+   vta.abiinfo_both.guest_stack_redzone_size = 128;
+   if (cache_guest_regs) {
+      vta.abiinfo_both.host_amd64_cached_guest_offsets[0] = SB_CACHED_OFFSET_0;
+      vta.abiinfo_both.host_amd64_cached_guest_offsets[1] = SB_CACHED_OFFSET_1;
+      vta.abiinfo_both.host_amd64_cached_guest_offsets[2] = SB_CACHED_OFFSET_2;
+      vta.abiinfo_both.host_amd64_cached_guest_offsets[3] = SB_CACHED_OFFSET_3;
+   }
+#  endif
 
-   vta.disp_cp_chain_me_to_slowEP = NULL; //disp_chain_fast;
-   vta.disp_cp_chain_me_to_fastEP = NULL; //disp_chain_slow;
-   vta.disp_cp_xindir             = NULL; //disp_chain_indir;
+   if (chaining) {
+      vta.disp_cp_chain_me_to_slowEP = disp_chain_me_to_slowEP;
+      vta.disp_cp_chain_me_to_fastEP = disp_chain_me_to_fastEP;
+      vta.disp_cp_xindir             = disp_chain_indir;
+      vta.disp_cp_xindir_miss        = use_ics ? disp_chain_indir_miss
+                                               : NULL;
+   } else {
+      vta.disp_cp_chain_me_to_slowEP = NULL;
+      vta.disp_cp_chain_me_to_fastEP = NULL;
+      vta.disp_cp_xindir             = NULL;
+      vta.disp_cp_xindir_miss        = NULL;
+   }
    vta.disp_cp_xassisted          = disp_chain_assisted;
 
-   vta.addProfInc       = False;
-
-   tres = LibVEX_Translate ( &vta );
+   if (jit_mode == JitSingle) {
+      vta.addProfInc = False;
+      tres = LibVEX_Translate ( &vta );
+   } else {
+      double t0 = now_ms();
+      if (jit_mode == JitOpt)
+         tier = 1;
+      vta.addProfInc = jit_mode == JitTiered && tier == 0;
+      tres = LibVEX_TranslateCtx ( &tier_ctx[tier], &vta );
+      tier_translate_ms[tier] += now_ms() - t0;
+      n_tier_translations[tier]++;
+   }
 
    assert(tres.status == VexTransOK);
-   assert(tres.offs_profInc == -1);
+   assert(vta.addProfInc == (tres.offs_profInc != -1));
 
    ws_needed = (trans_used+7) / 8;
    assert(ws_needed > 0);
-   assert(trans_cache_used + ws_needed < N_TRANS_CACHE);
+   assert(sec->words_used + ws_needed <= SECTOR_WORDS);
    n_translations_made++;
+   if (in_evicted_set(guest_addr))
+      n_retranslations++;
 
+   ULong* where = &trans_cache[cur_sector * SECTOR_WORDS + sec->words_used];
    for (i = 0; i < trans_used; i++) {
-      HChar* dst = ((HChar*)(&trans_cache[trans_cache_used])) + i;
+      HChar* dst = ((HChar*)where) + i;
       HChar* src = (HChar*)(&transbuf[i]);
       *dst = *src;
    }
 
 #if defined(__aarch64__)
-   invalidate_icache( &trans_cache[trans_cache_used], trans_used );
+   invalidate_icache( where, trans_used );
 #endif
 
-   trans_tableP[trans_table_used] = &trans_cache[trans_cache_used];
-   trans_table_used++;
-   trans_cache_used += ws_needed;
+   trans_tableP[tte]   = where;
+   tt_in_edges[tte]    = -1;
+   tt_count[tte]       = 0;
+   tt_tier[tte]        = jit_mode == JitSingle ? 0 : tier;
+   tt_superseded[tte]  = False;
+   if (vta.addProfInc) {
+      VexInvalRange vir
+         = LibVEX_PatchProfInc(VexArch, (UChar*)where + tres.offs_profInc,
+                               &tt_count[tte]);
+#     if defined(__aarch64__)
+      invalidate_icache((void*)vir.start, vir.len);
+#     else
+      (void)vir;
+#     endif
+   }
+   add_to_trans_hash(tte);
+   sec->tt_used++;
+   sec->words_used += ws_needed;
+   return tte;
 }
 
 
@@ -666,6 +1390,137 @@ void log_bytes ( HChar* bytes, Int nbytes )
 }
 
 
+/* A translation stopped at an XDirect at chain_place, which was
+   still calling disp_chain_me_to_{slow,fast}EP, with the guest PC
+   set to the jump target.  Translate the target if need be and
+   patch the jump to go straight there from now on. */
+static void chain_to_next ( Bool toFastEP )
+{
+   Addr64 next_guest = gst.GuestPC;
+   HWord  next_host;
+   Int    next_tte;
+   Int    from_sector = sector_of_host_addr(chain_place);
+   UInt   from_gen    = sectors[from_sector].gen;
+   void*  disp_cp_chain_me
+      = toFastEP ? (void*)disp_chain_me_to_fastEP
+                 : (void*)disp_chain_me_to_slowEP;
+   VexInvalRange vir;
+
+   if (next_guest == Ptr_to_ULong(&serviceFn))
+      return;
+
+   next_tte = find_tte(next_guest);
+   if (next_tte == -1) {
+      make_translation(next_guest,0,False);
+      /* If that evicted the sector holding chain_place, the jump
+         has gone with it. */
+      if (sectors[from_sector].gen != from_gen)
+         return;
+      next_tte = find_tte(next_guest);
+      assert(next_tte != -1);
+   }
+   if (!add_in_edge(next_tte, chain_place, toFastEP, False)) {
+      n_chains_dropped++;
+      return;
+   }
+   next_host = (HWord)trans_tableP[next_tte];
+   if (toFastEP)
+      next_host += LibVEX_evCheckSzB(VexArch);
+
+   vir = LibVEX_Chain(VexArch, (void*)chain_place,
+                      disp_cp_chain_me, (void*)next_host);
+#  if defined(__aarch64__)
+   invalidate_icache((void*)vir.start, vir.len);
+#  else
+   (void)vir;
+#  endif
+   n_chained++;
+}
+
+
+/* A translation stopped at an empty XIndir inline cache at
+   chain_place, with the guest PC set to the jump target.  Translate
+   the target if need be and populate the cache with it.  Inline
+   caches jump to the slow entry point, so that the event check is
+   still done, as it is when going through disp_chain_indir. */
+static void populate_xindir ( void )
+{
+   Addr64 next_guest  = gst.GuestPC;
+   Int    next_tte;
+   Int    from_sector = sector_of_host_addr(chain_place);
+   UInt   from_gen    = sectors[from_sector].gen;
+   VexInvalRange vir;
+
+   if (next_guest == Ptr_to_ULong(&serviceFn))
+      return;
+
+   next_tte = find_tte(next_guest);
+   if (next_tte == -1) {
+      make_translation(next_guest,0,False);
+      if (sectors[from_sector].gen != from_gen)
+         return;
+      next_tte = find_tte(next_guest);
+      assert(next_tte != -1);
+   }
+   if (!add_in_edge(next_tte, chain_place, False, True)) {
+      n_chains_dropped++;
+      return;
+   }
+   vir = LibVEX_ChainXIndir(VexArch, (void*)chain_place,
+                            (void*)disp_chain_indir_miss, next_guest,
+                            (void*)trans_tableP[next_tte],
+                            (void*)disp_chain_indir);
+#  if defined(__aarch64__)
+   invalidate_icache((void*)vir.start, vir.len);
+#  else
+   (void)vir;
+#  endif
+   n_ics_populated++;
+}
+
+
+/* Replace tier 0 translation 'old' with a tier 1 one, and return
+   the index of that.  Jumps chained to 'old' are unchained; they
+   will be chained to the new translation the next time they are
+   taken. */
+static Int promote ( Int old )
+{
+   Addr64 guest_addr = trans_table[old].base[0];
+   Int    old_sector = old / SECTOR_TT;
+   UInt   old_gen    = sectors[old_sector].gen;
+   Int    tte        = make_translation(guest_addr, 1, False);
+   HWord* fce        = fast_cache[FAST_CACHE_INDEX(guest_addr)];
+
+   /* If making it evicted 'old', that unchained it already. */
+   if (sectors[old_sector].gen == old_gen) {
+      unchain_in_edges(old, -1);
+      tt_superseded[old] = True;
+   }
+   if (fce[0] == (HWord)guest_addr)
+      fce[1] = (HWord)trans_tableP[tte];
+   n_promotions++;
+   return tte;
+}
+
+/* Look for hot tier 0 translations that only ever run chained, and
+   so aren't seen by the check in run_simulator.  Called whenever
+   the event counter runs out. */
+static void promote_hot ( void )
+{
+   Int s, k;
+   for (s = 0; s < N_SECTORS; s++) {
+      /* tt_used is reread each time round, since promoting can
+         evict sectors, including this one. */
+      for (k = 0; k < sectors[s].tt_used; k++) {
+         Int i = s * SECTOR_TT + k;
+         if (tt_tier[i] == 0 && !tt_superseded[i]
+             && tt_count[i] >= tier_threshold)
+            promote(i);
+      }
+   }
+}
+
+
 /* run simulated code forever (it will exit by calling
    serviceFn(0)). */
 static void run_simulator ( void )
@@ -673,6 +1528,7 @@ static void run_simulator ( void )
    static Addr64 last_guest = 0;
    Addr64 next_guest;
    HWord next_host;
+   Int next_tte;
    while (1) {
       next_guest = gst.GuestPC;
 
@@ -690,6 +1546,14 @@ static void run_simulator ( void )
             gst.guest_ESP = esp+4;
             next_guest = gst.guest_EIP;
          }
+#        elif defined(__x86_64__)
+         {
+            HWord rsp = gst.guest_RSP;
+            gst.guest_RIP = *(ULong*)(rsp+0);
+            gst.guest_RAX = serviceFn( gst.guest_RDI, gst.guest_RSI );
+            gst.guest_RSP = rsp+8;
+            next_guest = gst.guest_RIP;
+         }
 #        elif defined(__aarch64__)
          {
             gst.guest_X0 = serviceFn( gst.guest_X0, gst.guest_X1 );
@@ -701,11 +1565,19 @@ static void run_simulator ( void )
 #        endif
       }
 
-      next_host = find_translation(next_guest);
-      if (next_host == 0) {
-         make_translation(next_guest,False);
-         next_host = find_translation(next_guest);
-         assert(next_host != 0);
+      next_tte = find_tte(next_guest);
+      if (next_tte == -1)
+         next_tte = make_translation(next_guest,0,False);
+      if (jit_mode == JitTiered && tt_tier[next_tte] == 0
+          && tt_count[next_tte] >= tier_threshold)
+         next_tte = promote(next_tte);
+      next_host = (HWord)trans_tableP[next_tte];
+      if (chaining) {
+         /* Let disp_chain_indir find it next time round.  serviceFn
+            is never entered here, since it is never translated. */
+         HWord* fce = fast_cache[FAST_CACHE_INDEX(next_guest)];
+         fce[0] = (HWord)next_guest;
+         fce[1] = next_host;
       }
 
       // Switchback
@@ -714,13 +1586,13 @@ static void run_simulator ( void )
 #if 1
          if (last_guest) {
             printf("\n*** Last run translation (bb:%llu):\n", n_bbs_done-1);
-            make_translation(last_guest,True);
+            make_translation(last_guest,0,True);
          }
 #endif
 #if 0
          if (next_guest) {
             printf("\n*** Current translation (bb:%llu):\n", n_bbs_done);
-            make_translation(next_guest,True);
+            make_translation(next_guest,0,True);
          }
 #endif
          printf("---  end SWITCHBACK at bb:%llu ---\n", n_bbs_done);
@@ -731,29 +1603,86 @@ static void run_simulator ( void )
       last_guest = next_guest;
       HWord trc = run_translation(next_host);
       if (0) printf("------- trc = %lu\n", trc);
-      if (trc != VEX_TRC_JMP_BORING) {
-        if (1) printf("------- trc = %lu\n", trc);
+      switch (trc) {
+         case VEX_TRC_JMP_BORING:
+         case SB_TRC_FASTMISS:
+            break;
+         case SB_TRC_COUNTERZERO:
+            gst.host_EvC_COUNTER = evc_reload;
+            if (jit_mode == JitTiered)
+               promote_hot();
+            break;
+         case SB_TRC_CHAIN_ME_TO_SLOW_EP:
+         case SB_TRC_CHAIN_ME_TO_FAST_EP:
+            chain_to_next(trc == SB_TRC_CHAIN_ME_TO_FAST_EP);
+            break;
+         case SB_TRC_XINDIR_MISS:
+            populate_xindir();
+            break;
+         default:
+            printf("------- trc = %lu\n", trc);
+            assert(0);
       }
-      assert(trc == VEX_TRC_JMP_BORING);
    }
 }
 
 
 static void usage ( void )
 {
-   printf("usage: switchback #bbs\n");
+   printf("usage: switchback [--opt | --tiered[=N]] [--no-ic] #bbs\n");
    printf("   - begins switchback for basic block #bbs\n");
-   printf("   - use -1 for largest possible run without switchback\n\n");
+   printf("   - use -1 for largest possible run without switchback\n");
+   printf("   --opt: make full-size, fully optimised translations\n");
+   printf("   --tiered: make cheap translations first, and reoptimise\n");
+   printf("     those run N times (default 1000)\n");
+   printf("   --no-ic: don't use inline caches for indirect exits\n");
+   printf("   --no-rs: don't predict returns with a shadow return stack\n");
+   printf("   --no-grc: don't keep guest registers in host registers\n");
+   printf("   --no-cold: don't move conditional exits out of line\n");
+   printf("   --no-rep-bulk: do REP string ops an iteration at a time\n");
+   printf("   --no-hoist: don't loop inside self-looping translations\n");
+   printf("   --hwcaps=N: give guest and host the VEX_HWCAPS_ bits N\n");
+   printf("   --opt and --tiered need #bbs == -1\n\n");
    exit(1);
 }
 
 
 int main ( Int argc, HChar** argv )
 {
-   if (argc != 2)
+   Int i;
+   for (i = 1; i < argc - 1; i++) {
+      if (0 == strcmp(argv[i], "--opt"))
+         jit_mode = JitOpt;
+      else if (0 == strcmp(argv[i], "--tiered"))
+         jit_mode = JitTiered;
+      else if (0 == strcmp(argv[i], "--no-ic"))
+         use_ics = False;
+      else if (0 == strcmp(argv[i], "--no-rs"))
+         use_ret_stack = False;
+      else if (0 == strcmp(argv[i], "--no-grc"))
+         cache_guest_regs = False;
+      else if (0 == strcmp(argv[i], "--no-cold"))
+         use_cold_exits = False;
+      else if (0 == strcmp(argv[i], "--no-rep-bulk"))
+         use_rep_bulk = False;
+      else if (0 == strcmp(argv[i], "--no-hoist"))
+         use_loop_hoist = False;
+      else if (0 == strncmp(argv[i], "--hwcaps=", 9))
+         sb_hwcaps = (UInt)strtoul(argv[i] + 9, NULL, 0);
+      else if (0 == strncmp(argv[i], "--tiered=", 9)) {
+         jit_mode = JitTiered;
+         tier_threshold = (ULong)atoll(argv[i] + 9);
+      }
+      else
+         usage();
+   }
+   if (argc - i != 1)
       usage();
 
-   stopAfter = (ULong)atoll(argv[1]);
+   stopAfter = (ULong)atoll(argv[i]);
+   chaining  = stopAfter == (ULong)-1;
+   if (jit_mode != JitSingle && !chaining)
+      usage();
 
    extern void entry ( void*(*service)(int,int) );
    entryP = (UChar*)&entry;
@@ -767,11 +1696,47 @@ int main ( Int argc, HChar** argv )
    vcon.guest_max_insns=50 - 49;
    vcon.guest_chase_thresh=0;
    vcon.iropt_level=2;
+   /* Only amd64 hosts support it; it is ignored elsewhere. */
+   vcon.shadow_ret_stack = chaining && use_ret_stack;
+   vcon.host_cold_exits  = use_cold_exits;
+   vcon.guest_rep_bulk   = use_rep_bulk;
+   vcon.iropt_loop_hoist = use_loop_hoist;
 
    LibVEX_Init( failure_exit, log_bytes, 1, False, &vcon );
+
+   LibVEX_default_VexControl(&tier_vcon[0]);
+   tier_vcon[0].iropt_level         = 1;
+   tier_vcon[0].iropt_unroll_thresh = 0;
+   tier_vcon[0].guest_chase_thresh  = 0;
+   tier_vcon[0].shadow_ret_stack    = vcon.shadow_ret_stack;
+   tier_vcon[0].host_cold_exits     = vcon.host_cold_exits;
+   tier_vcon[0].guest_rep_bulk      = vcon.guest_rep_bulk;
+   tier_vcon[0].iropt_loop_hoist    = vcon.iropt_loop_hoist;
+   LibVEX_default_VexControl(&tier_vcon[1]);
+   tier_vcon[1].shadow_ret_stack    = vcon.shadow_ret_stack;
+   tier_vcon[1].host_cold_exits     = vcon.host_cold_exits;
+   tier_vcon[1].guest_rep_bulk      = vcon.guest_rep_bulk;
+   tier_vcon[1].iropt_loop_hoist    = vcon.iropt_loop_hoist;
+   for (i = 0; i < 2; i++) {
+      HChar* area = malloc(5000000);
+      assert(area);
+      LibVEX_InitTranslateContext(&tier_ctx[i], &tier_vcon[i],
+                                  area, 5000000);
+   }
+   if (jit_mode == JitTiered)
+      evc_reload = EVC_RELOAD_TIERED;
+   trans_cache = mmap(NULL, N_TRANS_CACHE * sizeof(ULong),
+                      PROT_READ | PROT_WRITE | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (trans_cache == MAP_FAILED) {
+      printf("switchback: can't map translation cache\n");
+      exit(1);
+   }
+
    LibVEX_Guest_initialise(&gst);
-   gst.host_EvC_COUNTER  = 999999999; // so we should never get an exit
-   gst.host_EvC_FAILADDR = 0x5a5a5a5a5a5a5a5a;
+   gst.host_EvC_COUNTER  = evc_reload;
+   gst.host_EvC_FAILADDR = (HWord)&disp_evcheck_fail;
+   init_trans_cache();
 
    /* set up as if a call to the entry point passing serviceFn as 
       the one and only parameter */
@@ -781,9 +1746,18 @@ int main ( Int argc, HChar** argv )
    *(UInt*)(gst.guest_ESP+4) = (UInt)serviceFn;
    *(UInt*)(gst.guest_ESP+0) = 0x12345678;
 
+#  elif defined(__x86_64__)
+   gst.guest_RIP = (ULong)entryP;
+   gst.guest_RSP = (ULong)&gstack[31999];
+   gst.guest_RDI = (ULong)serviceFn;
+   *(ULong*)(gst.guest_RSP+0) = 0x12345678;
+   HWord fs_base = 0;
+   __asm__ __volatile__("movq %%fs:0, %0" : "=r"(fs_base));
+   gst.guest_FS_ZERO = fs_base;
+
 #  elif defined(__aarch64__)
    gst.guest_PC = (ULong)entryP;
-   gst.guest_SP = (ULong)&gstack[32000];
+   gst.guest_XSP = (ULong)&gstack[32000];
    gst.guest_X0 = (ULong)serviceFn;
    HWord tpidr_el0 = 0;
    __asm__ __volatile__("mrs %0, tpidr_el0" : "=r"(tpidr_el0));
@@ -0,0 +1,116 @@
+/* Check the amd64 CRC32 helpers, which use the slicing-by-8 kernel
+   x86amd64g_calc_crc32c, against the bit-serial loop they replaced,
+   on random inputs.  With --bench, time both instead.
+
+   Built and run by the check and crc32c-bench targets in
+   Makefile-gcc. */
+
+#include "libvex_basictypes.h"
+#include "libvex_guest_amd64.h"
+#include "main_util.h"
+#include "guest_amd64_defs.h"
+
+/* After the VEX headers, which define NULL themselves. */
+#include <stdio.h>
+#include <string.h>
+
+#define N_CASES   4000000
+#define N_BENCH  20000000
+
+/* The helpers as they were: one bit per iteration. */
+static ULong crc32_bitwise ( ULong crcIn, ULong data, UInt szB )
+{
+   UInt  i;
+   ULong mask = szB == 8 ? ~0ULL : (1ULL << (8 * szB)) - 1;
+   ULong crc;
+   if (szB == 8)
+      return crc32_bitwise(crc32_bitwise(crcIn, data, 4), data >> 32, 4);
+   crc = (data & mask) ^ crcIn;
+   for (i = 0; i < 8 * szB; i++)
+      crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78ULL : 0);
+   return crc;
+}
+
+static ULong crc32_tables ( ULong crcIn, ULong data, UInt szB )
+{
+   switch (szB) {
+      case 1:  return amd64g_calc_crc32b(crcIn, data);
+      case 2:  return amd64g_calc_crc32w(crcIn, data);
+      case 4:  return amd64g_calc_crc32l(crcIn, data);
+      default: return amd64g_calc_crc32q(crcIn, data);
+   }
+}
+
+/* Keeps the timed loops from being optimised away. */
+static volatile ULong crc32_sink;
+
+static ULong rng_state = 0x9e3779b97f4a7c15ULL;
+
+static ULong rng ( void )
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 7;
+   rng_state ^= rng_state << 17;
+   return rng_state;
+}
+
+static int check ( void )
+{
+   UInt  szB, i;
+   int   n_bad = 0;
+   for (i = 0; i < N_CASES; i++) {
+      /* The helpers are handed a 64-bit crc, of which the insn only
+         uses the low 32 bits; the upper ones must be ignored. */
+      ULong crc  = rng();
+      ULong data = rng();
+      ULong want, got;
+      szB  = 1 << (i & 3);
+      want = crc32_bitwise(crc & 0xFFFFFFFFULL, data, szB);
+      got  = crc32_tables(crc, data, szB);
+      if (got != want) {
+         if (n_bad++ < 10)
+            printf("crc32c: szB %u crc 0x%llx data 0x%llx: "
+                   "got 0x%llx, want 0x%llx\n",
+                   szB, crc, data, got, want);
+      }
+   }
+   printf("crc32c: %d random cases, %d mismatches\n", N_CASES, n_bad);
+   return n_bad != 0;
+}
+
+static void bench ( void )
+{
+   UInt  szB, i;
+   ULong crc, t;
+   for (szB = 1; szB <= 8; szB *= 2) {
+      crc = 0;
+      t = vexReadCycles();
+      for (i = 0; i < N_BENCH / 8; i++)
+         crc = crc32_bitwise(crc, i, szB);
+      t = vexReadCycles() - t;
+      printf("crc32c %u bytes: bit-serial %.2f cycles/byte",
+             szB, (double)t / ((double)(N_BENCH / 8) * szB));
+      crc32_sink += crc;
+      crc = 0;
+      t = vexReadCycles();
+      for (i = 0; i < N_BENCH; i++)
+         crc = crc32_tables(crc, i, szB);
+      t = vexReadCycles() - t;
+      printf(", slicing-by-8 %.2f cycles/byte\n",
+             (double)t / ((double)N_BENCH * szB));
+      crc32_sink += crc;
+   }
+}
+
+int main ( int argc, char** argv )
+{
+   if (argc == 2 && 0 == strcmp(argv[1], "--bench")) {
+      bench();
+      return 0;
+   }
+   if (argc != 1) {
+      fprintf(stderr, "usage: crc32c [--bench]\n");
+      return 2;
+   }
+   return check();
+}
@@ -0,0 +1,219 @@
+/* Check h_generic_calc_MAddF32/F64 on directed edge cases, in all
+   four rounding modes: subnormal results, underflow to +-0, sums near
+   DBL_MAX and FLT_MAX, and large exponent gaps between x * y and z.
+   The expected results are those of a correctly rounded fma.
+
+   Built and run by the check target in Makefile-gcc. */
+
+#include "libvex_basictypes.h"
+#include "host_generic_maddf.h"
+
+/* After the VEX headers, which define NULL themselves. */
+#include <fenv.h>
+#include <stdio.h>
+#include <string.h>
+
+static const int modes[4]
+   = { FE_TONEAREST, FE_TOWARDZERO, FE_UPWARD, FE_DOWNWARD };
+static const char* const mode_names[4] = { "RN", "RZ", "RU", "RD" };
+
+/* x, y, z, then x * y + z rounded in each of modes[]. */
+static const struct { ULong x, y, z, want[4]; } vecs64[] = {
+   /* subnormal: 2.5 ulps, a tie */
+   { 0x1e68000000000000ULL, 0x1e60000000000000ULL, 0x0000000000000001ULL,
+     { 0x0000000000000002ULL, 0x0000000000000002ULL,
+       0x0000000000000003ULL, 0x0000000000000002ULL } },
+   /* subnormal: a tie just under DBL_MIN / 2 */
+   { 0x017fffffffffffffULL, 0x3e80000000000000ULL, 0x8008000000000000ULL,
+     { 0x0008000000000000ULL, 0x0007ffffffffffffULL,
+       0x0008000000000000ULL, 0x0007ffffffffffffULL } },
+   /* subnormal, exact */
+   { 0x4008000000000000ULL, 0x0000000000000001ULL, 0x8000000000000002ULL,
+     { 0x0000000000000001ULL, 0x0000000000000001ULL,
+       0x0000000000000001ULL, 0x0000000000000001ULL } },
+   /* subnormal, sticky bits */
+   { 0x2000000000000001ULL, 0x1ff0000000000001ULL, 0x8008000000000000ULL,
+     { 0x0000000000000001ULL, 0x0000000000000001ULL,
+       0x0000000000000002ULL, 0x0000000000000001ULL } },
+   /* subnormal product, z zero */
+   { 0x1e6fffffffffffffULL, 0x1e6fffffffffffffULL, 0x0000000000000000ULL,
+     { 0x0000000000000004ULL, 0x0000000000000003ULL,
+       0x0000000000000004ULL, 0x0000000000000003ULL } },
+   /* subnormal, DBL_MIN * 0.75 */
+   { 0x0010000000000000ULL, 0x3fe8000000000000ULL, 0x0000000000000001ULL,
+     { 0x000c000000000001ULL, 0x000c000000000001ULL,
+       0x000c000000000001ULL, 0x000c000000000001ULL } },
+   /* subnormal, mixed */
+   { 0x1f7123456789abcdULL, 0x1edfedcba9876543ULL, 0x0000000001000000ULL,
+     { 0x00000000032330b1ULL, 0x00000000032330b1ULL,
+       0x00000000032330b2ULL, 0x00000000032330b1ULL } },
+   /* underflow: just under -DBL_TRUE_MIN */
+   { 0x0170000000000000ULL, 0x39b0000000000000ULL, 0x8000000000000001ULL,
+     { 0x8000000000000001ULL, 0x8000000000000000ULL,
+       0x8000000000000000ULL, 0x8000000000000001ULL } },
+   /* underflow: negative product, z zero */
+   { 0x1a70000000000000ULL, 0x9a70000000000000ULL, 0x0000000000000000ULL,
+     { 0x8000000000000000ULL, 0x8000000000000000ULL,
+       0x8000000000000000ULL, 0x8000000000000001ULL } },
+   /* underflow: half DBL_TRUE_MIN, a tie */
+   { 0x0000000000000001ULL, 0x3fe0000000000000ULL, 0x0000000000000000ULL,
+     { 0x0000000000000000ULL, 0x0000000000000000ULL,
+       0x0000000000000001ULL, 0x0000000000000000ULL } },
+   /* underflow: -DBL_TRUE_MIN / 4 */
+   { 0x0000000000000001ULL, 0x3fe8000000000000ULL, 0x8000000000000001ULL,
+     { 0x8000000000000000ULL, 0x8000000000000000ULL,
+       0x8000000000000000ULL, 0x8000000000000001ULL } },
+   /* underflow: tiny product */
+   { 0x1e30000000000000ULL, 0x1e30000000000000ULL, 0x8000000000000001ULL,
+     { 0x8000000000000001ULL, 0x8000000000000000ULL,
+       0x8000000000000000ULL, 0x8000000000000001ULL } },
+   /* exact cancellation */
+   { 0x3ff8000000000000ULL, 0x3fe0000000000000ULL, 0xbfe8000000000000ULL,
+     { 0x0000000000000000ULL, 0x0000000000000000ULL,
+       0x0000000000000000ULL, 0x8000000000000000ULL } },
+   /* DBL_MAX + half ulp, a tie */
+   { 0x7fefffffffffffffULL, 0x3ff0000000000000ULL, 0x7c90000000000000ULL,
+     { 0x7ff0000000000000ULL, 0x7fefffffffffffffULL,
+       0x7ff0000000000000ULL, 0x7fefffffffffffffULL } },
+   /* DBL_MAX + under half ulp */
+   { 0x7fefffffffffffffULL, 0x3ff0000000000000ULL, 0x7c8fffffffffffffULL,
+     { 0x7fefffffffffffffULL, 0x7fefffffffffffffULL,
+       0x7ff0000000000000ULL, 0x7fefffffffffffffULL } },
+   /* DBL_MAX exactly */
+   { 0x7fefffffffffffffULL, 0x3fe0000000000000ULL, 0x7fdfffffffffffffULL,
+     { 0x7fefffffffffffffULL, 0x7fefffffffffffffULL,
+       0x7fefffffffffffffULL, 0x7fefffffffffffffULL } },
+   /* near DBL_MAX, rounding */
+   { 0x5fefffffffffffffULL, 0x5fefffffffffffffULL, 0x7c90000000000000ULL,
+     { 0x7fefffffffffffffULL, 0x7feffffffffffffeULL,
+       0x7fefffffffffffffULL, 0x7feffffffffffffeULL } },
+   /* product overflows */
+   { 0x7e70000000000000ULL, 0x4630000000000000ULL, 0x8170000000000000ULL,
+     { 0x7ff0000000000000ULL, 0x7fefffffffffffffULL,
+       0x7ff0000000000000ULL, 0x7fefffffffffffffULL } },
+   /* -DBL_MAX - ulp */
+   { 0x7fefffffffffffffULL, 0xbff0000000000000ULL, 0xfca0000000000000ULL,
+     { 0xfff0000000000000ULL, 0xffefffffffffffffULL,
+       0xffefffffffffffffULL, 0xfff0000000000000ULL } },
+   /* product just under 2^1024 */
+   { 0x7fe0000000000001ULL, 0x3ffffffffffffffeULL, 0xfc90000000000000ULL,
+     { 0x7fefffffffffffffULL, 0x7fefffffffffffffULL,
+       0x7ff0000000000000ULL, 0x7fefffffffffffffULL } },
+   /* cancellation at DBL_MAX */
+   { 0xffefffffffffffffULL, 0x3ff0000000000001ULL, 0x7fefffffffffffffULL,
+     { 0xfcafffffffffffffULL, 0xfcafffffffffffffULL,
+       0xfcafffffffffffffULL, 0xfcafffffffffffffULL } },
+   /* gap: 1 + 2^-200 */
+   { 0x3ff0000000000000ULL, 0x3ff0000000000000ULL, 0x3370000000000000ULL,
+     { 0x3ff0000000000000ULL, 0x3ff0000000000000ULL,
+       0x3ff0000000000001ULL, 0x3ff0000000000000ULL } },
+   /* gap: 2^1000 - tiny */
+   { 0x6570000000000000ULL, 0x58f0000000000000ULL, 0x8170000000000000ULL,
+     { 0x7e70000000000000ULL, 0x7e6fffffffffffffULL,
+       0x7e70000000000000ULL, 0x7e6fffffffffffffULL } },
+   /* gap: tiny product + 1 */
+   { 0x1a70000000000000ULL, 0x26f0000000000000ULL, 0x3ff0000000000000ULL,
+     { 0x3ff0000000000000ULL, 0x3ff0000000000000ULL,
+       0x3ff0000000000001ULL, 0x3ff0000000000000ULL } },
+   /* gap: 1 - tiny product */
+   { 0x1a70000000000000ULL, 0xa6f0000000000000ULL, 0x3ff0000000000000ULL,
+     { 0x3ff0000000000000ULL, 0x3fefffffffffffffULL,
+       0x3ff0000000000000ULL, 0x3fefffffffffffffULL } },
+   /* gap: z = DBL_TRUE_MIN */
+   { 0x7e7fffffffffffffULL, 0x0170000000000000ULL, 0x0000000000000001ULL,
+     { 0x3fffffffffffffffULL, 0x3fffffffffffffffULL,
+       0x4000000000000000ULL, 0x3fffffffffffffffULL } },
+   /* gap: huge z, subnormal product */
+   { 0x3ff8000000000000ULL, 0x0000000000004000ULL, 0x7e70000000000000ULL,
+     { 0x7e70000000000000ULL, 0x7e70000000000000ULL,
+       0x7e70000000000001ULL, 0x7e70000000000000ULL } },
+   /* gap: huge z, negative subnormal product */
+   { 0xbff8000000000000ULL, 0x0000000000004000ULL, 0x7e70000000000000ULL,
+     { 0x7e70000000000000ULL, 0x7e6fffffffffffffULL,
+       0x7e70000000000000ULL, 0x7e6fffffffffffffULL } },
+   /* gap: huge z, product below DBL_MIN */
+   { 0x3f10000000000002ULL, 0x0060fc7a6bb0b6c7ULL, 0xfec9cb984d20c886ULL,
+     { 0xfec9cb984d20c886ULL, 0xfec9cb984d20c885ULL,
+       0xfec9cb984d20c885ULL, 0xfec9cb984d20c886ULL } },
+};
+
+static const struct { UInt x, y, z, want[4]; } vecs32[] = {
+   /* subnormal product, z zero */
+   { 0x1a000000, 0x1c800000, 0x00000000,
+     { 0x00000010, 0x00000010, 0x00000010, 0x00000010 } },
+   /* subnormal: 2.5 ulps, a tie */
+   { 0x1a400000, 0x1a800000, 0x00000001,
+     { 0x00000002, 0x00000002, 0x00000003, 0x00000002 } },
+   /* underflow: just under -FLT_TRUE_MIN */
+   { 0x0d800000, 0x21800000, 0x80000001,
+     { 0x80000001, 0x80000000, 0x80000000, 0x80000001 } },
+   /* FLT_MAX + half ulp, a tie */
+   { 0x7f7fffff, 0x3f800000, 0x73000000,
+     { 0x7f800000, 0x7f7fffff, 0x7f800000, 0x7f7fffff } },
+   /* gap: 1 + 2^-100 */
+   { 0x3f800000, 0x3f800000, 0x0d800000,
+     { 0x3f800000, 0x3f800000, 0x3f800001, 0x3f800000 } },
+   /* gap: 2^127 - tiny */
+   { 0x71800000, 0x4d000000, 0x8d800000,
+     { 0x7f000000, 0x7effffff, 0x7f000000, 0x7effffff } },
+};
+
+#define N_VECS(v) ((int)(sizeof(v) / sizeof((v)[0])))
+
+int main ( void )
+{
+   int    i, m, n_modes, n_bad = 0;
+   Double x, y, z, r;
+   Float  fx, fy, fz, fr;
+   ULong  got;
+   UInt   got32;
+
+#  if !defined(__FLT_EVAL_METHOD__) || __FLT_EVAL_METHOD__ != 0
+   /* The helpers fall back to an unfused x * y + z. */
+   printf("maddf: not fused with this compiler's evaluation method, "
+          "skipped\n");
+   return 0;
+#  endif
+   /* Elsewhere the helpers assume the host rounds to nearest, as it
+      does when generated code calls them. */
+#  if defined(__x86_64__) || defined(__i386__)
+   n_modes = 4;
+#  else
+   n_modes = 1;
+#  endif
+
+   for (m = 0; m < n_modes; m++) {
+      for (i = 0; i < N_VECS(vecs64); i++) {
+         memcpy(&x, &vecs64[i].x, 8);
+         memcpy(&y, &vecs64[i].y, 8);
+         memcpy(&z, &vecs64[i].z, 8);
+         fesetround(modes[m]);
+         h_generic_calc_MAddF64(&r, &x, &y, &z);
+         fesetround(FE_TONEAREST);
+         memcpy(&got, &r, 8);
+         if (got != vecs64[i].want[m]) {
+            printf("maddf: F64 %s vector %d: got 0x%016llx, "
+                   "want 0x%016llx\n",
+                   mode_names[m], i, got, vecs64[i].want[m]);
+            n_bad++;
+         }
+      }
+      for (i = 0; i < N_VECS(vecs32); i++) {
+         memcpy(&fx, &vecs32[i].x, 4);
+         memcpy(&fy, &vecs32[i].y, 4);
+         memcpy(&fz, &vecs32[i].z, 4);
+         fesetround(modes[m]);
+         h_generic_calc_MAddF32(&fr, &fx, &fy, &fz);
+         fesetround(FE_TONEAREST);
+         memcpy(&got32, &fr, 4);
+         if (got32 != vecs32[i].want[m]) {
+            printf("maddf: F32 %s vector %d: got 0x%08x, want 0x%08x\n",
+                   mode_names[m], i, got32, vecs32[i].want[m]);
+            n_bad++;
+         }
+      }
+   }
+   printf("maddf: %d vectors in %d rounding modes, %d mismatches\n",
+          N_VECS(vecs64) + N_VECS(vecs32), n_modes, n_bad);
+   return n_bad != 0;
+}
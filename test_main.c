@@ -37,6 +37,8 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "libvex_basictypes.h"
 #include "libvex.h"
@@ -90,6 +92,183 @@ static Bool chase_into_not_ok ( void* opaque, Addr64 dst ) {
 static UInt needs_self_check ( void* opaque, VexGuestExtents* vge ) {
    return 0;
 }
+/* A trace only resteers to the next address on its path, and the
+   .orig file puts all of those inside the block's own bytes. */
+static Bool chase_into_trace ( void* opaque, Addr64 dst ) {
+   return True;
+}
+
+/* The extents of the translation vta made, whichever kind it was. */
+static void get_extents ( const VexTranslateArgs* vta,
+                          VexGuestTraceExtents* vge ) {
+   UInt i;
+   if (vta->trace_len > 0) {
+      *vge = *(vta->trace_extents);
+      return;
+   }
+   memset(vge, 0, sizeof(*vge));
+   vge->n_used = vta->guest_extents->n_used;
+   for (i = 0; i < vge->n_used; i++) {
+      vge->base[i] = vta->guest_extents->base[i];
+      vge->len[i]  = vta->guest_extents->len[i];
+   }
+}
+
+static UInt guest_len ( const VexGuestTraceExtents* vge ) {
+   UInt i, len = 0;
+   for (i = 0; i < vge->n_used; i++)
+      len += vge->len[i];
+   return len;
+}
+
+static double now_ms ( void ) {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+/* For --jobs=N: every block is read in first, with its own copy of
+   the guest bytes and its own output buffer, and then they are all
+   translated with LibVEX_TranslateBatch. */
+typedef
+   struct {
+      Int    bb_number;
+      Addr32 orig_addr;
+      Int    orig_nbytes;
+      UChar* origbuf;
+      UChar  transbuf[N_TRANSBUF];
+      Int    trans_used;
+      VexGuestExtents vge;
+      VexGuestTraceExtents tvge;
+      Addr64 trace[VEX_MAX_TRACE_EXTENTS];
+   }
+   BatchBlock;
+
+static void (*batch_fn) ( void* );
+
+static void* batch_thread ( void* arg ) {
+   batch_fn(arg);
+   return NULL;
+}
+
+static void run_workers_pthreads ( void (*fn)( void* ), void** args,
+                                   Int n_workers ) {
+   pthread_t th[64];
+   Int w;
+   assert(n_workers <= 64);
+   batch_fn = fn;
+   for (w = 0; w < n_workers; w++)
+      assert(0 == pthread_create(&th[w], NULL, batch_thread, args[w]));
+   for (w = 0; w < n_workers; w++)
+      assert(0 == pthread_join(th[w], NULL));
+}
+
+/* For --cache: each block is translated with LibVEX_TranslateCached,
+   and then looked up again through a second VexTransCache on the same
+   area, as a later process which mapped the same cache file would,
+   but with the dispatcher somewhere else.  That has to hit, and give
+   back exactly what translating afresh in that process gives.  A
+   lookup in the first process again must give back what it first
+   made. */
+#define N_TC_AREA     (16 * 1024 * 1024)
+#define TC_CLIENT_ID  0x6E69616D5F747365ULL
+#define N_CHAIN_SITES 64
+
+static VexTransCache tcache;
+static UChar*        tc_area;
+
+typedef
+   struct {
+      UChar  bytes[N_TRANSBUF];
+      Int    used;
+      VexGuestTraceExtents vge;
+      Int    sites[N_CHAIN_SITES];
+      Int    n_sites;
+      VexTranslateResult tres;
+   }
+   TransCopy;
+
+static void take_copy ( TransCopy* c, const VexTranslateArgs* vta,
+                        VexTranslateResult tres ) {
+   assert(tres.status == VexTransOK);
+   c->used = *(vta->host_bytes_used);
+   memcpy(c->bytes, vta->host_bytes, c->used);
+   get_extents(vta, &c->vge);
+   c->n_sites = *(vta->n_chain_sites);
+   assert(c->n_sites >= 0 && c->n_sites <= N_CHAIN_SITES);
+   memcpy(c->sites, vta->chain_sites, c->n_sites * sizeof(Int));
+   c->tres = tres;
+}
+
+static void check_same ( const TransCopy* a, const TransCopy* b ) {
+   UInt i;
+   assert(a->tres.n_sc_extents == b->tres.n_sc_extents);
+   assert(a->tres.offs_profInc == b->tres.offs_profInc);
+   assert(a->tres.n_guest_instrs == b->tres.n_guest_instrs);
+   assert(a->used == b->used);
+   assert(0 == memcmp(a->bytes, b->bytes, a->used));
+   assert(a->vge.n_used == b->vge.n_used);
+   for (i = 0; i < a->vge.n_used; i++) {
+      assert(a->vge.base[i] == b->vge.base[i]);
+      assert(a->vge.len[i] == b->vge.len[i]);
+   }
+   assert(a->n_sites == b->n_sites);
+   assert(0 == memcmp(a->sites, b->sites, a->n_sites * sizeof(Int)));
+}
+
+static VexTranslateResult translate_round_trip ( VexTranslateArgs* vta )
+{
+   static TransCopy   first, again, fresh;
+   VexTranslateArgs   moved;
+   VexTransCache      tc2;
+   VexTranslateResult tres;
+   Int                i;
+
+   tres = LibVEX_TranslateCached(&tcache, vta);
+   if (tres.status != VexTransOK)
+      return tres;
+   take_copy(&first, vta, tres);
+   for (i = 0; i < first.n_sites; i++)
+      assert(*(ULong*)&first.bytes[first.sites[i] + 2]
+             == (ULong)(HWord)vta->disp_cp_chain_me_to_slowEP
+             || *(ULong*)&first.bytes[first.sites[i] + 2]
+                == (ULong)(HWord)vta->disp_cp_chain_me_to_fastEP);
+
+   moved = *vta;
+   moved.disp_cp_chain_me_to_slowEP = (void*)(HWord)0x7F0012345678ULL;
+   moved.disp_cp_chain_me_to_fastEP = (void*)(HWord)0x7F0012345679ULL;
+   moved.disp_cp_xindir             = (void*)(HWord)0x2234567AULL;
+   moved.disp_cp_xassisted          = (void*)(HWord)0x7F001234567BULL;
+   take_copy(&fresh, &moved, LibVEX_Translate(&moved));
+
+   LibVEX_InitTransCache(&tc2, tc_area, N_TC_AREA, TC_CLIENT_ID);
+   memset(vta->host_bytes, 0, vta->host_bytes_size);
+   take_copy(&again, &moved, LibVEX_TranslateCached(&tc2, &moved));
+   assert(tc2.n_hits == 1);
+   check_same(&again, &fresh);
+
+   memset(vta->host_bytes, 0, vta->host_bytes_size);
+   tres = LibVEX_TranslateCached(&tcache, vta);
+   take_copy(&again, vta, tres);
+   check_same(&again, &first);
+   return tres;
+}
+
+static void add_stats ( VexTranslateStats* acc, const VexTranslateStats* s )
+{
+   Int i;
+   acc->calls[VexPhaseRegAlloc]  += s->calls[VexPhaseRegAlloc];
+   acc->cycles[VexPhaseRegAlloc] += s->cycles[VexPhaseRegAlloc];
+   acc->n_spills         += s->n_spills;
+   acc->n_reloads        += s->n_reloads;
+   acc->n_direct_reloads += s->n_direct_reloads;
+   acc->n_host_instrs    += s->n_host_instrs;
+   acc->n_host_bytes     += s->n_host_bytes;
+   acc->n_guest_bytes    += s->n_guest_bytes;
+   for (i = 0; i < VexPeep_N; i++)
+      acc->n_peephole[i] += s->n_peephole[i];
+   acc->n_self_loops     += s->n_self_loops;
+}
 
 int main ( int argc, char** argv )
 {
@@ -102,12 +281,47 @@ int main ( int argc, char** argv )
    VexTranslateResult tres;
    VexControl vcon;
    VexGuestExtents vge;
+   VexGuestTraceExtents tvge;
+   Int chain_sites[N_CHAIN_SITES], n_chain_sites;
    VexArchInfo vai_x86, vai_amd64, vai_ppc32, vai_arm;
    VexAbiInfo vbi;
    VexTranslateArgs vta;
-
-   if (argc != 2) {
-      fprintf(stderr, "usage: vex file.orig\n");
+   VexTranslateStats vts;
+   Int unroll_thresh = -1;
+   Int n_jobs = 0;
+   Bool use_cache = False;
+   Bool use_hoist = False;
+   UInt trace_offs[VEX_MAX_TRACE_EXTENTS];
+   Addr64 trace[VEX_MAX_TRACE_EXTENTS];
+   UInt trace_len;
+   Int pos, pos1;
+   BatchBlock* blocks = NULL;
+   VexTranslateArgs* b_vtas = NULL;
+   Int n_blocks = 0, n_blocks_max = 0;
+   double t_start;
+
+   while (argc > 2 && 0 == strncmp(argv[1], "--", 2)) {
+      if (0 == strncmp(argv[1], "--unroll=", 9))
+         unroll_thresh = atoi(argv[1] + 9);
+      else if (0 == strncmp(argv[1], "--jobs=", 7))
+         n_jobs = atoi(argv[1] + 7);
+      else if (0 == strcmp(argv[1], "--cache"))
+         use_cache = True;
+      else if (0 == strcmp(argv[1], "--hoist"))
+         use_hoist = True;
+      else
+         break;
+      argc--; argv++;
+   }
+   if (argc != 2 || n_jobs < 0 || n_jobs > 64
+       || (use_cache && n_jobs > 0)) {
+      fprintf(stderr, "usage: vex [--unroll=N] [--hoist] "
+                      "[--jobs=1..64 | --cache] file.orig\n");
+      exit(1);
+   }
+   /* Traced translations bypass the cache. */
+   if (use_cache && (TEST_FLAGS) != 0) {
+      fprintf(stderr, "vex: --cache needs a run with TEST_FLAGS == 0\n");
       exit(1);
    }
    f = fopen(argv[1], "r");
@@ -124,12 +338,22 @@ int main ( int argc, char** argv )
    LibVEX_default_VexControl ( &vcon );
    vcon.iropt_level = 2;
    vcon.guest_max_insns = 60;
+   if (unroll_thresh >= 0)
+      vcon.iropt_unroll_thresh = unroll_thresh;
+   vcon.iropt_loop_hoist = use_hoist;
 
    LibVEX_Init ( &failure_exit, &log_bytes, 
                  1,  /* debug_paranoia */ 
                  TEST_VSUPPORT, /* valgrind support */
                  &vcon );
 
+   if (use_cache) {
+      tc_area = calloc(1, N_TC_AREA);
+      assert(tc_area);
+      LibVEX_InitTransCache(&tcache, tc_area, N_TC_AREA, TC_CLIENT_ID);
+   }
+
+   t_start = now_ms();
 
    while (!feof(f)) {
 
@@ -141,18 +365,31 @@ int main ( int argc, char** argv )
       if (n_bbs_done == TEST_N_BBS) break;
       n_bbs_done++;
 
-      /* first line is:   . bb-number bb-addr n-bytes */
-      assert(3 == sscanf(&linebuf[1], " %d %x %d\n", 
+      /* first line is:   . bb-number bb-addr n-bytes [offs ...]
+         If there are any offs, the block is translated as a trace
+         (see VexTranslateArgs.trace) whose path goes on to the given
+         offsets from bb-addr, in order.  Each step must be a taken
+         branch or jump, so that it makes an extent of its own. */
+      assert(3 == sscanf(&linebuf[1], " %d %x %d%n",
                                  & bb_number,
-                                 & orig_addr, & orig_nbytes ));
+                                 & orig_addr, & orig_nbytes, &pos ));
       assert(orig_nbytes >= 1);
+      trace_offs[0] = 0;
+      trace_len = 1;
+      while (1 == sscanf(&linebuf[1 + pos], " %x%n", &u, &pos1)) {
+         assert(trace_len < VEX_MAX_TRACE_EXTENTS);
+         trace_offs[trace_len++] = u;
+         pos += pos1;
+      }
+      if (trace_len == 1)
+         trace_len = 0;
       assert(!feof(f));
       __attribute__((unused))
       char* unused2 = fgets(linebuf, N_LINEBUF,f);
       assert(linebuf[0] == '.');
 
       /* second line is:   . byte byte byte etc */
-      if (verbose)
+      if (verbose && n_jobs == 0)
          printf("============ Basic Block %d, Done %d, "
                 "Start %x, nbytes %2d ============", 
                 bb_number, n_bbs_done-1, orig_addr, orig_nbytes);
@@ -193,30 +430,38 @@ int main ( int argc, char** argv )
       vta.guest_bytes_addr = (Addr64)orig_addr;
       vta.callback_opaque = NULL;
       vta.chase_into_ok   = chase_into_not_ok;
+      vta.trace           = NULL;
+      vta.trace_len       = 0;
       vta.guest_extents   = &vge;
+      vta.trace_extents   = &tvge;
       vta.host_bytes      = transbuf;
       vta.host_bytes_size = N_TRANSBUF;
       vta.host_bytes_used = &trans_used;
+      vta.chain_sites      = chain_sites;
+      vta.chain_sites_size = N_CHAIN_SITES;
+      vta.n_chain_sites    = &n_chain_sites;
 
-#if 0 /* ppc32 -> ppc32 */
+      /* Defining TEST_ARCH_AMD64 selects amd64 -> amd64 whatever is
+         enabled below, as the bench targets in Makefile-gcc do. */
+#if 0 && !defined(TEST_ARCH_AMD64) /* ppc32 -> ppc32 */
       vta.arch_guest     = VexArchPPC32;
       vta.archinfo_guest = vai_ppc32;
       vta.arch_host      = VexArchPPC32;
       vta.archinfo_host  = vai_ppc32;
 #endif
-#if 0 /* amd64 -> amd64 */
+#if 0 || defined(TEST_ARCH_AMD64) /* amd64 -> amd64 */
       vta.arch_guest     = VexArchAMD64;
       vta.archinfo_guest = vai_amd64;
       vta.arch_host      = VexArchAMD64;
       vta.archinfo_host  = vai_amd64;
 #endif
-#if 0 /* x86 -> x86 */
+#if 0 && !defined(TEST_ARCH_AMD64) /* x86 -> x86 */
       vta.arch_guest     = VexArchX86;
       vta.archinfo_guest = vai_x86;
       vta.arch_host      = VexArchX86;
       vta.archinfo_host  = vai_x86;
 #endif
-#if 1 /* arm -> arm */
+#if 1 && !defined(TEST_ARCH_AMD64) /* arm -> arm */
       vta.arch_guest     = VexArchARM;
       vta.archinfo_guest = vai_arm;
       vta.arch_host      = VexArchARM;
@@ -227,6 +472,13 @@ int main ( int argc, char** argv )
       vta.guest_bytes_addr = (Addr64)(&origbuf[18 +1]);
 #endif
 
+      for (u = 0; u < trace_len; u++)
+         trace[u] = vta.guest_bytes_addr + trace_offs[u];
+      vta.trace     = trace_len > 0 ? trace : NULL;
+      vta.trace_len = trace_len;
+      if (trace_len > 0)
+         vta.chase_into_ok = chase_into_trace;
+
 #if 1 /* no instrumentation */
       vta.instrument1     = NULL;
       vta.instrument2     = NULL;
@@ -248,30 +500,140 @@ int main ( int argc, char** argv )
       vta.disp_cp_chain_me_to_slowEP = (void*)0x12345678;
       vta.disp_cp_chain_me_to_fastEP = (void*)0x12345679;
       vta.disp_cp_xindir             = (void*)0x1234567A;
+      vta.disp_cp_xindir_miss        = NULL;
       vta.disp_cp_xassisted          = (void*)0x1234567B;
 
       vta.finaltidy = NULL;
 
+      if (n_jobs > 0) {
+         BatchBlock* b;
+         if (n_blocks == n_blocks_max) {
+            n_blocks_max = n_blocks_max ? 2 * n_blocks_max : 256;
+            blocks = realloc(blocks, n_blocks_max * sizeof(BatchBlock));
+            b_vtas = realloc(b_vtas, n_blocks_max * sizeof(VexTranslateArgs));
+            assert(blocks && b_vtas);
+         }
+         b = &blocks[n_blocks];
+         b->bb_number   = bb_number;
+         b->orig_addr   = orig_addr;
+         b->orig_nbytes = orig_nbytes;
+         b->origbuf     = malloc(N_ORIGBUF);
+         assert(b->origbuf);
+         memcpy(b->origbuf, origbuf, N_ORIGBUF);
+         memcpy(b->trace, trace, sizeof(trace));
+         /* Read from the private copy but keep guest_bytes_addr as
+            is, so the guest PCs baked into the code match serial mode. */
+         vta.guest_bytes = b->origbuf + (vta.guest_bytes - origbuf);
+         b_vtas[n_blocks] = vta;
+         n_blocks++;
+         continue;
+      }
+
       for (i = 0; i < TEST_N_ITERS; i++)
-         tres = LibVEX_Translate ( &vta );
+         tres = use_cache ? translate_round_trip ( &vta )
+                          : LibVEX_Translate ( &vta );
 
       if (tres.status != VexTransOK)
          printf("\ntres = %d\n", (Int)tres.status);
       assert(tres.status == VexTransOK);
       assert(tres.n_sc_extents == 0);
-      assert(vge.n_used == 1);
-      assert((UInt)(vge.len[0]) == orig_nbytes);
+      get_extents(&vta, &tvge);
+      assert(tvge.n_used == (trace_len > 0 ? trace_len : 1));
+      assert(guest_len(&tvge) == orig_nbytes);
 
       sum = 0;
       for (i = 0; i < trans_used; i++)
          sum += (UInt)transbuf[i];
+      u = guest_len(&tvge);
       printf ( " %6.2f ... %u\n", 
-               (double)trans_used / (double)vge.len[0], sum );
+               (double)trans_used / (double)u, sum );
    }
 
    fclose(f);
-   printf("\n");
+
+   if (n_jobs > 0) {
+      VexTranslateContext ctxs[64];
+      VexTranslateResult* results = malloc(n_blocks * sizeof(VexTranslateResult));
+      assert(results);
+      for (i = 0; i < n_jobs; i++) {
+         HChar* area = malloc(5000000);
+         assert(area);
+         LibVEX_InitTranslateContext(&ctxs[i], &vcon, area, 5000000);
+      }
+      /* The stash may have moved whilst it grew, so only now can the
+         per-block pointers be filled in. */
+      for (i = 0; i < n_blocks; i++) {
+         b_vtas[i].guest_extents   = &blocks[i].vge;
+         b_vtas[i].trace_extents   = &blocks[i].tvge;
+         b_vtas[i].host_bytes      = blocks[i].transbuf;
+         b_vtas[i].host_bytes_used = &blocks[i].trans_used;
+         b_vtas[i].n_chain_sites   = NULL;
+         if (b_vtas[i].trace_len > 0)
+            b_vtas[i].trace = blocks[i].trace;
+      }
+      t_start = now_ms();
+      LibVEX_TranslateBatch(ctxs, n_jobs, b_vtas, results, n_blocks,
+                            run_workers_pthreads);
+      for (i = 0; i < n_blocks; i++) {
+         BatchBlock* b = &blocks[i];
+         assert(results[i].status == VexTransOK);
+         assert(results[i].n_sc_extents == 0);
+         get_extents(&b_vtas[i], &tvge);
+         assert(tvge.n_used == (b_vtas[i].trace_len > 0
+                                ? b_vtas[i].trace_len : 1));
+         assert(guest_len(&tvge) == b->orig_nbytes);
+         sum = 0;
+         for (u = 0; u < b->trans_used; u++)
+            sum += (UInt)b->transbuf[u];
+         u = guest_len(&tvge);
+         if (verbose)
+            printf("============ Basic Block %d, Done %d, "
+                   "Start %x, nbytes %2d ============",
+                   b->bb_number, i, b->orig_addr,
+                   b->orig_nbytes);
+         printf ( " %6.2f ... %u\n",
+                  (double)b->trans_used / (double)u, sum );
+      }
+      printf("\n");
+      printf("batch: %d blocks, %d jobs, %.1f ms\n",
+             n_blocks, n_jobs, now_ms() - t_start);
+      memset(&vts, 0, sizeof(vts));
+      for (i = 0; i < n_jobs; i++) {
+         VexTranslateStats s1;
+         LibVEX_GetTranslateStats(&ctxs[i], &s1);
+         add_stats(&vts, &s1);
+      }
+   } else {
+      printf("\n");
+      printf("serial: %d blocks, %.1f ms\n",
+             n_bbs_done, now_ms() - t_start);
+      LibVEX_GetTranslateStats(NULL, &vts);
+   }
+
    LibVEX_ShowAllocStats();
+   if (use_cache)
+      LibVEX_ShowTransCacheStats(&tcache);
+
+   /* Register allocator cost; see the regalloc-bench target in
+      Makefile-gcc. */
+   printf("regalloc: %llu calls, %llu cycles, %llu spills, "
+          "%llu reloads (%llu direct), %llu host insns, %llu bytes\n",
+          vts.calls[VexPhaseRegAlloc],
+          vts.cycles[VexPhaseRegAlloc], vts.n_spills, vts.n_reloads,
+          vts.n_direct_reloads, vts.n_host_instrs, vts.n_host_bytes);
+   printf("peephole: %llu self-moves, %llu moves back, "
+          "%llu store-reloads, %llu load-stores\n",
+          vts.n_peephole[VexPeepSelfMove], vts.n_peephole[VexPeepMoveBack],
+          vts.n_peephole[VexPeepStoreReload],
+          vts.n_peephole[VexPeepLoadStore]);
+   printf("loops: %llu translations loop within themselves\n",
+          vts.n_self_loops);
+   /* Over all blocks, in the format of the per-block trace line; see
+      the expansion-bench target in Makefile-gcc. */
+   printf("VexExpansionRatio %llu %llu   %llu :10\n",
+          vts.n_guest_bytes, vts.n_host_bytes,
+          (10 * vts.n_host_bytes) / (vts.n_guest_bytes == 0
+                                     ? 1 : vts.n_guest_bytes));
 
    return 0;
 }
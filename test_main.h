@@ -1,8 +1,10 @@
 
-/* Copy this file (test_main.h.in) to test_main.h, and edit */
+/* Copy this file (test_main.h.in) to test_main.h, and edit.
+   Defining TEST_RUN_CHECKING on the command line selects the
+   checking run regardless, as the bench targets in Makefile-gcc do. */
 
 /* DEBUG RUN, ON V */
-#if 1
+#if 1 && !defined(TEST_RUN_CHECKING)
 #define TEST_VSUPPORT  True
 #define TEST_N_ITERS   1
 #define TEST_N_BBS     1
@@ -10,7 +12,7 @@
 #endif
 
 /* CHECKING RUN, ON V */
-#if 0
+#if 0 || defined(TEST_RUN_CHECKING)
 #define TEST_VSUPPORT  True
 #define TEST_N_ITERS   1
 #define TEST_N_BBS     100000